@@ -40,6 +40,7 @@
 #include "resip/stack/InteropHelper.hxx"
 #include "resip/stack/ConnectionManager.hxx"
 #include "resip/stack/TransactionState.hxx"
+#include "resip/stack/UdpTransport.hxx"
 #include "resip/stack/WsCookieContextFactory.hxx"
 
 #include "resip/dum/InMemorySyncRegDb.hxx"
@@ -331,6 +332,14 @@ ReproRunner::run(int argc, char** argv)
                    mProxyConfig->getConfigData("LogFilename", "repro.log", true).c_str(),
                    isEqualNoCase(loggingType, "file") ? &g_ReproLogger : 0, // if logging to file then write WARNINGS, and Errors to console still
                    syslogFacilityName);
+   if(mProxyConfig->getConfigBool("LoggingAsync", false))
+   {
+      Log::startAsyncWriter(mProxyConfig->getConfigUnsignedLong("LoggingAsyncQueueSize", 4096));
+   }
+   else
+   {
+      Log::stopAsyncWriter();
+   }
 
    InfoLog( << "Starting repro version " << VersionUtils::instance().releaseVersion() << "...");
 
@@ -511,6 +520,7 @@ ReproRunner::shutdown()
    mSipStack->setCongestionManager(0);
 
    cleanupObjects();
+   Log::stopAsyncWriter();
    mRunning = false;
 }
 
@@ -737,6 +747,10 @@ ReproRunner::createSipStack()
    {
       security->addCAFile(caFile);
    }
+   security->setTlsSessionCache(mProxyConfig->getConfigUnsignedLong("TLSSessionCacheSize", 20480),
+                                mProxyConfig->getConfigInt("TLSSessionLifetime", 300));
+   security->setTlsSessionTickets(mProxyConfig->getConfigInt("TLSTicketKeyRotation", 3600));
+   security->setTlsClientSessionReuse(mProxyConfig->getConfigBool("TLSClientSessionReuse", true));
 #endif
 
 #ifdef USE_SIGCOMP
@@ -805,6 +819,14 @@ ReproRunner::createSipStack()
       mSipStack->setEnumDomains(enumDomains);
    }
 
+   // Restore, and keep saving, the DNS cache across restarts - if enabled
+   Data dnsCacheSnapshotFile;
+   mProxyConfig->getConfigValue("DNSCacheSnapshotFile", dnsCacheSnapshotFile);
+   if(!dnsCacheSnapshotFile.empty())
+   {
+      mSipStack->setDnsCacheSnapshot(dnsCacheSnapshotFile, mProxyConfig->getConfigUnsignedLong("DNSCacheSnapshotInterval", 60));
+   }
+
    // Add External Stats handler
    mSipStack->setExternalStatsHandler(this);
 
@@ -854,6 +876,10 @@ ReproRunner::createSipStack()
       ConnectionManager::MinimumGcAge = tcpConnectionGCAge * 1000;
       ConnectionManager::EnableAgressiveGc = true;
    }
+   ConnectionManager::setIdleTimeout(TCP, mProxyConfig->getConfigUnsignedLong("TCPIdleTimeout", 0) * 1000);
+   ConnectionManager::setIdleTimeout(TLS, mProxyConfig->getConfigUnsignedLong("TLSIdleTimeout", 0) * 1000);
+   ConnectionManager::setIdleTimeout(WS, mProxyConfig->getConfigUnsignedLong("WSIdleTimeout", 0) * 1000);
+   ConnectionManager::setIdleTimeout(WSS, mProxyConfig->getConfigUnsignedLong("WSSIdleTimeout", 0) * 1000);
    unsigned long outboundFlowTimer = mProxyConfig->getConfigUnsignedLong("FlowTimer", 0);
    if(outboundFlowTimer > 0)
    {
@@ -1663,6 +1689,8 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
          // Transport1TlsClientVerification = None
          // Transport1RecordRouteUri = sip:sipdomain.com;transport=TLS
          // Transport1RcvBufLen = 2000
+         // Transport1BatchSize = 32
+         // Transport1RxShards = 4
 
          allTransportsSpecifyRecordRoute = true;
 
@@ -1734,6 +1762,13 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
                }
 #endif
 
+               int rxShards = tc.getConfigInt("RxShards", 0);
+               if (rxShards > 1 && tt != UDP)
+               {
+                  WarningLog(<< "Ignoring RxShards for non-UDP transport " << ipAddr << ":" << port);
+                  rxShards = 0;
+               }
+
                Transport *t = mSipStack->addTransport(tt,
                                  port,
                                  DnsUtil::isIpV6Address(ipAddr) ? V6 : V4,
@@ -1742,7 +1777,7 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
                                  tlsDomain,
                                  tlsPrivateKeyPassPhrase,  // private key passphrase
                                  sslType, // sslType
-                                 0,            // transport flags
+                                 rxShards > 1 ? RESIP_TRANSPORT_FLAG_REUSEPORT : 0, // transport flags
                                  tlsCertificate, tlsPrivateKey,
                                  cvm,          // tls client verification mode
                                  useEmailAsSIP,
@@ -1762,6 +1797,25 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
 #endif
                   }
 
+                  int batchSize = tc.getConfigInt("BatchSize", 0);
+                  if (batchSize > 0)
+                  {
+                     t->setBatchSize(batchSize);
+                  }
+
+                  if (rxShards > 1)
+                  {
+                     UdpTransport* udp = dynamic_cast<UdpTransport*>(t);
+                     resip_assert(udp);
+                     // give each receive thread its own transaction shard
+                     std::vector<Fifo<TransactionMessage>*> fifos;
+                     for (unsigned int s = 0; s < mSipStack->getNumTransactionControllerShards(); ++s)
+                     {
+                        fifos.push_back(&mSipStack->stateMacFifo(s));
+                     }
+                     udp->setRxShards(rxShards, fifos);
+                  }
+
                   Data recordRouteUri = tc.getConfigData("RecordRouteUri", Data::Empty);
                   if(!recordRouteUri.empty())
                   {
@@ -1,13 +1,11 @@
 #ifndef resip_CancelableTimerQueue_hxx
 #define resip_CancelableTimerQueue_hxx
 
-#include <map>
 #include <limits.h>
 #include <iosfwd>
 
 #include "rutil/Timer.hxx"
-#include "rutil/HashMap.hxx"
-#include "rutil/Inserter.hxx"
+#include "rutil/TimerWheel.hxx"
 
 using namespace std;
 
@@ -18,45 +16,32 @@ template<class T>
 class CancelableTimerQueue
 {
     public:
-      CancelableTimerQueue() : mNextId(0) {};
+      CancelableTimerQueue() {};
       ~CancelableTimerQueue() {};
 
-      typedef long Id;
+      typedef TimerHandle Id;
    private:
-      typedef std::multimap< UInt64, std::pair<T, Id> > TimerMap;
-      typedef HashMap<Id, UInt64> IdToTimer;
+      class Entry
+      {
+         public:
+            Entry(const T& msg, UInt64 when) : mMsg(msg), mWhen(when) {}
+            UInt64 getWhen() const { return mWhen; }
+            T mMsg;
+            UInt64 mWhen;
+      };
+      typedef TimerWheel<Entry> TimerMap;
 
    public:
       Id addRelative(T msg,
                      unsigned int offset)
       {
-         return addTimer(msg, resip::Timer::getTimeMs() + offset);
+         return mTimerMap.add(Entry(msg, resip::Timer::getTimeMs() + offset));
       }
 
       //returns true if the id existed
       bool cancel(Id id)
       {
-         typename IdToTimer::iterator j = mIdToTimer.find(id);
-         if (j == mIdToTimer.end())
-         {
-            return false;
-         }
-         
-         for (typename TimerMap::iterator i = mTimerMap.lower_bound(j->second); i != mTimerMap.upper_bound(j->second); i++)
-         {
-            if (i->second.second == id)
-            {
-               mTimerMap.erase(i);
-               mIdToTimer.erase(j);
-               return true;
-            }
-         }
-         //cerr << "mIdToTimer: " << Inserter(mIdToTimer) << endl;
-         //cerr << "Searching for ID: " << id << endl;
-         //cerr << "TimerMap state: " << Inserter(mTimerMap) << endl;
-         resip_assert(mIdToTimer.size() == mTimerMap.size());
-         resip_assert(0);
-         return false;
+         return mTimerMap.cancel(id);
       }
 
       //get the number of milliseconds until the next event, returns -1 if no
@@ -69,7 +54,7 @@ class CancelableTimerQueue
          }
          else
          {
-            int timeout = (int)(mTimerMap.begin()->first - resip::Timer::getTimeMs());
+            int timeout = (int)(mTimerMap.nextExpiry() - resip::Timer::getTimeMs());
             if (timeout < 0)
             {
                return 0;
@@ -84,22 +69,18 @@ class CancelableTimerQueue
       bool available() const
       {
          return (!mTimerMap.empty() && 
-                 mTimerMap.begin()->first <= resip::Timer::getTimeMs());
+                 mTimerMap.nextExpiry() <= resip::Timer::getTimeMs());
       }
 
       T getNext()
       {
-         resip_assert(mIdToTimer.size() == mTimerMap.size());
-
          resip_assert(available());
 
-         typename TimerMap::iterator it = mTimerMap.begin();
-         mIdToTimer.erase(it->second.second);
+         Id id = mTimerMap.nextExpired(resip::Timer::getTimeMs());
+         resip_assert(id);
 
-         T msg = it->second.first;
-         mTimerMap.erase(it);
-
-         resip_assert(mIdToTimer.size() == mTimerMap.size());
+         T msg = mTimerMap.find(id)->mMsg;
+         mTimerMap.cancel(id);
          
          return msg;
       }
@@ -107,7 +88,6 @@ class CancelableTimerQueue
       void clear()
       {
          mTimerMap.clear();
-         mIdToTimer.clear();
       }
 
       bool empty() const
@@ -121,28 +101,6 @@ class CancelableTimerQueue
       }
 
    private:
-      
-      Id addTimer(T msg, UInt64 expiry)
-      {
-         Id id = getNextId();
-         mTimerMap.insert(std::make_pair(expiry, std::make_pair(msg, id)));
-         mIdToTimer[id] = expiry;
-         resip_assert(mIdToTimer.size() == mTimerMap.size());
-         return id;
-      }
-
-      Id getNextId()
-      {
-         mNextId++;
-         if (mNextId == INT_MAX)
-         {
-            mNextId = 1;
-         }
-         return mNextId;
-      }
-         
-      Id mNextId;
-      IdToTimer mIdToTimer;
       TimerMap mTimerMap;
 };
 
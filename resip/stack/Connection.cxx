@@ -36,6 +36,11 @@ Connection::Connection(Transport* transport,const Tuple& who, Socket socket,
                        bool isServer)
    : ConnectionBase(transport,who,compression),
      mFirstWriteAfterConnectedPending(false),
+     mPreparedSends(0),
+     mBytesWritten(0),
+     mWriteCalls(0),
+     mIdleDeadline(0),
+     mIdleSlot(0),
      mInWritable(false),
      mFlowTimerEnabled(false),
      mPollItemHandle(0),
@@ -58,6 +63,8 @@ Connection::Connection(Transport* transport,const Tuple& who, Socket socket,
 
 Connection::~Connection()
 {
+   DebugLog (<< "Connection::~Connection: " << mWho << " wrote " << mBytesWritten
+             << " bytes in " << mWriteCalls << " writes");
    if(mWho.mFlowKey && ConnectionBase::transport())
    {
       getConnectionManager().removeConnection(this);
@@ -81,6 +88,10 @@ Connection::removeFrontOutstandingSend()
 {
    delete mOutstandingSends.front();
    mOutstandingSends.pop_front();
+   if (mPreparedSends > 0)
+   {
+      --mPreparedSends;
+   }
 
    if (mOutstandingSends.empty())
    {
@@ -90,57 +101,10 @@ Connection::removeFrontOutstandingSend()
    }
 }
 
-int
-Connection::performWrite()
+void
+Connection::prepareSend(std::list<SendData*>::iterator send)
 {
-   if(transportWrite())
-   {
-      // If we get here it means:
-      // a. on a previous invocation, SSL_do_handshake wanted to write
-      //         (SSL_ERROR_WANT_WRITE)
-      // b. now the handshake is complete or it wants to read
-      if(mInWritable)
-      {
-         getConnectionManager().removeFromWritable(this);
-         mInWritable = false;
-      }
-      else
-      {
-         WarningLog(<<"performWrite invoked while not in write set");
-      }
-      return 0; // Q. What does this transportWrite() mean?
-                // A. It makes the TLS handshake move along after it
-                //    was waiting in the write set.
-   }
-
-   // If the TLS handshake returned SSL_ERROR_WANT_WRITE again
-   // then we could get here without really having something to write
-   // so just return, remaining in the write set.
-   if(mOutstandingSends.empty())
-   {
-      // FIXME: this needs to be more elaborate with respect
-      // to TLS handshaking but it doesn't appear we can do that
-      // without ABI breakage.
-      return 0;
-   }
-
-   switch(mOutstandingSends.front()->command)
-   {
-   case SendData::CloseConnection:
-      // .bwc. Close this connection.
-      return -1;
-      break;
-   case SendData::EnableFlowTimer:
-      enableFlowTimer();
-      removeFrontOutstandingSend();
-      return 0;
-      break;
-   default:
-      // do nothing
-      break;
-   }
-
-   const Data& sigcompId = mOutstandingSends.front()->sigcompId;
+   const Data& sigcompId = (*send)->sigcompId;
 
    if(mSendingTransmissionFormat == Unknown)
    {
@@ -159,42 +123,27 @@ Connection::performWrite()
    }
    else if(mSendingTransmissionFormat == WebSocketData)
    {
-      SendData *dataWs, *oldSd;
-      const Data& dataRaw = mOutstandingSends.front()->data;
-      UInt64 dataSize = 1 + 1 + dataRaw.size();
-      UInt64 lSize = (UInt64)dataRaw.size();
-      UInt8* uBuffer;
-
-      if(lSize > 0x7D && lSize <= 0xFFFF)
-      {
-         dataSize += 2;
-      }
-      else if(lSize > 0xFFFF)
-      {
-         dataSize += 8;
-      }
-
-      oldSd = mOutstandingSends.front();
-      dataWs = new SendData(oldSd->destination,
-            Data(Data::Take, new char[(int)dataSize], (Data::size_type)dataSize),
-            oldSd->transactionId,
-            oldSd->sigcompId,
-            false);
-      resip_assert(dataWs && dataWs->data.data());
-      uBuffer = (UInt8*)dataWs->data.data();
-
+      // The frame header becomes data and the message is moved, not
+      // copied, into the first of moreData.
+      SendData* sd = *send;
+      UInt64 lSize = (UInt64)sd->size();
+      sd->moreData.insert(sd->moreData.begin(), Data());
+      sd->moreData.front().takeBuf(sd->data);
+
+      UInt8 uBuffer[10];
+      int headerSize;
       uBuffer[0] = 0x82;
       if(lSize <= 0x7D)
       {
          uBuffer[1] = (UInt8)lSize;
-         uBuffer = &uBuffer[2];
+         headerSize = 2;
       }
       else if(lSize <= 0xFFFF)
       {
          uBuffer[1] = 0x7E;
          uBuffer[2] = (UInt8)((lSize >> 8) & 0xFF);
          uBuffer[3] = (UInt8)(lSize & 0xFF);
-         uBuffer = &uBuffer[4];
+         headerSize = 4;
       }
       else
       {
@@ -207,21 +156,17 @@ Connection::performWrite()
          uBuffer[7] = (UInt8)((lSize >> 16) & 0xFF);
          uBuffer[8] = (UInt8)((lSize >> 8) & 0xFF);
          uBuffer[9] = (UInt8)(lSize & 0xFF);
-         uBuffer = &uBuffer[10];
+         headerSize = 10;
       }
-
-      memcpy(uBuffer, dataRaw.data(), dataRaw.size());
-      mOutstandingSends.front() = dataWs;
-      dataWs = 0;
-      delete oldSd;
+      sd->data.copy((const char*)uBuffer, headerSize);
    }
 
 #ifdef USE_SIGCOMP
    // Perform compression here, if appropriate
    if (mSendingTransmissionFormat == Compressed
-       && !(mOutstandingSends.front()->isAlreadyCompressed))
+       && !((*send)->isAlreadyCompressed))
    {
-      const Data& uncompressed = mOutstandingSends.front()->data;
+      const Data& uncompressed = (*send)->data;
       osc::SigcompMessage *sm = 
         mSigcompStack->compressMessage(uncompressed.data(), uncompressed.size(),
                                        sigcompId.data(), sigcompId.size(),
@@ -230,18 +175,69 @@ Connection::performWrite()
                 << uncompressed.size() << " bytes to " 
                 << sm->getStreamLength() << " bytes");
 
-      SendData *oldSd = mOutstandingSends.front();
+      SendData *oldSd = *send;
       SendData *newSd = new SendData(oldSd->destination,
                                      Data(sm->getStreamMessage(),
                                           sm->getStreamLength()),
                                      oldSd->transactionId,
                                      oldSd->sigcompId,
                                      true);
-      mOutstandingSends.front() = newSd;
+      *send = newSd;
       delete oldSd;
       delete sm;
    }
 #endif
+}
+
+int
+Connection::performWrite()
+{
+   if(transportWrite())
+   {
+      // If we get here it means:
+      // a. on a previous invocation, SSL_do_handshake wanted to write
+      //         (SSL_ERROR_WANT_WRITE)
+      // b. now the handshake is complete or it wants to read
+      if(mInWritable)
+      {
+         getConnectionManager().removeFromWritable(this);
+         mInWritable = false;
+      }
+      else
+      {
+         WarningLog(<<"performWrite invoked while not in write set");
+      }
+      return 0; // Q. What does this transportWrite() mean?
+                // A. It makes the TLS handshake move along after it
+                //    was waiting in the write set.
+   }
+
+   // If the TLS handshake returned SSL_ERROR_WANT_WRITE again
+   // then we could get here without really having something to write
+   // so just return, remaining in the write set.
+   if(mOutstandingSends.empty())
+   {
+      // FIXME: this needs to be more elaborate with respect
+      // to TLS handshaking but it doesn't appear we can do that
+      // without ABI breakage.
+      return 0;
+   }
+
+   switch(mOutstandingSends.front()->command)
+   {
+   case SendData::CloseConnection:
+      // .bwc. Close this connection.
+      return -1;
+      break;
+   case SendData::EnableFlowTimer:
+      enableFlowTimer();
+      removeFrontOutstandingSend();
+      return 0;
+      break;
+   default:
+      // do nothing
+      break;
+   }
 
    // Note:  The first time the socket is available for write, is when the TCP connect call is completed
    if (mFirstWriteAfterConnectedPending)
@@ -259,10 +255,53 @@ Connection::performWrite()
       }
    }
 
-   const Data& data = mOutstandingSends.front()->data;
-   int nBytes = write(data.data() + mSendPos,int(data.size() - mSendPos));
+   // Gather as much of the queue as we can into one write, stopping at the
+   // next command. Framing and compression are done to each message once,
+   // in order, the first time it is gathered.
+   WriteBuffer bufs[MaxWriteBuffers];
+   int count = 0;
+   Data::size_type skip = mSendPos;
+   size_t index = 0;
+   for (std::list<SendData*>::iterator it = mOutstandingSends.begin();
+        it != mOutstandingSends.end() && count < MaxWriteBuffers; ++it, ++index)
+   {
+      if ((*it)->command != SendData::NoCommand)
+      {
+         break;
+      }
+      if (index == mPreparedSends)
+      {
+         prepareSend(it);
+         ++mPreparedSends;
+      }
 
-   //DebugLog (<< "Tried to send " << data.size() - mSendPos << " bytes, sent " << nBytes << " bytes");
+      const SendData& sd = **it;
+      for (size_t i = 0; i < sd.numSegments() && count < MaxWriteBuffers; ++i)
+      {
+         const Data& seg = sd.segment(i);
+         if (skip >= seg.size())
+         {
+            skip -= seg.size();
+            continue;
+         }
+         bufs[count].mBuf = seg.data() + skip;
+         bufs[count].mLen = int(seg.size() - skip);
+         skip = 0;
+         ++count;
+      }
+   }
+
+   if (count == 0)
+   {
+      // Nothing but empty messages before the next command.
+      mSendPos = 0;
+      removeFrontOutstandingSend();
+      return 0;
+   }
+
+   int nBytes = count == 1 ? write(bufs[0].mBuf, bufs[0].mLen) : writev(bufs, count);
+
+   //DebugLog (<< "Tried to send " << count << " buffers, sent " << nBytes << " bytes");
 
    if (nBytes < 0)
    {
@@ -278,11 +317,21 @@ Connection::performWrite()
    }
    else
    {
+      ++mWriteCalls;
+      mBytesWritten += nBytes;
+
       // Safe because of the conditional above ( < 0 ).
       Data::size_type bytesWritten = static_cast<Data::size_type>(nBytes);
-      mSendPos += bytesWritten;
-      if (mSendPos == data.size())
+      Data::size_type left = bytesWritten;
+      while (left > 0)
       {
+         Data::size_type frontLeft = Data::size_type(mOutstandingSends.front()->size()) - mSendPos;
+         if (left < frontLeft)
+         {
+            mSendPos += left;
+            break;
+         }
+         left -= frontLeft;
          mSendPos = 0;
          removeFrontOutstandingSend();
       }
@@ -290,6 +339,26 @@ Connection::performWrite()
    }
 }
 
+int
+Connection::writev(const WriteBuffer* bufs, int count)
+{
+   int total = 0;
+   for (int i = 0; i < count; ++i)
+   {
+      int nBytes = write(bufs[i].mBuf, bufs[i].mLen);
+      if (nBytes < 0)
+      {
+         return total > 0 ? total : nBytes;
+      }
+      total += nBytes;
+      if (nBytes < bufs[i].mLen)
+      {
+         break;
+      }
+   }
+   return total;
+}
+
 
 bool 
 Connection::performWrites(unsigned int max)
@@ -100,6 +100,11 @@ class Connection : public ConnectionBase,
       void enableFlowTimer();
       bool isFlowTimerEnabled() { return mFlowTimerEnabled; }
 
+      /// Bytes written and write calls made so far; their ratio shows how
+      /// well queued messages are being coalesced into each write.
+      UInt64 getBytesWritten() const { return mBytesWritten; }
+      UInt64 getWriteCalls() const { return mWriteCalls; }
+
       bool mFirstWriteAfterConnectedPending;
       static volatile bool mEnablePostConnectSocketFuncCall;
       static void setEnablePostConnectSocketFuncCall(bool enabled = true) { mEnablePostConnectSocketFuncCall = enabled; }
@@ -109,6 +114,20 @@ class Connection : public ConnectionBase,
       virtual int read(char* /* buffer */, const int /* count */) { return 0; }
       /// pure virtual, but need concrete Connection for book-ends of lists
       virtual int write(const char* /* buffer */, const int /* count */) { return 0; }
+
+      struct WriteBuffer
+      {
+         const char* mBuf;
+         int mLen;
+      };
+      /// Most buffers performWrite() hands to writev() at once.
+      enum { MaxWriteBuffers = 64 };
+      /** Writes the buffers in order, using one system call where the
+          platform allows. Returns what write() does: bytes written, 0 if
+          nothing could be written yet, or -1 on error. The default calls
+          write() for each buffer until one is not completely written.
+      */
+      virtual int writev(const WriteBuffer* bufs, int count);
       virtual void onDoubleCRLF();
       virtual void onSingleCRLF();
 
@@ -120,6 +139,17 @@ class Connection : public ConnectionBase,
    private:
       ConnectionManager& getConnectionManager() const;
       void removeFrontOutstandingSend();
+      void prepareSend(std::list<SendData*>::iterator send);
+      // The first mPreparedSends of mOutstandingSends have been framed or
+      // compressed as needed and may be written.
+      size_t mPreparedSends;
+      UInt64 mBytesWritten;
+      UInt64 mWriteCalls;
+      // When ConnectionManager's idle wheel will next look at this
+      // connection (0 if it is not on the wheel), and where in that
+      // bucket it is.
+      UInt64 mIdleDeadline;
+      size_t mIdleSlot;
       bool mInWritable;
       bool mFlowTimerEnabled;
       FdPollItemHandle mPollItemHandle;
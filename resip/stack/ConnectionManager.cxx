@@ -12,6 +12,7 @@
 #include "rutil/Logger.hxx"
 #include "rutil/Inserter.hxx"
 
+#include <string.h>
 #include <vector>
 
 using namespace resip;
@@ -22,8 +23,26 @@ using namespace std;
 UInt64 ConnectionManager::MinimumGcAge = 1;  // in milliseconds
 UInt64 ConnectionManager::MinimumGcHeadroom = 0;
 bool ConnectionManager::EnableAgressiveGc = false;
+UInt64 ConnectionManager::IdleWheelResolution = 1000;  // in milliseconds
+UInt64 ConnectionManager::IdleTimeout[MAX_TRANSPORT] = {0};
+
+void
+ConnectionManager::setIdleTimeout(TransportType type, UInt64 ms)
+{
+   resip_assert(type < MAX_TRANSPORT);
+   IdleTimeout[type] = ms;
+}
+
+UInt64
+ConnectionManager::getIdleTimeout(TransportType type)
+{
+   resip_assert(type < MAX_TRANSPORT);
+   return IdleTimeout[type];
+}
 
 ConnectionManager::ConnectionManager() : 
+   mIdleResolution(resipMax(IdleWheelResolution, UInt64(1))),
+   mIdleTick(Timer::getTimeMs() / mIdleResolution),
    mHead(0,Tuple(),0,Compression::Disabled, false),
    mWriteHead(ConnectionWriteList::makeList(&mHead)),
    mReadHead(ConnectionReadList::makeList(&mHead)),
@@ -46,30 +65,78 @@ ConnectionManager::~ConnectionManager()
 void 
 ConnectionManager::closeConnections()
 {
-   while (!mAddrMap.empty())
+   // Each Connection removes itself from mAddrMap when deleted.
+   std::vector<Connection*> conns;
+   mAddrMap.values(conns);
+   for (std::vector<Connection*>::iterator i = conns.begin(); i != conns.end(); ++i)
    {
-      delete mAddrMap.begin()->second;
+      delete *i;
    }
 }
 
+namespace
+{
+// Final step of MurmurHash3; every input bit affects every output bit.
+inline UInt64
+mixBits(UInt64 k)
+{
+   k ^= k >> 33;
+   k *= 0xff51afd7ed558ccdULL;
+   k ^= k >> 33;
+   k *= 0xc4ceb9fe1a85ec53ULL;
+   k ^= k >> 33;
+   return k;
+}
+}
+
+// Tuple::hash() sums address, port and transport, which leaves the low bits
+// (all a power-of-two table looks at) nearly constant for peers in the same
+// network. Pack the same fields into a compact key and mix it instead.
+size_t
+ConnectionManager::addrHash(const Tuple& addr)
+{
+   UInt64 key = (UInt64(addr.getPort()) << 8) | UInt64(addr.getType());
+#ifdef USE_NETNS
+   key ^= UInt64(addr.getNetNs().hash()) << 24;
+#endif
+#ifdef USE_IPV6
+   if (addr.getSockaddr().sa_family == AF_INET6)
+   {
+      const sockaddr_in6& in6 = reinterpret_cast<const sockaddr_in6&>(addr.getSockaddr());
+      UInt64 words[2];
+      memcpy(words, &in6.sin6_addr, sizeof(words));
+      return size_t(mixBits(mixBits(key ^ words[0]) ^ words[1]));
+   }
+#endif
+   const sockaddr_in& in4 = reinterpret_cast<const sockaddr_in&>(addr.getSockaddr());
+   return size_t(mixBits(key ^ (UInt64(in4.sin_addr.s_addr) << 32)));
+}
+
+size_t
+ConnectionManager::idHash(FlowKey flowKey)
+{
+   // sockets are small integers on POSIX, but multiples of 4 on Windows
+   return size_t(mixBits(UInt64(flowKey)));
+}
+
 Connection*
 ConnectionManager::findConnection(const Tuple& addr)
 {
    if (addr.mFlowKey != 0)
    {
-      IdMap::iterator i = mIdMap.find(addr.mFlowKey);
-      if (i != mIdMap.end())
+      Connection* conn = mIdMap.find(addr.mFlowKey, idHash(addr.mFlowKey));
+      if (conn)
       {
-         if(i->second->who() == addr)
+         if(conn->who() == addr)
          {
             DebugLog(<<"Found fd " << addr.mFlowKey);
-            return i->second;
+            return conn;
          }
          else
          {
             DebugLog(<<"fd " << addr.mFlowKey 
                      << " exists, but does not match the destination. FD -> "
-                     << i->second->who() << ", tuple -> " << addr);
+                     << conn->who() << ", tuple -> " << addr);
          }
       }
       else
@@ -83,11 +150,11 @@ ConnectionManager::findConnection(const Tuple& addr)
       }
    }
    
-   AddrMap::iterator i = mAddrMap.find(addr);
-   if (i != mAddrMap.end())
+   Connection* conn = mAddrMap.find(addr, addrHash(addr));
+   if (conn)
    {
       DebugLog(<<"Found connection for tuple "<< addr );
-      return i->second;
+      return conn;
    }
 
    DebugLog(<<"Could not find a connection for " << addr);
@@ -99,19 +166,19 @@ ConnectionManager::findConnection(const Tuple& addr) const
 {
    if (addr.mFlowKey != 0)
    {
-      IdMap::const_iterator i = mIdMap.find(addr.mFlowKey);
-      if (i != mIdMap.end())
+      Connection* conn = mIdMap.find(addr.mFlowKey, idHash(addr.mFlowKey));
+      if (conn)
       {
-         if(i->second->who()==addr)
+         if(conn->who()==addr)
          {
             DebugLog(<<"Found fd " << addr.mFlowKey);
-            return i->second;
+            return conn;
          }
          else
          {
             DebugLog(<<"fd " << addr.mFlowKey 
                      << " exists, but does not match the destination. FD -> "
-                     << i->second->who() << ", tuple -> " << addr);
+                     << conn->who() << ", tuple -> " << addr);
          }
       }
       else
@@ -120,11 +187,11 @@ ConnectionManager::findConnection(const Tuple& addr) const
       }
    }
    
-   AddrMap::const_iterator i = mAddrMap.find(addr);
-   if (i != mAddrMap.end())
+   Connection* conn = mAddrMap.find(addr, addrHash(addr));
+   if (conn)
    {
       DebugLog(<<"Found connection for tuple "<< addr );
-      return i->second;
+      return conn;
    }
 
    DebugLog(<<"Could not find a connection for " << addr);
@@ -182,12 +249,12 @@ ConnectionManager::removeFromWritable(Connection* conn)
 void
 ConnectionManager::addConnection(Connection* connection)
 {
-   resip_assert(mAddrMap.find(connection->who())==mAddrMap.end());
+   resip_assert(mAddrMap.find(connection->who(), addrHash(connection->who()))==0);
 
    DebugLog (<< "ConnectionManager::addConnection() " << connection->mWho.mFlowKey  << ":" << connection->who() << ", totalConnections=" << mIdMap.size());
    
-   mAddrMap[connection->who()] = connection;
-   mIdMap[connection->who().mFlowKey] = connection;
+   mAddrMap.insert(connection, addrHash(connection->who()));
+   mIdMap.insert(connection, idHash(connection->who().mFlowKey));
 
    if ( mPollGrp ) 
    {
@@ -199,6 +266,7 @@ ConnectionManager::addConnection(Connection* connection)
       mReadHead->push_back(connection);
    }
    mLRUHead->push_back(connection);
+   scheduleIdle(connection);
 
    // Garbage collect old connections if agressive is enabled
    if(EnableAgressiveGc)
@@ -206,9 +274,7 @@ ConnectionManager::addConnection(Connection* connection)
       gc(MinimumGcAge, 0);  // cleanup all connections that haven't seen data in last x ms
    }
 
-   //DebugLog (<< "count=" << mAddrMap.count(connection->who()) << "who=" << connection->who() << " mAddrMap=" << Inserter(mAddrMap));
-   //assert(mAddrMap.begin()->first == connection->who());
-   resip_assert(mAddrMap.count(connection->who()) == 1);
+   resip_assert(mAddrMap.find(connection->who(), addrHash(connection->who())) == connection);
 }
 
 void
@@ -216,8 +282,9 @@ ConnectionManager::removeConnection(Connection* connection)
 {
    DebugLog (<< "ConnectionManager::removeConnection()");
 
-   mIdMap.erase(connection->mWho.mFlowKey);
-   mAddrMap.erase(connection->mWho);
+   mIdMap.erase(connection, idHash(connection->mWho.mFlowKey));
+   mAddrMap.erase(connection, addrHash(connection->mWho));
+   unscheduleIdle(connection);
 
    if ( mPollGrp ) 
    {
@@ -247,7 +314,6 @@ ConnectionManager::gc(UInt64 relThreshold, unsigned int maxToRemove)
    UInt64 threshold = curTimeMs - relThreshold;
    DebugLog(<< "recycling connections not used in last " << relThreshold/1000.0 << " seconds");
 
-   // Look through non-flow-timer connections and close those using the passed in relThreshold
    unsigned int numRemoved = 0;
    for (ConnectionLruList::iterator i = mLRUHead->begin();
         i != mLRUHead->end() &&
@@ -268,30 +334,8 @@ ConnectionManager::gc(UInt64 relThreshold, unsigned int maxToRemove)
       }
    }
 
-   // Look through flow-timer connections and close those using the configured FlowTimer 
-   // value + the configured grace period as a threshold
-   if(mFlowTimerLRUHead->begin() != mFlowTimerLRUHead->end())
-   {
-      threshold = curTimeMs - ((InteropHelper::getFlowTimerSeconds() + InteropHelper::getFlowTimerGracePeriodSeconds()) * 1000);
-      for (FlowTimerLruList::iterator i2 = mFlowTimerLRUHead->begin();
-         i2 != mFlowTimerLRUHead->end() &&
-         (maxToRemove == 0 || numRemoved != maxToRemove);)
-      {  
-         if ((*i2)->whenLastUsed() < threshold)
-         {
-            Connection* discard = *i2;
-            InfoLog(<< "recycling flow-timer enabled connection: " << discard << " " << discard->getSocket());
-            // iterate before removing
-            ++i2;
-            delete discard;
-            numRemoved++;
-         }
-         else
-         {
-            break;
-         }
-      }
-   }
+   // Flow-timer connections are closed by processIdleTimers() when their
+   // flow timer and its grace period run out.
 
    if(MinimumGcHeadroom > 0)
    {
@@ -306,13 +350,13 @@ ConnectionManager::gc(UInt64 relThreshold, unsigned int maxToRemove)
       else
       {
          rlim_t& soft_limit = rlim.rlim_cur;
-         AddrMap::size_type conn_count = mAddrMap.size();
-         AddrMap::size_type headroom = soft_limit - conn_count;
+         size_t conn_count = mAddrMap.size();
+         size_t headroom = soft_limit - conn_count;
          DebugLog(<< "GC headroom check: soft_limit = " << soft_limit << ", managed connection count = " << conn_count << ", headroom = " << headroom << ", minimum headroom = " << MinimumGcHeadroom);
          if(headroom < MinimumGcHeadroom)
          {
             WarningLog(<< "actual headroom = " << headroom << ", MinimumGcHeadroom = " << MinimumGcHeadroom << ", garbage collector making extra effort to reclaim file descriptors");
-            AddrMap::size_type mustRemove = MinimumGcHeadroom - headroom;
+            size_t mustRemove = MinimumGcHeadroom - headroom;
             unsigned int remainder = gcWithTarget(mustRemove);
             numRemoved += (mustRemove - remainder);
             if(remainder > 0)
@@ -388,6 +432,125 @@ ConnectionManager::moveToFlowTimerLru(Connection *connection)
 {
    connection->ConnectionLruList::remove();
    mFlowTimerLRUHead->push_back(connection);
+   // now times out with the flow timer
+   unscheduleIdle(connection);
+   scheduleIdle(connection);
+}
+
+UInt64
+ConnectionManager::idleTimeout(Connection* connection) const
+{
+   if(connection->isFlowTimerEnabled())
+   {
+      return (InteropHelper::getFlowTimerSeconds() + InteropHelper::getFlowTimerGracePeriodSeconds()) * 1000;
+   }
+   return IdleTimeout[connection->who().getType()];
+}
+
+void
+ConnectionManager::scheduleIdle(Connection* connection)
+{
+   UInt64 timeout = idleTimeout(connection);
+   if(timeout == 0)
+   {
+      return;
+   }
+   // the wheel must span the timeout, or connections would come round
+   // again before they are due
+   UInt64 ticks = timeout / mIdleResolution + 2;
+   if(ticks > mIdleWheel.size())
+   {
+      growIdleWheel((size_t)ticks);
+   }
+   // never into a bucket that has already been processed
+   insertIdle(connection, resipMax(connection->whenLastUsed() + timeout,
+                                   mIdleTick * mIdleResolution));
+}
+
+void
+ConnectionManager::insertIdle(Connection* connection, UInt64 deadline)
+{
+   IdleBucket& bucket = mIdleWheel[(deadline / mIdleResolution) & (mIdleWheel.size()-1)];
+   connection->mIdleDeadline = deadline;
+   connection->mIdleSlot = bucket.size();
+   bucket.push_back(connection);
+}
+
+void
+ConnectionManager::unscheduleIdle(Connection* connection)
+{
+   if(connection->mIdleDeadline == 0)
+   {
+      return;
+   }
+   IdleBucket& bucket = mIdleWheel[(connection->mIdleDeadline / mIdleResolution) & (mIdleWheel.size()-1)];
+   resip_assert(bucket[connection->mIdleSlot] == connection);
+   // fill the hole with the last entry
+   Connection* last = bucket.back();
+   bucket[connection->mIdleSlot] = last;
+   last->mIdleSlot = connection->mIdleSlot;
+   bucket.pop_back();
+   connection->mIdleDeadline = 0;
+}
+
+void
+ConnectionManager::growIdleWheel(size_t ticks)
+{
+   size_t size = 64;
+   while(size < ticks)
+   {
+      size <<= 1;
+   }
+   std::vector<IdleBucket> old(size);
+   old.swap(mIdleWheel);
+   for(size_t b = 0; b < old.size(); ++b)
+   {
+      for(size_t i = 0; i < old[b].size(); ++i)
+      {
+         insertIdle(old[b][i], old[b][i]->mIdleDeadline);
+      }
+   }
+   DebugLog(<< "idle wheel now has " << size << " buckets of " << mIdleResolution << "ms");
+}
+
+void
+ConnectionManager::processIdleTimers(UInt64 now)
+{
+   // a tick's bucket is processed once the tick is over
+   UInt64 nowTick = now / mIdleResolution;
+   if(mIdleTick >= nowTick)
+   {
+      return;
+   }
+   // after a long pause, one turn of the wheel covers every bucket
+   UInt64 end = resipMin(nowTick, mIdleTick + mIdleWheel.size());
+   for(UInt64 tick = mIdleTick; tick < end; ++tick)
+   {
+      // Take the bucket's contents, so that deleting or rescheduling them
+      // (which may grow the wheel) does not disturb the loop.
+      IdleBucket due;
+      due.swap(mIdleWheel[tick & (mIdleWheel.size()-1)]);
+      for(size_t i = 0; i < due.size(); ++i)
+      {
+         due[i]->mIdleDeadline = 0;
+      }
+      for(size_t i = 0; i < due.size(); ++i)
+      {
+         Connection* connection = due[i];
+         UInt64 timeout = idleTimeout(connection);
+         if(timeout != 0 && connection->whenLastUsed() + timeout <= now)
+         {
+            InfoLog(<< "closing idle connection: " << connection << " " << connection->getSocket());
+            delete connection;
+         }
+         else
+         {
+            // used since it was scheduled, or due in a later turn
+            scheduleIdle(connection);
+         }
+      }
+   }
+   mIdleTick = nowTick;
 }
 
 void
@@ -465,9 +628,13 @@ ConnectionManager::setPollGrp(FdPollGrp *grp)
 void 
 ConnectionManager::invokeAfterSocketCreationFunc() const
 {
-    for (AddrMap::const_iterator it = mAddrMap.begin(); it != mAddrMap.end(); it++)
+    for (ConnectionLruList::iterator it = mLRUHead->begin(); it != mLRUHead->end(); ++it)
+    {
+        (*it)->invokeAfterSocketCreationFunc();
+    }
+    for (FlowTimerLruList::iterator it = mFlowTimerLRUHead->begin(); it != mFlowTimerLRUHead->end(); ++it)
     {
-        it->second->invokeAfterSocketCreationFunc();
+        (*it)->invokeAfterSocketCreationFunc();
     }
 }
 
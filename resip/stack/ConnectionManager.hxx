@@ -1,8 +1,8 @@
 #ifndef RESIP_ConnectionMgr_hxx
 #define RESIP_ConnectionMgr_hxx 
 
-#include <map>
-#include "rutil/HashMap.hxx"
+#include <vector>
+#include "rutil/OpenHashTable.hxx"
 #include "resip/stack/Connection.hxx"
 
 namespace resip
@@ -12,9 +12,11 @@ class FdPollGrp;
 /**
    Collection of Connection per Transport. Maintains round-robin
    orders for read and write.  Maintains least-recently-used connections list
-   for garbage collection.
+   for garbage collection, and a wheel of idle timeouts.
 
-   Maintains mapping from Tuple to Connection.
+   Maintains mapping from Tuple to Connection, and from FlowKey (the
+   connection's socket) to Connection. Both are hash indexes, so lookups
+   stay constant-time with hundreds of thousands of connections.
  */
 class ConnectionManager
 {
@@ -34,6 +36,18 @@ class ConnectionManager
           perform garbage collection on every new connection.  If disabled
           then garbage collection is only performed if we run out of Fd's */
       static bool EnableAgressiveGc;
+      /** Granularity (in ms) of the idle timeout wheel: connections are
+          closed up to this long after their idle timeout. Read when a
+          ConnectionManager is constructed. */
+      static UInt64 IdleWheelResolution;
+
+      /** Connections of this transport type that have no inbound traffic
+          for longer than this (in ms) are closed. 0, the default, leaves
+          idle connections to the garbage collector. Connections with the
+          flow timer enabled use the flow timer and its grace period
+          instead. */
+      static void setIdleTimeout(TransportType type, UInt64 ms);
+      static UInt64 getIdleTimeout(TransportType type);
 
       ConnectionManager();
       ~ConnectionManager();
@@ -46,6 +60,10 @@ class ConnectionManager
       void setPollGrp(FdPollGrp *grp);
       void buildFdSet(FdSet& fdset);
       void process(FdSet& fdset);
+      /** Closes connections whose idle timeout or flow timer has expired.
+          The work done is proportional to the number of connections
+          that expire or have been used since they were last checked. */
+      void processIdleTimers(UInt64 now);
 
       virtual void invokeAfterSocketCreationFunc() const;
 
@@ -53,8 +71,30 @@ class ConnectionManager
       void addToWritable(Connection* conn); // add the specified conn to end
       void removeFromWritable(Connection* conn); // remove the current mWriteMark
 
-      typedef std::map<Tuple, Connection*> AddrMap;
-      typedef std::map<Socket, Connection*> IdMap;
+      struct AddrTraits
+      {
+         typedef Tuple KeyType;
+         static bool matches(Connection* conn, const Tuple& addr)
+         {
+            return conn->who() == addr;
+         }
+      };
+
+      struct IdTraits
+      {
+         typedef FlowKey KeyType;
+         static bool matches(Connection* conn, const FlowKey& flowKey)
+         {
+            return conn->who().mFlowKey == flowKey;
+         }
+      };
+
+      typedef OpenHashTable<Connection, AddrTraits> AddrMap;
+      typedef OpenHashTable<Connection, IdTraits> IdMap;
+
+      /// hash of the address, port, transport (and netns) of addr
+      static size_t addrHash(const Tuple& addr);
+      static size_t idHash(FlowKey flowKey);
 
       void addConnection(Connection* connection);
       void removeConnection(Connection* connection);
@@ -68,6 +108,23 @@ class ConnectionManager
       /// move to youngest 
       void touch(Connection* connection);
       void moveToFlowTimerLru(Connection *connection);
+
+      // Idle timeout wheel. Each bucket holds the connections whose
+      // mIdleDeadline falls in one tick of IdleWheelResolution, modulo the
+      // wheel size. touch() does not move a connection; when its bucket
+      // comes due, a connection used since is put back further on.
+      typedef std::vector<Connection*> IdleBucket;
+      UInt64 idleTimeout(Connection* connection) const;
+      void scheduleIdle(Connection* connection);
+      void unscheduleIdle(Connection* connection);
+      void insertIdle(Connection* connection, UInt64 deadline);
+      void growIdleWheel(size_t ticks);
+
+      static UInt64 IdleTimeout[MAX_TRANSPORT];
+      std::vector<IdleBucket> mIdleWheel;
+      const UInt64 mIdleResolution;
+      /// first tick whose bucket has not been processed yet
+      UInt64 mIdleTick;
       
       AddrMap mAddrMap;
       IdMap mIdMap;
@@ -39,11 +39,15 @@ DnsInterface::DnsInterface(DnsStub& dnsStub, bool useDnsVip) :
    if (useDnsVip)
    {
       mDnsStub.setResultTransform(&mVip);
+      mDnsStub.addSnapshotHandler("vips", &mVip);
    }
+   mDnsStub.addSnapshotHandler("marks", &mMarkManager);
 }
 
 DnsInterface::~DnsInterface()
 {
+   mDnsStub.removeSnapshotHandler("vips");
+   mDnsStub.removeSnapshotHandler("marks");
 }
 
 void 
@@ -97,6 +97,7 @@ DnsResult::DnsResult(DnsInterface& interfaceObj, DnsStub& dns, RRVip& vip, DnsHa
      mVip(vip),
      mHandler(handler),
      mSRVCount(0),
+     mAnsweringFromCache(false),
      mDoingEnum(0),
      mSips(false),
      mTransport(UNKNOWN_TRANSPORT),
@@ -260,11 +261,107 @@ DnsResult::lookup(const Uri& uri)
 {
    DebugLog (<< "DnsResult::lookup " << uri);
 
+   // ENUM settings and VIPs belong to the DnsThread
+   if (!uri.isEnumSearchable() && mDnsStub.canLookupCached())
+   {
+      lookupFromCache(uri);
+      return;
+   }
+
    // Dispatch lookup request to DnsThread
    LookupCommand *command = new LookupCommand(*this, uri);
    mDnsStub.queueCommand(command);
 }
 
+template<class QueryType> void
+DnsResult::query(const Data& target)
+{
+   if (mAnsweringFromCache)
+   {
+      mCacheQueries.push_back(std::make_pair((int)QueryType::getRRType(), target));
+   }
+   else
+   {
+      mDnsStub.lookup<QueryType>(target, Protocol::Sip, this);
+   }
+}
+
+template<class QueryType> bool
+DnsResult::answerFromCache(const Data& target)
+{
+   DNSResult<typename QueryType::Type> result;
+   if (!mDnsStub.lookupCached<QueryType>(target, result))
+   {
+      return false;
+   }
+   StackLog (<< "Answering " << QueryType::getRRTypeName() << " " << target << " from cache");
+   onDnsResult(result);
+   return true;
+}
+
+void
+DnsResult::lookupFromCache(const Uri& uri)
+{
+   // Take the steps one at a time, in the order the DnsThread would, for as
+   // long as their answers are cached. The queries that miss only go to the
+   // DnsThread once this thread is done with this result, so that the two
+   // never work on it at the same time.
+   mAnsweringFromCache = true;
+   lookupInternal(uri);
+   std::vector<std::pair<int, Data> > misses;
+   while (!mCacheQueries.empty())
+   {
+      std::pair<int, Data> next = mCacheQueries.front();
+      mCacheQueries.pop_front();
+      bool answered = false;
+      switch (next.first)
+      {
+         case T_NAPTR:
+            answered = answerFromCache<RR_NAPTR>(next.second);
+            break;
+         case T_SRV:
+            answered = answerFromCache<RR_SRV>(next.second);
+            break;
+#ifdef USE_IPV6
+         case T_AAAA:
+            answered = answerFromCache<RR_AAAA>(next.second);
+            break;
+#endif
+         case T_A:
+            answered = answerFromCache<RR_A>(next.second);
+            break;
+         default:
+            resip_assert(0);
+      }
+      if (!answered)
+      {
+         misses.push_back(next);
+      }
+   }
+   mAnsweringFromCache = false;
+
+   for (std::vector<std::pair<int, Data> >::const_iterator it = misses.begin(); it != misses.end(); ++it)
+   {
+      switch (it->first)
+      {
+         case T_NAPTR:
+            query<RR_NAPTR>(it->second);
+            break;
+         case T_SRV:
+            query<RR_SRV>(it->second);
+            break;
+#ifdef USE_IPV6
+         case T_AAAA:
+            query<RR_AAAA>(it->second);
+            break;
+#endif
+         default:
+            query<RR_A>(it->second);
+            break;
+      }
+   }
+}
+
 void
 DnsResult::lookupInternalWithEnum(const Uri& uri)
 {
@@ -369,7 +466,7 @@ DnsResult::lookupInternal(const Uri& uri)
                else
                {
                   mSRVCount++;
-                  mDnsStub.lookup<RR_SRV>("_sips._udp." + mTarget, Protocol::Sip, this);
+                  query<RR_SRV>("_sips._udp." + mTarget);
                   StackLog (<< "Doing SRV lookup of _sips._udp." << mTarget);
                }
             }
@@ -392,7 +489,7 @@ DnsResult::lookupInternal(const Uri& uri)
                else
                {
                   mSRVCount++;
-                  mDnsStub.lookup<RR_SRV>("_sips._tcp." + mTarget, Protocol::Sip,  this);
+                  query<RR_SRV>("_sips._tcp." + mTarget);
                   StackLog (<< "Doing SRV lookup of _sips._tcp." << mTarget);
                }
             }
@@ -418,17 +515,17 @@ DnsResult::lookupInternal(const Uri& uri)
             {
                case TLS: //deprecated, mean TLS over TCP
                   mSRVCount++;
-                  mDnsStub.lookup<RR_SRV>("_sips._tcp." + mTarget, Protocol::Sip, this);
+                  query<RR_SRV>("_sips._tcp." + mTarget);
                   StackLog (<< "Doing SRV lookup of _sips._tcp." << mTarget);
                   break;
                case DTLS: //deprecated, mean TLS over TCP
                   mSRVCount++;
-                  mDnsStub.lookup<RR_SRV>("_sip._dtls." + mTarget, Protocol::Sip, this);
+                  query<RR_SRV>("_sip._dtls." + mTarget);
                   StackLog (<< "Doing SRV lookup of _sip._dtls." << mTarget);
                   break;
                case TCP:
                   mSRVCount++;
-                  mDnsStub.lookup<RR_SRV>("_sip._tcp." + mTarget, Protocol::Sip, this);
+                  query<RR_SRV>("_sip._tcp." + mTarget);
                   StackLog (<< "Doing SRV lookup of _sip._tcp." << mTarget);
                   break;
                case SCTP:
@@ -436,7 +533,7 @@ DnsResult::lookupInternal(const Uri& uri)
                case UDP:
                default: //fall through to UDP for unimplemented & unknown
                   mSRVCount++;
-                  mDnsStub.lookup<RR_SRV>("_sip._udp." + mTarget, Protocol::Sip, this);
+                  query<RR_SRV>("_sip._udp." + mTarget);
                   StackLog (<< "Doing SRV lookup of _sip._udp." << mTarget);
             }
          }
@@ -586,7 +683,7 @@ DnsResult::lookupInternal(const Uri& uri)
       }
       else // do NAPTR
       {
-         mDnsStub.lookup<RR_NAPTR>(mTarget, Protocol::Sip, this); // for current target
+         query<RR_NAPTR>(mTarget); // for current target
       }
    }
 }
@@ -598,15 +695,15 @@ void DnsResult::lookupHost(const Data& target)
 #ifdef USE_IPV6
       DebugLog(<< "Doing host (AAAA) lookup: " << target);
       mPassHostFromAAAAtoA = target;
-      mDnsStub.lookup<RR_AAAA>(target, Protocol::Sip, this);
+      query<RR_AAAA>(target);
 #else
       resip_assert(0);
-      mDnsStub.lookup<RR_A>(target, Protocol::Sip, this);
+      query<RR_A>(target);
 #endif
    }
    else if (mInterface.isSupported(mTransport, V4))
    {
-      mDnsStub.lookup<RR_A>(target, Protocol::Sip, this);
+      query<RR_A>(target);
    }
    else
    {
@@ -1090,7 +1187,7 @@ void DnsResult::onDnsResult(const DNSResult<DnsAAAARecord>& result)
       StackLog (<< "Failed async AAAA query: " << result.msg);
    }
    // funnel through to host processing
-   mDnsStub.lookup<RR_A>(mPassHostFromAAAAtoA, Protocol::Sip, this);
+   query<RR_A>(mPassHostFromAAAAtoA);
 #else
    resip_assert(0);
 #endif
@@ -1374,7 +1471,7 @@ DnsResult::onNaptrResult(const DNSResult<DnsNaptrRecord>& result)
                StackLog (<< "NAPTR record is supported and matches highes priority order. doing SRV query: " << (*it));
                mTopOrderedNAPTRs[(*it).replacement] = (*it);
                mSRVCount++;
-               mDnsStub.lookup<RR_SRV>((*it).replacement, Protocol::Sip, this);
+               query<RR_SRV>((*it).replacement);
             }
          }
       }
@@ -1404,32 +1501,32 @@ DnsResult::onNaptrResult(const DNSResult<DnsNaptrRecord>& result)
          }
 
          mSRVCount++;
-         mDnsStub.lookup<RR_SRV>("_sips._tcp." + mTarget, Protocol::Sip, this);
+         query<RR_SRV>("_sips._tcp." + mTarget);
          StackLog (<< "Doing SRV lookup of _sips._tcp." << mTarget);
       }
       else
       {
          if (mInterface.isSupportedProtocol(TLS))
          {
-            mDnsStub.lookup<RR_SRV>("_sips._tcp." + mTarget, Protocol::Sip, this);
+            query<RR_SRV>("_sips._tcp." + mTarget);
             ++mSRVCount;
             StackLog (<< "Doing SRV lookup of _sips._tcp." << mTarget);
          }
          if (mInterface.isSupportedProtocol(DTLS))
          {
-            mDnsStub.lookup<RR_SRV>("_sips._udp." + mTarget, Protocol::Sip, this);
+            query<RR_SRV>("_sips._udp." + mTarget);
             ++mSRVCount;
             StackLog (<< "Doing SRV lookup of _sips._udp." << mTarget);
          }
          if (mInterface.isSupportedProtocol(TCP))
          {
-            mDnsStub.lookup<RR_SRV>("_sip._tcp." + mTarget, Protocol::Sip, this);
+            query<RR_SRV>("_sip._tcp." + mTarget);
             ++mSRVCount;
             StackLog (<< "Doing SRV lookup of _sip._tcp." << mTarget);
          }
          if (mInterface.isSupportedProtocol(UDP))
          {
-            mDnsStub.lookup<RR_SRV>("_sip._udp." + mTarget, Protocol::Sip, this);
+            query<RR_SRV>("_sip._udp." + mTarget);
             ++mSRVCount;
             StackLog (<< "Doing SRV lookup of _sip._udp." << mTarget);
          }
@@ -85,6 +85,10 @@ class DnsResult : public DnsResultSink, public EnumResultSink
          from a uri as per rfc3263 and then does a NAPTR lookup or an A
          lookup depending on the uri.  Also does ENUM lookups if
          domain matches a configured enum domain.  This call is threadsafe.
+         Steps whose answers are in the DnsStub's cache are taken on the
+         calling thread, so a fully cached target is resolved (and the
+         DnsHandler called) before this returns; only the queries that miss
+         go to the DnsThread. ENUM and DNS VIP lookups always go there.
          
          @param uri The uri to resolve.
       */
@@ -199,10 +203,10 @@ class DnsResult : public DnsResultSink, public EnumResultSink
    private:
 
       /*
-         The following command is used to ensure that all DnsInterface mRRVip and 
-         mTupleMarkManager, and enum setting accesses are done from the DnsThread.  
-         This gets the initial call * lookupInternalWithEnum to occur on the 
-         DnsThread (using the DnsStub command fifo).
+         The following command is used to ensure that all DnsInterface mRRVip
+         and enum setting accesses are done from the DnsThread.  This gets the
+         initial call * lookupInternalWithEnum to occur on the DnsThread (using
+         the DnsStub command fifo), unless lookup() can answer from the cache.
        */
       class LookupCommand : public DnsStub::Command
       {
@@ -220,6 +224,12 @@ class DnsResult : public DnsResultSink, public EnumResultSink
       friend class LookupCommand;
       void lookupInternalWithEnum(const Uri& uri);
       void lookupInternal(const Uri& uri);
+      void lookupFromCache(const Uri& uri);
+
+      // Looks target up through the DnsStub, or, while lookupFromCache() is
+      // running, queues it to be answered from the cache.
+      template<class QueryType> void query(const Data& target);
+      template<class QueryType> bool answerFromCache(const Data& target);
 
       // Given a transport and port from uri, return the default port to use
       int getDefaultPort(TransportType transport, int port);
@@ -243,6 +253,9 @@ class DnsResult : public DnsResultSink, public EnumResultSink
       RRVip& mVip;
       DnsHandler* mHandler;
       int mSRVCount;
+      bool mAnsweringFromCache;
+      // queries made while mAnsweringFromCache, by rrType and target
+      std::deque<std::pair<int, Data> > mCacheQueries;
       Uri mInputUri;
       int mDoingEnum;
       std::map<int,Uri> mEnumDestinations;
@@ -0,0 +1,188 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include "resip/stack/EncodeSegments.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+
+EncodeSegments::EncodeSegments()
+   : mSize(0),
+     mBuffer(*this)
+{
+   mSegments.reserve(32);
+   mScratch.reserve(256);
+}
+
+EncodeStream&
+EncodeSegments::stream()
+{
+   if (!mStream.get())
+   {
+#ifdef RESIP_USE_STL_STREAMS
+      mStream.reset(new std::ostream(&mBuffer));
+#else
+      mStream.reset(new ResipFastOStream(&mBuffer));
+#endif
+   }
+   return *mStream;
+}
+
+void
+EncodeSegments::add(const char* buf, size_t len)
+{
+   if (len < CopyLimit)
+   {
+      copy(buf, len);
+      return;
+   }
+
+   mSize += len;
+   if (!mSegments.empty())
+   {
+      Segment& last = mSegments.back();
+      if (last.mBuf && last.mBuf + last.mLen == buf)
+      {
+         // adjacent in memory, as consecutive values of a header often are
+         last.mLen += len;
+         return;
+      }
+   }
+
+   Segment seg;
+   seg.mBuf = buf;
+   seg.mPos = 0;
+   seg.mLen = len;
+   mSegments.push_back(seg);
+}
+
+void
+EncodeSegments::copy(const char* buf, size_t len)
+{
+   if (len == 0)
+   {
+      return;
+   }
+
+   if (!mSegments.empty() && mSegments.back().mBuf == 0)
+   {
+      mSegments.back().mLen += len;
+   }
+   else
+   {
+      Segment seg;
+      seg.mBuf = 0;
+      seg.mPos = mScratch.size();
+      seg.mLen = len;
+      mSegments.push_back(seg);
+   }
+   mScratch.append(buf, (Data::size_type)len);
+   mSize += len;
+}
+
+void
+EncodeSegments::getSegment(size_t index, const char*& buf, size_t& len) const
+{
+   resip_assert(index < mSegments.size());
+   const Segment& seg = mSegments[index];
+   buf = seg.mBuf ? seg.mBuf : mScratch.data() + seg.mPos;
+   len = seg.mLen;
+}
+
+void
+EncodeSegments::gather(Data& out) const
+{
+   out.reserve(out.size() + (Data::size_type)mSize);
+   for (std::vector<Segment>::const_iterator i = mSegments.begin();
+        i != mSegments.end(); ++i)
+   {
+      out.append(i->mBuf ? i->mBuf : mScratch.data() + i->mPos,
+                 (Data::size_type)i->mLen);
+   }
+}
+
+#ifdef RESIP_USE_STL_STREAMS
+std::streamsize
+EncodeSegments::ScratchBuffer::xsputn(const char* s, std::streamsize count)
+{
+   mSegs.copy(s, (size_t)count);
+   return count;
+}
+
+int
+EncodeSegments::ScratchBuffer::overflow(int c)
+{
+   if (c != -1)
+   {
+      char ch = (char)c;
+      mSegs.copy(&ch, 1);
+   }
+   return 0;
+}
+#else
+size_t
+EncodeSegments::ScratchBuffer::writebuf(const char* s, size_t count)
+{
+   mSegs.copy(s, count);
+   return count;
+}
+
+size_t
+EncodeSegments::ScratchBuffer::putbuf(char ch)
+{
+   mSegs.copy(&ch, 1);
+   return 1;
+}
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
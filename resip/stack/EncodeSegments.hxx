@@ -0,0 +1,155 @@
+#if !defined(RESIP_ENCODESEGMENTS_HXX)
+#define RESIP_ENCODESEGMENTS_HXX
+
+#include <memory>
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/resipfaststreams.hxx"
+
+namespace resip
+{
+
+/**
+   @brief An encoded message held as a list of pieces, to be gathered or
+   written out with a scatter/gather call.
+
+   Text that already exists somewhere else (the original wire text of a
+   header value, say) is referred to rather than copied; it must stay valid,
+   and unchanged, for as long as the segments are used. Anything that has
+   to be generated is written to stream() or copy(), which put it in a
+   buffer owned by this object.
+*/
+class EncodeSegments
+{
+   public:
+      EncodeSegments();
+
+      /**
+         Adds len bytes at buf as a segment. Pieces shorter than CopyLimit
+         are copied, since a segment of their own would cost more than the
+         copy; longer ones are referred to.
+      */
+      void add(const char* buf, size_t len);
+      void add(const Data& data) {add(data.data(), data.size());}
+
+      /// Copies len bytes at buf into storage owned by this object.
+      void copy(const char* buf, size_t len);
+
+      /// A stream that copy()s whatever is written to it.
+      EncodeStream& stream();
+
+      /// Total number of bytes in all the segments.
+      size_t size() const {return mSize;}
+      size_t numSegments() const {return mSegments.size();}
+      /// The segment at index; index must be less than numSegments().
+      void getSegment(size_t index, const char*& buf, size_t& len) const;
+
+      /// Appends the segments, in order, to out.
+      void gather(Data& out) const;
+
+      static const size_t CopyLimit = 32;
+
+   private:
+      // Unbuffered, so that copy() can be called between writes to the
+      // stream.
+      class ScratchBuffer :
+#ifdef RESIP_USE_STL_STREAMS
+         public std::streambuf
+#else
+         public ResipStreamBuf
+#endif
+      {
+         public:
+            explicit ScratchBuffer(EncodeSegments& segs) : mSegs(segs) {}
+
+         protected:
+#ifdef RESIP_USE_STL_STREAMS
+            virtual std::streamsize xsputn(const char* s, std::streamsize count);
+            virtual int overflow(int c = -1);
+#else
+            virtual size_t writebuf(const char* s, size_t count);
+            virtual size_t readbuf(char* buf, size_t count) {return 0;}
+            virtual size_t putbuf(char ch);
+            virtual void flushbuf(void) {}
+            virtual UInt64 tellpbuf(void) {return mSegs.size();}
+#endif
+
+         private:
+            EncodeSegments& mSegs;
+      };
+
+      // mBuf of 0 means mPos is an offset into mScratch, which can be
+      // reallocated while segments are still being added.
+      struct Segment
+      {
+         const char* mBuf;
+         size_t mPos;
+         size_t mLen;
+      };
+
+      std::vector<Segment> mSegments;
+      size_t mSize;
+      Data mScratch;
+      ScratchBuffer mBuffer;
+      // made on first use; most of a received message needs no encoding
+      std::auto_ptr<EncodeStream> mStream;
+
+      // disabled
+      EncodeSegments(const EncodeSegments&);
+      EncodeSegments& operator=(const EncodeSegments&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -8,6 +8,7 @@
 
 #include "rutil/ResipAssert.h"
 #include "rutil/ParseBuffer.hxx"
+#include "rutil/DataIntern.hxx"
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::SIP
 
@@ -25,6 +26,8 @@ ExtensionHeader::ExtensionHeader(const char* name)
    if (Headers::getType(mName.data(), (int)mName.size()) != Headers::UNKNOWN) {
       throw Exception("Extension header name is not unknown",__FILE__,__LINE__);
    }
+   // Lets messages that carry this header share the name rather than copy it.
+   DataIntern::intern(mName);
 }
 
 ExtensionHeader::ExtensionHeader(const Data& name)
@@ -38,6 +41,7 @@ ExtensionHeader::ExtensionHeader(const Data& name)
    if (Headers::getType(mName.data(), (int)mName.size()) != Headers::UNKNOWN) {
       throw Exception("Extension header name is not unknown",__FILE__,__LINE__);
    }
+   DataIntern::intern(mName);
 }
 
 const Data&
@@ -6,6 +6,7 @@
 #include "ParameterTypeEnums.hxx"
 
 #include "rutil/ResipAssert.h"
+#include "rutil/DataIntern.hxx"
 #include <string.h>
 
 using namespace resip;
@@ -18,6 +19,8 @@ ExtensionParameter::ExtensionParameter(const Data& name)
       resip_assert(false);
       throw Exception("Empty extension parameter",__FILE__,__LINE__);
    }
+   // Lets parsed parameters with this name share it rather than copy it.
+   DataIntern::intern(mName);
 }
 
 const Data& 
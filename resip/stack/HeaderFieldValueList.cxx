@@ -9,6 +9,8 @@
 #include "resip/stack/HeaderFieldValueList.hxx"
 #include "resip/stack/ParserContainerBase.hxx"
 #include "resip/stack/Embedded.hxx"
+#include "resip/stack/EncodeSegments.hxx"
+#include "rutil/DataStream.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
 using namespace resip;
@@ -136,6 +138,101 @@ HeaderFieldValueList::encode(const Data& headerName, EncodeStream& str) const
    return str;
 }
 
+void
+HeaderFieldValueList::encode(int headerEnum, EncodeSegments& segs) const
+{
+   const Data& headerName = Headers::getHeaderName(static_cast<Headers::Type>(headerEnum));
+
+   if (getParserContainer() != 0)
+   {
+      getParserContainer()->encode(headerName, segs);
+   }
+   else
+   {
+      encodeRaw(headerName,
+                Headers::isCommaEncoding(static_cast<Headers::Type>(headerEnum)),
+                segs);
+   }
+}
+
+void
+HeaderFieldValueList::encode(const Data& headerName, EncodeSegments& segs) const
+{
+   if (getParserContainer() != 0)
+   {
+      getParserContainer()->encode(headerName, segs);
+   }
+   else
+   {
+      encodeRaw(headerName, true, segs);
+   }
+}
+
+void
+HeaderFieldValueList::encodeRaw(const Data& headerName,
+                                bool commaEncoding,
+                                EncodeSegments& segs) const
+{
+   static const char nameSep[] = ": ";
+   static const char commaSep[] = ", ";
+   static const char crlf[] = "\r\n";
+
+   if (!headerName.empty())
+   {
+      segs.add(headerName);
+      segs.add(nameSep, 2);
+   }
+
+   for (HeaderFieldValueList::const_iterator j = begin(); j != end(); ++j)
+   {
+      if (j != begin())
+      {
+         if (commaEncoding)
+         {
+            segs.add(commaSep, 2);
+         }
+         else
+         {
+            segs.add(crlf, 2);
+            segs.add(headerName);
+            segs.add(nameSep, 2);
+         }
+      }
+      segs.add(j->getBuffer(), j->getLength());
+   }
+   segs.add(crlf, 2);
+}
+
+void
+HeaderFieldValueList::encodeValues(Data& text, std::vector<size_t>& ends) const
+{
+   if (getParserContainer() != 0)
+   {
+      for (ParserContainerBase::size_type i = 0; i < getParserContainer()->size(); ++i)
+      {
+         const HeaderFieldValue* raw = getParserContainer()->getRawValue(i);
+         if (raw)
+         {
+            text.append(raw->getBuffer(), raw->getLength());
+         }
+         else
+         {
+            DataStream str(text);
+            getParserContainer()->encodeValue(i, str);
+         }
+         ends.push_back(text.size());
+      }
+   }
+   else
+   {
+      for (HeaderFieldValueList::const_iterator j = begin(); j != end(); ++j)
+      {
+         text.append(j->getBuffer(), j->getLength());
+         ends.push_back(text.size());
+      }
+   }
+}
+
 EncodeStream&
 HeaderFieldValueList::encodeEmbedded(const Data& headerName, EncodeStream& str) const
 {
@@ -192,6 +289,19 @@ HeaderFieldValueList::parsedEmpty() const
    }
 }
 
+void
+HeaderFieldValueList::grow()
+{
+   ListImpl bigger(mHeaders.get_allocator());
+   bigger.reserve(mHeaders.empty() ? 1 : 2*mHeaders.size());
+   for (iterator i = mHeaders.begin(); i != mHeaders.end(); ++i)
+   {
+      bigger.push_back(HeaderFieldValue::Empty);
+      bigger.back().swap(*i);
+   }
+   mHeaders.swap(bigger);
+}
+
 void 
 HeaderFieldValueList::freeParserContainer()
 {
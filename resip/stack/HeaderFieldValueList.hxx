@@ -13,6 +13,7 @@ namespace resip
 class Data;
 class ParserContainerBase;
 class HeaderFieldValue;
+class EncodeSegments;
 
 /**
    @internal
@@ -45,6 +46,13 @@ class HeaderFieldValueList
       EncodeStream& encode(int headerEnum, EncodeStream& str) const;
       EncodeStream& encode(const Data& headerName, EncodeStream& str) const;
       EncodeStream& encodeEmbedded(const Data& headerName, EncodeStream& str) const;
+      // Like encode(), but values that have not been modified since they were
+      // parsed are referred to rather than copied.
+      void encode(int headerEnum, EncodeSegments& segs) const;
+      void encode(const Data& headerName, EncodeSegments& segs) const;
+      // Encodes each value on its own (no header name or separators) and
+      // adds the size of text reached after each one to ends.
+      void encodeValues(Data& text, std::vector<size_t>& ends) const;
 
       bool empty() const {return mHeaders.empty();}
       size_t size() const {return mHeaders.size();}
@@ -65,6 +73,10 @@ class HeaderFieldValueList
       */
       void push_back(const char* buffer, size_t length, bool own) 
       {
+         if(mHeaders.size()==mHeaders.capacity())
+         {
+            grow();
+         }
          mHeaders.push_back(HeaderFieldValue::Empty); 
          mHeaders.back().init(buffer,length,own);
       }
@@ -94,6 +106,12 @@ class HeaderFieldValueList
       const_iterator end() const {return mHeaders.end();}
 
    private:
+      // Makes room by swapping the values into a larger vector; letting the
+      // vector reallocate would deep-copy every field we own.
+      void grow();
+      void encodeRaw(const Data& headerName, bool commaEncoding,
+                     EncodeSegments& segs) const;
+
       ListImpl mHeaders;
       PoolBase* mPool;
       ParserContainerBase* mParserContainer;
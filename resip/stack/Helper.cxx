@@ -2,6 +2,7 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 #include <iomanip>
 #include <algorithm>
@@ -21,6 +22,7 @@
 #include "rutil/DnsUtil.hxx"
 #include "rutil/compat.hxx"
 #include "rutil/ParseBuffer.hxx"
+#include "rutil/ThreadIf.hxx"
 #include "rutil/TransportType.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/Pkcs7Contents.hxx"
@@ -373,11 +375,20 @@ Helper::makeResponse(SipMessage& response,
 {
    DebugLog(<< "Helper::makeResponse(" << request.brief() << " code=" << responseCode << " reason=" << reason);
    response.header(h_StatusLine).responseCode() = responseCode;
-   response.header(h_From) = request.header(h_From);
-   response.header(h_To) = request.header(h_To);
-   response.header(h_CallId) = request.header(h_CallId);
-   response.header(h_CSeq) = request.header(h_CSeq);
-   response.header(h_Vias) = request.header(h_Vias);
+
+   // Copying these as text spares us cloning the request's parse trees; in
+   // the response they are only parsed if someone looks at them.
+   static const Headers::Type echoed[] = 
+   {
+      Headers::From, Headers::To, Headers::CallID, Headers::CSeq, Headers::Via,
+      Headers::RecordRoute
+   };
+   size_t numEchoed = sizeof(echoed)/sizeof(*echoed);
+   if (!(responseCode >= 180 && responseCode < 300 && request.exists(h_RecordRoutes)))
+   {
+      --numEchoed;
+   }
+   response.copyHeadersUnparsed(request, echoed, numEchoed);
 
    if (!warning.empty())
    {
@@ -389,8 +400,8 @@ Helper::makeResponse(SipMessage& response,
    }
 
    if(responseCode > 100 &&
-      response.const_header(h_To).isWellFormed() &&
-      !response.const_header(h_To).exists(p_tag))
+      request.const_header(h_To).isWellFormed() &&
+      !request.const_header(h_To).exists(p_tag))
    {
       // Only generate a To: tag if one doesn't exist.  Think Re-INVITE.   
       // No totag for failure responses or 100s   
@@ -405,17 +416,12 @@ Helper::makeResponse(SipMessage& response,
    
    //response.header(h_ContentLength).value() = 0;
    
-   if (responseCode >= 180 && responseCode < 300 && request.exists(h_RecordRoutes))
-   {
-      response.header(h_RecordRoutes) = request.header(h_RecordRoutes);
-   }
-
    // .bwc. If CSeq is malformed, basicCheck would have already attempted to
    // parse it, meaning we won't throw here (we never try to parse the same
    // thing twice, see LazyParser::checkParsed())
    if (responseCode/100 == 2 &&
          !response.exists(h_Contacts) &&
-         !(response.const_header(h_CSeq).method()==CANCEL) )
+         !(request.const_header(h_CSeq).method()==CANCEL) )
    {
       // in general, this should not create a Contact header since only requests
       // that create a dialog (or REGISTER requests) should produce a response with
@@ -641,16 +647,32 @@ Helper::computeUniqueBranch()
 {
    Data result(16, Data::Preallocate);
    result += cookie;
-   result += Random::getRandomHex(4);
+   result += Random::getFastRandomHex(4);
    result += "C1";
-   result += Random::getRandomHex(2);
+   result += Random::getFastRandomHex(2);
    return result;
 }
 
+namespace
+{
+// Per-thread target of Helper::setCallIdShard().
+struct CallIdShard
+{
+   unsigned int shard;
+   unsigned int shards;
+};
+
+ThreadLocal<CallIdShard>&
+callIdShards()
+{
+   static ThreadLocal<CallIdShard> shards;
+   return shards;
+}
+
 Data
-Helper::computeCallId()
+makeCallId()
 {
-   Data hostAndSalt(DnsUtil::getLocalHostName() + Random::getRandomHex(16));
+   Data hostAndSalt(DnsUtil::getLocalHostName() + Random::getFastRandomHex(16));
 #ifndef USE_SSL // .bwc. None of this is neccessary if we're using openssl
 #if defined(__linux__) || defined(__APPLE__)
    pid_t pid = getpid();
@@ -669,11 +691,45 @@ Helper::computeCallId()
 #endif // of USE_SSL
    return hostAndSalt.md5(Data::BASE64);
 }
+}
+
+Data
+Helper::computeCallId()
+{
+   const CallIdShard* target = callIdShards().peek();
+   if (target == 0 || target->shards <= 1)
+   {
+      return makeCallId();
+   }
+
+   // Takes target->shards tries on average.
+   Data callId;
+   do
+   {
+      callId = makeCallId();
+   } while (callIdShard(callId, target->shards) != target->shard);
+   return callId;
+}
+
+unsigned int
+Helper::callIdShard(const Data& callId, unsigned int shards)
+{
+   return shards > 1 ? (unsigned int)(callId.hash() % shards) : 0;
+}
+
+void
+Helper::setCallIdShard(unsigned int shard, unsigned int shards)
+{
+   CallIdShard* target = callIdShards().get();
+   resip_assert(shards <= 1 || shard < shards);
+   target->shard = shard;
+   target->shards = shards;
+}
 
 Data
 Helper::computeTag(int numBytes)
 {
-   return Random::getRandomHex(numBytes);
+   return Random::getFastRandomHex(numBytes);
 }
 
 void
@@ -394,6 +394,22 @@ class Helper
       static Data computeCallId();
       static Data computeTag(int numBytes);
 
+      /**
+          The TransactionController shard, out of shards, that messages with
+          this Call-ID belong to when the stack shards by Call-ID (see
+          SipStackOptions::mShardByCallId).
+      */
+      static unsigned int callIdShard(const Data& callId, unsigned int shards);
+
+      /**
+          Makes computeCallId() return, on the calling thread only, Call-IDs
+          that callIdShard() assigns to shard. A TransactionUser bound to a
+          shard (TransactionUser::setShard()) calls this from the thread it
+          runs in, so that the dialogs it starts stay in its shard. shards
+          of 1 or less turns this off again.
+      */
+      static void setCallIdShard(unsigned int shard, unsigned int shards);
+
       enum AuthResult {Failed = 1, Authenticated, Expired, BadlyFormed};
 
       static AuthResult authenticateRequest(const SipMessage& request, 
@@ -8,6 +8,7 @@
 #include "resip/stack/Headers.hxx"
 #include "resip/stack/HeaderFieldValue.hxx"
 #include "resip/stack/LazyParser.hxx"
+#include "resip/stack/EncodeSegments.hxx"
 #include "rutil/ParseBuffer.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
@@ -115,6 +116,19 @@ LazyParser::encode(EncodeStream& str) const
    }
 }
 
+void
+LazyParser::encode(EncodeSegments& segs) const
+{
+   if (mState == DIRTY)
+   {
+      encodeParsed(segs.stream());
+   }
+   else
+   {
+      segs.add(mHeaderField.getBuffer(), mHeaderField.getLength());
+   }
+}
+
 #ifndef  RESIP_USE_STL_STREAMS
 EncodeStream&
 resip::operator<<(EncodeStream&s, const LazyParser& lp)
@@ -14,6 +14,7 @@ namespace resip
 
 class ParseBuffer;
 class Data;
+class EncodeSegments;
 
 /**
    @brief The base-class for all lazily-parsed SIP grammar elements.
@@ -84,6 +85,13 @@ class LazyParser
       */
       EncodeStream& encode(EncodeStream& str) const;
 
+      /**
+         @internal
+         @brief Like encode(EncodeStream&), but refers to the original text
+            instead of copying it if this element has not been modified.
+      */
+      void encode(EncodeSegments& segs) const;
+
       /**
          @brief Returns true iff a parse has been attempted.
          @note This means that this will return true if a parse failed earlier.
@@ -94,6 +102,17 @@ class LazyParser
          @internal
       */
       HeaderFieldValue& getHeaderField() { return mHeaderField; }
+      /**
+         @internal
+      */
+      const HeaderFieldValue& getHeaderField() const { return mHeaderField; }
+
+      /**
+         @brief Returns true iff this element has been (or may have been)
+            modified since it was parsed, so that its original text can no
+            longer be used to encode it.
+      */
+      bool isDirty() const {return mState==DIRTY;}
 
       // call (internally) before every access 
       /**
@@ -8,8 +8,23 @@
 #include "resip/stack/HeaderTypes.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/MsgHeaderScanner.hxx"
+#include "rutil/ResipAssert.h"
 #include "rutil/WinLeakCheck.hxx"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define RESIP_MSG_HEADER_SCANNER_SSE2
+#  include <emmintrin.h>
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  endif
+// AVX2 code is compiled per function and only run if the CPU supports it.
+#  if (defined(__x86_64__) || defined(__i386__)) && \
+      (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#    define RESIP_MSG_HEADER_SCANNER_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+
 namespace resip 
 {
 
@@ -412,6 +427,167 @@ static void initStateMachine()
                   sMsgStart); // Arbitrary but possibly handy.
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//   The status line and value scanning states loop on themselves, doing
+//   nothing, for almost every character.  A character is "plain" if that holds
+//   in every one of those states and it sets no text property bit.  Runs of
+//   plain characters are skipped without consulting the state machine.
+
+static bool skipStateArray[numStates];
+static bool plainCharArray[UCHAR_MAX+1];
+
+static void initSkipArrays()
+{
+   static const State skipStates[] = { sScanStatusLine,
+                                       sScan1Value,
+                                       sScanNValue,
+                                       sScanNValueInQuotes,
+                                       sScanNValueInAngles };
+   const size_t numSkipStates = sizeof(skipStates) / sizeof(skipStates[0]);
+   for (size_t i = 0; i < numSkipStates; ++i)
+   {
+      skipStateArray[c2i(skipStates[i])] = true;
+   }
+   for (unsigned int charIndex = 0; charIndex <= UCHAR_MAX; ++charIndex)
+   {
+      const CharInfo &charInfo = charInfoArray[charIndex];
+      bool isPlain = (charInfo.textPropBitMask == 0);
+      for (size_t i = 0; isPlain && i < numSkipStates; ++i)
+      {
+         const TransitionInfo &transitionInfo =
+            stateMachine[c2i(skipStates[i])][c2i(charInfo.category)];
+         isPlain = (transitionInfo.action == taNone &&
+                    transitionInfo.nextState == skipStates[i]);
+      }
+      plainCharArray[charIndex] = isPlain;
+   }
+}
+
+//   A skip function returns the first character at or after "charPtr" that is
+//   not plain.  "termCharPtr" points at the chunk's sentinel, which is never
+//   plain, so it bounds the scan; vector loads never go past it.
+
+typedef char* (*SkipFunction)(char *charPtr, const char *termCharPtr);
+
+static char* skipPlainCharsScalar(char *charPtr, const char *)
+{
+   while (plainCharArray[(unsigned char)*charPtr])
+   {
+      ++charPtr;
+   }
+   return charPtr;
+}
+
+#if defined(RESIP_MSG_HEADER_SCANNER_SSE2)
+
+static inline unsigned int lowestBitIndex(unsigned int mask)
+{
+#if defined(_MSC_VER)
+   unsigned long index;
+   _BitScanForward(&index, mask);
+   return index;
+#else
+   return __builtin_ctz(mask);
+#endif
+}
+
+//   The vector code flags every byte up to ',', from ';' to '>', and '\\'.
+//   That is a superset of the characters that are not plain (it also stops on
+//   '!', '#', '&', ...), which are then checked against "plainCharArray".
+
+enum
+{
+   maybeSpecialLowMax = ',',
+   maybeSpecialMidMin = ';',
+   maybeSpecialMidRange = '>' - ';'
+};
+
+static inline bool isMaybeSpecial(unsigned char c)
+{
+   return (c <= maybeSpecialLowMax ||
+           (unsigned char)(c - maybeSpecialMidMin) <= maybeSpecialMidRange ||
+           c == '\\');
+}
+
+static inline unsigned int maybeSpecialMask(__m128i chars)
+{
+   // Unsigned "a <= b" is "min(a, b) == a".
+   __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(chars, _mm_set1_epi8(maybeSpecialLowMax)),
+                                chars);
+   __m128i mid = _mm_sub_epi8(chars, _mm_set1_epi8(maybeSpecialMidMin));
+   mid = _mm_cmpeq_epi8(_mm_min_epu8(mid, _mm_set1_epi8(maybeSpecialMidRange)), mid);
+   __m128i backslash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('\\'));
+   return (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(low, mid), backslash));
+}
+
+static char* skipPlainCharsSse2(char *charPtr, const char *termCharPtr)
+{
+   while (termCharPtr - charPtr >= 16)
+   {
+      unsigned int mask =
+         maybeSpecialMask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(charPtr)));
+      if (mask == 0)
+      {
+         charPtr += 16;
+         continue;
+      }
+      charPtr += lowestBitIndex(mask);
+      if (!plainCharArray[(unsigned char)*charPtr])
+      {
+         return charPtr;
+      }
+      ++charPtr;
+   }
+   return skipPlainCharsScalar(charPtr, termCharPtr);
+}
+
+#endif
+
+#if defined(RESIP_MSG_HEADER_SCANNER_AVX2)
+
+__attribute__((target("avx2")))
+static char* skipPlainCharsAvx2(char *charPtr, const char *termCharPtr)
+{
+   const __m256i lowMax = _mm256_set1_epi8(maybeSpecialLowMax);
+   const __m256i midMin = _mm256_set1_epi8(maybeSpecialMidMin);
+   const __m256i midRange = _mm256_set1_epi8(maybeSpecialMidRange);
+   const __m256i backslash = _mm256_set1_epi8('\\');
+   while (termCharPtr - charPtr >= 32)
+   {
+      __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(charPtr));
+      __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(chars, lowMax), chars);
+      __m256i mid = _mm256_sub_epi8(chars, midMin);
+      mid = _mm256_cmpeq_epi8(_mm256_min_epu8(mid, midRange), mid);
+      __m256i special = _mm256_or_si256(_mm256_or_si256(low, mid),
+                                        _mm256_cmpeq_epi8(chars, backslash));
+      unsigned int mask = (unsigned int)_mm256_movemask_epi8(special);
+      if (mask == 0)
+      {
+         charPtr += 32;
+         continue;
+      }
+      charPtr += lowestBitIndex(mask);
+      if (!plainCharArray[(unsigned char)*charPtr])
+      {
+         return charPtr;
+      }
+      ++charPtr;
+   }
+   return skipPlainCharsSse2(charPtr, termCharPtr);
+}
+
+static bool cpuSupportsAvx2()
+{
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") != 0;
+}
+
+#endif
+
+static MsgHeaderScanner::ValueSkipMode valueSkipMode = MsgHeaderScanner::vsmCharByChar;
+static SkipFunction skipPlainChars = 0;
+
+
 // Debug follows
 #if defined(RESIP_MSG_HEADER_SCANNER_DEBUG)  
 
@@ -917,6 +1093,7 @@ MsgHeaderScanner::scanChunk(char * chunk,
    MsgHeaderScanner::ScanChunkResult result;
    CharInfo* localCharInfoArray = charInfoArray;
    TransitionInfo (*localStateMachine)[numCharCategories] = stateMachine;
+   SkipFunction localSkipPlainChars = skipPlainChars;
    State localState = mState;
    char *charPtr = chunk + mPrevScanChunkNumSavedTextChars;
    char *termCharPtr = chunk + chunkLength;
@@ -950,7 +1127,16 @@ MsgHeaderScanner::scanChunk(char * chunk,
       printStateTransition(localState, *charPtr, transitionAction);
 #endif
       localState = transitionInfo->nextState;
-      if (transitionAction == taNone) continue;
+      if (transitionAction == taNone)
+      {
+         if (localSkipPlainChars &&
+             skipStateArray[c2i(localState)] &&
+             plainCharArray[(unsigned char)charPtr[1]])
+         {
+            charPtr = localSkipPlainChars(charPtr + 2, termCharPtr) - 1;
+         }
+         continue;
+      }
       // END message header character scan block END
       // The loop remainder is executed about 4-5 times per message header line.
       switch (transitionAction)
@@ -1067,6 +1253,69 @@ MsgHeaderScanner::initialize()
 {
    initCharInfoArray();
    initStateMachine();
+   initSkipArrays();
+#if defined(RESIP_MSG_HEADER_SCANNER_SSE2)
+   for (unsigned int charIndex = 0; charIndex <= UCHAR_MAX; ++charIndex)
+   {
+      resip_assert(isMaybeSpecial((unsigned char)charIndex) ||
+                   plainCharArray[charIndex]);
+      resip_assert(isMaybeSpecial((unsigned char)charIndex) ==
+                   (maybeSpecialMask(_mm_set1_epi8((char)charIndex)) != 0));
+   }
+#endif
+   if (!setValueSkipMode(vsmAvx2) && !setValueSkipMode(vsmSse2))
+   {
+      setValueSkipMode(vsmScalar);
+   }
+   return true;
+}
+
+MsgHeaderScanner::ValueSkipMode
+MsgHeaderScanner::getValueSkipMode()
+{
+   if (!mInitialized)
+   {
+      mInitialized = true;
+      initialize();
+   }
+   return valueSkipMode;
+}
+
+bool
+MsgHeaderScanner::setValueSkipMode(ValueSkipMode mode)
+{
+   if (!mInitialized)
+   {
+      mInitialized = true;
+      initialize();
+   }
+   SkipFunction skipFunction = 0;
+   switch (mode)
+   {
+      case vsmCharByChar:
+         break;
+      case vsmScalar:
+         skipFunction = skipPlainCharsScalar;
+         break;
+#if defined(RESIP_MSG_HEADER_SCANNER_SSE2)
+      case vsmSse2:
+         skipFunction = skipPlainCharsSse2;
+         break;
+#endif
+#if defined(RESIP_MSG_HEADER_SCANNER_AVX2)
+      case vsmAvx2:
+         if (!cpuSupportsAvx2())
+         {
+            return false;
+         }
+         skipFunction = skipPlainCharsAvx2;
+         break;
+#endif
+      default:
+         return false;
+   }
+   valueSkipMode = mode;
+   skipPlainChars = skipFunction;
    return true;
 }
 
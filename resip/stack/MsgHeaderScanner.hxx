@@ -119,7 +119,24 @@ class MsgHeaderScanner
     
       // !ah! DEBUG only, write to fd.
       // !ah! for documentation generation
-      static int dumpStateMachine(int fd); 
+      static int dumpStateMachine(int fd);
+
+      // While scanning the status line or a value, runs of characters that
+      // cannot change the scanner's state are skipped in bulk rather than fed
+      // through the state machine one by one.  The fastest mode the CPU
+      // supports is selected when the first scanner is constructed;
+      // vsmCharByChar disables skipping altogether.  Forcing a mode is only
+      // meant for tests and benchmarks, and is not thread safe.
+      enum ValueSkipMode {
+         vsmCharByChar,
+         vsmScalar,
+         vsmSse2,
+         vsmAvx2
+      };
+      static ValueSkipMode getValueSkipMode();
+      // Returns false, leaving the mode unchanged, if the CPU or the build
+      // does not support the requested mode.
+      static bool setValueSkipMode(ValueSkipMode mode);
 
    private:
 
@@ -131,7 +148,7 @@ class MsgHeaderScanner
       MsgHeaderScanner & operator=(const MsgHeaderScanner & from);
 
       // Automatically called when 1st MsgHeaderScanner constructed.
-      bool initialize();
+      static bool initialize();
       static bool mInitialized;
 
 
@@ -2,6 +2,7 @@
 
 #include "resip/stack/ParserContainerBase.hxx"
 #include "resip/stack/Embedded.hxx"
+#include "resip/stack/EncodeSegments.hxx"
 
 using namespace resip;
 using namespace std;;
@@ -114,6 +115,53 @@ ParserContainerBase::encode(const Data& headerName,
    return str;
 }
 
+void
+ParserContainerBase::encode(const Data& headerName, 
+                            EncodeSegments& segs) const
+{
+   static const char nameSep[] = ": ";
+   static const char commaSep[] = ", ";
+   static const char crlf[] = "\r\n";
+
+   if (!mParsers.empty())
+   {
+      if (!headerName.empty())
+      {
+         segs.add(headerName);
+         segs.add(nameSep, 2);
+      }
+
+      for (size_type i = 0; i < mParsers.size(); ++i)
+      {
+         if (i != 0)
+         {
+            if (Headers::isCommaEncoding(mType))
+            {
+               segs.add(commaSep, 2);
+            }
+            else
+            {
+               segs.add(crlf, 2);
+               segs.add(headerName);
+               segs.add(nameSep, 2);
+            }
+         }
+
+         const HeaderKit& kit = mParsers[i];
+         if (kit.pc)
+         {
+            kit.pc->encode(segs);
+         }
+         else
+         {
+            segs.add(kit.hfv.getBuffer(), kit.hfv.getLength());
+         }
+      }
+
+      segs.add(crlf, 2);
+   }
+}
+
 EncodeStream&
 ParserContainerBase::encodeEmbedded(const Data& headerName, 
                                     EncodeStream& str) const
@@ -14,6 +14,7 @@ namespace resip
 
 class HeaderFieldValueList;
 class PoolBase;
+class EncodeSegments;
 
 /**
   @class ParserContainerBase
@@ -86,6 +87,14 @@ class ParserContainerBase
         */
       EncodeStream& encode(const Data& headerName, EncodeStream& str) const;
 
+      /**
+        @internal
+        @brief encodes like encode(headerName, str), but refers to the
+         original text of elements that have not been modified since they
+         were parsed instead of copying it
+        */
+      void encode(const Data& headerName, EncodeSegments& segs) const;
+
       /**
         @internal
         @brief the actual mechanics of parsing
@@ -115,6 +124,32 @@ class ParserContainerBase
         */
       void append(const ParserContainerBase& rhs);
 
+      /**
+        @internal
+        @brief encodes the element at index on its own, without the header
+         name or separators; an element that has not been modified since it
+         was parsed is written out as its original text
+        */
+      EncodeStream& encodeValue(size_type index, EncodeStream& str) const
+      {
+         return mParsers[index].encode(str);
+      }
+
+      /**
+        @internal
+        @brief the original text of the element at index, or 0 if it has
+         been modified since it was parsed
+        */
+      const HeaderFieldValue* getRawValue(size_type index) const
+      {
+         const HeaderKit& kit = mParsers[index];
+         if (!kit.pc)
+         {
+            return &kit.hfv;
+         }
+         return kit.pc->isDirty() ? 0 : &kit.pc->getHeaderField();
+      }
+
       /**
         @brief pure virtual function to be implemented in derived classes
          The intention is to provide an ability to parse all elements 
@@ -1,6 +1,8 @@
 #ifndef RESIP_SendData_HXX
 #define RESIP_SendData_HXX
 
+#include <vector>
+
 #include "rutil/Data.hxx"
 #include "resip/stack/Tuple.hxx"
 
@@ -56,15 +58,39 @@ class SendData
       void clear()
       {
          data.clear();
+         moreData.clear();
       }
 
       bool empty() const
       {
-         return data.empty();
+         return size() == 0;
+      }
+
+      /// Total number of bytes in data and moreData.
+      size_t size() const
+      {
+         size_t total = data.size();
+         for (std::vector<Data>::const_iterator i = moreData.begin();
+              i != moreData.end(); ++i)
+         {
+            total += i->size();
+         }
+         return total;
+      }
+
+      /// data is segment 0, moreData[0] segment 1 and so on.
+      size_t numSegments() const {return 1 + moreData.size();}
+      const Data& segment(size_t index) const
+      {
+         return index == 0 ? data : moreData[index - 1];
       }
 
       Tuple destination;
       Data data;
+      // Further segments, sent after data in order. They let a connection
+      // put a frame header in front of a message without copying it.
+      // Only connection-oriented transports look at these.
+      std::vector<Data> moreData;
       Data transactionId;
       Data sigcompId;
       bool isAlreadyCompressed;
@@ -4,12 +4,14 @@
 
 #include "resip/stack/Contents.hxx"
 #include "resip/stack/Embedded.hxx"
+#include "resip/stack/EncodeSegments.hxx"
 #include "resip/stack/OctetContents.hxx"
 #include "resip/stack/HeaderFieldValueList.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/ExtensionHeader.hxx"
 #include "rutil/Coders.hxx"
 #include "rutil/CountStream.hxx"
+#include "rutil/DataIntern.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/MD5Stream.hxx"
 #include "rutil/compat.hxx"
@@ -37,6 +39,7 @@ SipMessage::SipMessage(const Tuple *receivedTransportTuple)
 #else
      mUnknownHeaders(),
 #endif
+     mBufferList(StlPoolAllocator<char*, PoolBase >(&mPool)),
      mRequest(false),
      mResponse(false),
      mInvalid(false),
@@ -59,6 +62,7 @@ SipMessage::SipMessage(const SipMessage& from)
 #else
      mUnknownHeaders(),
 #endif
+     mBufferList(StlPoolAllocator<char*, PoolBase >(&mPool)),
      mCreatedTime(Timer::getTimeMicroSec())
 {
    init(from);
@@ -87,12 +91,12 @@ SipMessage::~SipMessage()
 #ifdef DINKYPOOL_PROFILING
    if (mPool.getHeapBytes() > 0)
    {
-       InfoLog(<< "SipMessage mPool filled up and used " << mPool.getHeapBytes() << " bytes on the heap, consider increasing the mPool size (sizeof SipMessage is " << sizeof(SipMessage) << " bytes): msg="
+       InfoLog(<< "SipMessage mPool filled up and used " << mPool.getHeapBytes() << " bytes in " << mPool.getHeapAllocations() << " heap allocations, consider increasing the mPool size (sizeof SipMessage is " << sizeof(SipMessage) << " bytes): msg="
            << std::endl << *this);
    }
    else
    {
-       InfoLog(<< "SipMessage mPool used " << mPool.getPoolBytes() << " bytes of a total " << mPool.getPoolSizeBytes() << " bytes (sizeof SipMessage is " << sizeof(SipMessage) << " bytes): msg="
+       InfoLog(<< "SipMessage mPool used " << mPool.getPoolBytes() << " bytes of a total " << mPool.getPoolSizeBytes() << " bytes in " << mPool.getChunkCount() << " extra chunks (sizeof SipMessage is " << sizeof(SipMessage) << " bytes): msg="
            << std::endl << *this);
    }
 #endif
@@ -161,8 +165,9 @@ SipMessage::init(const SipMessage& rhs)
         i != rhs.mUnknownHeaders.end(); i++)
    {
       mUnknownHeaders.push_back(pair<Data, HeaderFieldValueList*>(
-                                   i->first,
+                                   Data::Empty,
                                    getCopyHfvl(*i->second)));
+      DataIntern::assign(mUnknownHeaders.back().first, i->first.data(), i->first.size());
    }
    if (rhs.mStartLine != 0)
    {
@@ -232,7 +237,7 @@ SipMessage::freeMem(bool leaveResponseStuff)
    {
       clearHeaders();
 
-      for (vector<char*>::iterator i = mBufferList.begin();
+      for (std::vector<char*, StlPoolAllocator<char*, PoolBase> >::iterator i = mBufferList.begin();
            i != mBufferList.end(); i++)
       {
          delete [] *i;
@@ -776,6 +781,73 @@ SipMessage::encode(EncodeStream& str, bool isSipFrag) const
    return str;
 }
 
+void
+SipMessage::encode(EncodeSegments& segs) const
+{
+   static const char crlf[] = "\r\n";
+   static const char contentLength[] = "Content-Length: ";
+
+   if (mStartLine != 0)
+   {
+      mStartLine->encode(segs);
+      segs.add(crlf, 2);
+   }
+
+   for (UInt8 i = 0; i < Headers::MAX_HEADERS; i++)
+   {
+      if (i != Headers::ContentLength) // !dlb! hack...
+      {
+         if (mHeaderIndices[i] > 0)
+         {
+            mHeaders[mHeaderIndices[i]]->encode(i, segs);
+         }
+      }
+   }
+
+   for (UnknownHeaders::const_iterator i = mUnknownHeaders.begin(); 
+        i != mUnknownHeaders.end(); i++)
+   {
+      i->second->encode(i->first, segs);
+   }
+
+   // The body has to be sized before the Content-Length goes out. A body
+   // that was modified is encoded here and copied into segs.
+   Data contents;
+   const char* body = 0;
+   size_t bodyLength = 0;
+   if (mContents != 0)
+   {
+      if (mContents->isDirty())
+      {
+         oDataStream temp(contents);
+         mContents->encode(temp);
+      }
+      else
+      {
+         body = mContents->getHeaderField().getBuffer();
+         bodyLength = mContents->getHeaderField().getLength();
+      }
+   }
+   else if (mContentsHfv.getBuffer() != 0)
+   {
+      body = mContentsHfv.getBuffer();
+      bodyLength = mContentsHfv.getLength();
+   }
+
+   segs.add(contentLength, sizeof(contentLength) - 1);
+   Data length(UInt64(body ? bodyLength : contents.size()));
+   segs.copy(length.data(), length.size());
+   segs.add(Symbols::CRLFCRLF, 4);
+   if (body)
+   {
+      segs.add(body, bodyLength);
+   }
+   else
+   {
+      segs.copy(contents.data(), contents.size());
+   }
+}
+
 EncodeStream&
 SipMessage::encodeSingleHeader(Headers::Type type, EncodeStream& str) const
 {
@@ -1163,7 +1235,8 @@ SipMessage::header(const ExtensionHeader& headerName)
    // create the list empty
    HeaderFieldValueList* hfvs = getEmptyHfvl();
    hfvs->setParserContainer(makeParserContainer<StringCategory>(hfvs, Headers::RESIP_DO_NOT_USE));
-   mUnknownHeaders.push_back(make_pair(headerName.getName(), hfvs));
+   mUnknownHeaders.push_back(make_pair(Data::Empty, hfvs));
+   DataIntern::assign(mUnknownHeaders.back().first, headerName.getName().data(), headerName.getName().size());
    return *dynamic_cast<ParserContainer<StringCategory>*>(hfvs->getParserContainer());
 }
 
@@ -1275,8 +1348,10 @@ SipMessage::addHeader(Headers::Type header, const char* headerName, int headerLe
       {
          hfvs->push_back(start, len, false);
       }
-      mUnknownHeaders.push_back(pair<Data, HeaderFieldValueList*>(Data(headerName, headerLen),
-                                                                  hfvs));
+      // Names of ExtensionHeaders are interned; share those instead of
+      // copying them.
+      mUnknownHeaders.push_back(pair<Data, HeaderFieldValueList*>(Data::Empty, hfvs));
+      DataIntern::assign(mUnknownHeaders.back().first, headerName, headerLen);
    }
 }
 
@@ -1621,6 +1696,64 @@ SipMessage::setRawHeader(const HeaderFieldValueList* hfvs, Headers::Type headerT
    }
 }
 
+void
+SipMessage::copyHeadersUnparsed(const SipMessage& msg,
+                                const Headers::Type* types,
+                                size_t numTypes)
+{
+   Data text(512, Data::Preallocate);
+   std::vector<size_t> ends;
+   std::vector<size_t> lastEnd; // per type, index into ends past its values
+   for (size_t t = 0; t < numTypes; ++t)
+   {
+      const HeaderFieldValueList* hfvs = msg.getRawHeader(types[t]);
+      if (hfvs)
+      {
+         hfvs->encodeValues(text, ends);
+      }
+      lastEnd.push_back(ends.size());
+   }
+
+   char* buffer = 0;
+   if (!text.empty())
+   {
+      buffer = new char[text.size()];
+      memcpy(buffer, text.data(), text.size());
+      addBuffer(buffer);
+   }
+
+   size_t e = 0;
+   size_t start = 0;
+   for (size_t t = 0; t < numTypes; ++t)
+   {
+      if (msg.getRawHeader(types[t]) == 0)
+      {
+         remove(types[t]);
+         continue;
+      }
+
+      HeaderFieldValueList* hfvs = ensureHeaders(types[t]);
+      hfvs->clear();
+      for (; e < lastEnd[t]; ++e)
+      {
+         if (ends[e] == start)
+         {
+            // empty values stay unparsed-and-empty, as ensureHeader() makes them
+            hfvs->push_back(0, 0, false);
+         }
+         else
+         {
+            hfvs->push_back(buffer + start, ends[e] - start, false);
+         }
+         start = ends[e];
+      }
+      if (!Headers::isMulti(types[t]) && hfvs->empty())
+      {
+         hfvs->push_back(0, 0, false);
+      }
+   }
+}
+
 void
 SipMessage::setForceTarget(const Uri& uri)
 {
@@ -21,7 +21,7 @@
 #include "resip/stack/WsCookieContext.hxx"
 #include "rutil/BaseException.hxx"
 #include "rutil/Data.hxx"
-#include "rutil/DinkyPool.hxx"
+#include "rutil/ArenaPool.hxx"
 #include "rutil/StlPoolAllocator.hxx"
 #include "rutil/Timer.hxx"
 #include "rutil/HeapInstanceCounter.hxx"
@@ -31,6 +31,7 @@ namespace resip
 {
 
 class Contents;
+class EncodeSegments;
 class ExtensionHeader;
 class SecurityAttributes;
 
@@ -264,6 +265,15 @@ class SipMessage : public TransactionMessage
       @return string representation of a SIP message.
       */
       virtual EncodeStream& encode(EncodeStream& str) const;      
+      /** @brief Encodes the message as a list of segments.
+
+      Header values, the start line and the body are referred to as received
+      unless they have been modified; only modified elements, the
+      Content-Length and the separators between headers are generated. The
+      segments point into this message, so they are only good while it is
+      alive and unchanged. The output is the same as encode(EncodeStream&).
+      */
+      virtual void encode(EncodeSegments& segs) const;
       //sipfrags will not output Content Length if there is no body--introduce
       //friendship to hide this?
       virtual EncodeStream& encodeSipFrag(EncodeStream& str) const;
@@ -465,6 +475,19 @@ class SipMessage : public TransactionMessage
       /// typeless header interface
       const HeaderFieldValueList* getRawHeader(Headers::Type headerType) const;
       void setRawHeader(const HeaderFieldValueList* hfvs, Headers::Type headerType);
+      /**
+         Replaces the headers of the given types with those of msg, copied as
+         text instead of as parsed objects. Values msg has not modified are
+         copied as received; modified ones are encoded. All of the text goes
+         into one buffer owned by this message, and nothing is parsed until
+         it is accessed here. Headers msg does not have are removed.
+
+         This is much cheaper than assigning parsed headers when they are
+         just echoed back, as Helper::makeResponse() does.
+      */
+      void copyHeadersUnparsed(const SipMessage& msg,
+                               const Headers::Type* types,
+                               size_t numTypes);
       const UnknownHeaders& getRawUnknownHeaders() const {return mUnknownHeaders;}
       /**
          Return the raw body string (if it exists). The returned HFV
@@ -667,7 +690,9 @@ class SipMessage : public TransactionMessage
       // To profile current sizing, enable DINKYPOOL_PROFILING in SipMessage.cxx 
       // and look for DebugLog message in SipMessage destructor to know when heap
       // allocations are occuring and how much of the pool is used.
-      DinkyPool<3732> mPool;
+      // Bigger messages grow the pool a chunk at a time instead of falling
+      // back to a heap allocation per header, parser and parameter.
+      ArenaPool<3732> mPool;
 
       typedef std::vector<HeaderFieldValueList*, 
                            StlPoolAllocator<HeaderFieldValueList*, 
@@ -693,7 +718,7 @@ class SipMessage : public TransactionMessage
       Tuple mDestination;
       
       // Raw buffers coming from the Transport. message manages the memory
-      std::vector<char*> mBufferList;
+      std::vector<char*, StlPoolAllocator<char*, PoolBase> > mBufferList;
 
       // special case for the first line of message
       StartLine* mStartLine;
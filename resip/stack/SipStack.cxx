@@ -202,7 +202,12 @@ SipStack::init(const SipStackOptions& options)
 
    // WATCHOUT: the transaction controller constructor will
    // grab the security, DnsStub, compression and statsManager
-   mTransactionController = new TransactionController(*this, mAsyncProcessHandler, options.mUseDnsVip);
+   mTransactionController = new TransactionController(*this, 
+                                                      mAsyncProcessHandler,
+                                                      options.mUseDnsVip,
+                                                      options.mLockFreeStateMacFifo,
+                                                      options.mTransactionControllerShards,
+                                                      options.mShardByCallId);
    mTransactionController->transportSelector().setPollGrp(mPollGrp);
    mTransactionControllerThread = 0;
    mTransportSelectorThread = 0;
@@ -224,10 +229,19 @@ SipStack::~SipStack()
    DebugLog (<< "SipStack::~SipStack()");
    shutdownAndJoinThreads();
 
+   // while the DnsInterface, with the vips and marks, is still around
+   mDnsStub->saveDnsCacheSnapshot();
+
    delete mDnsThread;
    mDnsThread=0;
    delete mTransactionControllerThread;
    mTransactionControllerThread=0;
+   for(std::vector<TransactionControllerThread*>::iterator i=mTransactionControllerShardThreads.begin();
+       i!=mTransactionControllerShardThreads.end(); ++i)
+   {
+      delete *i;
+   }
+   mTransactionControllerShardThreads.clear();
    delete mTransportSelectorThread;
    mTransportSelectorThread=0;
 
@@ -268,6 +282,13 @@ SipStack::run()
    delete mTransactionControllerThread;
    mTransactionControllerThread=new TransactionControllerThread(*mTransactionController);
    mTransactionControllerThread->run();
+   for(unsigned int i=1; i<mTransactionController->getNumShards(); ++i)
+   {
+      TransactionControllerThread* shardThread = 
+         new TransactionControllerThread(mTransactionController->getShard(i));
+      mTransactionControllerShardThreads.push_back(shardThread);
+      shardThread->run();
+   }
 
    delete mTransportSelectorThread;
    mTransportSelectorThread=new TransportSelectorThread(mTransactionController->transportSelector());
@@ -303,6 +324,13 @@ SipStack::shutdownAndJoinThreads()
       mTransactionControllerThread->join();
    }
 
+   for(std::vector<TransactionControllerThread*>::iterator i=mTransactionControllerShardThreads.begin();
+       i!=mTransactionControllerShardThreads.end(); ++i)
+   {
+      (*i)->shutdown();
+      (*i)->join();
+   }
+
    if(mTransportSelectorThread)
    {
       mTransportSelectorThread->shutdown();
@@ -364,7 +392,11 @@ SipStack::addTransport( TransportType protocol,
 #endif
 
    InternalTransport* transport=0;
-   Fifo<TransactionMessage>& stateMacFifo = mTransactionController->transportSelector().stateMacFifo();
+   // With several TransactionController shards, each transport feeds one of
+   // them, round-robin in the order transports are added; messages only go
+   // on to another shard when they belong to it.
+   Fifo<TransactionMessage>& stateMacFifo = 
+      this->stateMacFifo((mNextTransportKey - 1) % getNumTransactionControllerShards());
    try
    {
       switch (protocol)
@@ -671,6 +703,12 @@ SipStack::stateMacFifo()
    return mTransactionController->transportSelector().stateMacFifo();
 }
 
+Fifo<TransactionMessage>&
+SipStack::stateMacFifo(unsigned int shard)
+{
+   return mTransactionController->getShard(shard).stateMacFifo();
+}
+
 void
 SipStack::addAlias(const Data& domain, int port)
 {
@@ -1051,7 +1089,10 @@ SipStack::processTimers()
 {
    if(!mTransactionControllerThread)
    {
-      mTransactionController->process();
+      for(unsigned int i=0; i<mTransactionController->getNumShards(); ++i)
+      {
+         mTransactionController->getShard(i).process();
+      }
    }
 
    if(!mDnsThread)
@@ -1166,6 +1207,12 @@ SipStack::unregisterTransactionUser(TransactionUser& tu)
    checkAsyncProcessHandler();
 }
 
+unsigned int
+SipStack::getNumTransactionControllerShards() const
+{
+   return mTransactionController->getNumShards();
+}
+
 void
 SipStack::registerMarkListener(MarkListener* listener)
 {
@@ -1208,6 +1255,12 @@ SipStack::logDnsCache()
    mDnsStub->logDnsCache();
 }
 
+void
+SipStack::setDnsCacheSnapshot(const Data& path, unsigned int intervalSecs)
+{
+   mDnsStub->setDnsCacheSnapshot(path, intervalSecs);
+}
+
 void 
 SipStack::getDnsCacheDump(std::pair<unsigned long, unsigned long> key, GetDnsCacheDumpHandler* handler)
 {
@@ -1247,13 +1300,13 @@ SipStack::dump(EncodeStream& strm)  const
       strm << " AppTimers size=" << this->mAppTimers.size() << std::endl;
    }
    strm << " ServerTransactionMap size=" << this->mTransactionController->mServerTransactionMap.size() << std::endl
-        << " ClientTransactionMap size=" << this->mTransactionController->mClientTransactionMap.size() << std::endl
-        // !slg! TODO - There is technically a threading concern with the following three lines and the runtime addTransport or removeTransport call
-        << " Exact interface / Specific port=" << Inserter(this->mTransactionController->mTransportSelector.mExactTransports) << std::endl
-        << " Any interface / Specific port=" << Inserter(this->mTransactionController->mTransportSelector.mAnyInterfaceTransports) << std::endl
-        << " Exact interface / Any port =" << Inserter(this->mTransactionController->mTransportSelector.mAnyPortTransports) << std::endl
-        << " Any interface / Any port=" << Inserter(this->mTransactionController->mTransportSelector.mAnyPortAnyInterfaceTransports) << std::endl
-        << " TLS Transports=" << Inserter(this->mTransactionController->mTransportSelector.mTlsTransports) << std::endl;
+        << " ClientTransactionMap size=" << this->mTransactionController->mClientTransactionMap.size() << std::endl;
+   // !slg! TODO - There is technically a threading concern with the following loop and the runtime addTransport or removeTransport call
+   const TransportSelector::TransportKeyMap& transports = this->mTransactionController->mTransportSelector.mTransports;
+   for (TransportSelector::TransportKeyMap::const_iterator it = transports.begin(); it != transports.end(); ++it)
+   {
+      strm << " Transport " << it->first << "=" << *it->second << std::endl;
+   }
    return strm;
 }
 
@@ -6,6 +6,7 @@
 #endif
 
 #include <set>
+#include <vector>
 #include <iosfwd>
 
 #include "rutil/CongestionManager.hxx"
@@ -101,6 +102,38 @@ class FdPollGrp;
            Set to true to enable Whitelisting of DNS entries.  A feature
            that usually desired by UA's that want to stick to a known
            good server / dns result.
+
+        mLockFreeStateMacFifo
+           Set to true to make the transaction state machine fifo (the queue
+           that transports, the DNS layer and TUs all post into) use
+           lock-free producers. Producers then never contend on the fifo
+           mutex; only the transaction controller thread takes it, to block
+           when there is no work. See AbstractFifo::setLockFree(). Default
+           false.
+
+        mTransactionControllerShards
+           Number of shards to split the transaction layer into. Each shard
+           has its own transaction maps, timer queue and state machine fifo,
+           and once run() is called, its own thread. Messages are assigned
+           to a shard by a hash of their transaction id, so a transaction and
+           its CANCEL/ACK always live in the same shard; the TransportSelector
+           remains shared. Transports created by addTransport() feed the
+           shards round-robin, and a shard passes on what it receives for
+           another shard. Only useful together with run(); without it the
+           stack's own process loop drives all shards. Default 1.
+
+        mShardByCallId
+           Set to true to assign messages to TransactionController shards by
+           a hash of their Call-ID (Helper::callIdShard()) instead of their
+           transaction id, so that all transactions of a dialog are handled
+           by one shard. Together with one TransactionUser bound to each
+           shard (TransactionUser::setShard()), this runs a pipeline per
+           shard that only hands a message to another thread when a
+           transport received it for another shard. Messages that only
+           carry a transaction id (transport failures, TCP connect states,
+           abandon and cancel requests from the TU) are offered to every
+           shard. A response whose Call-ID was changed by the far end is
+           lost as a stray response. Default false.
 **/
 class SipStackOptions
 {
@@ -109,7 +142,8 @@ class SipStackOptions
          : mSecurity(0), mExtraNameserverList(0),
            mAsyncProcessHandler(0), mStateless(false),
            mSocketFunc(0), mCompression(0), mPollGrp(0),
-           mUseDnsVip(false)
+           mUseDnsVip(false), mLockFreeStateMacFifo(false),
+           mTransactionControllerShards(1), mShardByCallId(false)
       {
       }
 
@@ -121,6 +155,9 @@ class SipStackOptions
       Compression *mCompression;
       FdPollGrp* mPollGrp;
       bool mUseDnsVip;
+      bool mLockFreeStateMacFifo;
+      unsigned int mTransactionControllerShards;
+      bool mShardByCallId;
 };
 
 
@@ -378,6 +415,15 @@ class SipStack : public FdSetIOObserver
       */
       Fifo<TransactionMessage>& stateMacFifo();
 
+      /**
+          Returns the state machine fifo of TransactionController shard
+          number shard, 0 <= shard < getNumTransactionControllerShards().
+          A transport may post to any shard; binding transports (or UDP
+          receive shards, see UdpTransport::setRxShards()) to different
+          shards spreads the work of handing messages to their shard.
+      */
+      Fifo<TransactionMessage>& stateMacFifo(unsigned int shard);
+
       /**
           @brief add an alias for this sip element
           
@@ -836,6 +882,10 @@ class SipStack : public FdSetIOObserver
       /** @brief Removes a TU from the TU selection chain **/
       void unregisterTransactionUser(TransactionUser&);
 
+      /** @brief Number of TransactionController shards, for TransactionUser::setShard()
+          and Helper::setCallIdShard() (see SipStackOptions::mTransactionControllerShards) **/
+      unsigned int getNumTransactionControllerShards() const;
+
       /**
           Register a handler with the DNS Interface for notifications of when a Dns
           Resource Record has been blacklisted.
@@ -900,6 +950,16 @@ class SipStack : public FdSetIOObserver
       */
       void getDnsCacheDump(std::pair<unsigned long, unsigned long> key, GetDnsCacheDumpHandler* handler);
 
+      /**
+          @brief Keep the DNS Cache across restarts
+          @details Restores the DNS Cache, along with DNS vips and 
+                   grey/blacklisted targets, from the snapshot file at path, 
+                   and saves it back there every intervalSecs and when the 
+                   stack is destroyed. Entries that expired in the meantime are 
+                   dropped.  An empty path turns this off.
+      */
+      void setDnsCacheSnapshot(const Data& path, unsigned int intervalSecs);
+
       /**
            @brief Check if DnsServers list has changed, and if so reinitializes 
                   the DNS resolver (ares).  Any lookups currenlty in progress will fail.
@@ -947,7 +1007,7 @@ class SipStack : public FdSetIOObserver
       */
       void setFixBadDialogIdentifiers(bool pFixBadDialogIdentifiers) 
       {
-         mTransactionController->mFixBadDialogIdentifiers = pFixBadDialogIdentifiers;
+         mTransactionController->setFixBadDialogIdentifiers(pFixBadDialogIdentifiers);
       }
 
       inline bool getFixBadCSeqNumbers() const
@@ -970,6 +1030,21 @@ class SipStack : public FdSetIOObserver
          return mTransactionController->transportSelector().getUdpOnlyOnNumeric();
       }
 
+      /**
+         @brief Controls how long, and for how wide a range of destinations,
+         the local address chosen by the OS to reach a destination is reused
+         (see TransportSelector::setSourceInterfaceCache()).
+         @note The transaction thread reads these settings without a lock,
+         so call this before run(), or from the thread that calls process()
+         when the stack is not run().
+      */
+      void setSourceInterfaceCache(unsigned int v4PrefixBits,
+                                   unsigned int v6PrefixBits,
+                                   unsigned int ttlSeconds)
+      {
+         mTransactionController->transportSelector().setSourceInterfaceCache(v4PrefixBits, v6PrefixBits, ttlSeconds);
+      }
+
       /**
          @todo should this be fixed to work with other applicable transports? []
          @brief Used to enable/disable content-length checking on datagram-based 
@@ -1140,6 +1215,8 @@ class SipStack : public FdSetIOObserver
       TransactionController* mTransactionController;
 
       TransactionControllerThread* mTransactionControllerThread;
+      // one for each TransactionController shard after the first
+      std::vector<TransactionControllerThread*> mTransactionControllerShardThreads;
       TransportSelectorThread* mTransportSelectorThread;
       bool mInternalThreadsRunning;
       bool mProcessingHasStarted; 
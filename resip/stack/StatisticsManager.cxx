@@ -2,11 +2,16 @@
 #include "config.h"
 #endif
 
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
+#include "rutil/dns/DnsStub.hxx"
 #include "resip/stack/StatisticsManager.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/TransactionController.hxx"
 #include "resip/stack/SipStack.hxx"
+#ifdef USE_SSL
+#include "resip/stack/ssl/Security.hxx"
+#endif
 
 using namespace resip;
 using std::vector;
@@ -45,6 +50,25 @@ StatisticsManager::poll()
    activeClientTransactions = mStack.mTransactionController->getNumClientTransactions();
    activeServerTransactions = mStack.mTransactionController->getNumServerTransactions();
 
+   DnsStub::CacheStatistics dns;
+   mStack.mDnsStub->getCacheStatistics(dns);
+   dnsCacheHits = dns.hits;
+   dnsCacheMisses = dns.misses;
+   dnsPrefetches = dns.prefetches;
+   dnsStaleAnswers = dns.staleAnswers;
+   dnsWireQueries = dns.wireQueries;
+   dnsCoalescedQueries = dns.coalescedQueries;
+
+#ifdef USE_SSL
+   if (mStack.getSecurity())
+   {
+      BaseSecurity::TlsSessionStatistics tls;
+      mStack.getSecurity()->getTlsSessionStatistics(tls);
+      tlsFullHandshakes = tls.fullHandshakes;
+      tlsResumedHandshakes = tls.resumedHandshakes;
+   }
+#endif
+
    // .kw. At last check payload was > 146kB, which seems too large
    // to alloc on stack. Also, the post'd message has reference
    // to the appStats, so not safe queue as ref to stack element.
@@ -54,7 +78,10 @@ StatisticsManager::poll()
        mPublicPayload = new StatisticsMessage::AtomicPayload;
        // re-used each time, free'd in destructor
    }
-   mPublicPayload->loadIn(*this);
+   {
+      Lock lock(mMutex);
+      mPublicPayload->loadIn(*this);
+   }
 
    bool postToStack = true;
    StatisticsMessage msg(*mPublicPayload);
@@ -80,6 +107,13 @@ StatisticsManager::poll()
    }
 }
 
+void
+StatisticsManager::zeroOut()
+{
+   Lock lock(mMutex);
+   StatisticsMessage::Payload::zeroOut();
+}
+
 void 
 StatisticsManager::process()
 {
@@ -95,6 +129,7 @@ StatisticsManager::sent(SipMessage* msg)
 {
    MethodTypes met = msg->method();
 
+   Lock lock(mMutex);
    if (msg->isRequest())
    {
       ++requestsSent;
@@ -121,6 +156,7 @@ StatisticsManager::retransmitted(MethodTypes met,
                                  bool request, 
                                  unsigned int code)
 {
+   Lock lock(mMutex);
    if(request)
    {
       ++requestsRetransmitted;
@@ -140,6 +176,7 @@ StatisticsManager::received(SipMessage* msg)
 {
    MethodTypes met = msg->header(h_CSeq).method();
 
+   Lock lock(mMutex);
    if (msg->isRequest())
    {
       ++requestsReceived;
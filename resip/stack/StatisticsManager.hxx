@@ -3,6 +3,7 @@
 
 #include "rutil/Timer.hxx"
 #include "rutil/Data.hxx"
+#include "rutil/Mutex.hxx"
 #include "resip/stack/StatisticsMessage.hxx"
 #include "resip/stack/StatisticsHandler.hxx"
 
@@ -57,6 +58,10 @@ class StatisticsManager : public StatisticsMessage::Payload
       bool received(SipMessage* msg);
 
       void poll(); // force an update
+      void zeroOut();
+
+      // The counters are bumped by every TransactionController shard.
+      Mutex mMutex;
 
       SipStack& mStack;
       UInt64 mInterval;
@@ -121,6 +121,14 @@ StatisticsMessage::Payload::zeroOut()
    activeClientTransactions = 0;
    activeServerTransactions = 0;
    pendingDnsQueries = 0;
+   dnsCacheHits = 0;
+   dnsCacheMisses = 0;
+   dnsPrefetches = 0;
+   dnsStaleAnswers = 0;
+   dnsWireQueries = 0;
+   dnsCoalescedQueries = 0;
+   tlsFullHandshakes = 0;
+   tlsResumedHandshakes = 0;
    requestsSent = 0;
    responsesSent = 0;
    requestsRetransmitted = 0;
@@ -154,6 +162,15 @@ StatisticsMessage::Payload::operator=(const StatisticsMessage::Payload& rhs)
       activeServerTransactions = rhs.activeServerTransactions;
       pendingDnsQueries = rhs.pendingDnsQueries;
 
+      dnsCacheHits = rhs.dnsCacheHits;
+      dnsCacheMisses = rhs.dnsCacheMisses;
+      dnsPrefetches = rhs.dnsPrefetches;
+      dnsStaleAnswers = rhs.dnsStaleAnswers;
+      dnsWireQueries = rhs.dnsWireQueries;
+      dnsCoalescedQueries = rhs.dnsCoalescedQueries;
+      tlsFullHandshakes = rhs.tlsFullHandshakes;
+      tlsResumedHandshakes = rhs.tlsResumedHandshakes;
+
       requestsSent = rhs.requestsSent;
       responsesSent = rhs.responsesSent;
       requestsRetransmitted = rhs.requestsRetransmitted;
@@ -272,7 +289,17 @@ resip::operator<<(EncodeStream& strm, const StatisticsMessage::Payload& stats)
         << " INFx " << stats.requestsRetransmittedByMethod[INFO]
         << " PRAx " << stats.requestsRetransmittedByMethod[PRACK]
         << " SERx " << stats.requestsRetransmittedByMethod[SERVICE]
-        << " UPDx " << stats.requestsRetransmittedByMethod[UPDATE];
+        << " UPDx " << stats.requestsRetransmittedByMethod[UPDATE]
+        << std::endl
+        << "DNS cache: hits " << stats.dnsCacheHits
+        << " misses " << stats.dnsCacheMisses
+        << " prefetches " << stats.dnsPrefetches
+        << " stale " << stats.dnsStaleAnswers
+        << " queries " << stats.dnsWireQueries
+        << " coalesced " << stats.dnsCoalescedQueries
+        << std::endl
+        << "TLS handshakes: full " << stats.tlsFullHandshakes
+        << " resumed " << stats.tlsResumedHandshakes;
    strm.flush();
    return strm;
 }
@@ -36,6 +36,15 @@ class StatisticsMessage : public ApplicationMessage
             unsigned int activeServerTransactions;
             unsigned int pendingDnsQueries; // .dlb. not implemented
 
+            unsigned int dnsCacheHits;
+            unsigned int dnsCacheMisses;
+            unsigned int dnsPrefetches; // popular answers refreshed before expiry
+            unsigned int dnsStaleAnswers; // expired answers served while refreshing
+            unsigned int dnsWireQueries; // queries sent to the resolver
+            unsigned int dnsCoalescedQueries; // queries that waited on an identical outstanding one
+            unsigned int tlsFullHandshakes;
+            unsigned int tlsResumedHandshakes; // handshakes that resumed an earlier session
+
             unsigned int requestsSent; // includes retransmissions
             unsigned int responsesSent; // includes retransmissions
             unsigned int requestsRetransmitted; // counts each retransmission
@@ -392,6 +392,7 @@ TcpBaseTransport::process()
    if (mPollGrp)
    {
        processAllWriteRequests();
+       mConnectionManager.processIdleTimers(Timer::getTimeMs());
    }
    mStateMachineFifo.flush();
 }
@@ -405,6 +406,7 @@ TcpBaseTransport::process(FdSet& fdSet)
 
    // process the connections in ConnectionManager
    mConnectionManager.process(fdSet);
+   mConnectionManager.processIdleTimers(Timer::getTimeMs());
 
    // process our own listen/accept socket for incoming connections
    if (mFd!=INVALID_SOCKET && fdSet.readyToRead(mFd))
@@ -21,6 +21,12 @@ TcpConnectState::isClientTransaction() const
     return true;
 }
 
+Message*
+TcpConnectState::clone() const
+{
+    return new TcpConnectState(*this);
+}
+
 EncodeStream&
 TcpConnectState::encodeBrief(EncodeStream& str) const
 {
@@ -26,6 +26,7 @@ public:
 
     virtual const Data& getTransactionId() const;
     virtual bool isClientTransaction() const;
+    virtual Message* clone() const;
 
     State getState() const { return mState; }
 
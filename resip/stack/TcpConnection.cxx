@@ -7,6 +7,10 @@
 #include "resip/stack/TcpConnection.hxx"
 #include "resip/stack/Tuple.hxx"
 
+#if !defined(WIN32)
+#include <sys/uio.h>
+#endif
+
 using namespace resip;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSPORT
@@ -91,6 +95,40 @@ TcpConnection::write( const char* buf, const int count )
    int bytesWritten = ::write(getSocket(), buf, count);
 #endif
 
+   return checkWrite(bytesWritten);
+}
+
+int
+TcpConnection::writev( const WriteBuffer* bufs, int count )
+{
+   resip_assert(count > 0 && count <= MaxWriteBuffers);
+
+#if defined(WIN32)
+   WSABUF wsaBufs[MaxWriteBuffers];
+   for (int i = 0; i < count; ++i)
+   {
+      wsaBufs[i].buf = const_cast<char*>(bufs[i].mBuf);
+      wsaBufs[i].len = bufs[i].mLen;
+   }
+   DWORD sent = 0;
+   int bytesWritten = ::WSASend(getSocket(), wsaBufs, count, &sent, 0, 0, 0) == 0 ?
+                         (int)sent : INVALID_SOCKET;
+#else
+   iovec iov[MaxWriteBuffers];
+   for (int i = 0; i < count; ++i)
+   {
+      iov[i].iov_base = const_cast<char*>(bufs[i].mBuf);
+      iov[i].iov_len = bufs[i].mLen;
+   }
+   int bytesWritten = (int)::writev(getSocket(), iov, count);
+#endif
+
+   return checkWrite(bytesWritten);
+}
+
+int
+TcpConnection::checkWrite(int bytesWritten)
+{
    if (bytesWritten == INVALID_SOCKET)
    {
       int e = getErrno();
@@ -15,6 +15,7 @@ class TcpConnection : public Connection
       
       int read( char* buf, const int count );
       int write( const char* buf, const int count );
+      virtual int writev( const WriteBuffer* bufs, int count );
       virtual bool hasDataToRead(); // has data that can be read 
       virtual bool isGood(); // has valid connection
       virtual bool isWritable();
@@ -23,6 +24,7 @@ class TcpConnection : public Connection
    private:
       /// No default c'tor
       TcpConnection();
+      int checkWrite(int bytesWritten);
 };
  
 }
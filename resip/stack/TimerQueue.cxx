@@ -33,22 +33,18 @@ DtlsTimerQueue::DtlsTimerQueue( Fifo<DtlsMessage>& fifo )
 
 DtlsTimerQueue::~DtlsTimerQueue()
 {
-   while(!mTimers.empty())
-   {
-      delete mTimers.top().getMessage();
-      mTimers.pop();
-   }
+   DeletePayload deletePayload;
+   mTimers.clear(deletePayload);
 }
 
 #endif
 
-UInt64
+TimerHandle
 TransactionTimerQueue::add(Timer::Type type, const Data& transactionId, unsigned long msOffset)
 {
    TransactionTimer t(msOffset, type, transactionId);
-   mTimers.push(t);
    DebugLog (<< "Adding timer: " << Timer::toData(type) << " tid=" << transactionId << " ms=" << msOffset);
-   return mTimers.top().getWhen();
+   return mTimers.add(t);
 }
 
 #ifdef USE_DTLS
@@ -57,19 +53,16 @@ UInt64
 DtlsTimerQueue::add( SSL *ssl, unsigned long msOffset )
 {
    TimerWithPayload t( msOffset, new DtlsMessage( ssl ) ) ;
-   mTimers.push( t ) ;
-   return mTimers.top().getWhen();
+   mTimers.add( t ) ;
+   return mTimers.nextExpiry();
 }
 
 #endif
 
 BaseTimeLimitTimerQueue::~BaseTimeLimitTimerQueue()
 {
-   while(!mTimers.empty())
-   {
-      delete mTimers.top().getMessage();
-      mTimers.pop();
-   }
+   DeletePayload deletePayload;
+   mTimers.clear(deletePayload);
 }
 
 UInt64
@@ -77,8 +70,8 @@ BaseTimeLimitTimerQueue::add(unsigned int timeMs,Message* payload)
 {
    resip_assert(payload);
    DebugLog(<< "Adding application timer: " << payload->brief() << " ms=" << timeMs);
-   mTimers.push(TimerWithPayload(timeMs,payload));
-   return mTimers.top().getWhen();
+   mTimers.add(TimerWithPayload(timeMs,payload));
+   return mTimers.nextExpiry();
 }
 
 void
@@ -110,11 +103,8 @@ TuSelectorTimerQueue::TuSelectorTimerQueue(TuSelector& sel) : mFifoSelector(sel)
 
 TuSelectorTimerQueue::~TuSelectorTimerQueue()
 {
-   while(!mTimers.empty())
-   {
-      delete mTimers.top().getMessage();
-      mTimers.pop();
-   }
+   DeletePayload deletePayload;
+   mTimers.clear(deletePayload);
 }
 
 UInt64
@@ -122,8 +112,8 @@ TuSelectorTimerQueue::add(unsigned int timeMs,Message* payload)
 {
    resip_assert(payload);
    DebugLog(<< "Adding application timer: " << payload->brief() << " ms=" << timeMs);
-   mTimers.push(TimerWithPayload(timeMs,payload));
-   return mTimers.top().getWhen();
+   mTimers.add(TimerWithPayload(timeMs,payload));
+   return mTimers.nextExpiry();
 }
 
 void
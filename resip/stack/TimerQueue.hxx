@@ -5,19 +5,13 @@
   #include "config.h"
 #endif
 
-#include <functional>
-#include <queue>
-#include <set>
 #include <iosfwd>
 #include "resip/stack/TimerMessage.hxx"
 #include "resip/stack/DtlsMessage.hxx"
 #include "rutil/Fifo.hxx"
 #include "rutil/TimeLimitFifo.hxx"
 #include "rutil/Timer.hxx"
-
-// .dlb. 
-// to do: timer wheel for transaction-bound timers and a heap for
-// everything longer.
+#include "rutil/TimerWheel.hxx"
 
 namespace resip
 {
@@ -31,9 +25,10 @@ class TuSelector;
   * @brief This class takes a fifo as a place to where you can write your stuff.
   * When using this in the main loop, call process() on this.
   * During Transaction processing, TimerMessages and SIP messages are generated.
-  * 
-    @todo .dlb. timer wheel for transaction-bound timers and a heap for 
-      everything longer.
+  *
+  * Timers are kept in a hierarchical TimerWheel, so adding a timer is O(1)
+  * and a timer that is no longer needed can be removed with cancel() instead
+  * of being left to fire.
   */
 template <class T>
 class TimerQueue
@@ -43,15 +38,8 @@ class TimerQueue
       // thing subclasses must implement.
       virtual void processTimer(const T& timer)=0;
 
-      /// @brief deletes the message associated with the timer as well.
       virtual ~TimerQueue()
       {
-         //xkd-2004-11-4
-         // delete the message associated with the timer
-         while (!mTimers.empty())
-         {
-            mTimers.pop();
-         }
       }
 
       /// @brief provides the time in milliseconds before the next timer will fire
@@ -63,7 +51,7 @@ class TimerQueue
       {
          if (!mTimers.empty())
          {
-            UInt64 next = mTimers.top().getWhen();
+            UInt64 next = mTimers.nextExpiry();
             UInt64 now = Timer::getTimeMs();
             if (now > next) 
             {
@@ -93,21 +81,23 @@ class TimerQueue
       /// machine fifo and application messages into the TU fifo
       virtual UInt64 process()
       {
-         if (!mTimers.empty())
-         {
-            UInt64 now=Timer::getTimeMs();
-            while (!mTimers.empty() && !(mTimers.top().getWhen() > now))
-            {
-               processTimer(mTimers.top());
-               mTimers.pop();
-            }
+         // Called even when empty, so that the wheel keeps up with the clock
+         // while idle.
+         Expirer expirer(*this);
+         mTimers.expire(Timer::getTimeMs(), expirer);
+         return mTimers.nextExpiry();
+      }
 
-            if(!mTimers.empty())
-            {
-               return mTimers.top().getWhen();
-            }
-         }
-         return 0;
+      /// @brief removes a timer before it fires
+      /// @return false if the timer already fired or was cancelled
+      bool cancel(TimerHandle handle)
+      {
+         return mTimers.cancel(handle);
+      }
+
+      bool isPending(TimerHandle handle) const
+      {
+         return mTimers.isPending(handle);
       }
 
       int size() const
@@ -125,7 +115,7 @@ class TimerQueue
          if(mTimers.size() > 0)
          {
             return str << "TimerQueue[ size =" << mTimers.size() 
-                       << " top=" << mTimers.top() << "]" ;
+                       << " next=" << mTimers.nextExpiry() << "]" ;
          }
          else
          {
@@ -139,7 +129,7 @@ class TimerQueue
          if(mTimers.size() > 0)
          {
             return str << "TimerQueue[ size =" << mTimers.size() 
-                       << " top=" << mTimers.top() << "]" ;
+                       << " next=" << mTimers.nextExpiry() << "]" ;
          }
          else
          {
@@ -149,8 +139,23 @@ class TimerQueue
 #endif
 
    protected:
-      typedef std::vector<T, std::allocator<T> > TimerVector;
-      std::priority_queue<T, TimerVector, std::greater<T> > mTimers;
+      class Expirer
+      {
+         public:
+            Expirer(TimerQueue<T>& queue) : mQueue(queue) {}
+            void operator()(const T& timer) { mQueue.processTimer(timer); }
+         private:
+            TimerQueue<T>& mQueue;
+      };
+
+      /// @brief Used by subclasses whose timers own a Message payload.
+      class DeletePayload
+      {
+         public:
+            void operator()(const T& timer) { delete timer.getMessage(); }
+      };
+
+      TimerWheel<T> mTimers;
 };
 
 /**
@@ -203,7 +208,8 @@ class TransactionTimerQueue : public TimerQueue<TransactionTimer>
 {
    public:
       TransactionTimerQueue(Fifo<TimerMessage>& fifo);
-      UInt64 add(Timer::Type type, const Data& transactionId, unsigned long msOffset);
+      /// @return a handle that can be passed to cancel()
+      TimerHandle add(Timer::Type type, const Data& transactionId, unsigned long msOffset);
       virtual void processTimer(const TransactionTimer& timer);
    private:
       Fifo<TimerMessage>& mFifo;
@@ -13,10 +13,13 @@
 #include "resip/stack/InvokeAfterSocketCreationFunc.hxx"
 #include "resip/stack/ZeroOutStatistics.hxx"
 #include "resip/stack/PollStatistics.hxx"
+#include "resip/stack/KeepAliveMessage.hxx"
 #include "resip/stack/ShutdownMessage.hxx"
 #include "resip/stack/SipMessage.hxx"
+#include "resip/stack/TcpConnectState.hxx"
 #include "resip/stack/TransactionController.hxx"
 #include "resip/stack/TransactionState.hxx"
+#include "resip/stack/TransportFailure.hxx"
 #ifdef USE_SSL
 #include "resip/stack/ssl/Security.hxx"
 #endif
@@ -39,7 +42,10 @@ unsigned int TransactionController::MaxTUFifoTimeDepthSecs = 0;
 
 TransactionController::TransactionController(SipStack& stack, 
                                              AsyncProcessHandler* handler,
-                                             bool useDnsVip) :
+                                             bool useDnsVip,
+                                             bool lockFreeStateMacFifo,
+                                             unsigned int shards,
+                                             bool shardByCallId) :
    mStack(stack),
    mDiscardStrayResponses(true),
    mFixBadDialogIdentifiers(true),
@@ -48,17 +54,59 @@ TransactionController::TransactionController(SipStack& stack,
    mStateMacFifoOutBuffer(mStateMacFifo),
    mCongestionManager(0),
    mTuSelector(stack.mTuSelector),
-   mTransportSelector(mStateMacFifo,
-                      stack.getSecurity(),
-                      stack.getDnsStub(),
-                      stack.getCompression(),
-                      useDnsVip),
+   mOwnTransportSelector(new TransportSelector(mStateMacFifo,
+                                               stack.getSecurity(),
+                                               stack.getDnsStub(),
+                                               stack.getCompression(),
+                                               useDnsVip)),
+   mTransportSelector(*mOwnTransportSelector),
    mTimers(mTimerFifo),
    mShuttingDown(false),
+   mPrimary(*this),
+   mShardIndex(0),
+   mShardByCallId(shardByCallId),
    mStatsManager(stack.mStatsManager),
    mHostname(DnsUtil::getLocalHostName())
 {
    mStateMacFifo.setDescription("TransactionController::mStateMacFifo");
+   // Must happen before anything can post to the fifo.
+   mStateMacFifo.setLockFree(lockFreeStateMacFifo);
+
+   if(shards > 1)
+   {
+      mTransportSelector.setShared();
+      for(unsigned int i=1; i<shards; ++i)
+      {
+         mShards.push_back(new TransactionController(*this, i, handler, lockFreeStateMacFifo));
+      }
+      InfoLog(<< "Running " << shards << " TransactionController shards, by "
+              << (mShardByCallId ? "Call-ID" : "transaction id"));
+   }
+}
+
+TransactionController::TransactionController(TransactionController& primary,
+                                             unsigned int index,
+                                             AsyncProcessHandler* handler,
+                                             bool lockFreeStateMacFifo) :
+   mStack(primary.mStack),
+   mDiscardStrayResponses(primary.mDiscardStrayResponses),
+   mFixBadDialogIdentifiers(primary.mFixBadDialogIdentifiers),
+   mFixBadCSeqNumbers(primary.mFixBadCSeqNumbers),
+   mStateMacFifo(handler),
+   mStateMacFifoOutBuffer(mStateMacFifo),
+   mCongestionManager(0),
+   mTuSelector(primary.mTuSelector),
+   mTransportSelector(primary.mTransportSelector),
+   mTimers(mTimerFifo),
+   mShuttingDown(false),
+   mPrimary(primary),
+   mShardIndex(index),
+   mShardByCallId(primary.mShardByCallId),
+   mStatsManager(primary.mStatsManager),
+   mHostname(primary.mHostname)
+{
+   mStateMacFifo.setDescription("TransactionController::mStateMacFifo (shard)");
+   mStateMacFifo.setLockFree(lockFreeStateMacFifo);
 }
 
 #if defined(WIN32) && !defined(__GNUC__)
@@ -67,6 +115,14 @@ TransactionController::TransactionController(SipStack& stack,
 
 TransactionController::~TransactionController()
 {
+   // Transports may feed any shard, and flush into its fifo as the
+   // TransportSelector deletes them; so they go before the shards do.
+   mOwnTransportSelector.reset();
+   for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      delete *i;
+   }
+
    if(mClientTransactionMap.size())
    {
       WarningLog(<< "On shutdown, there are Client TransactionStates remaining!");
@@ -89,16 +145,127 @@ void
 TransactionController::shutdown()
 {
    mShuttingDown = true;
-   mTransportSelector.shutdown();
+   if(mOwnTransportSelector.get())
+   {
+      mTransportSelector.shutdown();
+   }
+   for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      (*i)->shutdown();
+   }
+}
+
+TransactionController&
+TransactionController::shardFor(const Data& tid)
+{
+   if(getNumShards() == 1)
+   {
+      return *this;
+   }
+   return getShard((unsigned int)(tid.hash() % getNumShards()));
+}
+
+TransactionController&
+TransactionController::shardFor(const SipMessage& msg)
+{
+   if(mShardByCallId && getNumShards() > 1 && msg.exists(h_CallId))
+   {
+      return getShard(Helper::callIdShard(msg.const_header(h_CallId).value(), getNumShards()));
+   }
+   return shardFor(msg.getTransactionId());
+}
+
+void
+TransactionController::copyToOtherShards(const TransactionMessage& message)
+{
+   for(unsigned int i=0; i<getNumShards(); ++i)
+   {
+      TransactionController& shard = getShard(i);
+      if(&shard != this)
+      {
+         TransactionMessage* copy = static_cast<TransactionMessage*>(message.clone());
+         copy->setShardCopy();
+         shard.mStateMacFifo.add(copy);
+      }
+   }
+}
+
+bool
+TransactionController::dispatchToShard(TransactionMessage* message)
+{
+   if(getNumShards() == 1)
+   {
+      return false;
+   }
+
+   // Everything that is not tied to a transaction (keepalives, transport
+   // and flow management, statistics...) stays here.
+   SipMessage* sip = dynamic_cast<SipMessage*>(message);
+   if(sip)
+   {
+      if(dynamic_cast<KeepAliveMessage*>(sip) || sip->empty(h_Vias))
+      {
+         return false;
+      }
+   }
+   else if(!dynamic_cast<TransportFailure*>(message) &&
+           !dynamic_cast<TcpConnectState*>(message))
+   {
+      return false;
+   }
+
+   if(!sip && mShardByCallId)
+   {
+      // No Call-ID to go by; offer it to every shard, this one included.
+      if(!message->isShardCopy())
+      {
+         copyToOtherShards(*message);
+      }
+      return false;
+   }
+
+   TransactionController* shard = 0;
+   try
+   {
+      if(sip)
+      {
+         shard = &shardFor(*sip);
+      }
+      else
+      {
+         // A client CANCEL lives in the same shard as the INVITE it cancels,
+         // but transport notifications for it carry the INVITE tid with
+         // "cancel" appended (see TransactionState::handleInternalCancel).
+         static const Data cancelSuffix("cancel");
+         const Data& tid = message->getTransactionId();
+         shard = tid.postfix(cancelSuffix) ?
+            &shardFor(tid.substr(0, tid.size() - cancelSuffix.size())) :
+            &shardFor(tid);
+      }
+   }
+   catch(resip::BaseException&)
+   {
+      // Let TransactionState::process() drop it.
+      return false;
+   }
+
+   if(shard == this)
+   {
+      return false;
+   }
+   shard->mStateMacFifo.add(message);
+   return true;
 }
 
 void
 TransactionController::process(int timeout)
 {
    if (mShuttingDown && 
+       mOwnTransportSelector.get() &&
        //mTimers.empty() && 
        !mStateMacFifoOutBuffer.messageAvailable() && // !dcm! -- see below 
        !mStack.mTUFifo.messageAvailable() &&
+       getTransactionFifoSize() == 0 &&
        mTransportSelector.isFinished())
 // !dcm! -- why would one wait for the Tu's fifo to be empty before delivering a
 // shutdown message?
@@ -118,7 +285,7 @@ TransactionController::process(int timeout)
 
       // Check if Statistics Manager needs to be polled - note:  all statistic manager polls should happen from the 
       // TransactionController thread / process loop
-      if(mStack.mStatisticsManagerEnabled)
+      if(mStack.mStatisticsManagerEnabled && mOwnTransportSelector.get())
       {
          mStatsManager.process();
       }
@@ -150,7 +317,10 @@ TransactionController::process(int timeout)
          int runs=16;
          while(message)
          {
-            TransactionState::process(*this, message);
+            if(!dispatchToShard(message))
+            {
+               TransactionState::process(*this, message);
+            }
             if(--runs==0)
             {
                break;
@@ -170,25 +340,44 @@ TransactionController::getTimeTillNextProcessMS()
    {
       return 0;
    }
-   return mTimers.msTillNextTimer();
+   unsigned int next = mTimers.msTillNextTimer();
+   for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      next = resipMin(next, (*i)->getTimeTillNextProcessMS());
+   }
+   return next;
 } 
 
 void
 TransactionController::send(SipMessage* msg)
 {
+   // Hand the message straight to the shard owning its transaction, so that
+   // it does not have to pass through shard 0.
+   TransactionController* shard = this;
+   if(getNumShards() > 1 && !msg->empty(h_Vias))
+   {
+      try
+      {
+         shard = &shardFor(*msg);
+      }
+      catch(resip::BaseException&)
+      {
+      }
+   }
+
    if(msg->isRequest() && 
       msg->method() != ACK && 
-      getRejectionBehavior()!=CongestionManager::NORMAL)
+      shard->getRejectionBehavior()!=CongestionManager::NORMAL)
    {
       // Need to 503 this.
       SipMessage* resp(Helper::makeResponse(*msg, 503));
-      resp->header(h_RetryAfter).value()=(UInt32)mStateMacFifo.expectedWaitTimeMilliSec()/1000;
+      resp->header(h_RetryAfter).value()=(UInt32)shard->mStateMacFifo.expectedWaitTimeMilliSec()/1000;
       resp->setTransactionUser(msg->getTransactionUser());
       mTuSelector.add(resp, TimeLimitFifo<Message>::InternalElement);
       delete msg;
       return;
    }
-   mStateMacFifo.add(msg);
+   shard->mStateMacFifo.add(msg);
 }
 
 
@@ -209,25 +398,45 @@ TransactionController::getTransactionFifoSize() const
 {
    // Should we include the stuff in mStateMacFifoOutBuffer here too? This is
    // likely to be called from other threads...
-   return mStateMacFifo.size();
+   unsigned int size = mStateMacFifo.size();
+   for(std::vector<TransactionController*>::const_iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      size += (*i)->getTransactionFifoSize();
+   }
+   return size;
 }
 
 unsigned int 
 TransactionController::getNumClientTransactions() const
 {
-   return mClientTransactionMap.size();
+   unsigned int size = mClientTransactionMap.size();
+   for(std::vector<TransactionController*>::const_iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      size += (*i)->getNumClientTransactions();
+   }
+   return size;
 }
 
 unsigned int 
 TransactionController::getNumServerTransactions() const
 {
-   return mServerTransactionMap.size();
+   unsigned int size = mServerTransactionMap.size();
+   for(std::vector<TransactionController*>::const_iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      size += (*i)->getNumServerTransactions();
+   }
+   return size;
 }
 
 unsigned int 
 TransactionController::getTimerQueueSize() const
 {
-   return mTimers.size();
+   unsigned int size = mTimers.size();
+   for(std::vector<TransactionController*>::const_iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      size += (*i)->getTimerQueueSize();
+   }
+   return size;
 }
 
 void 
@@ -256,13 +465,27 @@ void TransactionController::unregisterMarkListener(MarkListener* listener)
 void 
 TransactionController::abandonServerTransaction(const Data& tid)
 {
-   mStateMacFifo.add(new AbandonServerTransaction(tid));
+   if(mShardByCallId)
+   {
+      AbandonServerTransaction* abandon = new AbandonServerTransaction(tid);
+      copyToOtherShards(*abandon);
+      mStateMacFifo.add(abandon);
+      return;
+   }
+   shardFor(tid).mStateMacFifo.add(new AbandonServerTransaction(tid));
 }
 
 void 
 TransactionController::cancelClientInviteTransaction(const Data& tid, const resip::Tokens* reasons)
 {
-   mStateMacFifo.add(new CancelClientInviteTransaction(tid, reasons));
+   if(mShardByCallId)
+   {
+      CancelClientInviteTransaction* cancel = new CancelClientInviteTransaction(tid, reasons);
+      copyToOtherShards(*cancel);
+      mStateMacFifo.add(cancel);
+      return;
+   }
+   shardFor(tid).mStateMacFifo.add(new CancelClientInviteTransaction(tid, reasons));
 }
 
 void 
@@ -1,6 +1,9 @@
 #if !defined(RESIP_TRANSACTION_CONTROLLER_HXX)
 #define RESIP_TRANSACTION_CONTROLLER_HXX
 
+#include <memory>
+#include <vector>
+
 #include "resip/stack/TuSelector.hxx"
 #include "resip/stack/TransactionMap.hxx"
 #include "resip/stack/TransportSelector.hxx"
@@ -27,9 +30,36 @@ class TransactionController
       static unsigned int MaxTUFifoSize;
       static unsigned int MaxTUFifoTimeDepthSecs;
 
-      TransactionController(SipStack& stack, AsyncProcessHandler* handler, bool useDnsVip);
+      // shards > 1 makes this controller shard 0 of that many; see
+      // SipStackOptions::mTransactionControllerShards and mShardByCallId
+      TransactionController(SipStack& stack, 
+                            AsyncProcessHandler* handler, 
+                            bool useDnsVip,
+                            bool lockFreeStateMacFifo=false,
+                            unsigned int shards=1,
+                            bool shardByCallId=false);
       ~TransactionController();
 
+      // Each shard has its own transaction maps, timer queue and state
+      // machine fifo, and is given cycles (process()) separately. Shard 0 is
+      // the controller the stack creates; it owns the TransportSelector,
+      // which all shards share. Transports may post to any shard's fifo;
+      // that shard hands each message over to the shard that owns its
+      // transaction, unless it is that shard itself. These may be called on
+      // any shard.
+      unsigned int getNumShards() const { return (unsigned int)mPrimary.mShards.size() + 1; }
+      TransactionController& getShard(unsigned int index)
+      {
+         return index ? *mPrimary.mShards[index-1] : mPrimary;
+      }
+      unsigned int getShardIndex() const { return mShardIndex; }
+      // The shard owning transaction tid (without any "cancel" suffix, so
+      // that a CANCEL lands next to the INVITE it cancels).
+      TransactionController& shardFor(const Data& tid);
+      // The shard owning msg's transaction: by Call-ID when sharding by
+      // Call-ID, so that all transactions of a dialog share a shard.
+      TransactionController& shardFor(const SipMessage& msg);
+
       void process(int timeout=0);
       unsigned int getTimeTillNextProcessMS();
 
@@ -39,6 +69,9 @@ class TransactionController
       TransportSelector& transportSelector() { return mTransportSelector; }
       const TransportSelector& transportSelector() const { return mTransportSelector; }
 
+      // The fifo transports bound to this shard post to.
+      Fifo<TransactionMessage>& stateMacFifo() { return mStateMacFifo; }
+
       bool isTUOverloaded() const;
       
       void send(SipMessage* msg);
@@ -54,7 +87,14 @@ class TransactionController
       
       void setCongestionManager( CongestionManager *manager ) 
       { 
-         mTransportSelector.setCongestionManager(manager);
+         if(mOwnTransportSelector.get())
+         {
+            mTransportSelector.setCongestionManager(manager);
+         }
+         for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+         {
+            (*i)->setCongestionManager(manager);
+         }
          if(mCongestionManager)
          {
             mCongestionManager->unregisterFifo(&mStateMacFifo);
@@ -86,12 +126,20 @@ class TransactionController
       inline void setFixBadDialogIdentifiers(bool pFixBadDialogIdentifiers) 
       {
          mFixBadDialogIdentifiers = pFixBadDialogIdentifiers;
+         for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+         {
+            (*i)->mFixBadDialogIdentifiers = pFixBadDialogIdentifiers;
+         }
       }
 
       inline bool getFixBadCSeqNumbers() const { return mFixBadCSeqNumbers;} 
       inline void setFixBadCSeqNumbers(bool pFixBadCSeqNumbers)
       {
          mFixBadCSeqNumbers = pFixBadCSeqNumbers;
+         for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+         {
+            (*i)->mFixBadCSeqNumbers = pFixBadCSeqNumbers;
+         }
       }
 
       void abandonServerTransaction(const Data& tid);
@@ -108,6 +156,21 @@ class TransactionController
    private:
       TransactionController(const TransactionController& rhs);
       TransactionController& operator=(const TransactionController& rhs);
+
+      // constructs shard number index of primary
+      TransactionController(TransactionController& primary,
+                            unsigned int index,
+                            AsyncProcessHandler* handler,
+                            bool lockFreeStateMacFifo);
+
+      // Called for messages taken off this shard's fifo. Returns true if
+      // the message was handed to another shard.
+      bool dispatchToShard(TransactionMessage* message);
+      // Queues a copy of message on every shard but this one. With Call-ID sharding,
+      // messages that only carry a transaction id go to every shard; those
+      // that do not have the transaction drop them.
+      void copyToOtherShards(const TransactionMessage& message);
+
       SipStack& mStack;
       
       // If true, indicate to the Transaction to ignore responses for which
@@ -139,18 +202,29 @@ class TransactionController
       // from the sipstack (for convenience)
       TuSelector& mTuSelector;
 
-      // Used to decide which transport to send a sip message on. 
-      TransportSelector mTransportSelector;
-
-      // stores all of the transactions that are currently active in this stack 
-      TransactionMap mClientTransactionMap;
-      TransactionMap mServerTransactionMap;
+      // Used to decide which transport to send a sip message on. Owned by
+      // shard 0 and shared by the others.
+      std::auto_ptr<TransportSelector> mOwnTransportSelector;
+      TransportSelector& mTransportSelector;
 
       // timers associated with the transactions. When a timer fires, it is
       // placed in the mStateMacFifo
+      // WATCHOUT: declared before the maps, since TransactionState cancels its
+      // timers when the maps delete it.
       TransactionTimerQueue  mTimers;
 
+      // stores all of the transactions that are currently active in this stack 
+      TransactionMap mClientTransactionMap;
+      TransactionMap mServerTransactionMap;
+
       bool mShuttingDown;
+
+      // shards 1..n-1 if this is shard 0, otherwise empty
+      std::vector<TransactionController*> mShards;
+      // shard 0
+      TransactionController& mPrimary;
+      unsigned int mShardIndex;
+      bool mShardByCallId;
       
       StatisticsManager& mStatsManager;
       
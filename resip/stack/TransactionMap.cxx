@@ -10,65 +10,62 @@ using namespace resip;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSACTION
 
+bool
+TransactionMap::BranchTraits::matches(const TransactionState* state, const Data& branch)
+{
+   return isEqualNoCase(state->mId, branch);
+}
+
 TransactionMap::~TransactionMap()
 {
    //DebugLog (<< "Deleting TransactionMap: " << this << " " << mMap.size() << " entries");
-   while (!mMap.empty())
+   // Each TransactionState erases itself from mMap when deleted.
+   std::vector<TransactionState*> states;
+   mMap.values(states);
+   for (std::vector<TransactionState*>::iterator i = states.begin(); i != states.end(); ++i)
    {
-      DebugLog (<< mMap.begin()->first << " -> " << mMap.begin()->second << ": " << *mMap.begin()->second);
-      delete mMap.begin()->second;
+      DebugLog (<< (*i)->mId << " -> " << *i << ": " << **i);
+      delete *i;
    }
 }
 
 TransactionState* 
 TransactionMap::find( const Data& tid ) const
 {
-   MapConstIterator i = mMap.find(tid);
-   if (i != mMap.end())
-   {
-      return i->second;
-   }
-   else
-   {
-      return 0;
-   }
+   return mMap.find(tid, hash(tid));
 }
+
  
 void 
-TransactionMap::add(const Data& tid, TransactionState* state  )
+TransactionMap::add(TransactionState* state)
 {
-   MapIterator i = mMap.find(tid);
-   if (i != mMap.end())
+   TransactionState* existing = mMap.find(state->mId, state->mIdHash);
+   if (existing)
    {
-      if (i->second != state)
+      if (existing != state)
       {
          // .bwc. ~TransactionState will remove itself from the map.
-         delete i->second;
-         //DebugLog (<< "Replacing TMAP[" << tid << "] = " << state << " : " << *state);
-         mMap[tid] = state;
+         delete existing;
+         //DebugLog (<< "Replacing TMAP[" << state->mId << "] = " << state << " : " << *state);
+         mMap.insert(state, state->mIdHash);
       }
    }
    else
    {
-      //DebugLog (<< "Inserting TMAP[" << tid << "] = " << state << " : " << *state);
-      mMap[tid] = state;
+      //DebugLog (<< "Inserting TMAP[" << state->mId << "] = " << state << " : " << *state);
+      mMap.insert(state, state->mIdHash);
    }
 }
  
 void 
-TransactionMap::erase(const Data& tid )
+TransactionMap::erase(TransactionState* state)
 {
-   MapIterator i = mMap.find(tid);
-   if (i != mMap.end())
-   {
-      // don't delete it here, the TransactionState deletes itself and removes
-      // itself from the map
-      //DebugLog (<< "Erasing " << tid << "(" << i->second << ")");
-      mMap.erase(i);
-   }
-   else
+   // don't delete it here, the TransactionState deletes itself and removes
+   // itself from the map
+   //DebugLog (<< "Erasing " << state->mId << "(" << state << ")");
+   if (!mMap.erase(state, state->mIdHash))
    {
-      InfoLog (<< "Couldn't find " << tid << " to remove");
+      InfoLog (<< "Couldn't find " << state->mId << " to remove");
       resip_assert(0);
    }
 }
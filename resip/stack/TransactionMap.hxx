@@ -2,7 +2,7 @@
 #define RESIP_TRANSACTIONMAP_HXX
 
 #include "rutil/Data.hxx"
-#include "rutil/HashMap.hxx"
+#include "rutil/OpenHashTable.hxx"
 
 namespace resip
 {
@@ -17,11 +17,10 @@ class TransactionMap
      ~TransactionMap();
      
      TransactionState* find( const Data& transactionId ) const;
-     void add( const Data& transactionId, TransactionState* state  );
-     void erase( const Data& transactionId );
+     // Keyed by state->mId. Replaces (deletes) any other state with that id.
+     void add( TransactionState* state );
+     void erase( TransactionState* state );
      int size() const;
-     
-  private:
 
      // We treat branch parameters as case insensitive (RFC3261):
      // 7.3.1 Header Field Format
@@ -32,77 +31,26 @@ class TransactionMap
      //    values are case-insensitive.Tokens are always case-insensitive.
      //    Unless specified otherwise, values expressed as quoted strings are
      //    case-sensitive.
-#if  defined(__INTEL_COMPILER ) || (defined(WIN32) && defined(_MSC_VER) && (_MSC_VER >= 1310) && (_MSC_VER < 1900))  // !slg! not sure if this works on __INTEL_COMPILER 
-      /**
-         @internal
-      */
-      class BranchCompare
-      {
-         public:
-            enum { bucket_size = 4, min_buckets = 8 };
-
-            inline size_t operator()(const Data& branch) const
-            {
-               return branch.caseInsensitiveTokenHash();
-            }
-
-            inline bool operator()(const Data& branch1, const Data& branch2) const
-            {
-               return isLessThanNoCase(branch1,branch2);
-            }
-      };
-#elif defined(HASH_MAP_NAMESPACE)
-      /**
-         @internal
-      */
-      class BranchHasher
-      {
-         public:
-            inline size_t operator()(const Data& branch) const
-            {
-               return branch.caseInsensitiveTokenHash();
-            }
-      };
-
-      /**
-         @internal
-      */
-      class BranchEqual
-      {
-         public:
-            inline bool operator()(const Data& branch1, const Data& branch2) const
-            {
-               return isEqualNoCase(branch1,branch2);
-            }
-      };
-#else
+     static size_t hash( const Data& transactionId )
+     {
+        return transactionId.caseInsensitiveTokenHash();
+     }
+     
+  private:
       /**
          @internal
       */
-      class BranchCompare
+      class BranchTraits
       {
          public:
-            inline bool operator()(const Data& branch1, const Data& branch2) const
-            {
-               return isLessThanNoCase(branch1,branch2);
-            }
+            typedef Data KeyType;
+            static bool matches(const TransactionState* state, const Data& branch);
       };
-#endif
-
-      // .bwc. If rutil/HashMap.hxx fails to find a hash_map impl for the 
-      // platform we're using, it will #define HashMap to a std::map, which
-      // takes different template args. We try to compensate for this here.
-#if  defined(__INTEL_COMPILER ) || (defined(WIN32) && defined(_MSC_VER) && (_MSC_VER >= 1310) && (_MSC_VER < 1900))
-     typedef HashMap<Data, TransactionState*, BranchCompare> Map;
-#elif defined(HASH_MAP_NAMESPACE)
-     typedef HashMap<Data, TransactionState*, BranchHasher, BranchEqual> Map;
-#else
-     typedef std::map<Data, TransactionState*, BranchCompare> Map;
-#endif
 
+     // TransactionStates carry their id and its hash (mIdHash), so the table
+     // only stores the hash and a pointer per entry.
+     typedef OpenHashTable<TransactionState, BranchTraits> Map;
      Map mMap;
-     typedef Map::iterator MapIterator;
-     typedef Map::const_iterator MapConstIterator;
 };
 }
 
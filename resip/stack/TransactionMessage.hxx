@@ -20,6 +20,17 @@ class TransactionMessage : public Message
       virtual bool isClientTransaction() const = 0; 
 
       virtual Message* clone() const {resip_assert(false); return NULL;}
+
+      // Set on the copies a TransactionController shard offers to the other
+      // shards, so that those do not offer them on again.
+      bool isShardCopy() const { return mShardCopy; }
+      void setShardCopy() { mShardCopy = true; }
+
+   protected:
+      TransactionMessage() : mShardCopy(false) {}
+
+   private:
+      bool mShardCopy;
 };
 
 }
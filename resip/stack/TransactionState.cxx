@@ -48,7 +48,7 @@ using namespace resip;
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSACTION
 
 UInt64 TransactionState::DnsGreylistDurationMs = 32000;  // default to 32 seconds, application can override
-UInt32 TransactionState::StatelessIdCounter = 0;
+std::atomic<UInt32> TransactionState::StatelessIdCounter(0);
 
 TransactionState::TransactionState(TransactionController& controller, Machine m, 
                                    State s, const Data& id, MethodTypes method, const Data& methodText, TransactionUser* tu) : 
@@ -61,6 +61,7 @@ TransactionState::TransactionState(TransactionController& controller, Machine m,
    mNextTransmission(0),
    mDnsResult(0),
    mId(id),
+   mIdHash(TransactionMap::hash(id)),
    mMethod(method),
    mMethodText(method==UNKNOWN ? new Data(methodText) : 0),
    mCurrentMethodType(UNKNOWN),
@@ -90,7 +91,7 @@ TransactionState::makeCancelTransaction(TransactionState* tr, Machine machine, c
    //cancel->mIsReliable = tr->mIsReliable;  
    cancel->mResponseTarget = tr->mResponseTarget;
    cancel->mTarget = tr->mTarget;
-   cancel->add(tid);
+   cancel->add();
 
    // !jf! don't call processServerNonInvite since it will delete
    // the sip message which needs to get sent to the TU
@@ -109,7 +110,7 @@ TransactionState::handleInternalCancel(SipMessage* cancel,
    cancel->header(h_Vias).front().param(p_branch) = clientInvite.mNextTransmission->const_header(h_Vias).front().param(p_branch);
    state->processClientNonInvite(cancel);
    // for the INVITE in case we never get a 487
-   clientInvite.mController.mTimers.add(Timer::TimerCleanUp, clientInvite.mId, 128*Timer::T1);
+   clientInvite.startTimer(Timer::TimerCleanUp, 128*Timer::T1);
 }
 
 bool
@@ -158,7 +159,7 @@ TransactionState::~TransactionState()
    }
 
    //StackLog (<< "Deleting TransactionState " << mId << " : " << this);
-   erase(mId);
+   erase();
    
    delete mNextTransmission;
    delete mMethodText;
@@ -167,6 +168,13 @@ TransactionState::~TransactionState()
 
    setPendingCancelReasons(0);
 
+   // Nothing can act on these once we are gone; don't leave them in the
+   // timer queue until they fire.
+   for(std::vector<TimerHandle>::const_iterator i=mTimerHandles.begin(); i!=mTimerHandles.end(); ++i)
+   {
+      mController.mTimers.cancel(*i);
+   }
+
    mState = Bogus;
 }
 
@@ -180,7 +188,7 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
    {
       if (controller.mTuSelector.haveTransactionUsers() && sip->isRequest())
       {
-         tu = controller.mTuSelector.selectTransactionUser(*sip);
+         tu = controller.mTuSelector.selectTransactionUser(*sip, (int)controller.getShardIndex());
          if (!tu)
          {
             //InfoLog (<< "Didn't find a TU for " << sip->brief());
@@ -233,7 +241,7 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
             // since we don't want to reply to the source port if rport present 
             state->mResponseTarget.setPort(Helper::getPortForReply(*sip));
             state->mIsReliable = isReliable(state->mResponseTarget.getType());
-            state->add(tid);
+            state->add();
                
             if (Timer::T100 == 0)
             {
@@ -243,7 +251,7 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
             else
             {
                //StackLog(<<" adding T100 timer (INV)");
-               controller.mTimers.add(Timer::TimerTrying, tid, Timer::T100);
+               state->startTimer(Timer::TimerTrying, Timer::T100);
             }
             state->sendToTU(sip);
             return true;
@@ -287,7 +295,7 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
             state->mResponseTarget = sip->getSource();
             // since we don't want to reply to the source port if rport present 
             state->mResponseTarget.setPort(Helper::getPortForReply(*sip));
-            state->add(tid);
+            state->add();
             state->mIsReliable = isReliable(state->mResponseTarget.getType());
             state->startServerNonInviteTimerTrying(*sip,tid);
             state->sendToTU(sip);
@@ -309,7 +317,7 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
                                                             INVITE,
                                                             Data::Empty,
                                                             tu);
-            state->add(state->mId);
+            state->add();
             state->processClientInvite(sip);
          }
          else if (method == ACK)
@@ -321,8 +329,8 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
                                                             ACK,
                                                             Data::Empty,
                                                             tu);
-            state->add(state->mId);
-            state->mController.mTimers.add(Timer::TimerStateless, state->mId, Timer::TS );
+            state->add();
+            state->startTimer(Timer::TimerStateless, Timer::TS );
             state->processStateless(sip);
          }
          else if (method == CANCEL)
@@ -370,7 +378,7 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
                                                             method,
                                                             sip->methodStr(),
                                                             tu);
-            state->add(tid);
+            state->add();
             state->processClientNonInvite(sip);
          }
       }
@@ -389,12 +397,12 @@ TransactionState::processSipMessageAsNew(SipMessage* sip, TransactionController&
             new TransactionState(controller, 
                                  Stateless, 
                                  Calling, 
-                                 Data(StatelessIdCounter++), 
+                                 Data(StatelessIdCounter.fetch_add(1)), 
                                  method,
                                  sip->methodStr(),
                                  tu);
-         state->add(state->mId);
-         state->mController.mTimers.add(Timer::TimerStateless, state->mId, Timer::TS );
+         state->add();
+         state->startTimer(Timer::TimerStateless, Timer::TS );
          state->processStateless(sip);
       }
    }
@@ -840,7 +848,11 @@ TransactionState::processTimer(TransactionController& controller,
 {
    Data tid = message->getTransactionId();
 
-   if(controller.getRejectionBehavior()==CongestionManager::REJECTING_NON_ESSENTIAL)
+   TransactionState* state = 0;
+   if (message->isClientTransaction()) state = controller.mClientTransactionMap.find(tid);
+   else state = controller.mServerTransactionMap.find(tid);
+
+   if(state && controller.getRejectionBehavior()==CongestionManager::REJECTING_NON_ESSENTIAL)
    {
       // .bwc. State machine fifo is backed up; we probably should not be 
       // retransmitting anything right now. If we have a retransmit timer, 
@@ -848,23 +860,18 @@ TransactionState::processTimer(TransactionController& controller,
       switch(message->getType())
       {
          case Timer::TimerA: // doubling
-            controller.mTimers.add(Timer::TimerA, 
-                                    tid, 
-                                    message->getDuration()*2);
+            state->startTimer(Timer::TimerA, message->getDuration()*2);
             delete message;
             return;
          case Timer::TimerE1:// doubling, until T2
          case Timer::TimerG: // doubling, until T2
-            controller.mTimers.add(message->getType(), 
-                                    tid, 
-                                    resipMin(message->getDuration()*2,
-                                             Timer::T2));
+            state->startTimer(message->getType(), 
+                              resipMin(message->getDuration()*2,
+                                       Timer::T2));
             delete message;
             return;
          case Timer::TimerE2:// just reset
-            controller.mTimers.add(Timer::TimerE2, 
-                                    tid, 
-                                    Timer::T2);
+            state->startTimer(Timer::TimerE2, Timer::T2);
             delete message;
             return;
          default:
@@ -872,10 +879,6 @@ TransactionState::processTimer(TransactionController& controller,
       }
    }
 
-   TransactionState* state = 0;
-   if (message->isClientTransaction()) state = controller.mClientTransactionMap.find(tid);
-   else state = controller.mServerTransactionMap.find(tid);
-   
    if (state) // found transaction for timer
    {
       StackLog (<< "Found matching transaction for " << message->brief() << " -> " << *state);
@@ -927,7 +930,27 @@ TransactionState::startServerNonInviteTimerTrying(SipMessage& sip, const Data& t
       while(duration*2<Timer::T2) duration = duration * 2;
    }
    resetNextTransmission(make100(&sip));  // Store for use when timer expires
-   mController.mTimers.add(Timer::TimerTrying, tid, duration );  // Start trying timer so that we can send 100 to NITs as recommened in RFC4320
+   startTimer(Timer::TimerTrying, duration );  // Start trying timer so that we can send 100 to NITs as recommened in RFC4320
+}
+
+void
+TransactionState::startTimer(Timer::Type type, unsigned long msOffset)
+{
+   // Forget timers that have already fired, so that retransmission timers on
+   // a long-lived transaction don't make this grow.
+   std::vector<TimerHandle>::iterator i=mTimerHandles.begin();
+   while(i!=mTimerHandles.end())
+   {
+      if(mController.mTimers.isPending(*i))
+      {
+         ++i;
+      }
+      else
+      {
+         i=mTimerHandles.erase(i);
+      }
+   }
+   mTimerHandles.push_back(mController.mTimers.add(type, mId, msOffset));
 }
 
 void
@@ -1030,7 +1053,7 @@ TransactionState::processClientNonInvite(TransactionMessage* msg)
       SipMessage* sip = dynamic_cast<SipMessage*>(msg);
       resetNextTransmission(sip);
       saveOriginalContactAndVia(*sip);
-      mController.mTimers.add(Timer::TimerF, mId, Timer::TF);
+      startTimer(Timer::TimerF, Timer::TF);
       sendCurrentToWire();
    }
    else if (isResponse(msg) && isFromWire(msg)) // from the wire
@@ -1047,7 +1070,7 @@ TransactionState::processClientNonInvite(TransactionMessage* msg)
             // Should we restart the E2 timer though?  If so, we need to use somekind of timer sequence number so that previous E2 timers get discarded.
             if (!mIsReliable && mState == Trying)
             {
-               mController.mTimers.add(Timer::TimerE2, mId, Timer::T2 );
+               startTimer(Timer::TimerE2, Timer::T2 );
             }
             mState = Proceeding;
             sendToTU(msg); // don't delete            
@@ -1083,7 +1106,7 @@ TransactionState::processClientNonInvite(TransactionMessage* msg)
          else if (mState != Completed) // prevent TimerK reproduced
          {
             mState = Completed;
-            mController.mTimers.add(Timer::TimerK, mId, Timer::T4 );
+            startTimer(Timer::TimerK, Timer::T4 );
             // !bwc! Got final response in NIT. We don't need to do anything
             // except quietly absorb retransmissions. Dump all state.
             if(mDnsResult)
@@ -1113,7 +1136,7 @@ TransactionState::processClientNonInvite(TransactionMessage* msg)
             {
                unsigned long d = timer->getDuration();
                if (d < Timer::T2) d *= 2;
-               mController.mTimers.add(Timer::TimerE1, mId, d);
+               startTimer(Timer::TimerE1, d);
                StackLog (<< "Transmitting current message");
                sendCurrentToWire();
                delete timer;
@@ -1128,7 +1151,7 @@ TransactionState::processClientNonInvite(TransactionMessage* msg)
          case Timer::TimerE2:
             if (mState == Proceeding)
             {
-               mController.mTimers.add(Timer::TimerE2, mId, Timer::T2);
+               startTimer(Timer::TimerE2, Timer::T2);
                StackLog (<< "Transmitting current message");
                sendCurrentToWire();
                delete timer;
@@ -1228,7 +1251,7 @@ TransactionState::processClientInvite(TransactionMessage* msg)
             {
                resetNextTransmission(sip);
                saveOriginalContactAndVia(*sip);
-               mController.mTimers.add(Timer::TimerB, mId, Timer::TB );
+               startTimer(Timer::TimerB, Timer::TB );
                sendCurrentToWire();
             }
             else
@@ -1320,7 +1343,7 @@ TransactionState::processClientInvite(TransactionMessage* msg)
                }
                StackLog (<< "Received 2xx on client invite transaction");
                StackLog (<< *this);
-               mController.mTimers.add(Timer::TimerStaleClient, mId, Timer::TS );
+               startTimer(Timer::TimerStaleClient, Timer::TS );
             }
             else if (code >= 300)
             {
@@ -1358,7 +1381,7 @@ TransactionState::processClientInvite(TransactionMessage* msg)
                      // reliable, if transport is Unreliable then Fire the Timer D which 
                      // take care of re-Transmission of ACK 
                      mState = Completed;
-                     mController.mTimers.add(Timer::TimerD, mId, Timer::TD );
+                     startTimer(Timer::TimerD, Timer::TD );
                      SipMessage* ack = Helper::makeFailureAck(*mNextTransmission, *sip);
                      mNextTransmission->copyOutboundDecoratorsToStackFailureAck(*ack);
                      resetNextTransmission(ack);
@@ -1425,7 +1448,7 @@ TransactionState::processClientInvite(TransactionMessage* msg)
                unsigned long d = timer->getDuration()*2;
                // TimerA is supposed to double with each retransmit RFC3261 17.1.1          
 
-               mController.mTimers.add(Timer::TimerA, mId, d);
+               startTimer(Timer::TimerA, d);
                DebugLog (<< "Retransmitting INVITE ");
                sendCurrentToWire();
             }
@@ -1628,7 +1651,7 @@ TransactionState::processServerNonInvite(TransactionMessage* msg)
             if (mState == Trying || mState == Proceeding)
             {
                mState = Completed;
-               mController.mTimers.add(Timer::TimerJ, mId, 64*Timer::T1 );
+               startTimer(Timer::TimerJ, 64*Timer::T1 );
                resetNextTransmission(sip);
                sendCurrentToWire();
             }
@@ -1718,7 +1741,7 @@ TransactionState::processServerNonInvite(TransactionMessage* msg)
             // retransmission comes in. In the meantime, set up timers for
             // transaction termination.
             mState = Completed;
-            mController.mTimers.add(Timer::TimerJ, mId, 64*Timer::T1 );
+            startTimer(Timer::TimerJ, 64*Timer::T1 );
          }
       }
       delete msg;
@@ -1753,10 +1776,10 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                mAckIsValid=true;
                resetNextTransmission(Helper::makeResponse(*sip, 500));
                mState = Completed;
-               mController.mTimers.add(Timer::TimerH, mId, Timer::TH );
+               startTimer(Timer::TimerH, Timer::TH );
                if (!mIsReliable)
                {
-                  mController.mTimers.add(Timer::TimerG, mId, Timer::T1 );
+                  startTimer(Timer::TimerG, Timer::T1 );
                }
                sendCurrentToWire();
                delete msg;
@@ -1807,7 +1830,7 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                {
                   //StackLog (<< "Received ACK in Completed (unreliable) - confirmed, start Timer I");
                   mState = Confirmed;
-                  mController.mTimers.add(Timer::TimerI, mId, Timer::T4 );
+                  startTimer(Timer::TimerI, Timer::T4 );
                   // !bwc! Got an ACK/failure; we can stop retransmitting
                   // our failure response now.
                   resetNextTransmission(0);
@@ -1882,7 +1905,7 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                   // source Tuple that the request was received on. 
                   //terminateServerTransaction(mId);
                   mMachine = ServerStale;
-                  mController.mTimers.add(Timer::TimerStaleServer, mId, Timer::TS );
+                  startTimer(Timer::TimerStaleServer, Timer::TS );
                }
                else
                {
@@ -1908,10 +1931,10 @@ TransactionState::processServerInvite(TransactionMessage* msg)
                   StackLog (<< "Received failed response in Trying or Proceeding. Start Timer H, move to completed." << *this);
                   resetNextTransmission(sip);
                   mState = Completed;
-                  mController.mTimers.add(Timer::TimerH, mId, Timer::TH );
+                  startTimer(Timer::TimerH, Timer::TH );
                   if (!mIsReliable)
                   {
-                     mController.mTimers.add(Timer::TimerG, mId, Timer::T1 );
+                     startTimer(Timer::TimerG, Timer::T1 );
                   }
                   sendCurrentToWire(); // don't delete msg
                }
@@ -1949,7 +1972,7 @@ TransactionState::processServerInvite(TransactionMessage* msg)
             {
                StackLog (<< "TimerG fired. retransmit, and re-add TimerG");
                sendCurrentToWire();
-               mController.mTimers.add(Timer::TimerG, mId, resipMin(Timer::T2, timer->getDuration()*2) );  //  TimerG is supposed to double - up until a max of T2 RFC3261 17.2.1
+               startTimer(Timer::TimerG, resipMin(Timer::T2, timer->getDuration()*2) );  //  TimerG is supposed to double - up until a max of T2 RFC3261 17.2.1
             }
             break;
 
@@ -2018,10 +2041,10 @@ TransactionState::processServerInvite(TransactionMessage* msg)
             mAckIsValid=true;
             StackLog (<< "Received failed response in Trying or Proceeding. Start Timer H, move to completed." << *this);
             mState = Completed;
-            mController.mTimers.add(Timer::TimerH, mId, Timer::TH );
+            startTimer(Timer::TimerH, Timer::TH );
             if (!mIsReliable)
             {
-               mController.mTimers.add(Timer::TimerG, mId, Timer::T1 );
+               startTimer(Timer::TimerG, Timer::T1 );
             }
          }
          else
@@ -2428,7 +2451,7 @@ TransactionState::processTcpConnectState(TransactionMessage* msg)
        (mState == Trying || mState == Calling))
    {
       // Start Timer
-      mController.mTimers.add(Timer::TcpConnectTimer, mId, Timer::TcpConnectTimeout);
+      startTimer(Timer::TcpConnectTimer, Timer::TcpConnectTimeout);
       mTcpConnectTimerStarted = true;
    }
    else if (tcpConnectState->getState() == TcpConnectState::Connected &&
@@ -2520,11 +2543,11 @@ TransactionState::processReliability(TransportType type)
             switch (mMachine)
             {
                case ClientNonInvite:
-                  mController.mTimers.add(Timer::TimerE1, mId, Timer::T1 );
+                  startTimer(Timer::TimerE1, Timer::T1 );
                   break;
                   
                case ClientInvite:
-                  mController.mTimers.add(Timer::TimerA, mId, Timer::T1 );
+                  startTimer(Timer::TimerA, Timer::T1 );
                   break;
 
                default:
@@ -2856,28 +2879,28 @@ TransactionState::make100(SipMessage* request) const
 }
 
 void
-TransactionState::add(const Data& tid)
+TransactionState::add()
 {
    if (isClient())
    {
-      mController.mClientTransactionMap.add(tid, this);
+      mController.mClientTransactionMap.add(this);
    }
    else
    {
-      mController.mServerTransactionMap.add(tid, this);
+      mController.mServerTransactionMap.add(this);
    }
 }
 
 void
-TransactionState::erase(const Data& tid)
+TransactionState::erase()
 {
    if (isClient())
    {
-      mController.mClientTransactionMap.erase(tid);
+      mController.mClientTransactionMap.erase(this);
    }
    else
    {
-      mController.mServerTransactionMap.erase(tid);
+      mController.mServerTransactionMap.erase(this);
    }
 }
 
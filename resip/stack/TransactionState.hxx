@@ -1,13 +1,16 @@
 #if !defined(RESIP_TRANSACTIONSTATE_HXX)
 #define RESIP_TRANSACTIONSTATE_HXX
 
+#include <atomic>
 #include <iosfwd>
 #include <memory>
+#include <vector>
 #include "rutil/dns/DnsHandler.hxx"
 #include "resip/stack/MethodTypes.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/Transport.hxx"
 #include "rutil/HeapInstanceCounter.hxx"
+#include "rutil/TimerWheel.hxx"
 
 namespace resip
 {
@@ -92,8 +95,9 @@ class TransactionState : public DnsHandler
       void processNoDnsResults();
       void processReliability(TransportType type);
       
-      void add(const Data& tid);
-      void erase(const Data& tid);
+      // add/remove this in the controller's client or server map, under mId
+      void add();
+      void erase();
       
       bool isClient() const;
    private:
@@ -121,6 +125,9 @@ class TransactionState : public DnsHandler
       const Data& tid(SipMessage* sip) const;
 
       void startServerNonInviteTimerTrying(SipMessage& sip, const Data& tid);
+      /// Starts a transaction timer for mId that is cancelled if this 
+      /// transaction is destroyed before it fires.
+      void startTimer(Timer::Type type, unsigned long msOffset);
 
       static TransactionState* makeCancelTransaction(TransactionState* tran, Machine machine, const Data& tid);
       static void handleInternalCancel(SipMessage* cancel,
@@ -180,6 +187,8 @@ class TransactionState : public DnsHandler
       std::auto_ptr<Via> mOriginalVia;
 
       const Data mId;
+      // TransactionMap::hash(mId), so that the map does not rehash the id
+      const size_t mIdHash;
       const MethodTypes mMethod;
       Data* mMethodText;
 
@@ -193,11 +202,14 @@ class TransactionState : public DnsHandler
       TransportFailure::FailureReason mFailureReason;      
       int mFailureSubCode;
       bool mTcpConnectTimerStarted;
+      std::vector<TimerHandle> mTimerHandles;
 
-      static UInt32 StatelessIdCounter;
+      // shared by every TransactionController shard thread
+      static std::atomic<UInt32> StatelessIdCounter;
       
       friend EncodeStream& operator<<(EncodeStream& strm, const TransactionState& state);
       friend class TransactionController;
+      friend class TransactionMap;
 };
 
 
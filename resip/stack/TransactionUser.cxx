@@ -17,7 +17,8 @@ TransactionUser::TransactionUser(TransactionTermination t,
    mDomainMatcher(new BasicDomainMatcher()),
    mRegisteredForTransactionTermination(t == RegisterForTransactionTermination),
    mRegisteredForConnectionTermination(c == RegisterForConnectionTermination),
-   mRegisteredForKeepAlivePongs(k == RegisterForKeepAlivePongs)
+   mRegisteredForKeepAlivePongs(k == RegisterForKeepAlivePongs),
+   mShard(-1)
 {
   // This creates a default message filter rule, which
   // handles all sip:, sips:, and tel: requests.
@@ -38,7 +39,8 @@ TransactionUser::TransactionUser(MessageFilterRuleList &mfrl,
    mDomainMatcher(new BasicDomainMatcher()),
    mRegisteredForTransactionTermination(t == RegisterForTransactionTermination),
    mRegisteredForConnectionTermination(c == RegisterForConnectionTermination),
-   mRegisteredForKeepAlivePongs(k == RegisterForKeepAlivePongs)
+   mRegisteredForKeepAlivePongs(k == RegisterForKeepAlivePongs),
+   mShard(-1)
 {
   // Set a default Fifo description - should be modified by override class to be
   // more desriptive
@@ -180,6 +180,20 @@ class TransactionUser
       // here, meaning that in dire congestion situations, the stack will drop
       // responses bound for the TU.
       virtual bool responsesMandatory() const {return true;}
+
+      /**
+         @brief Binds this TransactionUser to one TransactionController shard
+            (see SipStackOptions::mTransactionControllerShards): new requests
+            are then only offered to it by that shard. Registering one
+            TransactionUser per shard, each with its own thread, gives every
+            shard its own pipeline; with SipStackOptions::mShardByCallId
+            (and Helper::setCallIdShard() on the TransactionUser's thread) a
+            dialog stays within one pipeline.
+         @param shard The shard index, or -1 (the default) for all shards.
+         @note Call this before registering the TransactionUser.
+      */
+      void setShard(int shard) { mShard = shard; }
+      int getShard() const { return mShard; }
       
    protected:
       enum TransactionTermination 
@@ -263,6 +277,7 @@ class TransactionUser
       bool mRegisteredForTransactionTermination;
       bool mRegisteredForConnectionTermination;
       bool mRegisteredForKeepAlivePongs;
+      int mShard;
       friend class TuSelector;      
 };
 
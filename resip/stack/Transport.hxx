@@ -52,6 +52,10 @@ class FdPollGrp;
  *    Specifies whether this Transport object has its own thread (ie; if
  *    set, the TransportSelector should not run the select/poll loop for
  *    this transport, since that is another thread's job)
+ * REUSEPORT:
+ *    Set SO_REUSEPORT before binding, so that several sockets can share
+ *    the same address and port and the kernel spreads incoming traffic
+ *    across them. Used by UdpTransport::setRxShards().
  */
 #define RESIP_TRANSPORT_FLAG_NOBIND      (1<<0)
 #define RESIP_TRANSPORT_FLAG_RXALL       (1<<1)
@@ -59,6 +63,7 @@ class FdPollGrp;
 #define RESIP_TRANSPORT_FLAG_KEEP_BUFFER (1<<3)
 #define RESIP_TRANSPORT_FLAG_TXNOW       (1<<4)
 #define RESIP_TRANSPORT_FLAG_OWNTHREAD   (1<<5)
+#define RESIP_TRANSPORT_FLAG_REUSEPORT   (1<<6)
 
 /**
    @brief The base class for Transport classes.
@@ -377,6 +382,10 @@ class Transport : public FdSetIOObserver
       // set the receive buffer length (SO_RCVBUF)
       virtual void setRcvBufLen(int buflen) { };	// make pure?
 
+      // set the number of datagrams read or written per system call, where
+      // the transport and platform support it (currently UDP on Linux)
+      virtual void setBatchSize(unsigned batchSize) { };
+
       inline unsigned int getKey() const {return mTuple.mTransportKey;} 
       inline void setKey(unsigned int pKey) { mTuple.mTransportKey = pKey;} // should only be called once after creation
 
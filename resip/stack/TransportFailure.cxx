@@ -21,6 +21,12 @@ TransportFailure::isClientTransaction() const
    return true;
 }
 
+Message*
+TransportFailure::clone() const
+{
+   return new TransportFailure(*this);
+}
+
 EncodeStream&
 TransportFailure::encodeBrief(EncodeStream& str) const
 {
@@ -0,0 +1,370 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <map>
+#include <string.h>
+
+#include "resip/stack/TransportRouteTable.hxx"
+#include "resip/stack/Transport.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+
+TransportRouteTable::Key::Key(Kind kind, TransportType type, IpVersion version)
+   : mNetNs(&Data::Empty),
+     mDomain(&Data::Empty)
+{
+   memset(mBytes, 0, sizeof(mBytes));
+   mBytes[0] = (unsigned char)kind;
+   mBytes[1] = (unsigned char)type;
+   mBytes[2] = (unsigned char)version;
+}
+
+void
+TransportRouteTable::Key::setPort(const Tuple& tuple)
+{
+   int port = tuple.getPort();
+   mBytes[3] = (unsigned char)(port >> 8);
+   mBytes[4] = (unsigned char)port;
+}
+
+void
+TransportRouteTable::Key::setAddress(const Tuple& tuple)
+{
+#ifdef USE_IPV6
+   if (tuple.ipVersion() == V6)
+   {
+      const sockaddr_in6& in6 = reinterpret_cast<const sockaddr_in6&>(tuple.getSockaddr());
+      memcpy(mBytes + 5, &in6.sin6_addr, 16);
+      return;
+   }
+#endif
+   const sockaddr_in& in4 = reinterpret_cast<const sockaddr_in&>(tuple.getSockaddr());
+   memcpy(mBytes + 5, &in4.sin_addr, 4);
+}
+
+void
+TransportRouteTable::Key::setTransportKey(unsigned int transportKey)
+{
+   mBytes[21] = (unsigned char)(transportKey >> 24);
+   mBytes[22] = (unsigned char)(transportKey >> 16);
+   mBytes[23] = (unsigned char)(transportKey >> 8);
+   mBytes[24] = (unsigned char)transportKey;
+}
+
+size_t
+TransportRouteTable::Key::hash() const
+{
+   size_t h = Data::rawHash(mBytes, sizeof(mBytes));
+   if (!mNetNs->empty())
+   {
+      h ^= mNetNs->hash() * 31;
+   }
+   if (!mDomain->empty())
+   {
+      h ^= mDomain->hash() * 17;
+   }
+   return h;
+}
+
+bool
+TransportRouteTable::RouteTraits::matches(const Route* route, const Key& key)
+{
+   return memcmp(route->mBytes, key.mBytes, sizeof(key.mBytes)) == 0 &&
+          route->mNetNs == *key.mNetNs &&
+          route->mDomain == *key.mDomain;
+}
+
+// The keys compare what the corresponding Tuple comparators did: operator<,
+// AnyInterfaceCompare, AnyPortCompare and AnyPortAnyInterfaceCompare.
+TransportRouteTable::Key
+TransportRouteTable::exactKey(const Tuple& tuple)
+{
+   Key key(Exact, tuple.getType(), tuple.ipVersion());
+   key.setPort(tuple);
+   key.setAddress(tuple);
+#ifdef USE_NETNS
+   key.mNetNs = &tuple.getNetNs();
+#endif
+   return key;
+}
+
+TransportRouteTable::Key
+TransportRouteTable::anyInterfaceKey(const Tuple& tuple)
+{
+   Key key(AnyInterface, tuple.getType(), tuple.ipVersion());
+   key.setPort(tuple);
+   return key;
+}
+
+TransportRouteTable::Key
+TransportRouteTable::anyPortKey(const Tuple& tuple)
+{
+   Key key(AnyPort, tuple.getType(), tuple.ipVersion());
+   key.setAddress(tuple);
+#ifdef USE_NETNS
+   key.mNetNs = &tuple.getNetNs();
+#endif
+   return key;
+}
+
+TransportRouteTable::Key
+TransportRouteTable::anyPortAnyInterfaceKey(const Tuple& tuple)
+{
+   return Key(AnyPortAnyInterface, tuple.getType(), tuple.ipVersion());
+}
+
+TransportRouteTable::Key
+TransportRouteTable::loopbackKey(const Tuple& tuple, bool ignorePort)
+{
+   Key key(ignorePort ? LoopbackAnyPort : LoopbackPort, tuple.getType(), V4);
+   if (!ignorePort)
+   {
+      key.setPort(tuple);
+   }
+   key.mNetNs = &tuple.getNetNs();
+   return key;
+}
+
+TransportRouteTable::TransportRouteTable(const std::vector<Transport*>& transports)
+   : mTable(transports.size() * 8),
+     mNumTransports(transports.size())
+{
+   // loopback lookups used to take the first match in address order
+   std::map<Tuple, Transport*> loopbacks;
+
+   for (std::vector<Transport*>::const_iterator i = transports.begin(); i != transports.end(); ++i)
+   {
+      Transport* transport = *i;
+      Tuple tuple(transport->interfaceName(), transport->port(),
+                  transport->ipVersion(), transport->transport(),
+                  Data::Empty, // Domain
+                  transport->netNs());
+      tuple.mTransportKey = transport->getKey();
+
+      Key byKey(ByKey);
+      byKey.setTransportKey(transport->getKey());
+      add(byKey, transport, tuple, Replace);
+      add(Key(OnlyOfType, tuple.getType(), tuple.ipVersion()), transport, tuple, Unique);
+
+      if (!isSecure(transport->transport()))
+      {
+         // Transports that specify ANY interface are found by the ANY
+         // interface lookups, the others by the specific interface ones.
+         if (transport->interfaceName().empty() ||
+             transport->getTuple().isAnyInterface() ||
+             transport->hasSpecificContact())
+         {
+            add(anyInterfaceKey(tuple), transport, tuple, Replace);
+            add(anyPortAnyInterfaceKey(tuple), transport, tuple, Replace);
+         }
+         else
+         {
+            add(exactKey(tuple), transport, tuple, Replace);
+            add(anyPortKey(tuple), transport, tuple, Replace);
+            if (tuple.ipVersion() == V4 && tuple.isLoopback())
+            {
+               loopbacks[tuple] = transport;
+            }
+         }
+      }
+      else
+      {
+         tuple.setTargetDomain(transport->tlsDomain());
+         Key domainKey(TlsDomain, tuple.getType(), tuple.ipVersion());
+         domainKey.mDomain = &tuple.getTargetDomain();
+         add(domainKey, transport, tuple, Replace);
+         add(Key(TlsDefault, tuple.getType(), tuple.ipVersion()), transport, tuple, LowestDomain);
+      }
+   }
+
+   for (std::map<Tuple, Transport*>::const_iterator i = loopbacks.begin(); i != loopbacks.end(); ++i)
+   {
+      add(loopbackKey(i->first, false), i->second, i->first, KeepFirst);
+      add(loopbackKey(i->first, true), i->second, i->first, KeepFirst);
+   }
+}
+
+TransportRouteTable::~TransportRouteTable()
+{
+   for (std::vector<Route*>::iterator i = mRoutes.begin(); i != mRoutes.end(); ++i)
+   {
+      delete *i;
+   }
+}
+
+void
+TransportRouteTable::add(const Key& key, Transport* transport, const Tuple& tuple, Collision collision)
+{
+   size_t hash = key.hash();
+   Route* route = mTable.find(key, hash);
+   if (route)
+   {
+      switch (collision)
+      {
+         case Replace:
+            break;
+         case KeepFirst:
+            return;
+         case LowestDomain:
+            if (!(tuple.getTargetDomain() < route->mTuple.getTargetDomain()))
+            {
+               return;
+            }
+            break;
+         case Unique:
+            route->mTransport = 0;
+            return;
+      }
+      route->mTuple = tuple;
+      route->mTransport = transport;
+      return;
+   }
+
+   route = new Route;
+   memcpy(route->mBytes, key.mBytes, sizeof(route->mBytes));
+   route->mNetNs = *key.mNetNs;
+   route->mDomain = *key.mDomain;
+   route->mHash = hash;
+   route->mTuple = tuple;
+   route->mTransport = transport;
+   mRoutes.push_back(route);
+   mTable.insert(route, hash);
+}
+
+const TransportRouteTable::Route*
+TransportRouteTable::find(const Key& key) const
+{
+   return mTable.find(key, key.hash());
+}
+
+Transport*
+TransportRouteTable::findTransport(const Key& key) const
+{
+   const Route* route = find(key);
+   return route ? route->mTransport : 0;
+}
+
+Transport*
+TransportRouteTable::findByKey(unsigned int transportKey) const
+{
+   Key key(ByKey);
+   key.setTransportKey(transportKey);
+   return findTransport(key);
+}
+
+Transport*
+TransportRouteTable::findOnlyOfType(const Tuple& dest) const
+{
+   return findTransport(Key(OnlyOfType, dest.getType(), dest.ipVersion()));
+}
+
+Transport*
+TransportRouteTable::findExact(const Tuple& source) const
+{
+   return findTransport(exactKey(source));
+}
+
+Transport*
+TransportRouteTable::findAnyInterface(const Tuple& source) const
+{
+   return findTransport(anyInterfaceKey(source));
+}
+
+Transport*
+TransportRouteTable::findAnyPort(const Tuple& source) const
+{
+   return findTransport(anyPortKey(source));
+}
+
+Transport*
+TransportRouteTable::findAnyPortAnyInterface(const Tuple& source) const
+{
+   return findTransport(anyPortAnyInterfaceKey(source));
+}
+
+Transport*
+TransportRouteTable::findLoopback(Tuple& source, bool ignorePort) const
+{
+   if (source.ipVersion() != V4)
+   {
+      return 0;
+   }
+   const Route* route = find(loopbackKey(source, ignorePort));
+   if (!route)
+   {
+      return 0;
+   }
+   source = route->mTuple;
+   return route->mTransport;
+}
+
+Transport*
+TransportRouteTable::findTls(const Data& domain, TransportType type, IpVersion version) const
+{
+   if (domain.empty())
+   {
+      return findTransport(Key(TlsDefault, type, version));
+   }
+   return findTlsByDomain(domain, type, version);
+}
+
+Transport*
+TransportRouteTable::findTlsByDomain(const Data& domain, TransportType type, IpVersion version) const
+{
+   Key key(TlsDomain, type, version);
+   key.mDomain = &domain;
+   return findTransport(key);
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
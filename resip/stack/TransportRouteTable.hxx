@@ -0,0 +1,191 @@
+#if !defined(RESIP_TRANSPORTROUTETABLE_HXX)
+#define RESIP_TRANSPORTROUTETABLE_HXX
+
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/OpenHashTable.hxx"
+#include "rutil/TransportType.hxx"
+#include "resip/stack/Tuple.hxx"
+
+namespace resip
+{
+
+class Transport;
+
+/**
+   @brief Answers TransportSelector's transport lookups from a single hash
+   table.
+
+   @details Built from the complete list of transports and never modified
+   afterwards: TransportSelector builds a new one whenever a transport is
+   added or removed, and swaps it in. Each kind of lookup (by exact
+   address, by port on any interface, by TLS domain, ...) is a differently
+   tagged key in the same table, so every query costs one hash lookup.
+
+   The results are the same as those of the ordered maps TransportSelector
+   used before, including which transport wins when several match: the
+   last one added for the "any port" lookups, the lowest ordered one for
+   loopback and default TLS lookups.
+*/
+class TransportRouteTable
+{
+   public:
+      /// @param transports all transports, in the order they were added
+      explicit TransportRouteTable(const std::vector<Transport*>& transports);
+      ~TransportRouteTable();
+
+      Transport* findByKey(unsigned int transportKey) const;
+      /// The transport of dest's type and IP version, if there is only one.
+      Transport* findOnlyOfType(const Tuple& dest) const;
+
+      /// Non-secure transports bound to source's interface and port.
+      Transport* findExact(const Tuple& source) const;
+      /// Non-secure transports bound to any interface, on source's port.
+      Transport* findAnyInterface(const Tuple& source) const;
+      /// Non-secure transports bound to source's interface, on any port.
+      Transport* findAnyPort(const Tuple& source) const;
+      /// Non-secure transports bound to any interface, on any port.
+      Transport* findAnyPortAnyInterface(const Tuple& source) const;
+      /** The transport bound to the lowest 127/8 address (and source's
+          port, unless ignorePort); source is set to that transport's
+          address. */
+      Transport* findLoopback(Tuple& source, bool ignorePort) const;
+
+      /// A secure transport for domain, or the default one if domain is empty.
+      Transport* findTls(const Data& domain, TransportType type, IpVersion version) const;
+      /// The secure transport for exactly domain, which may be empty.
+      Transport* findTlsByDomain(const Data& domain, TransportType type, IpVersion version) const;
+
+      /// Number of transports the table was built from.
+      size_t numTransports() const { return mNumTransports; }
+
+   private:
+      TransportRouteTable(const TransportRouteTable&);
+      TransportRouteTable& operator=(const TransportRouteTable&);
+
+      typedef enum
+      {
+         ByKey,
+         OnlyOfType,
+         Exact,
+         AnyInterface,
+         AnyPort,
+         AnyPortAnyInterface,
+         LoopbackPort,
+         LoopbackAnyPort,
+         TlsDomain,
+         TlsDefault
+      } Kind;
+
+      // kind, type, version, port, address, transport key
+      enum { KeySize = 1 + 1 + 1 + 2 + 16 + 4 };
+
+      class Key
+      {
+         public:
+            Key(Kind kind, TransportType type=UNKNOWN_TRANSPORT, IpVersion version=V4);
+            void setPort(const Tuple& tuple);
+            void setAddress(const Tuple& tuple);
+            void setTransportKey(unsigned int transportKey);
+            size_t hash() const;
+
+            unsigned char mBytes[KeySize];
+            const Data* mNetNs;
+            const Data* mDomain;
+      };
+
+      struct Route
+      {
+         unsigned char mBytes[KeySize];
+         Data mNetNs;
+         Data mDomain;
+         size_t mHash;
+         Tuple mTuple;
+         Transport* mTransport;
+      };
+
+      struct RouteTraits
+      {
+         typedef Key KeyType;
+         static bool matches(const Route* route, const Key& key);
+      };
+
+      typedef enum
+      {
+         Replace,
+         KeepFirst,
+         // the transport whose tuple has the lowest target domain wins
+         LowestDomain,
+         // a second transport for the key makes it ambiguous
+         Unique
+      } Collision;
+
+      void add(const Key& key, Transport* transport, const Tuple& tuple, Collision collision);
+      const Route* find(const Key& key) const;
+      Transport* findTransport(const Key& key) const;
+
+      static Key exactKey(const Tuple& tuple);
+      static Key anyInterfaceKey(const Tuple& tuple);
+      static Key anyPortKey(const Tuple& tuple);
+      static Key anyPortAnyInterfaceKey(const Tuple& tuple);
+      static Key loopbackKey(const Tuple& tuple, bool ignorePort);
+
+      std::vector<Route*> mRoutes;
+      OpenHashTable<Route, RouteTraits> mTable;
+      size_t mNumTransports;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
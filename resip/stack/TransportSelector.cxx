@@ -18,6 +18,7 @@
 
 #include "resip/stack/ExtensionParameter.hxx"
 #include "resip/stack/Compression.hxx"
+#include "resip/stack/EncodeSegments.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/TransactionState.hxx"
 #include "resip/stack/TransportFailure.hxx"
@@ -32,8 +33,11 @@
 #include "rutil/DataStream.hxx"
 #include "rutil/DnsUtil.hxx"
 #include "rutil/Inserter.hxx"
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/Socket.hxx"
+#include "rutil/Time.hxx"
+#include "rutil/Timer.hxx"
 #include "rutil/FdPoll.hxx"
 #include "rutil/WinLeakCheck.hxx"
 #include "rutil/dns/DnsStub.hxx"
@@ -66,14 +70,71 @@ using namespace resip;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSPORT
 
+namespace
+{
+
+// Like PtrLock, but can be let go of before the end of the scope.
+class ReleasablePtrLock
+{
+   public:
+      ReleasablePtrLock(Lockable* lockable) : mLockable(lockable)
+      {
+         if(mLockable)
+         {
+            mLockable->lock();
+         }
+      }
+
+      ~ReleasablePtrLock()
+      {
+         release();
+      }
+
+      void release()
+      {
+         if(mLockable)
+         {
+            mLockable->unlock();
+            mLockable = 0;
+         }
+      }
+
+   private:
+      Lockable* mLockable;
+};
+
+// Counts a send made outside TransportSelector::mSharedMutex.
+class UnlockedSend
+{
+   public:
+      UnlockedSend(std::atomic<unsigned int>& count) : mCount(count)
+      {
+         ++mCount;
+      }
+
+      ~UnlockedSend()
+      {
+         --mCount;
+      }
+
+   private:
+      std::atomic<unsigned int>& mCount;
+};
+
+}
+
 TransportSelector::TransportSelector(Fifo<TransactionMessage>& fifo, Security* security, DnsStub& dnsStub, Compression &compression, bool useDnsVip) :
    mDns(dnsStub, useDnsVip),
    mStateMacFifo(fifo),
+   mUnlockedSends(0),
    mSecurity(security),
+   mRoutes(new TransportRouteTable(std::vector<Transport*>())),
+   mSourceCacheV4Bits(32),
+   mSourceCacheV6Bits(128),
+   mSourceCacheTtl(60),
    mCompression(compression),
    mSigcompStack (0),
    mPollGrp(0),
-   mAvgBufferSize(1024),
    mInterruptorHandle(0)
 {
    memset(&mUnspecified.v4Address, 0, sizeof(sockaddr_in));
@@ -102,14 +163,8 @@ TransportSelector::TransportSelector(Fifo<TransactionMessage>& fifo, Security* s
 
 TransportSelector::~TransportSelector()
 {
-   mExactTransports.clear();
-   mAnyInterfaceTransports.clear();
-   mAnyPortTransports.clear();
-   mAnyPortAnyInterfaceTransports.clear();
-   mTlsTransports.clear();
    mSharedProcessTransports.clear();
    mHasOwnProcessTransports.clear();
-   mTypeToTransportMap.clear();
    for(TransportKeyMap::iterator it = mTransports.begin(); it != mTransports.end(); it++)
    {
       delete it->second;
@@ -144,6 +199,7 @@ TransportSelector::~TransportSelector()
 void
 TransportSelector::shutdown()
 {
+   PtrLock lock(mSharedMutex.get());
    for(TransportKeyMap::iterator it = mTransports.begin(); it != mTransports.end(); it++)
    {
        it->second->shutdown();
@@ -153,6 +209,7 @@ TransportSelector::shutdown()
 bool
 TransportSelector::isFinished() const
 {
+   PtrLock lock(mSharedMutex.get());
    for(TransportKeyMap::const_iterator it = mTransports.begin(); it != mTransports.end(); it++)
    {
       if (!it->second->isFinished())
@@ -166,6 +223,7 @@ TransportSelector::isFinished() const
 void
 TransportSelector::addTransport(std::auto_ptr<Transport> autoTransport, bool isStackRunning)
 {
+   PtrLock lock(mSharedMutex.get());
    Transport* transport = autoTransport.release();
 
    // !bwc! This is a multimap from TransportType/IpVersion to Transport*.
@@ -215,26 +273,9 @@ TransportSelector::addTransport(std::auto_ptr<Transport> autoTransport, bool isS
 
    if(!isSecure(transport->transport()))
    {
-      if(mExactTransports.find(tuple) == mExactTransports.end() &&
-         mAnyInterfaceTransports.find(tuple) == mAnyInterfaceTransports.end())
+      if(!mRoutes->findExact(tuple) && !mRoutes->findAnyInterface(tuple))
       {
          DebugLog (<< "Adding transport: " << tuple);
-
-         // Store the transport in the ANY interface maps if the tuple specifies ANY
-         // interface. Store the transport in the specific interface maps if the tuple
-         // specifies an interface. See TransportSelector::findTransport.
-         if (transport->interfaceName().empty() ||
-             transport->getTuple().isAnyInterface() ||
-             transport->hasSpecificContact() )
-         {
-            mAnyInterfaceTransports[tuple] = transport;
-            mAnyPortAnyInterfaceTransports[tuple] = transport;
-         }
-         else
-         {
-            mExactTransports[tuple] = transport;
-            mAnyPortTransports[tuple] = transport;
-         }
       }
       else
       {
@@ -246,10 +287,9 @@ TransportSelector::addTransport(std::auto_ptr<Transport> autoTransport, bool isS
    else
    {
       tuple.setTargetDomain(transport->tlsDomain());
-      TlsTransportKey key(tuple);
-      if(mTlsTransports.find(key) == mTlsTransports.end())
+      if(!mRoutes->findTlsByDomain(transport->tlsDomain(), tuple.getType(), tuple.ipVersion()))
       {
-         mTlsTransports[key] = transport;
+         DebugLog (<< "Adding transport: " << tuple);
       }
       else
       {
@@ -286,9 +326,9 @@ TransportSelector::addTransport(std::auto_ptr<Transport> autoTransport, bool isS
       mHasOwnProcessTransports.back()->startOwnProcessing();
    }
 
-   mTypeToTransportMap.insert(TypeToTransportMap::value_type(tuple,transport));
    mDns.addTransportType(transport->transport(), transport->ipVersion());
    mTransports[transport->getKey()] = transport;
+   rebuildRoutes();
 
    InfoLog(<< "TransportSelector::addTransport:  added transport for tuple=" << tuple << ", key=" << transport->getKey());
 }
@@ -296,52 +336,31 @@ TransportSelector::addTransport(std::auto_ptr<Transport> autoTransport, bool isS
 void
 TransportSelector::removeTransport(unsigned int transportKey)
 {
+   PtrLock lock(mSharedMutex.get());
    Transport* transportToRemove = 0;
 
-   // Find transport in global map and remove it
-   // Note: it is important that this map is removed from before rebuildAnyPortTransportMaps is called,
-   // since rebuildAnyPortTransportMaps uses this map.
+   // Find transport in global map and remove it, then rebuild the lookup
+   // tables from what is left
    TransportKeyMap::iterator it = mTransports.find(transportKey);
    if(it != mTransports.end())
    {
        transportToRemove = it->second;
        mTransports.erase(it);
+       rebuildRoutes();
    }
 
    // If we found the transport - continue removal from other maps
    if(transportToRemove)
    {
-      // notify transport to shutdown
-      transportToRemove->shutdown();
-
-      if(!isSecure(transportToRemove->transport()))
+      // A transmit that picked it before it was erased may still be using
+      // it outside the lock. No new one can start while we hold the lock.
+      while(mUnlockedSends.load() != 0)
       {
-         // Ensure transport is removed from all containers
-         mExactTransports.erase(transportToRemove->getTuple());
-         mAnyInterfaceTransports.erase(transportToRemove->getTuple());
-
-         // In the AnyPort maps 2 transports can end up overwriting each other in these maps - then when we remove one, there may be none left - even though we should have an
-         // entry.  The rebuilt method will dig through all transports again and rebuild these maps.
-         rebuildAnyPortTransportMaps();
-      }
-      else
-      {
-         Tuple tlsRemoveTuple = transportToRemove->getTuple();
-         tlsRemoveTuple.setTargetDomain(transportToRemove->tlsDomain());
-         TlsTransportKey tlsKey(tlsRemoveTuple);
-         mTlsTransports.erase(tlsKey);
+         sleepMs(0);
       }
 
-      // mTypeToTransportMap is a multimap - make sure to delete only this instance by looking up transportKey, instead of using 
-      // mTypeToTransportMap.erase(transportToRemove->getTuple()); which might end up deleting more than 1 transport
-      for (TypeToTransportMap::iterator itTypeToTransport = mTypeToTransportMap.begin(); itTypeToTransport != mTypeToTransportMap.end(); itTypeToTransport++)
-      {
-          if (itTypeToTransport->second->getKey() == transportKey)
-          {
-              mTypeToTransportMap.erase(itTypeToTransport);
-              break;
-          }
-      }
+      // notify transport to shutdown
+      transportToRemove->shutdown();
 
       // Remove transport types from Dns list of supported protocols
       // Note:  DNS tracks use counts so that we will only remove this transport type if this is the last of the type to be removed
@@ -372,36 +391,32 @@ TransportSelector::removeTransport(unsigned int transportKey)
 }
 
 void
-TransportSelector::rebuildAnyPortTransportMaps()
+TransportSelector::rebuildRoutes()
 {
-    // These maps may contain less transports than what exists in the mTransports map, due to the fact that multiple transports can 
-    // have the same index.  In these cases the last transport added that matches the custom map compare function is the only one that ends 
-    // up in these maps.  Therefor we cannot just simply remove items and expect transprot selection to work as expected.  
-    // We will clear these maps here.  Iterate through the master transport list and rebuild them back up.  This isn't very efficient,
-    // but it only occurs when a transport is removed.
+   std::vector<Transport*> transports;
+   transports.reserve(mTransports.size());
+   for (TransportKeyMap::const_iterator it = mTransports.begin(); it != mTransports.end(); ++it)
+   {
+      transports.push_back(it->second);
+   }
 
-    mAnyPortTransports.clear();
-    mAnyPortAnyInterfaceTransports.clear();
+   mRoutes.reset(new TransportRouteTable(transports));
 
-    for (TransportKeyMap::iterator it = mTransports.begin(); it != mTransports.end(); it++)
-    {
-        if (!isSecure(it->second->transport()))
-        {
-            // Store the transport in the ANY interface maps if the tuple specifies ANY
-            // interface. Store the transport in the specific interface maps if the tuple
-            // specifies an interface. See TransportSelector::findTransport.
-            if (it->second->interfaceName().empty() ||
-                it->second->getTuple().isAnyInterface() ||
-                it->second->hasSpecificContact())
-            {
-                mAnyPortAnyInterfaceTransports[it->second->getTuple()] = it->second;
-            }
-            else
-            {
-                mAnyPortTransports[it->second->getTuple()] = it->second;
-            }
-        }
-    }
+   // A transport on a new interface can change which source address we
+   // want for a destination.
+   mSourceInterfaceCache.clear();
+}
+
+void
+TransportSelector::setSourceInterfaceCache(unsigned int v4PrefixBits,
+                                           unsigned int v6PrefixBits,
+                                           unsigned int ttlSeconds)
+{
+   PtrLock lock(mSharedMutex.get());
+   mSourceCacheV4Bits = resipMin(v4PrefixBits, 32U);
+   mSourceCacheV6Bits = resipMin(v6PrefixBits, 128U);
+   mSourceCacheTtl = ttlSeconds;
+   mSourceInterfaceCache.clear();
 }
 
 void
@@ -532,6 +547,7 @@ TransportSelector::checkTransportAddRemoveQueue()
 void 
 TransportSelector::poke()
 {
+   PtrLock lock(mSharedMutex.get());
    for(TransportList::iterator it = mHasOwnProcessTransports.begin(); it != mHasOwnProcessTransports.end(); it++)
    {
       try
@@ -570,6 +586,7 @@ TransportSelector::hasDataToSend() const
 DnsResult*
 TransportSelector::createDnsResult(DnsHandler* handler)
 {
+   PtrLock lock(mSharedMutex.get());
    return mDns.createDnsResult(handler);
 }
 
@@ -577,6 +594,7 @@ void
 TransportSelector::dnsResolve(DnsResult* result,
                               SipMessage* msg)
 {
+   PtrLock lock(mSharedMutex.get());
    // Picking the target destination:
    //   - for request, use forced target if set
    //     otherwise use loose routing behaviour (route or, if none, request-uri)
@@ -766,159 +784,277 @@ TransportSelector::determineSourceInterface(SipMessage* msg, const Tuple& target
    if (1)
    {
       Tuple source(target);
-#if defined(WIN32) && !defined(NO_IPHLPAPI)
-      try
+      if (!findCachedSourceInterface(target, source) &&
+          querySourceInterface(target, source))
+      {
+         cacheSourceInterface(target, source);
+      }
+
+      // This is the port that the request will get sent out from. By default,
+      // this value will be 0, since the Helper that creates the request will not
+      // assign it. In this case, the stack will pick an arbitrary (but appropriate)
+      // transport. If it is non-zero, it will only match transports that are bound to
+      // the specified port (and fail if none are available)
+
+      if(msg->isRequest())
       {
-         GenericIPAddress addr = WinCompat::determineSourceInterface(target.toGenericIPAddress());
-         source.setSockaddr(addr);
+         source.setPort(via.sentPort());
       }
-      catch (WinCompat::Exception& ex)
+      else
       {
-         ErrLog (<< "Can't find source interface to use: " << ex);
-         throw Transport::Exception("Can't find source interface", __FILE__, __LINE__);
+         source.setPort(0);
       }
+
+      DebugLog (<< "Looked up source for destination: " << target
+                << " -> " << source
+                << " sent-by=" << via.sentHost()
+                << " sent-port=" << via.sentPort());
+
+      return source;
+   }
+}
+
+// Asks the OS which local address it would send from to reach target, and
+// stores it in source. Returns false if the OS had no answer and source is
+// only a guess, which should not be remembered.
+bool
+TransportSelector::querySourceInterface(const Tuple& target, Tuple& source) const
+{
+   bool cacheable = true;
+#if defined(WIN32) && !defined(NO_IPHLPAPI)
+   try
+   {
+      GenericIPAddress addr = WinCompat::determineSourceInterface(target.toGenericIPAddress());
+      source.setSockaddr(addr);
+   }
+   catch (WinCompat::Exception& ex)
+   {
+      ErrLog (<< "Can't find source interface to use: " << ex);
+      throw Transport::Exception("Can't find source interface", __FILE__, __LINE__);
+   }
 #else
-      // !kh!
-      // The connected UDP technique doesn't work all the time.
-      // 1. Might not work on all implementaions as stated in UNP vol.1 8.14.
-      // 2. Might not work under unspecified condition on Windows,
-      //    search "getsockname" in MSDN library.
-      // 3. We've experienced this issue on our production software.
-
-      // this process will determine which interface the kernel would use to
-      // send a packet to the target by making a connect call on a udp socket.
-      Socket tmp = INVALID_SOCKET;
-      Data netNs = target.getNetNs();
-      // One IPV4 and IPV6 socket per namespace.  Even if we do not support netns,
-      // we still have the default namespace of "" (empty string).
-      if (target.isV4())
+   // !kh!
+   // The connected UDP technique doesn't work all the time.
+   // 1. Might not work on all implementaions as stated in UNP vol.1 8.14.
+   // 2. Might not work under unspecified condition on Windows,
+   //    search "getsockname" in MSDN library.
+   // 3. We've experienced this issue on our production software.
+
+   // this process will determine which interface the kernel would use to
+   // send a packet to the target by making a connect call on a udp socket.
+   Socket tmp = INVALID_SOCKET;
+   Data netNs = target.getNetNs();
+   // One IPV4 and IPV6 socket per namespace.  Even if we do not support netns,
+   // we still have the default namespace of "" (empty string).
+   if (target.isV4())
+   {
+      // If socket does not exist for namespace, create one
+      if (mSockets.find(netNs) == mSockets.end() || mSockets[netNs] == INVALID_SOCKET)
       {
-         // If socket does not exist for namespace, create one
-         if (mSockets.find(netNs) == mSockets.end() || mSockets[netNs] == INVALID_SOCKET)
-         {
 #ifdef USE_NETNS
-            NetNs::setNs(netNs);
+         NetNs::setNs(netNs);
 #endif
-            mSockets[netNs] = InternalTransport::socket(UDP, V4); // may throw
-         }
-         tmp = mSockets[netNs];
+         mSockets[netNs] = InternalTransport::socket(UDP, V4); // may throw
       }
-      else
+      tmp = mSockets[netNs];
+   }
+   else
+   {
+      // If socket does not exist for namespace, create one
+      if (mSocket6s.find(netNs) == mSocket6s.end() || mSocket6s[netNs] == INVALID_SOCKET)
       {
-         // If socket does not exist for namespace, create one
-         if (mSocket6s.find(netNs) == mSocket6s.end() || mSocket6s[netNs] == INVALID_SOCKET)
-         {
 #ifdef USE_NETNS
-            NetNs::setNs(netNs);
+         NetNs::setNs(netNs);
 #endif
-            mSocket6s[netNs] = InternalTransport::socket(UDP, V6); // may throw
-         }
-         tmp = mSocket6s[netNs];
+         mSocket6s[netNs] = InternalTransport::socket(UDP, V6); // may throw
       }
+      tmp = mSocket6s[netNs];
+   }
 
 #ifdef USE_NETNS
-      // Not sure if connect has to be done in netns context or just the socket create
-      NetNs::setNs(netNs);
+   // Not sure if connect has to be done in netns context or just the socket create
+   NetNs::setNs(netNs);
 #endif
 
-      int ret = connect(tmp,&target.getSockaddr(), target.length());
-      if (ret < 0)
-      {
-         int e = getErrno();
-         Transport::error( e );
-         InfoLog(<< "Unable to route to " << target << " : [" << e << "] " << strerror(e) );
-         throw Transport::Exception("Can't find source address for Via", __FILE__,__LINE__);
-      }
+   int ret = connect(tmp,&target.getSockaddr(), target.length());
+   if (ret < 0)
+   {
+      int e = getErrno();
+      Transport::error( e );
+      InfoLog(<< "Unable to route to " << target << " : [" << e << "] " << strerror(e) );
+      throw Transport::Exception("Can't find source address for Via", __FILE__,__LINE__);
+   }
 
-      socklen_t len = source.length();
-      ret = getsockname(tmp,&source.getMutableSockaddr(), &len);
-      if (ret < 0)
-      {
-         int e = getErrno();
-         Transport::error(e);
-         InfoLog(<< "Can't determine name of socket " << target << " : " << strerror(e) );
-         throw Transport::Exception("Can't find source address for Via", __FILE__,__LINE__);
-      }
+   socklen_t len = source.length();
+   ret = getsockname(tmp,&source.getMutableSockaddr(), &len);
+   if (ret < 0)
+   {
+      int e = getErrno();
+      Transport::error(e);
+      InfoLog(<< "Can't determine name of socket " << target << " : " << strerror(e) );
+      throw Transport::Exception("Can't find source address for Via", __FILE__,__LINE__);
+   }
 
-      // !kh! test if connected UDP technique results INADDR_ANY, i.e. 0.0.0.0.
-      // if it does, assume the first avaiable interface.
-      if(source.isV4())
+   // !kh! test if connected UDP technique results INADDR_ANY, i.e. 0.0.0.0.
+   // if it does, assume the first avaiable interface.
+   if(source.isV4())
+   {
+      long src = (reinterpret_cast<const sockaddr_in*>(&source.getSockaddr())->sin_addr.s_addr);
+      if(src == INADDR_ANY)
       {
-         long src = (reinterpret_cast<const sockaddr_in*>(&source.getSockaddr())->sin_addr.s_addr);
-         if(src == INADDR_ANY)
-         {
-            InfoLog(<< "Connected UDP failed to determine source address, use first address instaed.");
-            source = getFirstInterface(true, target.getType());
-         }
+         InfoLog(<< "Connected UDP failed to determine source address, use first address instaed.");
+         source = getFirstInterface(true, target.getType());
+         cacheable = false;
       }
-      else  // IPv6
-      {
+   }
+   else  // IPv6
+   {
 //should never reach here in WIN32 w/ V6 support
 #if defined(USE_IPV6) && !defined(WIN32)
-         if (source.isAnyInterface())  //!dcm! -- when could this happen?
-         {
-            source = getFirstInterface(false, target.getType());
-         }
-# endif
-      }
-      // Unconnect.
-      // !jf! This is necessary, but I am not sure what we can do if this
-      // fails. I'm not sure the stack can recover from this error condition.
-      if (target.isV4())
+      if (source.isAnyInterface())  //!dcm! -- when could this happen?
       {
-         ret = connect(mSockets[netNs],
-                       (struct sockaddr*)&mUnspecified.v4Address,
-                       sizeof(mUnspecified.v4Address));
+         source = getFirstInterface(false, target.getType());
+         cacheable = false;
       }
+# endif
+   }
+   // Unconnect.
+   // !jf! This is necessary, but I am not sure what we can do if this
+   // fails. I'm not sure the stack can recover from this error condition.
+   if (target.isV4())
+   {
+      ret = connect(mSockets[netNs],
+                    (struct sockaddr*)&mUnspecified.v4Address,
+                    sizeof(mUnspecified.v4Address));
+   }
 #ifdef USE_IPV6
-      else
-      {
-         ret = connect(mSocket6s[netNs],
-                       (struct sockaddr*)&mUnspecified6.v6Address,
-                       sizeof(mUnspecified6.v6Address));
-      }
+   else
+   {
+      ret = connect(mSocket6s[netNs],
+                    (struct sockaddr*)&mUnspecified6.v6Address,
+                    sizeof(mUnspecified6.v6Address));
+   }
 #else
-      else
-      {
-         resip_assert(0);
-      }
+   else
+   {
+      resip_assert(0);
+   }
 #endif
 
-      if ( ret<0 )
+   if ( ret<0 )
+   {
+      int e =  getErrno();
+      //.dcm. OS X 10.5 workaround, we could #ifdef for specific OS X version.
+      if  (!(e ==EAFNOSUPPORT || e == EADDRNOTAVAIL))
       {
-         int e =  getErrno();
-         //.dcm. OS X 10.5 workaround, we could #ifdef for specific OS X version.
-         if  (!(e ==EAFNOSUPPORT || e == EADDRNOTAVAIL))
-         {
-            ErrLog(<< "Can't disconnect socket :  " << strerror(e) );
-            Transport::error(e);
-            throw Transport::Exception("Can't disconnect socket", __FILE__,__LINE__);
-         }
+         ErrLog(<< "Can't disconnect socket :  " << strerror(e) );
+         Transport::error(e);
+         throw Transport::Exception("Can't disconnect socket", __FILE__,__LINE__);
       }
+   }
 #endif
+   return cacheable;
+}
 
-      // This is the port that the request will get sent out from. By default,
-      // this value will be 0, since the Helper that creates the request will not
-      // assign it. In this case, the stack will pick an arbitrary (but appropriate)
-      // transport. If it is non-zero, it will only match transports that are bound to
-      // the specified port (and fail if none are available)
-
-      if(msg->isRequest())
+TransportSelector::SourcePrefix::SourcePrefix(const Tuple& dest, unsigned int v4Bits, unsigned int v6Bits)
+{
+   memset(mBytes, 0, sizeof(mBytes));
+   unsigned int bits = 0;
+   if (dest.isV4())
+   {
+      mBytes[0] = V4;
+      memcpy(mBytes + 1, &reinterpret_cast<const sockaddr_in&>(dest.getSockaddr()).sin_addr, 4);
+      bits = v4Bits;
+   }
+#ifdef USE_IPV6
+   else
+   {
+      mBytes[0] = V6;
+      memcpy(mBytes + 1, &reinterpret_cast<const sockaddr_in6&>(dest.getSockaddr()).sin6_addr, 16);
+      bits = v6Bits;
+   }
+#endif
+   for (unsigned int i = 1; i < sizeof(mBytes); ++i)
+   {
+      if (bits >= 8)
       {
-         source.setPort(via.sentPort());
+         bits -= 8;
       }
       else
       {
-         source.setPort(0);
+         mBytes[i] &= (unsigned char)(0xff00 >> bits);
+         bits = 0;
       }
+   }
+   mNetNs = dest.getNetNs();
+}
 
-      DebugLog (<< "Looked up source for destination: " << target
-                << " -> " << source
-                << " sent-by=" << via.sentHost()
-                << " sent-port=" << via.sentPort());
+bool
+TransportSelector::SourcePrefix::operator<(const SourcePrefix& rhs) const
+{
+   int c = memcmp(mBytes, rhs.mBytes, sizeof(mBytes));
+   if (c != 0)
+   {
+      return c < 0;
+   }
+   return mNetNs < rhs.mNetNs;
+}
 
-      return source;
+bool
+TransportSelector::findCachedSourceInterface(const Tuple& target, Tuple& source) const
+{
+   if (mSourceCacheTtl == 0)
+   {
+      return false;
+   }
+
+   SourceInterfaceCache::iterator it =
+      mSourceInterfaceCache.find(SourcePrefix(target, mSourceCacheV4Bits, mSourceCacheV6Bits));
+   if (it == mSourceInterfaceCache.end())
+   {
+      return false;
+   }
+   if (it->second.mExpires <= Timer::getTimeMs())
+   {
+      mSourceInterfaceCache.erase(it);
+      return false;
+   }
+   source.setSockaddr(it->second.mAddress);
+   return true;
+}
+
+void
+TransportSelector::cacheSourceInterface(const Tuple& target, const Tuple& source) const
+{
+   if (mSourceCacheTtl == 0)
+   {
+      return;
+   }
+
+   UInt64 now = Timer::getTimeMs();
+   if (mSourceInterfaceCache.size() >= MaxSourceInterfaceCacheSize)
+   {
+      // Drop whatever has expired; if that is not enough, start over.
+      for (SourceInterfaceCache::iterator it = mSourceInterfaceCache.begin(); it != mSourceInterfaceCache.end();)
+      {
+         if (it->second.mExpires <= now)
+         {
+            mSourceInterfaceCache.erase(it++);
+         }
+         else
+         {
+            ++it;
+         }
+      }
+      if (mSourceInterfaceCache.size() >= MaxSourceInterfaceCacheSize)
+      {
+         mSourceInterfaceCache.clear();
+      }
    }
+
+   CachedSource& cached = mSourceInterfaceCache[SourcePrefix(target, mSourceCacheV4Bits, mSourceCacheV6Bits)];
+   cached.mAddress = source.toGenericIPAddress();
+   cached.mExpires = now + mSourceCacheTtl * 1000ULL;
 }
 
 // !jf! there may be an extra copy of a tuple here. can probably get rid of it
@@ -926,6 +1062,9 @@ TransportSelector::determineSourceInterface(SipMessage* msg, const Tuple& target
 TransportSelector::TransmitState
 TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
 {
+   // Only held while the transport is picked and the message filled in
+   // from it; see the release() below.
+   ReleasablePtrLock lock(mSharedMutex.get());
    resip_assert(msg);
 
    if(msg->mIsDecorated)
@@ -1302,6 +1441,12 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
 
          resip_assert(target.mTransportKey == transport->getKey());
 
+         // Decorating, encoding and sending do not need the lock, so that
+         // shards sharing this selector can do them in parallel.
+         // removeTransport() keeps transport alive until we are done.
+         UnlockedSend unlockedSend(mUnlockedSends);
+         lock.release();
+
          // Call back anyone who wants to perform outbound decoration
          msg->callOutboundDecorators(source, target,remoteSigcompId);
 
@@ -1316,16 +1461,12 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
                                                    msg->getTransactionId(),
                                                    remoteSigcompId));
 
-         send->data.reserve(mAvgBufferSize + mAvgBufferSize/4);
-
-         DataStream str(send->data);
-         msg->encode(str);
-         str.flush();
-
-         // !bwc! Moving average of message size. (Used to intelligently
-         // predict how much space to reserve in the buffer, to minimize
-         // dynamic resizing.)
-         mAvgBufferSize = (255*mAvgBufferSize + send->data.size()+128)/256;
+         // Unmodified header values and bodies are referred to in place
+         // and copied into the send buffer once; the size is known before
+         // anything is copied, so there is no reallocation either.
+         EncodeSegments segs;
+         msg->encode(segs);
+         segs.gather(send->data);
 
          resip_assert(!send->data.empty());
          DebugLog (<< "Transmitting to " << target
@@ -1360,6 +1501,7 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
 void
 TransportSelector::retransmit(const SendData& data)
 {
+   ReleasablePtrLock lock(mSharedMutex.get());
    resip_assert(data.destination.mTransportKey);
    Transport* transport = findTransportByDest(data.destination);
 
@@ -1389,6 +1531,9 @@ TransportSelector::retransmit(const SendData& data)
    if(transport)
    {
       // If this is not true, it means the transport has been removed.
+      UnlockedSend unlockedSend(mUnlockedSends);
+      lock.release();
+
       Transport::SipMessageLoggingHandler* handler = transport->getSipMessageLoggingHandler();
       if(handler)
       {
@@ -1402,6 +1547,7 @@ TransportSelector::retransmit(const SendData& data)
 void 
 TransportSelector::closeConnection(const Tuple& peer)
 {
+   PtrLock lock(mSharedMutex.get());
    Transport* t = findTransportByDest(peer);
    if(t)
    {
@@ -1417,6 +1563,7 @@ TransportSelector::closeConnection(const Tuple& peer)
 unsigned int
 TransportSelector::sumTransportFifoSizes() const
 {
+   PtrLock lock(mSharedMutex.get());
    unsigned int sum = 0;
    for(TransportKeyMap::const_iterator it = mTransports.begin(); it != mTransports.end(); it++)
    {
@@ -1434,6 +1581,7 @@ TransportSelector::terminateFlow(const resip::Tuple& flow)
 void 
 TransportSelector::enableFlowTimer(const resip::Tuple& flow)
 {
+   PtrLock lock(mSharedMutex.get());
    Transport* t = findTransportByDest(flow);
    if(t)
    {
@@ -1449,6 +1597,7 @@ TransportSelector::enableFlowTimer(const resip::Tuple& flow)
 void 
 TransportSelector::invokeAfterSocketCreationFunc(TransportType type)
 {
+    PtrLock lock(mSharedMutex.get());
     for (TransportKeyMap::iterator it = mTransports.begin(); it != mTransports.end(); it++)
     {
         if (type == UNKNOWN_TRANSPORT || type == it->second->transport())
@@ -1468,77 +1617,14 @@ TransportSelector::findTransportByDest(const Tuple& target)
 {
    if(target.mTransportKey)
    {
-      TransportKeyMap::iterator it = mTransports.find(target.mTransportKey);
-      if(it != mTransports.end())
-      {
-          return it->second;
-      }
-   }
-   else
-   {
-      std::pair<TypeToTransportMap::iterator, TypeToTransportMap::iterator> range(mTypeToTransportMap.equal_range(target));
-
-      if(range.first != range.second) // At least one match
-      {
-         TypeToTransportMap::iterator i=range.first;
-         ++i;
-         if(i==range.second) // Exactly one match
-         {
-            return range.first->second;
-         }
-      }
+      return mRoutes->findByKey(target.mTransportKey);
    }
 
-   // .bwc. No luck here. Maybe findTransportBySource will end up working.
-   return 0;
+   // .bwc. If there is exactly one transport of this type and version, use
+   // it. Otherwise, maybe findTransportBySource will end up working.
+   return mRoutes->findOnlyOfType(target);
 }
 
-/**
-   Search for Transport on any loopback interface matching {search}.
-   WATCHOUT: This is O(N) walk thru (nearly) all transports.
-**/
-Transport*
-TransportSelector::findLoopbackTransportBySource(bool ignorePort, Tuple& search) const
-{
-   //When we are sending to a loopback address, the kernel makes an
-   //(effectively) arbitrary choice of which loopback address to send
-   //from. (Since any loopback address can be used to send to any other
-   //loopback address) This choice may not agree with our idea of what
-   //address we should be sending from, so we need to just choose the
-   //loopback address we like, and ignore what the kernel told us to do.
-   ExactTupleMap::const_iterator i;
-   for (i=mExactTransports.begin();i != mExactTransports.end();i++)
-   {
-      DebugLog(<<"search: " << search << " elem: " << i->first);
-      if(i->first.ipVersion()==V4)
-      {
-         //Compare only the first byte (the 127)
-         if(i->first.isEqualWithMask(search,8,ignorePort))
-         {
-            // Not sure if this should go here or in Tuple::isEqualWithMask
-            if(i->first.getNetNs() == search.getNetNs())
-            {
-               search=i->first;
-               DebugLog(<<"Match!");
-               return i->second;
-            }
-         }
-      }
-#ifdef USE_IPV6
-      else if(i->first.ipVersion()==V6)
-      {
-         //What to do?
-      }
-#endif
-      else
-      {
-         resip_assert(0);
-      }
-   }
-   
-   return 0;
-} // of findLoopbackTransport
-
 Transport*
 TransportSelector::findTransportBySource(Tuple& search, const SipMessage* msg) const
 {
@@ -1561,76 +1647,63 @@ TransportSelector::findTransportBySource(Tuple& search, const SipMessage* msg) c
    if (!ignorePort)
    {
       // 1. search for matching port on a specific interface
+      if (Transport* trans = mRoutes->findExact(search))
       {
-         ExactTupleMap::const_iterator i = mExactTransports.find(search);
-         if (i != mExactTransports.end())
-         {
-            DebugLog(<< "findTransport (exact) => " << *(i->second));
-            return i->second;
-         }
+         DebugLog(<< "findTransport (exact) => " << *trans);
+         return trans;
       }
 
       // 2. search for matching port on any loopback interface
+      //When we are sending to a loopback address, the kernel makes an
+      //(effectively) arbitrary choice of which loopback address to send
+      //from. (Since any loopback address can be used to send to any other
+      //loopback address) This choice may not agree with our idea of what
+      //address we should be sending from, so we need to just choose the
+      //loopback address we like, and ignore what the kernel told us to do.
       if (search.isLoopback())
       {
-         Transport *trans = findLoopbackTransportBySource( /*ignorePort*/false, search);
-         if (trans)
+         if (Transport* trans = mRoutes->findLoopback(search, /*ignorePort*/false))
          {
-            DebugLog(<< "findLoopbackTransportBySource(" << search << ")");
+            DebugLog(<< "findTransport (loopback) => " << *trans << " search: " << search);
             return trans;
          }
       }
 
       // 3. search for specific port on ANY interface
+      if (Transport* trans = mRoutes->findAnyInterface(search))
       {
-         AnyInterfaceTupleMap::const_iterator i = mAnyInterfaceTransports.find(search);
-         if (i != mAnyInterfaceTransports.end())
-         {
-            DebugLog(<< "findTransport (any interface) => " << *(i->second));
-            return i->second;
-         }
+         DebugLog(<< "findTransport (any interface) => " << *trans);
+         return trans;
       }
    }
    else
    {
       // 1. search for ANY port on specific interface
+      if (Transport* trans = mRoutes->findAnyPort(search))
       {
-         AnyPortTupleMap::const_iterator i = mAnyPortTransports.find(search);
-         if (i != mAnyPortTransports.end())
-         {
-            DebugLog(<< "findTransport (any port, specific interface) => " << *(i->second) << " key: " << (i->first) << " search: " << search);
-            return i->second;
-         }
+         DebugLog(<< "findTransport (any port, specific interface) => " << *trans << " search: " << search);
+         return trans;
       }
 
       // 2. search for ANY port on any loopback interface
       if (search.isLoopback())
       {
-         Transport *trans = findLoopbackTransportBySource( /*ignorePort*/true, search);
-         if (trans)
+         if (Transport* trans = mRoutes->findLoopback(search, /*ignorePort*/true))
          {
+            DebugLog(<< "findTransport (loopback, any port) => " << *trans << " search: " << search);
             return trans;
          }
       }
 
       // 3. search for ANY port on ANY interface
+      if (Transport* trans = mRoutes->findAnyPortAnyInterface(search))
       {
-         //CerrLog(<< "Trying AnyPortAnyInterfaceTupleMap " << mAnyPortAnyInterfaceTransports.size());
-         AnyPortAnyInterfaceTupleMap::const_iterator i = mAnyPortAnyInterfaceTransports.find(search);
-         if (i != mAnyPortAnyInterfaceTransports.end())
-         {
-            DebugLog(<< "findTransport (any port, any interface) => " << *(i->second));
-            return i->second;
-         }
+         DebugLog(<< "findTransport (any port, any interface) => " << *trans);
+         return trans;
       }
    }
 
-   DebugLog (<< "Exact interface / Specific port: " << Inserter(mExactTransports));
-   DebugLog (<< "Any interface / Specific port: " << Inserter(mAnyInterfaceTransports));
-   DebugLog (<< "Exact interface / Any port: " << Inserter(mAnyPortTransports));
-   DebugLog (<< "Any interface / Any port: " << Inserter(mAnyPortAnyInterfaceTransports));
-
-   WarningLog(<< "Can't find matching transport " << search);
+   WarningLog(<< "Can't find matching transport " << search << " among " << mRoutes->numTransports() << " transports");
    return 0;
 }
 
@@ -1639,33 +1712,18 @@ TransportSelector::findTlsTransport(const Data& domainname, TransportType type,
 {
    resip_assert(isSecure(type));
    DebugLog(<< "Searching for " << toData(type) << " transport for domain='"
-                  << domainname << "'" << " have " << mTlsTransports.size());
+                  << domainname << "'" << " have " << mRoutes->numTransports());
 
-   if (domainname == Data::Empty)
+   Transport* transport = mRoutes->findTls(domainname, type, version);
+   if(transport)
    {
-      for(TlsTransportMap::const_iterator i=mTlsTransports.begin(); i != mTlsTransports.end();++i)
-      {
-         if(i->first.mTuple.getType() == type && i->first.mTuple.ipVersion() == version)
-         {
-            DebugLog(<<"Found a default transport.");
-            return i->second;
-         }
-      }
+      DebugLog(<< (domainname.empty() ? "Found a default transport." : "Found a transport."));
    }
    else
    {
-      TlsTransportKey key(domainname, type, version);
-      TlsTransportMap::const_iterator i=mTlsTransports.find(key);
-
-      if(i!=mTlsTransports.end())
-      {
-         DebugLog(<< "Found a transport.");
-         return i->second;
-      }
+      DebugLog(<<"No transport found.");
    }
-
-   DebugLog(<<"No transport found.");
-   return 0;
+   return transport;
 }
 
 unsigned int
@@ -5,14 +5,18 @@
 #include <sys/select.h>
 #endif
 
+#include <atomic>
 #include <map>
 #include <vector>
 #include <list>
+#include <memory>
 
 #include "rutil/Data.hxx"
 #include "rutil/Fifo.hxx"
+#include "rutil/RecursiveMutex.hxx"
 #include "rutil/GenericIPAddress.hxx"
 #include "resip/stack/Transport.hxx"
+#include "resip/stack/TransportRouteTable.hxx"
 #include "resip/stack/DnsInterface.hxx"
 #include "rutil/SelectInterruptor.hxx"
 
@@ -54,7 +58,9 @@ the TransactionController Thread.  The TransportSelectorThread itself is used
 to provide cycles to the actual transports for sending data in their Fifo's and
 receiving data from the wire.  The mSharedProcessTransports list is one member that
 is expected to be accessed from TransportSelector processing loop only , all other 
-members are accessed from the TransactionController processing loop.
+members are accessed from the TransactionController processing loop (or, when
+several TransactionController shards share the selector, from any of their
+loops while holding the lock enabled by setShared()).
 */
 class TransportSelector
 {
@@ -75,6 +81,19 @@ class TransportSelector
       /// Returns true if all Transports have their buffers cleared, false otherwise.
       bool isFinished() const;
 
+      /// Called when more than one TransactionController shard will share this
+      /// TransportSelector; from then on transmit, DNS resolution and the
+      /// transport add/remove/flow operations serialize on a mutex. transmit
+      /// only holds it while it picks the transport; encoding and sending
+      /// happen outside it. Must be called before the stack is running.
+      void setShared()
+      {
+         if(!mSharedMutex.get())
+         {
+            mSharedMutex.reset(new RecursiveMutex);
+         }
+      }
+
       /// Configure a PollGrp to use (instead of buildFdSet/process)
       /// Must be called before adding any transports
       void setPollGrp(FdPollGrp *pollGrp);
@@ -155,6 +174,22 @@ class TransportSelector
 
       void invokeAfterSocketCreationFunc(TransportType type);
 
+      /**
+         When a message has to be sent from a transport bound to ANY
+         interface, the OS is asked which local address it would use to
+         reach the destination. The answers are kept for ttlSeconds, shared
+         by all destinations in the same prefix of v4PrefixBits or
+         v6PrefixBits. The defaults (32, 128, 60) only share an answer
+         between messages to the same address; shorter prefixes save more
+         lookups, but are only correct if the OS routes the whole prefix
+         out of one interface. A ttlSeconds of 0 turns the cache off.
+         Unless the selector is shared between transaction shards, this is
+         not locked against sends; see SipStack::setSourceInterfaceCache().
+      */
+      void setSourceInterfaceCache(unsigned int v4PrefixBits,
+                                   unsigned int v6PrefixBits,
+                                   unsigned int ttlSeconds);
+
       /**
          @internal - public only for stream operator access
       */
@@ -197,50 +232,68 @@ class TransportSelector
       void checkTransportAddRemoveQueue();
       Connection* findConnection(const Tuple& dest) const;
       Transport* findTransportBySource(Tuple& src, const SipMessage* msg) const;
-      Transport* findLoopbackTransportBySource(bool ignorePort, Tuple& src) const;
       Transport* findTransportByDest(const Tuple& dest);
       Transport* findTransportByVia(SipMessage* msg, const Tuple& dest, Tuple& src) const;
       Transport* findTlsTransport(const Data& domain,TransportType type,IpVersion ipv) const;
       Tuple determineSourceInterface(SipMessage* msg, const Tuple& dest) const;
-      void rebuildAnyPortTransportMaps(void);
+      bool querySourceInterface(const Tuple& dest, Tuple& source) const;
+      bool findCachedSourceInterface(const Tuple& dest, Tuple& source) const;
+      void cacheSourceInterface(const Tuple& dest, const Tuple& source) const;
+      void rebuildRoutes();
 
       DnsInterface mDns;
       Fifo<TransactionMessage>& mStateMacFifo;
+      // only set if shared between TransactionController shards
+      std::auto_ptr<RecursiveMutex> mSharedMutex;
+      // transmits between releasing mSharedMutex and being done with their
+      // Transport; removeTransport() waits for these before it lets go of
+      // one
+      std::atomic<unsigned int> mUnlockedSends;
       Security* mSecurity;// for computing identity header
 
-      // specific port and interface
-      typedef std::map<Tuple, Transport*> ExactTupleMap;
-      ExactTupleMap mExactTransports;
-
-      // specific port, ANY interface
-      typedef std::map<Tuple, Transport*, Tuple::AnyInterfaceCompare> AnyInterfaceTupleMap;
-      AnyInterfaceTupleMap mAnyInterfaceTransports;
-
-      // ANY port, specific interface
-      typedef std::map<Tuple, Transport*, Tuple::AnyPortCompare> AnyPortTupleMap;
-      AnyPortTupleMap mAnyPortTransports;
-
-      // ANY port, ANY interface
-      typedef std::map<Tuple, Transport*, Tuple::AnyPortAnyInterfaceCompare> AnyPortAnyInterfaceTupleMap;
-      AnyPortAnyInterfaceTupleMap mAnyPortAnyInterfaceTransports;
-
       typedef std::map<unsigned int, Transport*> TransportKeyMap;
       TransportKeyMap mTransports; // owns all Transports
 
-      typedef std::map<TlsTransportKey, Transport*> TlsTransportMap ;
-      TlsTransportMap mTlsTransports;
+      // All transport lookups by key, address, port and TLS domain. Rebuilt
+      // from mTransports whenever a transport is added or removed. Lookups
+      // and rebuilds happen on the selector's thread, or under mSharedMutex
+      // when the selector is shared, so a lookup never sees a table being
+      // replaced.
+      std::auto_ptr<TransportRouteTable> mRoutes;
 
       typedef std::list<Transport*> TransportList;
       TransportList mSharedProcessTransports;  // Warning - only access this from the TransportSelector process loop / thread
       TransportList mHasOwnProcessTransports;
 
-      typedef std::multimap<Tuple, Transport*, Tuple::AnyPortAnyInterfaceCompare> TypeToTransportMap;
-      TypeToTransportMap mTypeToTransportMap;
-
       // fake socket(s) one for each netns, for connect() and route table lookups
       mutable HashMap<Data, Socket> mSockets;
       mutable HashMap<Data, Socket> mSocket6s;
 
+      // Source addresses found through those sockets, by destination
+      // prefix (see setSourceInterfaceCache()).
+      class SourcePrefix
+      {
+         public:
+            SourcePrefix(const Tuple& dest, unsigned int v4Bits, unsigned int v6Bits);
+            bool operator<(const SourcePrefix& rhs) const;
+
+         private:
+            // IP version, then the address with the host bits cleared
+            unsigned char mBytes[17];
+            Data mNetNs;
+      };
+      struct CachedSource
+      {
+         GenericIPAddress mAddress;
+         UInt64 mExpires;
+      };
+      typedef std::map<SourcePrefix, CachedSource> SourceInterfaceCache;
+      enum { MaxSourceInterfaceCacheSize = 16384 };
+      mutable SourceInterfaceCache mSourceInterfaceCache;
+      unsigned int mSourceCacheV4Bits;
+      unsigned int mSourceCacheV6Bits;
+      unsigned int mSourceCacheTtl;
+
       // An AF_UNSPEC addr_in for rapid unconnect
       GenericIPAddress mUnspecified;
       GenericIPAddress mUnspecified6;
@@ -252,7 +305,6 @@ class TransportSelector
       // epoll support, for sharedprocess transports
       FdPollGrp* mPollGrp;
 
-      int mAvgBufferSize;
       Fifo<Transport> mTransportsToAddRemove;
       std::auto_ptr<SelectInterruptor> mSelectInterruptor;
       FdPollItemHandle mInterruptorHandle;
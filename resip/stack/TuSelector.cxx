@@ -191,11 +191,15 @@ TuSelector::unregisterTransactionUser(TransactionUser& tu)
 }
 
 TransactionUser* 
-TuSelector::selectTransactionUser(const SipMessage& msg)
+TuSelector::selectTransactionUser(const SipMessage& msg, int shard)
 {
    DebugLog(<< "TuSelector::selectTransactionUser: Checking which TU message belongs to:" << std::endl << std::endl << msg);
    for(TuList::iterator it = mTuList.begin(); it != mTuList.end(); it++)
    {
+      if (shard >= 0 && it->tu->getShard() >= 0 && it->tu->getShard() != shard)
+      {
+         continue;
+      }
       if (it->tu->isForMe(msg))
       {
          return it->tu;
@@ -29,7 +29,9 @@ class TuSelector
       unsigned int size() const;      
       bool wouldAccept(TimeLimitFifo<Message>::DepthUsage usage) const;
   
-      TransactionUser* selectTransactionUser(const SipMessage& msg);
+      // shard is the TransactionController shard msg arrived on; TUs bound to
+      // another shard are skipped (see TransactionUser::setShard()).
+      TransactionUser* selectTransactionUser(const SipMessage& msg, int shard=-1);
       bool haveTransactionUsers() const { return mTuSelectorMode; }
       void registerTransactionUser(TransactionUser&, const bool front = false);
       void requestTransactionUserShutdown(TransactionUser&);
@@ -2,7 +2,11 @@
 
 #include "resip/stack/MarkListener.hxx"
 #include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
 #include "rutil/Timer.hxx"
+#include "rutil/dns/DnsSnapshot.hxx"
+
+#define RESIPROCATE_SUBSYSTEM resip::Subsystem::DNS
 
 namespace resip
 {
@@ -10,6 +14,7 @@ namespace resip
 TupleMarkManager::MarkType 
 TupleMarkManager::getMarkType(const Tuple& tuple)
 {
+   Lock lock(mMutex);
    ListEntry entry(tuple,0);
    TupleList::iterator i=mList.find(entry);
    
@@ -35,6 +40,7 @@ TupleMarkManager::getMarkType(const Tuple& tuple)
 
 void TupleMarkManager::mark(const Tuple& tuple,UInt64 expiry,MarkType mark)
 {
+   Lock lock(mMutex);
    // .amr. Notify listeners first so they can change the entry if they want
    notifyListeners(tuple,expiry,mark);
    ListEntry entry(tuple,expiry);
@@ -43,14 +49,70 @@ void TupleMarkManager::mark(const Tuple& tuple,UInt64 expiry,MarkType mark)
 
 void TupleMarkManager::registerMarkListener(MarkListener* listener)
 {
+   Lock lock(mMutex);
    mListeners.insert(listener);
 }
 
 void TupleMarkManager::unregisterMarkListener(MarkListener* listener)
 {
+   Lock lock(mMutex);
    mListeners.erase(listener);
 }
 
+void
+TupleMarkManager::saveSnapshot(DnsSnapshotWriter& out)
+{
+   Lock lock(mMutex);
+   UInt64 now=Timer::getTimeMs();
+   for(TupleList::const_iterator i=mList.begin(); i!=mList.end(); ++i)
+   {
+      const Tuple& tuple=i->first.mTuple;
+      if(i->first.mExpiry <= now || i->second==OK)
+      {
+         continue;
+      }
+      out.putData(Tuple::inet_ntop(tuple));
+      out.putUInt16((UInt16)tuple.getPort());
+      out.putUInt8(tuple.ipVersion()==V6 ? 6 : 4);
+      out.putUInt8((UInt8)tuple.getType());
+      out.putData(tuple.getTargetDomain());
+      out.putData(tuple.getNetNs());
+      out.putUInt64(i->first.mExpiry - now); // time left, in ms
+      out.putUInt8((UInt8)i->second);
+   }
+}
+
+void
+TupleMarkManager::loadSnapshot(DnsSnapshotReader& in, UInt64 ageSecs)
+{
+   Lock lock(mMutex);
+   UInt64 now=Timer::getTimeMs();
+   while(!in.atEnd())
+   {
+      Data address;
+      UInt16 port=0;
+      UInt8 version=0;
+      UInt8 type=0;
+      Data targetDomain;
+      Data netNs;
+      UInt64 remaining=0;
+      UInt8 mark=0;
+      if(!in.getData(address) || !in.getUInt16(port) || !in.getUInt8(version) ||
+         !in.getUInt8(type) || !in.getData(targetDomain) || !in.getData(netNs) ||
+         !in.getUInt64(remaining) || !in.getUInt8(mark))
+      {
+         WarningLog(<< "Tuple marks in DNS cache snapshot are truncated");
+         return;
+      }
+      if(remaining <= ageSecs*1000 || (mark!=GREY && mark!=BLACK) || type>=MAX_TRANSPORT)
+      {
+         continue;
+      }
+      Tuple tuple(address, port, version==6 ? V6 : V4, (TransportType)type, targetDomain, netNs);
+      mList[ListEntry(tuple, now + remaining - ageSecs*1000)]=(MarkType)mark;
+   }
+}
+
 void
 TupleMarkManager::notifyListeners(const resip::Tuple& tuple, UInt64& expiry, MarkType& mark)
 {
@@ -3,6 +3,7 @@
 
 #include "resip/stack/Tuple.hxx"
 #include "rutil/Mutex.hxx"
+#include "rutil/dns/DnsStub.hxx"
 #include <set>
 #include <map>
 
@@ -11,7 +12,7 @@ namespace resip
 
 class MarkListener;
 
-class TupleMarkManager
+class TupleMarkManager : public DnsStub::SnapshotHandler
 {
    public:
       TupleMarkManager(){}
@@ -25,12 +26,19 @@ class TupleMarkManager
       }
       MarkType;
 
+      // These may be called from any thread. MarkListeners are called with
+      // the manager locked, and must not call back into it.
       MarkType getMarkType(const Tuple& tuple);
       
       void mark(const Tuple& tuple,UInt64 expiry,MarkType mark);
       void registerMarkListener(MarkListener*);
       void unregisterMarkListener(MarkListener*);
 
+      // Unexpired marks are kept in the DNS cache snapshot. Restoring them
+      // does not notify the MarkListeners.
+      void saveSnapshot(DnsSnapshotWriter& out);
+      void loadSnapshot(DnsSnapshotReader& in, UInt64 ageSecs);
+
    private:
       
       class ListEntry
@@ -54,6 +62,8 @@ class TupleMarkManager
             
       typedef std::set<MarkListener*> Listeners;
       Listeners mListeners;
+
+      Mutex mMutex;
       
       void notifyListeners(const resip::Tuple& tuple, UInt64& expiry, MarkType& mark);
 };
@@ -8,6 +8,7 @@
 #include "resip/stack/SendData.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/UdpTransport.hxx"
+#include "resip/stack/TransportThread.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/DnsUtil.hxx"
 #include "rutil/Logger.hxx"
@@ -16,6 +17,15 @@
 #include "rutil/compat.hxx"
 #include "rutil/stun/Stun.hxx"
 
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+#define RESIP_UDP_MMSG
+#include <sys/socket.h>
+#endif
+
+#ifdef RESIP_POLL_IMPL_URING
+#include <sys/socket.h>
+#endif
+
 #ifdef USE_SIGCOMP
 #include <osc/Stack.h>
 #include <osc/StateChanges.h>
@@ -27,6 +37,146 @@
 using namespace std;
 using namespace resip;
 
+#ifdef RESIP_UDP_MMSG
+/**
+   Per-slot state for recvmmsg/sendmmsg. Receive buffers are handed to
+   SipMessages as they are consumed and replaced on the next receive.
+**/
+struct UdpTransport::MmsgBatch
+{
+   MmsgBatch(unsigned size)
+      : mHdrs(new mmsghdr[size]),
+        mIovs(new iovec[size]),
+        mAddrs(new sockaddr_storage[size]),
+        mRxBuffers(new char*[size]),
+        mTxData(new SendData*[size])
+   {
+      for (unsigned i=0; i<size; ++i)
+      {
+         mRxBuffers[i] = 0;
+         mTxData[i] = 0;
+      }
+   }
+   ~MmsgBatch()
+   {
+      delete [] mHdrs;
+      delete [] mIovs;
+      delete [] mAddrs;
+      delete [] mTxData;
+      // mRxBuffers entries are freed by the owner, which knows the size
+      delete [] mRxBuffers;
+   }
+
+   void setSlot(unsigned i, void* name, socklen_t namelen, char* buf, size_t len)
+   {
+      mIovs[i].iov_base = buf;
+      mIovs[i].iov_len = len;
+      msghdr& hdr = mHdrs[i].msg_hdr;
+      memset(&hdr, 0, sizeof(hdr));
+      hdr.msg_name = name;
+      hdr.msg_namelen = namelen;
+      hdr.msg_iov = &mIovs[i];
+      hdr.msg_iovlen = 1;
+      mHdrs[i].msg_len = 0;
+   }
+
+   mmsghdr* mHdrs;
+   iovec* mIovs;
+   sockaddr_storage* mAddrs;
+   char** mRxBuffers;
+   SendData** mTxData;
+};
+#endif
+
+#ifdef RESIP_POLL_IMPL_URING
+/**
+   Receives and sends queued on a FdPollGrp that does the socket I/O
+   itself (FdPollGrp::submitIo()). Every receive slot is kept queued; its
+   buffer is handed to a SipMessage as it is consumed and replaced before
+   the slot is queued again. Send slots are taken as messages come off the
+   tx fifo, and are free again once the send is reported.
+**/
+struct UdpTransport::IoSlots
+{
+   IoSlots(unsigned depth)
+      : mDepth(depth),
+        mRx(new FdPollIo[depth]),
+        mRxHdrs(new msghdr[depth]),
+        mRxIovs(new iovec[depth]),
+        mRxAddrs(new sockaddr_storage[depth]),
+        mRxBuffers(new char*[depth]),
+        mTx(new FdPollIo[depth]),
+        mTxHdrs(new msghdr[depth]),
+        mTxIovs(new iovec[depth]),
+        mTxData(new SendData*[depth])
+   {
+      for (unsigned i=0; i<depth; ++i)
+      {
+         mRx[i].mOp = FPEM_Read;
+         mRx[i].mHdr = &mRxHdrs[i];
+         mRxBuffers[i] = 0;
+         mTx[i].mOp = FPEM_Write;
+         mTx[i].mHdr = &mTxHdrs[i];
+         mTxData[i] = 0;
+         mTxFree.push_back(i);
+      }
+   }
+   ~IoSlots()
+   {
+      for (unsigned i=0; i<mDepth; ++i)
+      {
+         delete[] mRxBuffers[i];
+         delete mTxData[i];
+      }
+      delete [] mRx;
+      delete [] mRxHdrs;
+      delete [] mRxIovs;
+      delete [] mRxAddrs;
+      delete [] mRxBuffers;
+      delete [] mTx;
+      delete [] mTxHdrs;
+      delete [] mTxIovs;
+      delete [] mTxData;
+   }
+
+   static void setSlot(msghdr& hdr, iovec& iov, void* name, socklen_t namelen,
+                       char* buf, size_t len)
+   {
+      iov.iov_base = buf;
+      iov.iov_len = len;
+      memset(&hdr, 0, sizeof(hdr));
+      hdr.msg_name = name;
+      hdr.msg_namelen = namelen;
+      hdr.msg_iov = &iov;
+      hdr.msg_iovlen = 1;
+   }
+
+   /// Sends queued when the slots were cancelled are dropped.
+   void releaseTx()
+   {
+      mTxFree.clear();
+      for (unsigned i=0; i<mDepth; ++i)
+      {
+         delete mTxData[i];
+         mTxData[i] = 0;
+         mTxFree.push_back(i);
+      }
+   }
+
+   const unsigned mDepth;
+   FdPollIo* mRx;
+   msghdr* mRxHdrs;
+   iovec* mRxIovs;
+   sockaddr_storage* mRxAddrs;
+   char** mRxBuffers;
+   FdPollIo* mTx;
+   msghdr* mTxHdrs;
+   iovec* mTxIovs;
+   SendData** mTxData;
+   std::vector<unsigned> mTxFree;
+};
+#endif
+
 UdpTransport::UdpTransport(Fifo<TransactionMessage>& fifo,
                            int portNum,
                            IpVersion version,
@@ -39,11 +189,17 @@ UdpTransport::UdpTransport(Fifo<TransactionMessage>& fifo,
      mSigcompStack(0),
      mRxBuffer(0),
      mExternalUnknownDatagramHandler(0),
-     mInWritable(false)
+     mInWritable(false),
+     mBatchSize(1),
+     mBatch(0),
+     mSubmitIo(false),
+     mIo(0),
+     mShardOf(0)
 {
    mPollEventCnt = 0;
    mTxTryCnt = mTxMsgCnt = mTxFailCnt = 0;
    mRxTryCnt = mRxMsgCnt = mRxKeepaliveCnt = mRxTransactionCnt = 0;
+   mRxBatchCnt = mRxBatchMsgCnt = mTxBatchCnt = mTxBatchMsgCnt = 0;
    mTuple.setType(UDP);
    mFd = InternalTransport::socket(transport(), version);
    mTuple.mFlowKey=(FlowKey)mFd;
@@ -72,6 +228,16 @@ UdpTransport::UdpTransport(Fifo<TransactionMessage>& fifo,
 
 UdpTransport::~UdpTransport()
 {
+   for (size_t i=0; i<mShardThreads.size(); ++i)
+   {
+      mShardThreads[i]->shutdown();
+   }
+   for (size_t i=0; i<mShards.size(); ++i)
+   {
+      mShardThreads[i]->join();
+      delete mShardThreads[i];
+      delete mShards[i];
+   }
    InfoLog(<< "Shutting down " << mTuple
            <<" tf="<<mTransportFlags<<" evt="<<(mPollGrp?1:0)
            <<" stats:"
@@ -83,6 +249,9 @@ UdpTransport::~UdpTransport()
            <<" rxmsg="<<mRxMsgCnt
            <<" rxka="<<mRxKeepaliveCnt
            <<" rxtr="<<mRxTransactionCnt
+           <<" batch="<<mBatchSize
+           <<" rxbatch="<<mRxBatchCnt<<"/"<<mRxBatchMsgCnt
+           <<" txbatch="<<mTxBatchCnt<<"/"<<mTxBatchMsgCnt
            );
 #ifdef USE_SIGCOMP
    delete mSigcompStack;
@@ -91,7 +260,21 @@ UdpTransport::~UdpTransport()
    {
       delete[] mRxBuffer;
    }
+#ifdef RESIP_UDP_MMSG
+   if ( mBatch )
+   {
+      for (unsigned i=0; i<mBatchSize; ++i)
+      {
+         delete[] mBatch->mRxBuffers[i];
+         delete mBatch->mTxData[i];
+      }
+      delete mBatch;
+   }
+#endif
    setPollGrp(0);
+#ifdef RESIP_POLL_IMPL_URING
+   delete mIo;
+#endif
 }
 
 void
@@ -99,13 +282,26 @@ UdpTransport::setPollGrp(FdPollGrp *grp)
 {
    if(mPollGrp)
    {
+      // also cancels the receives and sends queued on it
       mPollGrp->delPollItem(mPollItemHandle);
       mPollItemHandle=0;
+#ifdef RESIP_POLL_IMPL_URING
+      if (mIo)
+      {
+         mIo->releaseTx();
+      }
+#endif
    }
+   mSubmitIo = false;
 
    if(mFd!=INVALID_SOCKET && grp)
    {
-      mPollItemHandle = grp->addPollItem(mFd, FPEM_Read, this);
+#ifdef RESIP_POLL_IMPL_URING
+      // When the group can do the receives and sends itself there is no
+      // readiness to poll for.
+      mSubmitIo = grp->canSubmitIo();
+#endif
+      mPollItemHandle = grp->addPollItem(mFd, mSubmitIo ? 0 : FPEM_Read, this);
       // above released by InternalTransport destructor
       // ?bwc? Is this really a good idea? If the InternalTransport d'tor is
       // freeing this, shouldn't InternalTransport::setPollGrp() handle 
@@ -113,6 +309,20 @@ UdpTransport::setPollGrp(FdPollGrp *grp)
    }
 
    InternalTransport::setPollGrp(grp);
+
+#ifdef RESIP_POLL_IMPL_URING
+   if (mSubmitIo)
+   {
+      if (mIo == 0)
+      {
+         mIo = new IoSlots(mBatchSize > 1 ? mBatchSize : DefaultIoDepth);
+      }
+      for (unsigned i=0; i<mIo->mDepth && mSubmitIo; ++i)
+      {
+         submitRx(i);
+      }
+   }
+#endif
 }
 
 
@@ -122,6 +332,13 @@ UdpTransport::setPollGrp(FdPollGrp *grp)
 void
 UdpTransport::process() 
 {
+   if ( mSubmitIo )
+   {
+      processTxIo();
+      mStateMachineFifo.flush();
+      return;
+   }
+
    if ( (mTransportFlags & RESIP_TRANSPORT_FLAG_TXNOW)!= 0 )
    {
        processTxAll();
@@ -176,6 +393,204 @@ UdpTransport::processPollEvent(FdPollEventMask mask)
    mStateMachineFifo.flush();
 }
 
+/**
+ * Called when a receive or send queued by submitRx() or processTxIo()
+ * has been carried out.
+**/
+void
+UdpTransport::processIoCompletion(FdPollIo& io)
+{
+#ifdef RESIP_POLL_IMPL_URING
+   ++mPollEventCnt;
+   if ( io.mOp & FPEM_Read )
+   {
+      unsigned i = (unsigned)(&io - mIo->mRx);
+      ++mRxTryCnt;
+      int len = io.mResult;
+      if (len < 0)
+      {
+         if ( -len != EAGAIN && -len != EWOULDBLOCK && -len != ECANCELED )
+         {
+            error( -len );
+         }
+      }
+      // same len-1 trick as processRxRecv() to spot truncation
+      else if (len+1 >= MaxBufferSize)
+      {
+         InfoLog(<<"Datagram exceeded max length "<<MaxBufferSize);
+      }
+      else if (len > 0)
+      {
+         ++mRxMsgCnt;
+         Tuple sender(mTuple);
+         socklen_t slen = mIo->mRxHdrs[i].msg_namelen;
+         if (slen > sender.length())
+         {
+            slen = sender.length();
+         }
+         memcpy(&sender.getMutableSockaddr(), &mIo->mRxAddrs[i], slen);
+         if ( processRxParse(mIo->mRxBuffers[i], len, sender) )
+         {
+            mIo->mRxBuffers[i] = 0;
+         }
+      }
+      if (mSubmitIo)
+      {
+         submitRx(i);
+      }
+   }
+   else
+   {
+      unsigned i = (unsigned)(&io - mIo->mTx);
+      std::auto_ptr<SendData> sendData(mIo->mTxData[i]);
+      mIo->mTxData[i] = 0;
+      mIo->mTxFree.push_back(i);
+      if (io.mResult < 0)
+      {
+         error(-io.mResult);
+         InfoLog (<< "Failed (" << -io.mResult << ") sending to " << sendData->destination);
+         fail(sendData->transactionId);
+         ++mTxFailCnt;
+      }
+      else if ((size_t)io.mResult != sendData->data.size())
+      {
+         ErrLog (<< "UDPTransport - send buffer full" );
+         fail(sendData->transactionId);
+      }
+      if (mSubmitIo)
+      {
+         processTxIo();
+      }
+      else
+      {
+         updateEvents();
+      }
+   }
+   mStateMachineFifo.flush();
+#endif
+}
+
+/**
+ * Called when the poll group refuses a request: it can no longer do the
+ * socket I/O itself (see FdPollGrp::submitIo()). From here on the
+ * transport polls for readiness, as on any other group; the requests
+ * still queued are reported cancelled.
+**/
+void
+UdpTransport::stopSubmitIo()
+{
+   WarningLog(<< "Poll group stopped taking socket I/O, polling " << mTuple
+              << " for readiness instead");
+   mSubmitIo = false;
+   mInWritable = false;
+   mPollGrp->modPollItem(mPollItemHandle, FPEM_Read);
+   updateEvents();
+}
+
+/**
+ * Queues receive slot {i} on the poll group, with a fresh buffer if its
+ * last one was consumed.
+**/
+void
+UdpTransport::submitRx(unsigned i)
+{
+#ifdef RESIP_POLL_IMPL_URING
+   if (mIo->mRxBuffers[i] == 0)
+   {
+      mIo->mRxBuffers[i] = MsgHeaderScanner::allocateBuffer(MaxBufferSize);
+   }
+   IoSlots::setSlot(mIo->mRxHdrs[i], mIo->mRxIovs[i],
+                    &mIo->mRxAddrs[i], sizeof(sockaddr_storage),
+                    mIo->mRxBuffers[i], MaxBufferSize);
+   if (!mPollGrp->submitIo(mPollItemHandle, mIo->mRx[i]))
+   {
+      stopSubmitIo();
+   }
+#endif
+}
+
+/**
+ * Counterpart of processTxAll() when the poll group does the socket I/O:
+ * queues a send for each message on the tx fifo while there are free
+ * send slots. The rest wait until sends are reported done. Messages that
+ * need SigComp are sent on their own through processTxOne().
+**/
+void
+UdpTransport::processTxIo()
+{
+#ifdef RESIP_POLL_IMPL_URING
+   ++mTxTryCnt;
+   SendData* msg;
+   while (!mIo->mTxFree.empty() &&
+          (msg=mTxFifoOutBuffer.getNext(RESIP_FIFO_NOWAIT)) != NULL)
+   {
+      if (msg->command != SendData::NoCommand)
+      {
+         delete msg;
+         continue;
+      }
+#ifdef USE_SIGCOMP
+      if (mSigcompStack &&
+          msg->sigcompId.size() > 0 &&
+          !msg->isAlreadyCompressed)
+      {
+         processTxOne(msg);
+         continue;
+      }
+#endif
+      resip_assert( msg->destination.getPort() != 0 );
+      ++mTxMsgCnt;
+      unsigned i = mIo->mTxFree.back();
+      mIo->mTxFree.pop_back();
+      mIo->mTxData[i] = msg;
+      IoSlots::setSlot(mIo->mTxHdrs[i], mIo->mTxIovs[i],
+                       const_cast<sockaddr*>(&msg->destination.getSockaddr()),
+                       msg->destination.length(),
+                       const_cast<char*>(msg->data.data()), msg->data.size());
+      if (!mPollGrp->submitIo(mPollItemHandle, mIo->mTx[i]))
+      {
+         mIo->mTxData[i] = 0;
+         mIo->mTxFree.push_back(i);
+         --mTxMsgCnt;
+         processTxOne(msg);
+         stopSubmitIo();
+         break;
+      }
+   }
+#endif
+}
+
+void
+UdpTransport::setBatchSize(unsigned batchSize)
+{
+   if (batchSize < 1)
+   {
+      batchSize = 1;
+   }
+#ifdef RESIP_UDP_MMSG
+   resip_assert(mBatch == 0);
+   mBatchSize = batchSize;
+   if (mBatchSize > 1)
+   {
+      mBatch = new MmsgBatch(mBatchSize);
+   }
+#else
+   if (batchSize > 1)
+   {
+      WarningLog(<< "recvmmsg/sendmmsg not available, ignoring UDP batch size " << batchSize);
+   }
+#endif
+}
+
+void
+UdpTransport::getBatchStats(BatchStats& stats) const
+{
+   stats.mRxCalls = mRxBatchCnt;
+   stats.mRxMsgs = mRxBatchMsgCnt;
+   stats.mTxCalls = mTxBatchCnt;
+   stats.mTxMsgs = mTxBatchMsgCnt;
+}
+
 /**
    If we return true, the TransactionController will set the timeout
    to zero so that process() is called immediately. We don't want this;
@@ -224,6 +639,11 @@ UdpTransport::process(FdSet& fdset)
 void
 UdpTransport::processTxAll()
 {
+   if (mBatch)
+   {
+      processTxBatch();
+      return;
+   }
    SendData *msg;
    ++mTxTryCnt;
    while ( (msg=mTxFifoOutBuffer.getNext(RESIP_FIFO_NOWAIT)) != NULL )
@@ -319,6 +739,11 @@ UdpTransport::processTxOne(SendData *data)
 void
 UdpTransport::processRxAll()
 {
+   if (mBatch)
+   {
+      processRxBatch();
+      return;
+   }
    char *buffer = mRxBuffer;
    mRxBuffer = NULL;
    ++mRxTryCnt;
@@ -407,6 +832,168 @@ UdpTransport::processRxRecv(char*& buffer, Tuple& sender)
 }
 
 
+/**
+ * Batched counterpart of processTxAll(): pulls up to mBatchSize messages
+ * off the tx fifo and hands them to the kernel with one sendmmsg. Messages
+ * that need SigComp are sent on their own through processTxOne().
+**/
+void
+UdpTransport::processTxBatch()
+{
+#ifdef RESIP_UDP_MMSG
+   ++mTxTryCnt;
+   for (;;)
+   {
+      unsigned count = 0;
+      SendData* msg;
+      while (count < mBatchSize &&
+             (msg=mTxFifoOutBuffer.getNext(RESIP_FIFO_NOWAIT)) != NULL)
+      {
+         if (msg->command != SendData::NoCommand)
+         {
+            delete msg;
+            continue;
+         }
+#ifdef USE_SIGCOMP
+         if (mSigcompStack &&
+             msg->sigcompId.size() > 0 &&
+             !msg->isAlreadyCompressed)
+         {
+            processTxOne(msg);
+            continue;
+         }
+#endif
+         resip_assert( msg->destination.getPort() != 0 );
+         ++mTxMsgCnt;
+         mBatch->mTxData[count] = msg;
+         mBatch->setSlot(count,
+                         const_cast<sockaddr*>(&msg->destination.getSockaddr()),
+                         msg->destination.length(),
+                         const_cast<char*>(msg->data.data()), msg->data.size());
+         ++count;
+      }
+      if (count == 0)
+      {
+         break;
+      }
+
+      unsigned done = 0;
+      while (done < count)
+      {
+         int sent = sendmmsg(mFd, mBatch->mHdrs + done, count - done, 0);
+         if (sent <= 0)
+         {
+            // sendmmsg only fails outright when the first datagram fails;
+            // fail that one and carry on with the rest.
+            SendData* failed = mBatch->mTxData[done];
+            int e = getErrno();
+            error(e);
+            InfoLog (<< "Failed (" << e << ") sending to " << failed->destination);
+            fail(failed->transactionId);
+            ++mTxFailCnt;
+            ++done;
+            continue;
+         }
+         ++mTxBatchCnt;
+         mTxBatchMsgCnt += sent;
+         for (int i=0; i<sent; ++i)
+         {
+            const SendData* data = mBatch->mTxData[done+i];
+            if (mBatch->mHdrs[done+i].msg_len != data->data.size())
+            {
+               ErrLog (<< "UDPTransport - send buffer full" );
+               fail(data->transactionId);
+            }
+         }
+         done += sent;
+      }
+
+      for (unsigned i=0; i<count; ++i)
+      {
+         delete mBatch->mTxData[i];
+         mBatch->mTxData[i] = 0;
+      }
+
+      if ( count < mBatchSize ||
+           (mTransportFlags & RESIP_TRANSPORT_FLAG_TXALL)==0 )
+      {
+         break;
+      }
+   }
+#endif
+}
+
+/**
+ * Batched counterpart of processRxAll(): receives up to mBatchSize
+ * datagrams with one recvmmsg and parses each of them. With RXALL, keeps
+ * going while batches come back full.
+**/
+void
+UdpTransport::processRxBatch()
+{
+#ifdef RESIP_UDP_MMSG
+   ++mRxTryCnt;
+   for (;;)
+   {
+      for (unsigned i=0; i<mBatchSize; ++i)
+      {
+         if (mBatch->mRxBuffers[i] == 0)
+         {
+            mBatch->mRxBuffers[i] = MsgHeaderScanner::allocateBuffer(MaxBufferSize);
+         }
+         mBatch->setSlot(i, &mBatch->mAddrs[i], sizeof(sockaddr_storage),
+                         mBatch->mRxBuffers[i], MaxBufferSize);
+      }
+
+      int got = recvmmsg(mFd, mBatch->mHdrs, mBatchSize, 0, 0);
+      if (got <= 0)
+      {
+         if (got < 0)
+         {
+            int err = getErrno();
+            if ( err != EAGAIN && err != EWOULDBLOCK )
+            {
+               error( err );
+            }
+         }
+         break;
+      }
+      ++mRxBatchCnt;
+      mRxBatchMsgCnt += got;
+
+      for (int i=0; i<got; ++i)
+      {
+         int len = (int)mBatch->mHdrs[i].msg_len;
+         // same len-1 trick as processRxRecv() to spot truncation
+         if (len+1 >= MaxBufferSize)
+         {
+            InfoLog(<<"Datagram exceeded max length "<<MaxBufferSize);
+            continue;
+         }
+         ++mRxMsgCnt;
+         Tuple sender(mTuple);
+         socklen_t slen = mBatch->mHdrs[i].msg_hdr.msg_namelen;
+         if (slen > sender.length())
+         {
+            slen = sender.length();
+         }
+         memcpy(&sender.getMutableSockaddr(), &mBatch->mAddrs[i], slen);
+         if ( processRxParse(mBatch->mRxBuffers[i], len, sender) )
+         {
+            mBatch->mRxBuffers[i] = 0;
+         }
+      }
+
+      if ( (unsigned)got < mBatchSize ||
+           (mTransportFlags & RESIP_TRANSPORT_FLAG_RXALL) == 0 )
+      {
+         break;
+      }
+   }
+#endif
+}
+
+
 /**
  * Parse the contents of {buffer} and do something with it.
  * Return true iff {buffer} was consumed (absorbed into SipMessage
@@ -431,7 +1018,8 @@ UdpTransport::processRxParse(char *buffer, int len, Tuple& sender)
    // this must be a STUN response (or garbage)
    if (buffer[0] == 1 && buffer[1] == 1 && ipVersion() == V4)
    {
-      resip::Lock lock(myMutex);
+      UdpTransport& owner = mShardOf ? *mShardOf : *this;
+      resip::Lock lock(owner.myMutex);
       StunMessage resp;
       memset(&resp, 0, sizeof(StunMessage));
 
@@ -455,8 +1043,8 @@ UdpTransport::processRxParse(char *buffer, int len, Tuple& sender)
 #else
             sin_addr.s_addr = htonl(resp.xorMappedAddress.ipv4.addr);
 #endif
-            mStunMappedAddress = Tuple(sin_addr,resp.xorMappedAddress.ipv4.port, UDP);
-            mStunSuccess = true;
+            owner.mStunMappedAddress = Tuple(sin_addr,resp.xorMappedAddress.ipv4.port, UDP);
+            owner.mStunSuccess = true;
          }
          else if(resp.hasMappedAddress)
          {
@@ -465,8 +1053,8 @@ UdpTransport::processRxParse(char *buffer, int len, Tuple& sender)
 #else
             sin_addr.s_addr = htonl(resp.mappedAddress.ipv4.addr);
 #endif
-            mStunMappedAddress = Tuple(sin_addr,resp.mappedAddress.ipv4.port, UDP);
-            mStunSuccess = true;
+            owner.mStunMappedAddress = Tuple(sin_addr,resp.mappedAddress.ipv4.port, UDP);
+            owner.mStunSuccess = true;
          }
       }
       return false;
@@ -569,6 +1157,13 @@ UdpTransport::processRxParse(char *buffer, int len, Tuple& sender)
    //DebugLog ( << "UDP Rcv : " << len << " b" );
    //DebugLog ( << Data(buffer, len).escaped().c_str());
 
+   if (mShardOf)
+   {
+      // Make messages from a shard look as if they arrived on the transport
+      // the stack knows about, so that responses go out through it. The key
+      // is only assigned when that transport is added to the stack.
+      mTuple.mTransportKey = mShardOf->getKey();
+   }
    SipMessage* message = new SipMessage(&mTuple);
 
    // set the received from information into the received= parameter in the
@@ -598,7 +1193,7 @@ UdpTransport::processRxParse(char *buffer, int len, Tuple& sender)
       if(mExternalUnknownDatagramHandler)
       {
          auto_ptr<Data> datagram(new Data(buffer,len));
-         (*mExternalUnknownDatagramHandler)(this,sender,datagram);
+         (*mExternalUnknownDatagramHandler)(mShardOf ? mShardOf : this,sender,datagram);
       }
 
       // Idea: consider backing buffer out of message and letting caller reuse it
@@ -754,12 +1349,95 @@ void
 UdpTransport::setExternalUnknownDatagramHandler(ExternalUnknownDatagramHandler *handler)
 {
    mExternalUnknownDatagramHandler = handler;
+   for (size_t i=0; i<mShards.size(); ++i)
+   {
+      mShards[i]->mExternalUnknownDatagramHandler = handler;
+   }
 }
 
 void
 UdpTransport::setRcvBufLen(int buflen)
 {
    setSocketRcvBufLen(mFd, buflen);
+   for (size_t i=0; i<mShards.size(); ++i)
+   {
+      mShards[i]->setRcvBufLen(buflen);
+   }
+}
+
+void
+UdpTransport::setCongestionManager(CongestionManager* manager)
+{
+   InternalTransport::setCongestionManager(manager);
+   for (size_t i=0; i<mShards.size(); ++i)
+   {
+      mShards[i]->setCongestionManager(manager);
+   }
+}
+
+void
+UdpTransport::setRxShards(unsigned count,
+                          const std::vector<Fifo<TransactionMessage>*>& fifos)
+{
+   resip_assert(mShards.empty());
+   resip_assert(mShardOf == 0);
+   if (count <= 1)
+   {
+      return;
+   }
+   if ((mTransportFlags & RESIP_TRANSPORT_FLAG_REUSEPORT) == 0)
+   {
+      ErrLog (<< "UDP receive shards need RESIP_TRANSPORT_FLAG_REUSEPORT on " << mTuple);
+      throw Transport::Exception("Receive shards need SO_REUSEPORT", __FILE__,__LINE__);
+   }
+
+   size_t own = 0;
+   while (own < fifos.size() && fifos[own] != &mStateMachineFifo.getFifo())
+   {
+      ++own;
+   }
+   if (own == fifos.size())
+   {
+      own = 0;
+   }
+
+   // Bind every shard before starting any of them, so that a failure leaves
+   // nothing running.
+   const unsigned shardFlags = mTransportFlags | RESIP_TRANSPORT_FLAG_OWNTHREAD;
+   for (unsigned i=1; i<count; ++i)
+   {
+      Fifo<TransactionMessage>& fifo = fifos.empty() ?
+         mStateMachineFifo.getFifo() : *fifos[(own + i) % fifos.size()];
+      UdpTransport* shard = 0;
+      try
+      {
+         shard = new UdpTransport(fifo, port(), ipVersion(),
+                                  StunDisabled, interfaceName(), mSocketFunc,
+                                  mCompression, shardFlags);
+      }
+      catch (BaseException&)
+      {
+         for (size_t j=0; j<mShards.size(); ++j)
+         {
+            delete mShards[j];
+         }
+         mShards.clear();
+         throw;
+      }
+      shard->mShardOf = this;
+      shard->mTuple.mFlowKey = mTuple.mFlowKey;
+      shard->mExternalUnknownDatagramHandler = mExternalUnknownDatagramHandler;
+      shard->setBatchSize(mBatchSize);
+      shard->setCongestionManager(mCongestionManager);
+      mShards.push_back(shard);
+   }
+
+   for (size_t i=0; i<mShards.size(); ++i)
+   {
+      mShardThreads.push_back(new TransportThread(*mShards[i]));
+      mShardThreads.back()->run();
+   }
+   InfoLog (<< "Receiving on " << count << " SO_REUSEPORT sockets for " << mTuple);
 }
 
 /* ====================================================================
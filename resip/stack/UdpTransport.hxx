@@ -2,6 +2,7 @@
 #define RESIP_UDPTRANSPORT_HXX
 
 #include <memory>
+#include <vector>
 #include "resip/stack/InternalTransport.hxx"
 #include "resip/stack/MsgHeaderScanner.hxx"
 #include "rutil/HeapInstanceCounter.hxx"
@@ -12,6 +13,7 @@ namespace osc { class Stack; }
 namespace resip
 {
 class UdpTransport;
+class TransportThread;
 
 /** Interface functor for external unrecognized datagram handling.
   * User can catch datagram messages recevied that are not recognized by
@@ -75,12 +77,69 @@ public:
    virtual void buildFdSet( FdSet& fdset);
    virtual void setPollGrp(FdPollGrp *grp);
    virtual void setRcvBufLen(int buflen);
+   /**
+      Receive and transmit up to batchSize datagrams per system call
+      (recvmmsg/sendmmsg). 1, the default, keeps the traditional one
+      recvfrom/sendto per datagram. Batching is only available where the
+      platform provides recvmmsg and sendmmsg; elsewhere the request is
+      logged and ignored. Must be called before the transport is processed.
+      Batch buffers stay allocated for the life of the transport, as with
+      RESIP_TRANSPORT_FLAG_KEEP_BUFFER. The RXALL and TXALL flags apply per
+      batch: without them one batch is handled per wake-up.
+
+      On a poll group that does the socket I/O itself (the "uring" one),
+      receives and sends are queued on the group instead, and this is how
+      many of each are kept queued (DefaultIoDepth if 1).
+   */
+   virtual void setBatchSize(unsigned batchSize);
+   unsigned getBatchSize() const { return mBatchSize; }
+
+   /// Counts of batched system calls and the datagrams they carried, so
+   /// that msgs/calls gives the average batch occupancy.
+   struct BatchStats
+   {
+      unsigned mRxCalls;
+      unsigned mRxMsgs;
+      unsigned mTxCalls;
+      unsigned mTxMsgs;
+   };
+   void getBatchStats(BatchStats& stats) const;
+
+   /**
+      Opens count-1 more sockets on this transport's address and port, each
+      serviced by its own TransportThread, so that the kernel can spread
+      incoming datagrams (hashed by source address) across cores. Shards
+      feed this transport's state machine fifo, unless fifos is given: then
+      shard i feeds the fifo i places after this transport's own one in
+      fifos (wrapping around), e.g. SipStack::stateMacFifo(shard) for every
+      TransactionController shard, so that each receive thread has a
+      transaction shard of its own. This transport stays the one the
+      stack knows about: messages received on a shard look as if they
+      arrived here, and everything is sent from here. Servicing this
+      transport itself is unchanged, so combine with
+      RESIP_TRANSPORT_FLAG_OWNTHREAD to give it a thread of its own too.
+
+      Requires RESIP_TRANSPORT_FLAG_REUSEPORT; throws Transport::Exception
+      if the flag is missing or a shard cannot bind. Call once, after
+      setBatchSize() if that is used.
+   */
+   void setRxShards(unsigned count,
+                    const std::vector<Fifo<TransactionMessage>*>& fifos =
+                       std::vector<Fifo<TransactionMessage>*>());
+   unsigned getRxShards() const { return (unsigned)mShards.size() + 1; }
+   /// One of the extra receive sockets, 0 <= index < getRxShards()-1
+   const UdpTransport& getRxShard(unsigned index) const { return *mShards[index]; }
+
+   virtual void setCongestionManager(CongestionManager* manager);
 
    // FdPollItemIf
    // virtual Socket getPollSocket() const;
    virtual void processPollEvent(FdPollEventMask mask);
 
+   virtual void processIoCompletion(FdPollIo& io);
+
    static const int MaxBufferSize = 8192;
+   static const unsigned DefaultIoDepth = 16;
 
    // STUN client functionality
    bool stunSendTest(const Tuple& dest);
@@ -96,6 +155,11 @@ protected:
    bool processRxParse(char *buffer, int len, Tuple& sender);
    void processTxAll();
    void processTxOne(SendData *data);
+   void processRxBatch();
+   void processTxBatch();
+   void processTxIo();
+   void submitRx(unsigned i);
+   void stopSubmitIo();
    void updateEvents();
 
    osc::Stack *mSigcompStack;
@@ -109,7 +173,12 @@ protected:
    unsigned mRxMsgCnt;
    unsigned mRxKeepaliveCnt;
    unsigned mRxTransactionCnt;
+   unsigned mRxBatchCnt;
+   unsigned mRxBatchMsgCnt;
+   unsigned mTxBatchCnt;
+   unsigned mTxBatchMsgCnt;
 private:
+   struct MmsgBatch;
    char* mRxBuffer;
    MsgHeaderScanner mMsgHeaderScanner;
    mutable resip::Mutex  myMutex;
@@ -118,6 +187,17 @@ private:
    ExternalUnknownDatagramHandler* mExternalUnknownDatagramHandler;
    bool mInWritable;
    bool mInActiveWrite;
+   unsigned mBatchSize;
+   MmsgBatch* mBatch;
+   // receives and sends are queued on mPollGrp (FdPollGrp::submitIo())
+   struct IoSlots;
+   bool mSubmitIo;
+   IoSlots* mIo;
+   // receive shards opened by setRxShards(), and the transport a shard
+   // belongs to
+   std::vector<UdpTransport*> mShards;
+   std::vector<TransportThread*> mShardThreads;
+   UdpTransport* mShardOf;
 };
 
 }
@@ -4,6 +4,7 @@
 
 #include "resip/stack/UnknownParameter.hxx"
 #include "rutil/ParseBuffer.hxx"
+#include "rutil/DataIntern.hxx"
 #include "resip/stack/Symbols.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
@@ -15,10 +16,11 @@ UnknownParameter::UnknownParameter(const char* startName,
                                    ParseBuffer& pb, 
                                    const std::bitset<256>& terminators)
    : Parameter(ParameterTypes::UNKNOWN),
-     mName(startName, nameSize),
+     mName(),
      mValue(),
      mIsQuoted(false)
 {
+   DataIntern::assign(mName, startName, nameSize);
    pb.skipWhitespace();
    if (!pb.eof() && *pb.position() == Symbols::EQUALS[0])
    {
@@ -134,6 +134,8 @@ class DtlsTransport : public UdpTransport
       bool isReliable() const { return false; }
       bool isDatagram() const { return true; }
       virtual void buildFdSet( FdSet& fdset);
+      // DTLS records go through OpenSSL one datagram at a time
+      virtual void setBatchSize(unsigned batchSize) { }
 
       static const unsigned long DtlsReceiveTimeout = 250000 ;
 
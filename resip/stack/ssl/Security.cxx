@@ -20,6 +20,7 @@
 #include "rutil/ResipAssert.h"
 #include "rutil/BaseException.hxx"
 #include "rutil/DataStream.hxx"
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/Random.hxx"
 #include "rutil/Socket.hxx"
@@ -56,6 +57,13 @@
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 #include <openssl/ssl.h>
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#else
+#include <openssl/hmac.h>
+#endif
 
 using namespace resip;
 using namespace std;
@@ -446,6 +454,7 @@ Security::createDomainCtx(const SSL_METHOD* method, const Data& domain, const Da
    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER|SSL_VERIFY_CLIENT_ONCE, verifyCallback);
    SSL_CTX_set_cipher_list(ctx, mCipherList.cipherList().c_str());
    setDHParams(ctx);
+   configureSessionResumption(ctx, domain);
    SSL_CTX_set_options(ctx, BaseSecurity::OpenSSLCTXSetOptions);
    SSL_CTX_clear_options(ctx, BaseSecurity::OpenSSLCTXClearOptions);
 
@@ -1140,9 +1149,17 @@ BaseSecurity::BaseSecurity (const CipherList& cipherSuite, const Data& defaultPr
    mDefaultPrivateKeyPassPhrase(defaultPrivateKeyPassPhrase),
    mDHParamsFilename(dHParamsFilename),
    mRootTlsCerts(0),
-   mRootSslCerts(0)
+   mRootSslCerts(0),
+   mTlsSessionCacheSize(20480),
+   mTlsSessionLifetime(300),
+   mTlsTicketKeyRotation(3600),
+   mTlsClientSessionReuse(true),
+   mFullHandshakes(0),
+   mResumedHandshakes(0)
 { 
    DebugLog(<< "BaseSecurity::BaseSecurity");
+   mServerSessions.setMaxSize(mTlsSessionCacheSize);
+   mClientSessions.setMaxSize(mTlsSessionCacheSize);
    
    int ret;
    initialize(); 
@@ -1170,6 +1187,7 @@ BaseSecurity::BaseSecurity (const CipherList& cipherSuite, const Data& defaultPr
    ret = SSL_CTX_set_cipher_list(mTlsCtx, cipherSuite.cipherList().c_str());
    resip_assert(ret);
    setDHParams(mTlsCtx);
+   configureSessionResumption(mTlsCtx, Data::Empty);
    SSL_CTX_set_options(mTlsCtx, BaseSecurity::OpenSSLCTXSetOptions);
    SSL_CTX_clear_options(mTlsCtx, BaseSecurity::OpenSSLCTXClearOptions);
    
@@ -1181,6 +1199,7 @@ BaseSecurity::BaseSecurity (const CipherList& cipherSuite, const Data& defaultPr
    ret = SSL_CTX_set_cipher_list(mSslCtx,cipherSuite.cipherList().c_str());
    resip_assert(ret);
    setDHParams(mSslCtx);
+   configureSessionResumption(mSslCtx, Data::Empty);
    SSL_CTX_set_options(mSslCtx, BaseSecurity::OpenSSLCTXSetOptions);
    SSL_CTX_clear_options(mSslCtx, BaseSecurity::OpenSSLCTXClearOptions);
 }
@@ -1229,6 +1248,10 @@ BaseSecurity::~BaseSecurity ()
       SSL_CTX_free(mSslCtx);mSslCtx=0;  // This free's X509_STORE (mRootSslCerts)
    }
 
+   for (std::deque<TicketKey>::iterator it = mTicketKeys.begin(); it != mTicketKeys.end(); ++it)
+   {
+      OPENSSL_cleanse(&*it, sizeof(TicketKey));
+   }
 }
 
 void
@@ -3176,6 +3199,417 @@ BaseSecurity::setDHParams(SSL_CTX* ctx)
    }
 }
 
+namespace resip
+{
+
+// The OpenSSL callbacks for session resumption. They find the BaseSecurity
+// through the SSL_CTX, and the key a client session is saved under
+// through the SSL.
+class TlsSessionCallbacks
+{
+   public:
+      static int ctxIndex()
+      {
+         static int index = SSL_CTX_get_ex_new_index(0, 0, 0, 0, 0);
+         return index;
+      }
+
+      static int clientKeyIndex()
+      {
+         static int index = SSL_get_ex_new_index(0, 0, 0, 0, freeClientKey);
+         return index;
+      }
+
+      static void freeClientKey(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx, long argl, void* argp)
+      {
+         delete static_cast<Data*>(ptr);
+      }
+
+      static BaseSecurity* security(SSL_CTX* ctx)
+      {
+         return static_cast<BaseSecurity*>(SSL_CTX_get_ex_data(ctx, ctxIndex()));
+      }
+
+      static Data sessionId(const SSL_SESSION* session)
+      {
+         unsigned int len = 0;
+         const unsigned char* id = SSL_SESSION_get_id(session, &len);
+         return Data(id, len);
+      }
+
+      static int newSession(SSL* ssl, SSL_SESSION* session)
+      {
+         BaseSecurity* sec = security(SSL_get_SSL_CTX(ssl));
+         if (!sec)
+         {
+            return 0;
+         }
+         Data* clientKey = static_cast<Data*>(SSL_get_ex_data(ssl, clientKeyIndex()));
+         Lock lock(sec->mTlsSessionMutex);
+         if (clientKey)
+         {
+            sec->mClientSessions.add(*clientKey, session);
+            return 1;
+         }
+         if (SSL_is_server(ssl))
+         {
+            sec->mServerSessions.add(sessionId(session), session);
+            return 1;
+         }
+         return 0;
+      }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+      static SSL_SESSION* getSession(SSL* ssl, const unsigned char* id, int len, int* copy)
+#else
+      static SSL_SESSION* getSession(SSL* ssl, unsigned char* id, int len, int* copy)
+#endif
+      {
+         // find() hands over a reference of its own
+         *copy = 0;
+         BaseSecurity* sec = security(SSL_get_SSL_CTX(ssl));
+         if (!sec)
+         {
+            return 0;
+         }
+         Lock lock(sec->mTlsSessionMutex);
+         return sec->mServerSessions.find(Data(id, len));
+      }
+
+      static void removeSession(SSL_CTX* ctx, SSL_SESSION* session)
+      {
+         BaseSecurity* sec = security(ctx);
+         if (sec)
+         {
+            Lock lock(sec->mTlsSessionMutex);
+            sec->mServerSessions.remove(sessionId(session), session);
+         }
+      }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+      static int ticketKey(SSL* ssl, unsigned char* name, unsigned char* iv,
+                           EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int encrypt)
+#else
+      static int ticketKey(SSL* ssl, unsigned char* name, unsigned char* iv,
+                           EVP_CIPHER_CTX* cipher, HMAC_CTX* mac, int encrypt)
+#endif
+      {
+         BaseSecurity* sec = security(SSL_get_SSL_CTX(ssl));
+         BaseSecurity::TicketKey key;
+         bool current = false;
+         if (!sec || !sec->getTicketKey(encrypt ? 0 : name, key, current))
+         {
+            // no ticket issued, or a full handshake for this one; -1 would
+            // abort the handshake
+            return 0;
+         }
+
+         int ok = 0;
+         if (encrypt)
+         {
+            if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1)
+            {
+               OPENSSL_cleanse(&key, sizeof(key));
+               return 0;
+            }
+            memcpy(name, key.name, sizeof(key.name));
+            ok = EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), 0, key.aesKey, iv);
+         }
+         else
+         {
+            ok = EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), 0, key.aesKey, iv);
+         }
+         if (ok)
+         {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            char digest[] = "SHA256";
+            OSSL_PARAM params[3];
+            params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmacKey, sizeof(key.hmacKey));
+            params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0);
+            params[2] = OSSL_PARAM_construct_end();
+            ok = EVP_MAC_CTX_set_params(mac, params);
+#else
+            ok = HMAC_Init_ex(mac, key.hmacKey, sizeof(key.hmacKey), EVP_sha256(), 0);
+#endif
+         }
+         OPENSSL_cleanse(&key, sizeof(key));
+         if (!ok)
+         {
+            return -1;
+         }
+         if (encrypt)
+         {
+            return 1;
+         }
+#if defined(TLS1_3_VERSION)
+         // OpenSSL clients use a TLS 1.3 ticket once, so it is replaced
+         // whatever key sealed it
+         if (SSL_version(ssl) >= TLS1_3_VERSION)
+         {
+            return 2;
+         }
+#endif
+         // a ticket sealed with an older key is still good, but is replaced
+         return current ? 1 : 2;
+      }
+};
+
+}
+
+BaseSecurity::SessionStore::~SessionStore()
+{
+   for (Sessions::iterator it = mSessions.begin(); it != mSessions.end(); ++it)
+   {
+      SSL_SESSION_free(it->second);
+   }
+}
+
+void
+BaseSecurity::SessionStore::setMaxSize(unsigned long maxSize)
+{
+   mMaxSize = maxSize;
+   while (mSessions.size() > mMaxSize)
+   {
+      erase(mIndex.find(mSessions.back().first));
+   }
+}
+
+void
+BaseSecurity::SessionStore::add(const Data& key, SSL_SESSION* session)
+{
+   Index::iterator it = mIndex.find(key);
+   if (it != mIndex.end())
+   {
+      erase(it);
+   }
+   if (mMaxSize == 0)
+   {
+      SSL_SESSION_free(session);
+      return;
+   }
+   mSessions.push_front(std::make_pair(key, session));
+   mIndex[key] = mSessions.begin();
+   setMaxSize(mMaxSize);
+}
+
+SSL_SESSION*
+BaseSecurity::SessionStore::find(const Data& key)
+{
+   Index::iterator it = mIndex.find(key);
+   if (it == mIndex.end())
+   {
+      return 0;
+   }
+   SSL_SESSION* session = it->second->second;
+   if (SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) < (long)time(0))
+   {
+      erase(it);
+      return 0;
+   }
+   mSessions.splice(mSessions.begin(), mSessions, it->second);
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+   SSL_SESSION_up_ref(session);
+#else
+   CRYPTO_add(&session->references, 1, CRYPTO_LOCK_SSL_SESSION);
+#endif
+   return session;
+}
+
+void
+BaseSecurity::SessionStore::remove(const Data& key, const SSL_SESSION* session)
+{
+   Index::iterator it = mIndex.find(key);
+   if (it != mIndex.end() && it->second->second == session)
+   {
+      erase(it);
+   }
+}
+
+void
+BaseSecurity::SessionStore::erase(Index::iterator it)
+{
+   SSL_SESSION_free(it->second->second);
+   mSessions.erase(it->second);
+   mIndex.erase(it);
+}
+
+void
+BaseSecurity::configureSessionResumption(SSL_CTX* ctx, const Data& sessionContext)
+{
+   SSL_CTX_set_ex_data(ctx, TlsSessionCallbacks::ctxIndex(), this);
+
+   // OpenSSL will not resume without a session id context when it verifies
+   // peers; the digest keeps a long domain within SSL_MAX_SID_CTX_LENGTH
+   Data context = (Data("resip:") + sessionContext).md5();
+   SSL_CTX_set_session_id_context(ctx, (const unsigned char*)context.data(), (unsigned int)context.size());
+   SSL_CTX_set_timeout(ctx, mTlsSessionLifetime);
+
+   long mode = SSL_SESS_CACHE_OFF;
+   if (mTlsSessionCacheSize > 0)
+   {
+      // ours, shared between contexts, instead of one per SSL_CTX
+      mode = SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL;
+      if (mTlsClientSessionReuse)
+      {
+         mode |= SSL_SESS_CACHE_CLIENT;
+      }
+      SSL_CTX_sess_set_new_cb(ctx, TlsSessionCallbacks::newSession);
+      SSL_CTX_sess_set_get_cb(ctx, TlsSessionCallbacks::getSession);
+      SSL_CTX_sess_set_remove_cb(ctx, TlsSessionCallbacks::removeSession);
+   }
+   SSL_CTX_set_session_cache_mode(ctx, mode);
+
+   if (mTlsTicketKeyRotation > 0 && !(OpenSSLCTXSetOptions & SSL_OP_NO_TICKET))
+   {
+      SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+      SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, TlsSessionCallbacks::ticketKey);
+#else
+      SSL_CTX_set_tlsext_ticket_key_cb(ctx, TlsSessionCallbacks::ticketKey);
+#endif
+   }
+   else
+   {
+      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+   }
+}
+
+void
+BaseSecurity::setTlsSessionCache(unsigned long size, long lifetimeSecs)
+{
+   {
+      Lock lock(mTlsSessionMutex);
+      mTlsSessionCacheSize = size;
+      mTlsSessionLifetime = lifetimeSecs;
+      mServerSessions.setMaxSize(size);
+      mClientSessions.setMaxSize(size);
+   }
+   configureSessionResumption(mTlsCtx, Data::Empty);
+   configureSessionResumption(mSslCtx, Data::Empty);
+}
+
+void
+BaseSecurity::setTlsSessionTickets(long keyRotationSecs)
+{
+   mTlsTicketKeyRotation = keyRotationSecs;
+   configureSessionResumption(mTlsCtx, Data::Empty);
+   configureSessionResumption(mSslCtx, Data::Empty);
+}
+
+void
+BaseSecurity::setTlsClientSessionReuse(bool enable)
+{
+   mTlsClientSessionReuse = enable;
+   configureSessionResumption(mTlsCtx, Data::Empty);
+   configureSessionResumption(mSslCtx, Data::Empty);
+}
+
+void
+BaseSecurity::rotateTlsTicketKey()
+{
+   Lock lock(mTlsSessionMutex);
+   addTicketKey();
+}
+
+bool
+BaseSecurity::addTicketKey()
+{
+   TicketKey key;
+   if (RAND_bytes(key.name, sizeof(key.name)) != 1 ||
+       RAND_bytes(key.aesKey, sizeof(key.aesKey)) != 1 ||
+       RAND_bytes(key.hmacKey, sizeof(key.hmacKey)) != 1)
+   {
+      ErrLog(<< "Unable to make a TLS session ticket key");
+      return false;
+   }
+   key.created = Timer::getTimeSecs();
+   mTicketKeys.push_front(key);
+   OPENSSL_cleanse(&key, sizeof(key));
+   InfoLog(<< "New TLS session ticket key, " << mTicketKeys.size() << " in use");
+   return true;
+}
+
+bool
+BaseSecurity::getTicketKey(const unsigned char* name, TicketKey& key, bool& current)
+{
+   Lock lock(mTlsSessionMutex);
+   UInt64 now = Timer::getTimeSecs();
+   if (mTicketKeys.empty() ||
+       (mTlsTicketKeyRotation > 0 && mTicketKeys.front().created + mTlsTicketKeyRotation <= now))
+   {
+      if (!addTicketKey())
+      {
+         return false;
+      }
+   }
+   // a key sealed its last ticket when the next one was made, and is
+   // dropped once that ticket has expired
+   while (mTicketKeys.size() > 1 &&
+          mTicketKeys[mTicketKeys.size() - 2].created + mTlsSessionLifetime <= now)
+   {
+      OPENSSL_cleanse(&mTicketKeys.back(), sizeof(TicketKey));
+      mTicketKeys.pop_back();
+   }
+
+   if (!name)
+   {
+      key = mTicketKeys.front();
+      current = true;
+      return true;
+   }
+   for (std::deque<TicketKey>::iterator it = mTicketKeys.begin(); it != mTicketKeys.end(); ++it)
+   {
+      if (memcmp(it->name, name, sizeof(it->name)) == 0)
+      {
+         key = *it;
+         current = it == mTicketKeys.begin();
+         return true;
+      }
+   }
+   return false;
+}
+
+void
+BaseSecurity::prepareClientSession(SSL* ssl, const Data& key)
+{
+   SSL_SESSION* session = 0;
+   {
+      Lock lock(mTlsSessionMutex);
+      if (!mTlsClientSessionReuse || mTlsSessionCacheSize == 0)
+      {
+         return;
+      }
+      session = mClientSessions.find(key);
+   }
+   SSL_set_ex_data(ssl, TlsSessionCallbacks::clientKeyIndex(), new Data(key));
+   if (session)
+   {
+      DebugLog(<< "Offering the TLS session saved for " << key);
+      SSL_set_session(ssl, session);
+      SSL_SESSION_free(session);
+   }
+}
+
+void
+BaseSecurity::onHandshakeDone(SSL* ssl)
+{
+   if (SSL_session_reused(ssl))
+   {
+      ++mResumedHandshakes;
+   }
+   else
+   {
+      ++mFullHandshakes;
+   }
+}
+
+void
+BaseSecurity::getTlsSessionStatistics(TlsSessionStatistics& stats) const
+{
+   stats.fullHandshakes = mFullHandshakes.load();
+   stats.resumedHandshakes = mResumedHandshakes.load();
+}
+
 #endif
 
 
@@ -1,6 +1,8 @@
 #if !defined(RESIP_SECURITY_HXX)
 #define RESIP_SECURITY_HXX
 
+#include <atomic>
+#include <deque>
 #include <map>
 #include <vector>
 #include <list>
@@ -12,6 +14,7 @@
 
 #include "rutil/Socket.hxx"
 #include "rutil/BaseException.hxx"
+#include "rutil/Mutex.hxx"
 #include "resip/stack/SecurityTypes.hxx"
 #include "resip/stack/SecurityAttributes.hxx"
 
@@ -39,6 +42,7 @@ class Pkcs7Contents;
 class Security;
 class MultipartSignedContents;
 class SipMessage;
+class TlsSessionCallbacks;
 
 
 class BaseSecurity
@@ -195,6 +199,44 @@ class BaseSecurity
       static SecurityTypes::SSLType parseSSLType(const Data& typeName);
       static long parseOpenSSLCTXOption(const Data& optionName);
 
+      /**
+         TLS session resumption.
+
+         The SSL_CTXs this object owns or creates keep the sessions of the
+         peers that connect to them in one cache, so a peer may resume on any
+         transport serving the same domain. They also issue session tickets,
+         sealed with keys this object replaces every keyRotationSecs. As a
+         client, TlsConnection offers the last session it got from the same
+         destination.
+
+         Call these before adding TLS transports. A cache size of 0 turns
+         both the server and client caches off; 0 for keyRotationSecs turns
+         tickets off.
+      */
+      void setTlsSessionCache(unsigned long size, long lifetimeSecs);
+      void setTlsSessionTickets(long keyRotationSecs);
+      void setTlsClientSessionReuse(bool enable);
+
+      /// Seals new tickets with a fresh key now; tickets sealed with the
+      /// old keys are still accepted, and replaced, until they expire.
+      void rotateTlsTicketKey();
+
+      /// Offers ssl the session last saved under key, and saves the
+      /// sessions the server gives it under key.
+      void prepareClientSession(SSL* ssl, const Data& key);
+
+      /// Counts the handshake ssl has just completed as full or resumed.
+      void onHandshakeDone(SSL* ssl);
+
+      class TlsSessionStatistics
+      {
+         public:
+            TlsSessionStatistics() : fullHandshakes(0), resumedHandshakes(0) {}
+            unsigned int fullHandshakes;
+            unsigned int resumedHandshakes;
+      };
+      void getTlsSessionStatistics(TlsSessionStatistics& stats) const;
+
    public:
       SSL_CTX*       getTlsCtx ();
       SSL_CTX*       getSslCtx ();
@@ -261,6 +303,62 @@ class BaseSecurity
       static bool mAllowWildcardCertificates;
 
       void setDHParams(SSL_CTX* ctx);
+
+      // Points ctx at the session caches and ticket keys. sessionContext
+      // names the certificate the ctx serves, so that sessions only resume
+      // under it.
+      void configureSessionResumption(SSL_CTX* ctx, const Data& sessionContext);
+
+   private:
+      friend class TlsSessionCallbacks;
+
+      /// Sessions by key, dropping the least recently used past a size.
+      class SessionStore
+      {
+         public:
+            SessionStore() : mMaxSize(0) {}
+            ~SessionStore();
+
+            void setMaxSize(unsigned long maxSize);
+            /// Takes over the caller's reference to session.
+            void add(const Data& key, SSL_SESSION* session);
+            /// Returns a new reference, or 0 if there is no unexpired session.
+            SSL_SESSION* find(const Data& key);
+            /// Only removes the session under key if it is this one.
+            void remove(const Data& key, const SSL_SESSION* session);
+
+         private:
+            typedef std::list<std::pair<Data, SSL_SESSION*> > Sessions; // most recently used first
+            typedef std::map<Data, Sessions::iterator> Index;
+            void erase(Index::iterator it);
+
+            Sessions mSessions;
+            Index mIndex;
+            unsigned long mMaxSize;
+      };
+
+      struct TicketKey
+      {
+         unsigned char name[16];
+         unsigned char aesKey[32];
+         unsigned char hmacKey[32];
+         UInt64 created;
+      };
+      // The key to seal with when name is 0, else the key called name.
+      // current says whether it is the key new tickets are sealed with.
+      bool getTicketKey(const unsigned char* name, TicketKey& key, bool& current);
+      bool addTicketKey();
+
+      Mutex mTlsSessionMutex;
+      unsigned long mTlsSessionCacheSize;
+      long mTlsSessionLifetime;
+      long mTlsTicketKeyRotation;
+      bool mTlsClientSessionReuse;
+      SessionStore mServerSessions;
+      SessionStore mClientSessions;
+      std::deque<TicketKey> mTicketKeys; // newest first
+      std::atomic<unsigned int> mFullHandshakes;
+      std::atomic<unsigned int> mResumedHandshakes;
 };
 
 class Security : public BaseSecurity
@@ -7,6 +7,7 @@
 #include "resip/stack/ssl/TlsConnection.hxx"
 #include "resip/stack/ssl/TlsTransport.hxx"
 #include "resip/stack/ssl/Security.hxx"
+#include "rutil/DataStream.hxx"
 #include "rutil/Logger.hxx"
 #include "resip/stack/Uri.hxx"
 #include "rutil/Socket.hxx"
@@ -64,7 +65,8 @@ TlsConnection::TlsConnection( Transport* transport, const Tuple& tuple,
    mServer(server),
    mSecurity(security),
    mSslType( sslType ),
-   mDomain(domain)
+   mDomain(domain),
+   mPendingBatch(0)
 {
 #if defined(USE_SSL)
    InfoLog (<< "Creating TLS connection for domain " 
@@ -214,6 +216,7 @@ TlsConnection::checkState()
             DebugLog ( << "TLS SNI extension in Client Hello: " << who().getTargetDomain());
             SSL_set_tlsext_host_name(mSsl,who().getTargetDomain().c_str()); // set the SNI hostname
 #endif
+         mSecurity->prepareClientSession(mSsl, clientSessionKey());
          SSL_set_connect_state(mSsl);
          mTlsState = Handshaking;
       }
@@ -337,6 +340,11 @@ TlsConnection::checkState()
    {
       InfoLog( << "TLS connected" );
    }
+   mSecurity->onHandshakeDone(mSsl);
+   if (SSL_session_reused(mSsl))
+   {
+      DebugLog( << "TLS session resumed" );
+   }
 
    // force peer name to get checked and perhaps cert loaded
    computePeerName();
@@ -577,6 +585,33 @@ TlsConnection::write( const char* buf, int count )
 }
 
 
+int
+TlsConnection::writev( const WriteBuffer* bufs, int count )
+{
+   // Largest plaintext a single TLS record carries.
+   static const int RecordBudget = 16384;
+
+   if (mPendingBatch == 0 && bufs[0].mLen >= RecordBudget)
+   {
+      return write(bufs[0].mBuf, bufs[0].mLen);
+   }
+
+   // The capacity never has to grow past this, so the buffer does not move
+   // between a write that wants to be retried and its retry.
+   mWriteBatch.reserve(RecordBudget);
+   mWriteBatch.truncate2(0);
+   int limit = mPendingBatch ? mPendingBatch : RecordBudget;
+   for (int i = 0; i < count && (int)mWriteBatch.size() < limit; ++i)
+   {
+      int len = resipMin(bufs[i].mLen, limit - (int)mWriteBatch.size());
+      mWriteBatch.append(bufs[i].mBuf, len);
+   }
+
+   int ret = write(mWriteBatch.data(), (int)mWriteBatch.size());
+   mPendingBatch = ret == 0 ? (int)mWriteBatch.size() : 0;
+   return ret;
+}
+
 bool 
 TlsConnection::hasDataToRead() // has data that can be read 
 {
@@ -673,6 +708,18 @@ TlsConnection::getPeerNamesData() const
 }
 
 
+Data
+TlsConnection::clientSessionKey()
+{
+   Data key;
+   {
+      DataStream ds(key);
+      ds << Tuple::inet_ntop(who()) << ':' << who().getPort() << ' '
+         << toData(who().getType()) << ' ' << who().getTargetDomain();
+   }
+   return key;
+}
+
 void
 TlsConnection::computePeerName()
 {
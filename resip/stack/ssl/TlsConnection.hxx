@@ -43,6 +43,7 @@ class TlsConnection : public Connection
 
       int read( char* buf, const int count );
       int write( const char* buf, const int count );
+      virtual int writev( const WriteBuffer* bufs, int count );
       virtual bool hasDataToRead(); // has data that can be read 
       virtual bool isGood(); // has valid connection
       virtual bool isWritable();
@@ -60,6 +61,9 @@ class TlsConnection : public Connection
       void computePeerName();
       Data getPeerNamesData() const;
       TlsState checkState();
+      // What a client session is saved under: the same address, port and
+      // transport, reached under the same name.
+      Data clientSessionKey();
 
       bool mServer;
       Security* mSecurity;
@@ -71,6 +75,13 @@ class TlsConnection : public Connection
 
       SSL* mSsl;
       BIO* mBio;
+
+      // Queued messages shorter than a TLS record are copied here so that
+      // they go out in one SSL_write. mPendingBatch is the length of a
+      // batch whose SSL_write has to be retried; OpenSSL wants the retry
+      // to use the same buffer.
+      Data mWriteBatch;
+      int mPendingBatch;
       std::list<BaseSecurity::PeerName> mPeerNames;
 };
  
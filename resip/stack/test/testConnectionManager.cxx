@@ -0,0 +1,365 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "resip/stack/ConnectionManager.hxx"
+#include "resip/stack/TcpConnection.hxx"
+#include "resip/stack/TcpTransport.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Time.hxx"
+#include "rutil/Timer.hxx"
+
+// Checks ConnectionManager lookups by address and by flow key and its idle
+// timeouts, and measures how lookup, garbage collection and idle timeout
+// processing scale with the number of connections.
+// The std::map columns show the layout the manager used before its indexes
+// were hashed.
+
+using namespace resip;
+using namespace std;
+
+// Never handed to the OS; closing them on delete fails harmlessly with EBADF.
+static const Socket FakeSocketBase = 1 << 24;
+
+// Many clients behind a few NATs: addresses in one /16, a few ports each.
+static Tuple
+peer(unsigned int i)
+{
+   in_addr addr;
+   addr.s_addr = htonl((10u << 24) | (i / 4));
+   return Tuple(addr, 5060 + i % 4, TCP);
+}
+
+static Tuple
+flowTo(const Connection* conn, unsigned int i)
+{
+   Tuple flow = peer(i);
+   flow.mFlowKey = const_cast<Connection*>(conn)->getFlowKey();
+   return flow;
+}
+
+static unsigned int
+rate(unsigned int count, UInt64 us)
+{
+   return us ? (unsigned int)(count * 1000000ULL / us) : 0;
+}
+
+static void
+checkLookups(TcpTransport& transport)
+{
+   ConnectionManager& manager = transport.getConnectionManager();
+   const unsigned int count = 1000;
+   vector<Connection*> conns;
+   for (unsigned int i = 0; i < count; ++i)
+   {
+      conns.push_back(new TcpConnection(&transport, peer(i), FakeSocketBase + i,
+                                        Compression::Disabled, false));
+   }
+
+   for (unsigned int i = 0; i < count; ++i)
+   {
+      resip_assert(manager.findConnection(peer(i)) == conns[i]);
+      resip_assert(manager.findConnection(flowTo(conns[i], i)) == conns[i]);
+      const ConnectionManager& constManager = manager;
+      resip_assert(constManager.findConnection(peer(i)) == conns[i]);
+   }
+
+   // a flow key naming another connection falls back to the address...
+   Tuple stale = peer(3);
+   stale.mFlowKey = conns[4]->getFlowKey();
+   resip_assert(manager.findConnection(stale) == conns[3]);
+   // ...unless only that flow will do
+   stale.onlyUseExistingConnection = true;
+   resip_assert(manager.findConnection(stale) == 0);
+
+   // same address, other transport
+   Tuple tls = peer(5);
+   tls.setType(TLS);
+   resip_assert(manager.findConnection(tls) == 0);
+
+   for (unsigned int i = 0; i < count; i += 2)
+   {
+      delete conns[i];
+   }
+   for (unsigned int i = 0; i < count; ++i)
+   {
+      Connection* expected = (i % 2) ? conns[i] : 0;
+      resip_assert(manager.findConnection(peer(i)) == expected);
+      Tuple byFlow = peer(i);
+      byFlow.mFlowKey = FakeSocketBase + i;
+      byFlow.onlyUseExistingConnection = true;
+      resip_assert(manager.findConnection(byFlow) == expected);
+   }
+   for (unsigned int i = 1; i < count; i += 2)
+   {
+      delete conns[i];
+   }
+   resip_assert(manager.findConnection(peer(1)) == 0);
+}
+
+static void
+checkIdleTimeouts()
+{
+   ConnectionManager::IdleWheelResolution = 100;
+   ConnectionManager::setIdleTimeout(TCP, 1000);
+   Fifo<TransactionMessage> fifo;
+   TcpTransport transport(fifo, 0, V4, "127.0.0.1");
+   ConnectionManager& manager = transport.getConnectionManager();
+
+   const unsigned int count = 100;
+   UInt64 start = Timer::getTimeMs();
+   vector<Connection*> conns;
+   for (unsigned int i = 0; i < count; ++i)
+   {
+      conns.push_back(new TcpConnection(&transport, peer(i), FakeSocketBase + i,
+                                        Compression::Disabled, false));
+   }
+   // another transport type, with no idle timeout
+   Tuple udpPeer = peer(count);
+   udpPeer.setType(UDP);
+   Connection* untimed = new TcpConnection(&transport, udpPeer, FakeSocketBase + count,
+                                           Compression::Disabled, false);
+
+   manager.processIdleTimers(start + 500);
+   for (unsigned int i = 0; i < count; ++i)
+   {
+      resip_assert(manager.findConnection(peer(i)) == conns[i]);
+   }
+
+   // the odd ones are used again
+   sleepMs(300);
+   for (unsigned int i = 1; i < count; i += 2)
+   {
+      conns[i]->resetLastUsed();
+   }
+
+   manager.processIdleTimers(start + 1200);
+   for (unsigned int i = 0; i < count; ++i)
+   {
+      Connection* expected = (i % 2) ? conns[i] : 0;
+      resip_assert(manager.findConnection(peer(i)) == expected);
+   }
+
+   manager.processIdleTimers(start + 1500);
+   for (unsigned int i = 0; i < count; ++i)
+   {
+      resip_assert(manager.findConnection(peer(i)) == 0);
+   }
+   resip_assert(manager.findConnection(udpPeer) == untimed);
+   delete untimed;
+
+   ConnectionManager::setIdleTimeout(TCP, 0);
+   ConnectionManager::IdleWheelResolution = 1000;
+}
+
+static void
+benchmark(unsigned int live)
+{
+   Fifo<TransactionMessage> fifo;
+   TcpTransport transport(fifo, 0, V4, "127.0.0.1");
+   ConnectionManager& manager = transport.getConnectionManager();
+   vector<Tuple> probes;
+   probes.reserve(live);
+   for (unsigned int i = 0; i < live; ++i)
+   {
+      probes.push_back(peer(i));
+   }
+
+   // With aggressive gc every new connection also runs gc, which must only
+   // look at the oldest connections.
+   ConnectionManager::EnableAgressiveGc = true;
+   ConnectionManager::MinimumGcAge = 3600 * 1000;
+
+   vector<Connection*> conns;
+   conns.reserve(live);
+   UInt64 begin = Timer::getTimeMicroSec();
+   for (unsigned int i = 0; i < live; ++i)
+   {
+      conns.push_back(new TcpConnection(&transport, probes[i], FakeSocketBase + i,
+                                        Compression::Disabled, false));
+   }
+   UInt64 added = Timer::getTimeMicroSec();
+
+   unsigned int hits = 0;
+   for (unsigned int i = 0; i < live; ++i)
+   {
+      hits += manager.findConnection(probes[i]) != 0;
+   }
+   UInt64 foundByAddr = Timer::getTimeMicroSec();
+
+   for (unsigned int i = 0; i < live; ++i)
+   {
+      probes[i].mFlowKey = FakeSocketBase + i;
+   }
+   UInt64 flowsSet = Timer::getTimeMicroSec();
+   for (unsigned int i = 0; i < live; ++i)
+   {
+      hits += manager.findConnection(probes[i]) != 0;
+   }
+   UInt64 foundByFlow = Timer::getTimeMicroSec();
+   resip_assert(hits == 2 * live);
+
+   {
+      map<Tuple, Connection*> addrMap;
+      map<Socket, Connection*> idMap;
+      for (unsigned int i = 0; i < live; ++i)
+      {
+         addrMap[probes[i]] = conns[i];
+         idMap[probes[i].mFlowKey] = conns[i];
+      }
+      UInt64 mapBegin = Timer::getTimeMicroSec();
+      unsigned int mapHits = 0;
+      for (unsigned int i = 0; i < live; ++i)
+      {
+         mapHits += addrMap.find(probes[i]) != addrMap.end();
+      }
+      UInt64 mapByAddr = Timer::getTimeMicroSec();
+      for (unsigned int i = 0; i < live; ++i)
+      {
+         map<Socket, Connection*>::const_iterator it = idMap.find(probes[i].mFlowKey);
+         mapHits += it != idMap.end() && it->second->who() == probes[i];
+      }
+      UInt64 mapByFlow = Timer::getTimeMicroSec();
+      resip_assert(mapHits == 2 * live);
+      cout << "std::map         : " << live << " connections"
+           << ", find by tuple/s=" << rate(live, mapByAddr - mapBegin)
+           << ", find by flow/s=" << rate(live, mapByFlow - mapByAddr) << endl;
+   }
+
+   // Everything is now idle: the next new connection makes gc reclaim all
+   // the others in one LRU walk.
+   sleepMs(5);
+   ConnectionManager::MinimumGcAge = 1;
+   UInt64 gcBegin = Timer::getTimeMicroSec();
+   Connection* trigger = new TcpConnection(&transport, peer(live), FakeSocketBase + live,
+                                           Compression::Disabled, false);
+   UInt64 gcEnd = Timer::getTimeMicroSec();
+   for (unsigned int i = 0; i < live; i += live / 10 + 1)
+   {
+      resip_assert(manager.findConnection(peer(i)) == 0);
+   }
+   resip_assert(manager.findConnection(peer(live)) == trigger);
+   delete trigger;
+
+   // Idle timeouts: ticks where nothing is due cost nothing, and the tick
+   // where everything is due does work in proportion.
+   ConnectionManager::EnableAgressiveGc = false;
+   const UInt64 idleTimeout = 3600 * 1000;
+   ConnectionManager::setIdleTimeout(TCP, idleTimeout);
+   conns.clear();
+   for (unsigned int i = 0; i < live; ++i)
+   {
+      conns.push_back(new TcpConnection(&transport, peer(i), FakeSocketBase + i,
+                                        Compression::Disabled, false));
+   }
+   const unsigned int ticks = 1000;
+   UInt64 now = Timer::getTimeMs();
+   UInt64 idleBegin = Timer::getTimeMicroSec();
+   for (unsigned int i = 1; i <= ticks; ++i)
+   {
+      manager.processIdleTimers(now + i * ConnectionManager::IdleWheelResolution);
+   }
+   UInt64 idleTicked = Timer::getTimeMicroSec();
+   resip_assert(manager.findConnection(peer(0)) == conns[0]);
+   manager.processIdleTimers(now + idleTimeout + 2 * ConnectionManager::IdleWheelResolution);
+   UInt64 idleEnd = Timer::getTimeMicroSec();
+   for (unsigned int i = 0; i < live; i += live / 10 + 1)
+   {
+      resip_assert(manager.findConnection(peer(i)) == 0);
+   }
+   ConnectionManager::setIdleTimeout(TCP, 0);
+
+   cout << "ConnectionManager: " << live << " connections"
+        << ", find by tuple/s=" << rate(live, foundByAddr - added)
+        << ", find by flow/s=" << rate(live, foundByFlow - flowsSet)
+        << ", add+gc/s=" << rate(live, added - begin)
+        << ", gc sweep/s=" << rate(live, gcEnd - gcBegin)
+        << ", idle tick=" << (idleTicked - idleBegin) * 1000 / ticks << "ns"
+        << ", idle sweep/s=" << rate(live, idleEnd - idleTicked) << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+   unsigned int maxLive = 100000;
+   if (argc > 1)
+   {
+      maxLive = atoi(argv[1]);
+   }
+
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+   {
+      Fifo<TransactionMessage> fifo;
+      TcpTransport tcp(fifo, 0, V4, "127.0.0.1");
+      checkLookups(tcp);
+   }
+   checkIdleTimeouts();
+
+   UInt64 gcAge = ConnectionManager::MinimumGcAge;
+   bool agressive = ConnectionManager::EnableAgressiveGc;
+   for (unsigned int live = 1000; live <= maxLive; live *= 10)
+   {
+      benchmark(live);
+   }
+   ConnectionManager::MinimumGcAge = gcAge;
+   ConnectionManager::EnableAgressiveGc = agressive;
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
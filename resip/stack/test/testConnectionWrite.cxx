@@ -0,0 +1,270 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "resip/stack/TcpConnection.hxx"
+#include "resip/stack/TcpTransport.hxx"
+#include "resip/stack/WsTransport.hxx"
+#include "resip/stack/SendData.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Socket.hxx"
+#include "rutil/ResipAssert.h"
+
+// Checks that Connection coalesces queued messages into gathered writes,
+// keeps its place across partial writes, and frames WebSocket messages
+// exactly once.
+
+using namespace resip;
+using namespace std;
+
+// Writes into mWire instead of a socket, at most mCap bytes per call.
+class ScriptedConnection : public TcpConnection
+{
+   public:
+      ScriptedConnection(Transport* transport, const Tuple& who, Socket fd)
+         : TcpConnection(transport, who, fd, Compression::Disabled, false),
+           mCap(1 << 30),
+           mCalls(0)
+      {}
+
+      int write(const char* buf, const int count)
+      {
+         WriteBuffer b;
+         b.mBuf = buf;
+         b.mLen = count;
+         return writev(&b, 1);
+      }
+
+      int writev(const WriteBuffer* bufs, int count)
+      {
+         ++mCalls;
+         int total = 0;
+         for (int i = 0; i < count && total < mCap; ++i)
+         {
+            int len = resipMin(bufs[i].mLen, mCap - total);
+            mWire.append(bufs[i].mBuf, len);
+            total += len;
+         }
+         return total;
+      }
+
+      Data mWire;
+      int mCap;
+      int mCalls;
+};
+
+static SendData*
+makeSend(const Data& text)
+{
+   return new SendData(Tuple(), text, Data::Empty, Data::Empty);
+}
+
+static Data
+message(int i)
+{
+   return Data("OPTIONS sip:") + Data(i) + "@example.com SIP/2.0\r\n\r\n";
+}
+
+static Tuple
+peer()
+{
+   return Tuple("127.0.0.1", 5099, V4, TCP);
+}
+
+static void
+checkCoalesced(Transport& transport)
+{
+   ScriptedConnection* conn = new ScriptedConnection(&transport, peer(), (Socket)dup(0));
+   Data expected;
+   for (int i = 0; i < 20; ++i)
+   {
+      conn->requestWrite(makeSend(message(i)));
+      expected += message(i);
+   }
+
+   resip_assert(conn->performWrites());
+   resip_assert(conn->mWire == expected);
+   resip_assert(conn->mCalls == 1);
+   resip_assert(conn->getWriteCalls() == 1);
+   resip_assert(conn->getBytesWritten() == expected.size());
+   delete conn;
+}
+
+static void
+checkPartial(Transport& transport)
+{
+   ScriptedConnection* conn = new ScriptedConnection(&transport, peer(), (Socket)dup(0));
+   conn->mCap = 7;
+   Data expected;
+   for (int i = 0; i < 5; ++i)
+   {
+      SendData* send = makeSend(message(i));
+      // a message in several segments
+      send->moreData.push_back("X-Seg: one\r\n");
+      send->moreData.push_back(Data::Empty);
+      send->moreData.push_back("X-Seg: two\r\n");
+      expected += message(i) + "X-Seg: one\r\nX-Seg: two\r\n";
+      conn->requestWrite(send);
+   }
+   conn->requestWrite(makeSend(Data::Empty));
+   SendData* close = makeSend(Data::Empty);
+   close->command = SendData::EnableFlowTimer;
+   conn->requestWrite(close);
+   conn->requestWrite(makeSend("tail"));
+   expected += "tail";
+
+   // performWrites() stops at the empty message and at the command, as it
+   // would until the next writable event
+   for (int i = 0; i < 3; ++i)
+   {
+      resip_assert(conn->performWrites());
+   }
+   resip_assert(conn->mWire == expected);
+   resip_assert(conn->getBytesWritten() == expected.size());
+   resip_assert(conn->isFlowTimerEnabled());
+   delete conn;
+}
+
+static void
+checkWebSocket(Transport& transport)
+{
+   ScriptedConnection* conn = new ScriptedConnection(&transport, peer(), (Socket)dup(0));
+   conn->mCap = 5;
+
+   // The first message out is the handshake response, which is not framed.
+   Data handshake("HTTP/1.1 101 Switching Protocols\r\n\r\n");
+   conn->requestWrite(makeSend(handshake));
+   Data expected = handshake;
+
+   Data big(300, Data::Preallocate);
+   for (int i = 0; i < 300; ++i)
+   {
+      big += char('a' + i % 26);
+   }
+   Data small = message(1);
+   conn->requestWrite(makeSend(small));
+   conn->requestWrite(makeSend(big));
+
+   expected += char(0x82);
+   expected += char(small.size());
+   expected += small;
+   expected += char(0x82);
+   expected += char(0x7E);
+   expected += char(big.size() >> 8);
+   expected += char(big.size() & 0xFF);
+   expected += big;
+
+   resip_assert(conn->performWrites());
+   resip_assert(conn->mWire == expected);
+   delete conn;
+}
+
+#ifndef WIN32
+static void
+checkWritev(Transport& transport)
+{
+   int fds[2];
+   resip_assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+   TcpConnection* conn = new TcpConnection(&transport, peer(), fds[0], 
+                                           Compression::Disabled, false);
+   Data expected;
+   for (int i = 0; i < 10; ++i)
+   {
+      SendData* send = makeSend(message(i));
+      send->moreData.push_back("X-Seg: one\r\n");
+      expected += message(i) + "X-Seg: one\r\n";
+      conn->requestWrite(send);
+   }
+   resip_assert(conn->performWrites());
+   resip_assert(conn->getWriteCalls() == 1);
+
+   Data received;
+   char buf[4096];
+   while (received.size() < expected.size())
+   {
+      int n = (int)::read(fds[1], buf, sizeof(buf));
+      resip_assert(n > 0);
+      received.append(buf, n);
+   }
+   resip_assert(received == expected);
+   delete conn;
+   close(fds[1]);
+}
+#endif
+
+int
+main(int argc, char* argv[])
+{
+   Fifo<TransactionMessage> fifo;
+   TcpTransport tcp(fifo, 0, V4, "127.0.0.1");
+   WsTransport ws(fifo, 0, V4, "127.0.0.1");
+
+   checkCoalesced(tcp);
+   checkPartial(tcp);
+   checkWebSocket(ws);
+#ifndef WIN32
+   checkWritev(tcp);
+#endif
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
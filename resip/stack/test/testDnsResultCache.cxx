@@ -0,0 +1,262 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+
+#include "resip/stack/DnsInterface.hxx"
+#include "resip/stack/DnsResult.hxx"
+#include "resip/stack/Uri.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Time.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/dns/DnsHandler.hxx"
+#include "rutil/dns/DnsStub.hxx"
+#include "rutil/dns/DnsThread.hxx"
+#include "rutil/ResipAssert.h"
+
+// Checks that DnsResult::lookup() resolves a target whose NAPTR, SRV and A
+// records are all cached before it returns, that a target with a step
+// missing from the cache is finished by the DnsThread, and that answers
+// given this way count towards prefetching.
+
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+// Lets the test put answers in the cache without a nameserver.
+class CachingStub : public DnsStub
+{
+   public:
+      void cacheAnswer(const Data& name, unsigned short type, const Data& rdata)
+      {
+         Data msg;
+         appendShort(msg, 0);      // id
+         appendShort(msg, 0x8180); // response, recursion desired/available
+         appendShort(msg, 1);      // questions
+         appendShort(msg, 1);      // answers
+         appendShort(msg, 0);
+         appendShort(msg, 0);
+         appendName(msg, name);
+         appendShort(msg, type);
+         appendShort(msg, 1);      // IN
+         appendName(msg, name);
+         appendShort(msg, type);
+         appendShort(msg, 1);
+         appendShort(msg, 0);      // ttl, one hour
+         appendShort(msg, 3600);
+         appendShort(msg, (unsigned short)rdata.size());
+         msg += rdata;
+         cache(name, (const unsigned char*)msg.data(), (int)msg.size());
+      }
+
+      static void appendShort(Data& msg, unsigned short value)
+      {
+         msg += (char)(value >> 8);
+         msg += (char)(value & 0xff);
+      }
+
+      static void appendString(Data& msg, const Data& value)
+      {
+         msg += (char)value.size();
+         msg += value;
+      }
+
+      static void appendName(Data& msg, const Data& name)
+      {
+         Data::size_type start = 0;
+         while (start < name.size())
+         {
+            Data::size_type dot = name.find(".", start);
+            if (dot == Data::npos)
+            {
+               dot = name.size();
+            }
+            appendString(msg, name.substr(start, dot - start));
+            start = dot + 1;
+         }
+         msg += (char)0;
+      }
+};
+
+class CountingHandler : public DnsHandler
+{
+   public:
+      CountingHandler() : mHandled(0) {}
+      virtual void handle(DnsResult*) { ++mHandled; }
+      virtual void rewriteRequest(const Uri&) {}
+
+      volatile int mHandled;
+};
+
+static void
+cacheChain(CachingStub& stub, const Data& domain, bool withSrv)
+{
+   Data naptr;
+   CachingStub::appendShort(naptr, 10); // order
+   CachingStub::appendShort(naptr, 10); // preference
+   CachingStub::appendString(naptr, "s");
+   CachingStub::appendString(naptr, "SIP+D2U");
+   CachingStub::appendString(naptr, "");
+   CachingStub::appendName(naptr, "_sip._udp." + domain);
+   stub.cacheAnswer(domain, 35, naptr);
+
+   if (withSrv)
+   {
+      Data srv;
+      CachingStub::appendShort(srv, 0);    // priority
+      CachingStub::appendShort(srv, 0);    // weight
+      CachingStub::appendShort(srv, 5080); // port
+      CachingStub::appendName(srv, "host." + domain);
+      stub.cacheAnswer("_sip._udp." + domain, 33, srv);
+   }
+
+   Data a;
+   a += (char)127;
+   a += (char)0;
+   a += (char)0;
+   a += (char)2;
+   stub.cacheAnswer("host." + domain, 1, a);
+}
+
+static void
+checkResult(DnsResult* result)
+{
+   resip_assert(result->available() == DnsResult::Available);
+   Tuple tuple = result->next();
+   resip_assert(tuple == Tuple("127.0.0.2", 5080, UDP));
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   CachingStub stub;
+   DnsInterface dns(stub);
+   dns.addTransportType(UDP, V4);
+
+   // everything cached: answered on this thread, before lookup() returns
+   {
+      cacheChain(stub, "cached.example", true);
+      CountingHandler handler;
+      DnsResult* result = dns.createDnsResult(&handler);
+      dns.lookup(result, Uri("sip:cached.example"));
+      resip_assert(handler.mHandled == 1);
+      checkResult(result);
+      result->destroy();
+   }
+
+   // the SRV is missing: only the NAPTR is answered here, and the DnsThread
+   // takes over with the SRV query
+   {
+      cacheChain(stub, "partly.example", false);
+      CountingHandler handler;
+      DnsResult* result = dns.createDnsResult(&handler);
+      dns.lookup(result, Uri("sip:partly.example"));
+      resip_assert(handler.mHandled == 0);
+
+      // in the cache by the time the DnsThread gets to it
+      cacheChain(stub, "partly.example", true);
+      DnsThread thread(stub);
+      thread.run();
+      UInt64 end = Timer::getTimeMs() + 5000;
+      while (handler.mHandled == 0 && Timer::getTimeMs() < end)
+      {
+         sleepMs(10);
+      }
+      thread.shutdown();
+      thread.join();
+      resip_assert(handler.mHandled == 1);
+      checkResult(result);
+      result->destroy();
+   }
+
+   // answers given on this thread count as hits: with two lookups each
+   // of hot.example's three answers is due for a refresh (they all expire
+   // within the window), the one lookup of cached.example's is not
+   {
+      DnsStub::CacheStatistics stats;
+      stub.getCacheStatistics(stats);
+      const unsigned int prefetches = stats.prefetches;
+
+      stub.setDnsPrefetch(2 * 3600, 2);
+      cacheChain(stub, "hot.example", true);
+      for (int i = 0; i < 2; ++i)
+      {
+         CountingHandler handler;
+         DnsResult* result = dns.createDnsResult(&handler);
+         dns.lookup(result, Uri("sip:hot.example"));
+         resip_assert(handler.mHandled == 1);
+         checkResult(result);
+         result->destroy();
+      }
+      DnsThread thread(stub);
+      thread.run();
+      UInt64 end = Timer::getTimeMs() + 5000;
+      do
+      {
+         sleepMs(10);
+         stub.getCacheStatistics(stats);
+      }
+      while (stats.prefetches < prefetches + 3 && Timer::getTimeMs() < end);
+      thread.shutdown();
+      thread.join();
+      resip_assert(stats.prefetches == prefetches + 3);
+      stub.setDnsPrefetch(0, 0);
+   }
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,278 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "resip/stack/EncodeSegments.hxx"
+#include "resip/stack/PlainContents.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+// Checks that SipMessage::encode(EncodeSegments&) produces exactly what
+// encode(EncodeStream&) does, for messages as received and after the
+// changes a proxy makes before forwarding, and compares the cost of the
+// two.
+
+using namespace resip;
+using namespace std;
+
+static const Data invite("INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+                         "v: SIP/2.0/UDP 192.168.2.15:5100;branch=z9hG4bK-c87542-579667358-1--c87542-;rport\r\n"
+                         "Max-Forwards: 70\r\n"
+                         "To: Bob <sip:bob@biloxi.example.com>\r\n"
+                         "From: Alice <sip:alice@atlanta.example.com>;tag=ba1aee2d\r\n"
+                         "i: 6c64b42fce01b007@192.168.2.15\r\n"
+                         "CSeq: 2 INVITE\r\n"
+                         "Route: <sip:proxy1@192.168.2.1:5060;lr>, <sip:proxy2@192.168.2.220:5060;lr>\r\n"
+                         "Contact: <sip:alice@192.168.2.15:5100>\r\n"
+                         "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, MESSAGE, SUBSCRIBE, INFO\r\n"
+                         "Supported: replaces,  timer\r\n"
+                         "User-Agent: testEncodeSegments\r\n"
+                         "Proxy-Authorization: Digest username=\"alice\",realm=\"atlanta.example.com\",nonce=\"abc\",uri=\"sip:bob@biloxi.example.com\",response=\"0123456789abcdef0123456789abcdef\"\r\n"
+                         "X-Custom: one\r\n"
+                         "X-Custom: two, three\r\n"
+                         "Content-Type: application/sdp\r\n"
+                         "Content-Length: 138\r\n"
+                         "\r\n"
+                         "v=0\r\n"
+                         "o=alice 2890844526 2890844526 IN IP4 192.168.2.15\r\n"
+                         "s=-\r\n"
+                         "c=IN IP4 192.168.2.15\r\n"
+                         "t=0 0\r\n"
+                         "m=audio 49170 RTP/AVP 0\r\n"
+                         "a=rtpmap:0 PCMU/8000\r\n");
+
+static const Data response("SIP/2.0 401 Unauthorized\r\n"
+                           "Via: SIP/2.0/UDP 192.168.2.15:5100;branch=z9hG4bK-1;rport=5100;received=192.168.2.15\r\n"
+                           "To: Bob <sip:bob@biloxi.example.com>;tag=1234\r\n"
+                           "From: Alice <sip:alice@atlanta.example.com>;tag=ba1aee2d\r\n"
+                           "Call-ID: 6c64b42fce01b007@192.168.2.15\r\n"
+                           "CSeq: 1 REGISTER\r\n"
+                           "WWW-Authenticate: Digest realm=\"a.example.com\",nonce=\"1\"\r\n"
+                           "WWW-Authenticate: Digest realm=\"b.example.com\",nonce=\"2\"\r\n"
+                           "Content-Length: 0\r\n"
+                           "\r\n");
+
+static Data
+encodeStream(const SipMessage& msg)
+{
+   Data out;
+   {
+      DataStream str(out);
+      msg.encode(str);
+   }
+   return out;
+}
+
+static Data
+encodeSegments(const SipMessage& msg)
+{
+   EncodeSegments segs;
+   msg.encode(segs);
+
+   Data out;
+   segs.gather(out);
+   resip_assert(out.size() == segs.size());
+
+   // walking the segments one by one gives the same thing
+   Data walked;
+   for (size_t i = 0; i < segs.numSegments(); ++i)
+   {
+      const char* buf;
+      size_t len;
+      segs.getSegment(i, buf, len);
+      resip_assert(len > 0);
+      walked.append(buf, len);
+   }
+   resip_assert(walked == out);
+   return out;
+}
+
+static void
+checkSame(const SipMessage& msg, const char* what)
+{
+   Data expected = encodeStream(msg);
+   Data actual = encodeSegments(msg);
+   if (expected != actual)
+   {
+      cerr << what << ": segments differ from stream encoding" << endl
+           << "expected:" << endl << expected << endl
+           << "actual:" << endl << actual << endl;
+      resip_assert(0);
+   }
+}
+
+// What a proxy does to a request it forwards.
+static void
+forward(SipMessage& msg)
+{
+   msg.header(h_RequestLine).uri().host() = "10.0.0.2";
+   msg.header(h_MaxForwards).value()--;
+   msg.header(h_Routes).pop_front();
+   Via via;
+   via.transport() = "UDP";
+   via.sentHost() = "10.0.0.1";
+   via.sentPort() = 5060;
+   via.param(p_branch).reset("z9hG4bK-proxy-1");
+   msg.header(h_Vias).push_front(via);
+   NameAddr rr("<sip:10.0.0.1:5060;lr>");
+   msg.header(h_RecordRoutes).push_front(rr);
+}
+
+static void
+checkEncodings()
+{
+   {
+      auto_ptr<SipMessage> msg(SipMessage::make(invite));
+      resip_assert(msg.get());
+      checkSame(*msg, "unparsed invite");
+
+      // reading through const accessors leaves the raw text usable
+      msg->const_header(h_CSeq).method();
+      msg->const_header(h_From).exists(p_tag);
+      msg->getContents();
+      checkSame(*msg, "read invite");
+
+      forward(*msg);
+      checkSame(*msg, "forwarded invite");
+
+      msg->header(h_Supporteds).push_back(Token("path"));
+      msg->header(h_ProxyAuthorizations).front().param(p_nonce) = "def";
+      checkSame(*msg, "modified invite");
+
+      PlainContents text("hello");
+      msg->setContents(&text);
+      checkSame(*msg, "invite with new body");
+
+      msg->remove(h_Contacts);
+      msg->remove(h_Allows);
+      msg->setContents(0);
+      checkSame(*msg, "invite without body");
+   }
+   {
+      auto_ptr<SipMessage> msg(SipMessage::make(response));
+      resip_assert(msg.get());
+      checkSame(*msg, "unparsed response");
+
+      msg->header(h_Vias).front().param(p_received) = "10.0.0.9";
+      msg->header(h_StatusLine).reason() = "Unauthorized Here";
+      checkSame(*msg, "modified response");
+
+      auto_ptr<SipMessage> copy(new SipMessage(*msg));
+      checkSame(*copy, "copied response");
+   }
+   {
+      SipMessage msg;
+      msg.header(h_RequestLine) = RequestLine(OPTIONS);
+      msg.header(h_RequestLine).uri() = Uri("sip:bob@biloxi.example.com");
+      msg.header(h_CallId).value() = "1234";
+      msg.header(h_CSeq).sequence() = 1;
+      msg.header(h_CSeq).method() = OPTIONS;
+      checkSame(msg, "built request");
+   }
+}
+
+static void
+benchmark(const char* what, const SipMessage& msg, int runs)
+{
+   UInt64 begin = Timer::getTimeMicroSec();
+   for (int i = 0; i < runs; ++i)
+   {
+      Data out;
+      out.reserve(1024 + 256);
+      DataStream str(out);
+      msg.encode(str);
+      str.flush();
+   }
+   UInt64 stream = Timer::getTimeMicroSec() - begin;
+
+   begin = Timer::getTimeMicroSec();
+   for (int i = 0; i < runs; ++i)
+   {
+      EncodeSegments segs;
+      msg.encode(segs);
+      Data out;
+      segs.gather(out);
+   }
+   UInt64 segments = Timer::getTimeMicroSec() - begin;
+
+   cout << what << ": stream " << (stream ? runs*1000000ULL/stream : 0)
+        << "/s, segments " << (segments ? runs*1000000ULL/segments : 0) << "/s" << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+   int runs = 50000;
+   if (argc > 1)
+   {
+      runs = atoi(argv[1]);
+   }
+
+   checkEncodings();
+
+   auto_ptr<SipMessage> msg(SipMessage::make(invite));
+   resip_assert(msg.get());
+   benchmark("received INVITE", *msg, runs);
+   forward(*msg);
+   benchmark("forwarded INVITE", *msg, runs);
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
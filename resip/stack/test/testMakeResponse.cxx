@@ -0,0 +1,233 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+// Checks that Helper::makeResponse(), which copies the echoed headers as
+// text, produces the same responses as assigning the parsed headers did,
+// and compares the cost of the two for the responses a stateful proxy sends
+// most: 100 Trying, 407 and 200 OK.
+
+using namespace resip;
+using namespace std;
+
+static const Data invite("INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+                         "Via: SIP/2.0/UDP 192.168.2.220:5060;branch=z9hG4bK-c87542-da4d3e6a.0-1--c87542-;rport;stid=579667358\r\n"
+                         "Via: SIP/2.0/UDP 192.168.2.15:5100;branch=z9hG4bK-c87542-579667358-1--c87542-;rport=5100;received=192.168.2.15\r\n"
+                         "Max-Forwards: 69\r\n"
+                         "To: Bob <sip:bob@biloxi.example.com>\r\n"
+                         "From: Alice <sip:alice@atlanta.example.com>;tag=ba1aee2d\r\n"
+                         "Call-ID: 6c64b42fce01b007@192.168.2.15\r\n"
+                         "CSeq: 2 INVITE\r\n"
+                         "Record-Route: <sip:proxy2@192.168.2.220:5060;lr>\r\n"
+                         "Record-Route: <sip:proxy1@192.168.2.1:5060;lr>\r\n"
+                         "Contact: <sip:alice@192.168.2.15:5100>\r\n"
+                         "Content-Length: 0\r\n"
+                         "\r\n");
+
+// What the stack does to a request before the TU sees it: the transport
+// stamps the top Via, the transaction layer parses Via and CSeq, and the
+// TU looks at the To and From tags.
+static SipMessage*
+makeRequest()
+{
+   SipMessage* request = SipMessage::make(invite);
+   resip_assert(request);
+   request->header(h_Vias).front().param(p_rport).port() = 5060;
+   request->header(h_Vias).front().param(p_received) = "10.0.0.1";
+   request->const_header(h_CSeq).method();
+   request->const_header(h_To).exists(p_tag);
+   request->const_header(h_From).exists(p_tag);
+   request->const_header(h_CallId).value();
+   return request;
+}
+
+// How makeResponse() used to copy the headers.
+static void
+legacyMakeResponse(SipMessage& response, const SipMessage& request, int code)
+{
+   response.header(h_StatusLine).responseCode() = code;
+   response.header(h_From) = request.header(h_From);
+   response.header(h_To) = request.header(h_To);
+   response.header(h_CallId) = request.header(h_CallId);
+   response.header(h_CSeq) = request.header(h_CSeq);
+   response.header(h_Vias) = request.header(h_Vias);
+   if(code > 100 && !response.const_header(h_To).exists(p_tag))
+   {
+      response.header(h_To).param(p_tag) = Helper::computeTag(Helper::tagSize);
+   }
+   response.setRFC2543TransactionId(request.getRFC2543TransactionId());
+   if(code >= 180 && code < 300 && request.exists(h_RecordRoutes))
+   {
+      response.header(h_RecordRoutes) = request.header(h_RecordRoutes);
+   }
+   if(code/100 == 2)
+   {
+      response.header(h_Contacts).push_back(NameAddr());
+   }
+   response.setFromTU();
+   Helper::getResponseCodeReason(code, response.header(h_StatusLine).reason());
+}
+
+static Data
+encode(const SipMessage& msg)
+{
+   Data out;
+   {
+      DataStream str(out);
+      msg.encode(str);
+   }
+   return out;
+}
+
+static void
+checkSameAsLegacy(int code)
+{
+   auto_ptr<SipMessage> request(makeRequest());
+   auto_ptr<SipMessage> response(Helper::makeResponse(*request, code));
+   SipMessage legacy;
+   legacyMakeResponse(legacy, *request, code);
+   if(response->const_header(h_To).exists(p_tag))
+   {
+      legacy.header(h_To).param(p_tag) = response->const_header(h_To).param(p_tag);
+   }
+   Data ours(encode(*response));
+   Data theirs(encode(legacy));
+   if(ours != theirs)
+   {
+      cerr << "makeResponse(" << code << ") differs:" << endl
+           << ours << endl << "expected:" << endl << theirs << endl;
+      resip_assert(0);
+   }
+
+   // the copies must not depend on the request staying around
+   request.reset();
+   resip_assert(response->const_header(h_Vias).size() == 2);
+   resip_assert(response->const_header(h_Vias).front().param(p_received) == "10.0.0.1");
+   resip_assert(response->const_header(h_From).param(p_tag) == "ba1aee2d");
+   resip_assert(response->const_header(h_CSeq).sequence() == 2);
+   resip_assert(encode(*response) == ours);
+}
+
+static void
+checkUnparsedRequest()
+{
+   // nothing parsed yet, and a header the response already had
+   auto_ptr<SipMessage> request(SipMessage::make(invite));
+   SipMessage response;
+   response.header(h_CallId).value() = "stale";
+   Helper::makeResponse(response, *request, 180);
+   resip_assert(response.header(h_CallId).value() == "6c64b42fce01b007@192.168.2.15");
+   resip_assert(response.header(h_RecordRoutes).size() == 2);
+   resip_assert(response.header(h_To).exists(p_tag));
+   resip_assert(response.header(h_Vias).front().sentHost() == "192.168.2.220");
+}
+
+static void
+benchmark(int code, int runs)
+{
+   auto_ptr<SipMessage> request(makeRequest());
+   UInt64 begin = Timer::getTimeMicroSec();
+   for(int i=0; i<runs; ++i)
+   {
+      SipMessage response;
+      legacyMakeResponse(response, *request, code);
+      encode(response);
+   }
+   UInt64 legacy = Timer::getTimeMicroSec() - begin;
+
+   begin = Timer::getTimeMicroSec();
+   for(int i=0; i<runs; ++i)
+   {
+      SipMessage response;
+      Helper::makeResponse(response, *request, code);
+      encode(response);
+   }
+   UInt64 ours = Timer::getTimeMicroSec() - begin;
+
+   cout << code << ": parsed copy " << (legacy ? runs*1000000ULL/legacy : 0)
+        << "/s, text copy " << (ours ? runs*1000000ULL/ours : 0) << "/s" << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+   int runs = 50000;
+   if(argc > 1)
+   {
+      runs = atoi(argv[1]);
+   }
+
+   checkSameAsLegacy(100);
+   checkSameAsLegacy(180);
+   checkSameAsLegacy(200);
+   checkSameAsLegacy(407);
+   checkUnparsedRequest();
+
+   benchmark(100, runs);
+   benchmark(407, runs);
+   benchmark(200, runs);
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,266 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "resip/stack/MsgHeaderScanner.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+// Checks that every value skip mode of MsgHeaderScanner scans the RFC 4475
+// torture messages exactly like the plain state machine does, whole and split
+// into small chunks, then reports header scanning throughput for each mode.
+// The corpus is read from the directory given as the first argument, or from
+// $srcdir when run by "make check".
+
+using namespace resip;
+using namespace std;
+
+static const char* corpusFiles[] =
+{
+   "wsinv.dat", "intmeth.dat", "esc01.dat", "escnull.dat", "esc02.dat",
+   "lwsdisp.dat", "longreq.dat", "dblreq.dat", "semiuri.dat", "transports.dat",
+   "mpart01.dat", "unreason.dat", "noreason.dat", "badinv01.dat", "clerr.dat",
+   "ncl.dat", "scalar02.dat", "scalarlg.dat", "quotbal.dat", "ltgtruri.dat",
+   "lwsruri.dat", "lwsstart.dat", "trws.dat", "escruri.dat", "baddate.dat",
+   "regbadct.dat", "badaspec.dat", "baddn.dat", "badvers.dat", "mismatch01.dat",
+   "mismatch02.dat", "bigcode.dat", "badbranch.dat", "bcast.dat", "bext01.dat",
+   "cparam01.dat", "cparam02.dat", "insuf.dat", "inv2543.dat", "invut.dat",
+   "mcl01.dat", "multi01.dat", "novelsc.dat", "regaut01.dat", "regescrt.dat",
+   "sdp01.dat", "unkscm.dat", "unksm2.dat", "zeromf.dat"
+};
+
+static const char* modeNames[] = { "char-by-char", "scalar", "sse2", "avx2" };
+
+class ScanResult
+{
+   public:
+      ScanResult() : mResult(MsgHeaderScanner::scrError), mUsed(0), mHeaders(0) {}
+      bool operator==(const ScanResult& rhs) const
+      {
+         return mResult == rhs.mResult &&
+            mUsed == rhs.mUsed &&
+            mHeaders == rhs.mHeaders &&
+            mEncoded == rhs.mEncoded;
+      }
+
+      MsgHeaderScanner::ScanChunkResult mResult;
+      size_t mUsed;
+      unsigned int mHeaders;
+      Data mEncoded;
+};
+
+static ScanResult
+scan(const Data& text, size_t chunkSize)
+{
+   ScanResult result;
+   SipMessage msg;
+   MsgHeaderScanner scanner;
+   scanner.prepareForMessage(&msg);
+
+   size_t pos = 0;
+   size_t saved = 0;
+   const char* unprocessed = 0;
+   for (;;)
+   {
+      size_t count = text.size() - pos < chunkSize ? text.size() - pos : chunkSize;
+      char* buffer = MsgHeaderScanner::allocateBuffer((int)(saved + count));
+      msg.addBuffer(buffer);
+      memcpy(buffer, unprocessed, saved);
+      memcpy(buffer + saved, text.data() + pos, count);
+      pos += count;
+
+      char* unprocessedCharPtr;
+      result.mResult = scanner.scanChunk(buffer, (unsigned int)(saved + count), &unprocessedCharPtr);
+      size_t left = (buffer + saved + count) - unprocessedCharPtr;
+      result.mUsed = pos - left;
+      if (result.mResult != MsgHeaderScanner::scrNextChunk || pos == text.size())
+      {
+         break;
+      }
+      unprocessed = unprocessedCharPtr;
+      saved = left;
+   }
+
+   result.mHeaders = scanner.getHeaderCount();
+   if (result.mResult == MsgHeaderScanner::scrEnd)
+   {
+      try
+      {
+         DataStream str(result.mEncoded);
+         msg.encode(str);
+      }
+      catch (BaseException& e)
+      {
+         result.mEncoded = "encode failed: " + Data(e.getMessage());
+      }
+   }
+   return result;
+}
+
+int
+main(int argc, char** argv)
+{
+   Data dir(".");
+   if (argc > 1)
+   {
+      dir = argv[1];
+   }
+   else if (getenv("srcdir"))
+   {
+      dir = getenv("srcdir");
+   }
+   unsigned int iterations = 2000;
+   if (argc > 2)
+   {
+      iterations = atoi(argv[2]);
+   }
+
+   vector<Data> corpus;
+   for (size_t i = 0; i < sizeof(corpusFiles) / sizeof(corpusFiles[0]); ++i)
+   {
+      ifstream file((dir + "/" + corpusFiles[i]).c_str(), ios::binary);
+      if (!file)
+      {
+         cerr << "missing " << dir << "/" << corpusFiles[i] << endl;
+         return 1;
+      }
+      string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+      corpus.push_back(Data(text.data(), (Data::size_type)text.size()));
+   }
+
+   const MsgHeaderScanner::ValueSkipMode best = MsgHeaderScanner::getValueSkipMode();
+   cout << "default value skip mode: " << modeNames[best] << endl;
+   resip_assert(best != MsgHeaderScanner::vsmCharByChar);
+
+   // The reference results, from the state machine alone.
+   bool set = MsgHeaderScanner::setValueSkipMode(MsgHeaderScanner::vsmCharByChar);
+   resip_assert(set);
+   vector<ScanResult> expected;
+   size_t headerBytes = 0;
+   for (size_t i = 0; i < corpus.size(); ++i)
+   {
+      expected.push_back(scan(corpus[i], corpus[i].size()));
+      headerBytes += expected.back().mUsed;
+   }
+
+   const size_t chunkSizes[] = { 1, 7, 16, 33 };
+   double baseline = 0;
+   for (int mode = MsgHeaderScanner::vsmCharByChar; mode <= MsgHeaderScanner::vsmAvx2; ++mode)
+   {
+      if (!MsgHeaderScanner::setValueSkipMode((MsgHeaderScanner::ValueSkipMode)mode))
+      {
+         cout << modeNames[mode] << ": not supported here" << endl;
+         continue;
+      }
+
+      for (size_t i = 0; i < corpus.size(); ++i)
+      {
+         ScanResult whole = scan(corpus[i], corpus[i].size());
+         resip_assert(whole == expected[i]);
+         for (size_t c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); ++c)
+         {
+            ScanResult chunked = scan(corpus[i], chunkSizes[c]);
+            resip_assert(chunked == expected[i]);
+         }
+      }
+
+      vector<char*> buffers;
+      for (size_t i = 0; i < corpus.size(); ++i)
+      {
+         buffers.push_back(MsgHeaderScanner::allocateBuffer((int)corpus[i].size()));
+      }
+      MsgHeaderScanner scanner;
+      UInt64 begin = Timer::getTimeMicroSec();
+      for (unsigned int n = 0; n < iterations; ++n)
+      {
+         for (size_t i = 0; i < corpus.size(); ++i)
+         {
+            SipMessage msg;
+            scanner.prepareForMessage(&msg);
+            memcpy(buffers[i], corpus[i].data(), corpus[i].size());
+            char* unprocessedCharPtr;
+            scanner.scanChunk(buffers[i], (unsigned int)corpus[i].size(), &unprocessedCharPtr);
+         }
+      }
+      UInt64 elapsed = Timer::getTimeMicroSec() - begin;
+      for (size_t i = 0; i < buffers.size(); ++i)
+      {
+         delete [] buffers[i];
+      }
+
+      double mbPerSecond = elapsed ? (double)headerBytes * iterations / (double)elapsed : 0;
+      if (mode == MsgHeaderScanner::vsmCharByChar)
+      {
+         baseline = mbPerSecond;
+      }
+      cout << modeNames[mode] << ": " << corpus.size() << " messages, "
+           << headerBytes << " header bytes x " << iterations << ", "
+           << mbPerSecond << " MB/s";
+      if (baseline > 0)
+      {
+         cout << " (" << mbPerSecond / baseline << "x)";
+      }
+      cout << endl;
+   }
+
+   set = MsgHeaderScanner::setValueSkipMode(best);
+   resip_assert(set);
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,224 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/TransactionUser.hxx"
+#include "resip/stack/TuSelector.hxx"
+#include "resip/stack/TransportThread.hxx"
+#include "resip/stack/UdpTransport.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#endif
+
+// Checks the pieces that keep a dialog in one TransactionController shard
+// pipeline: Call-IDs generated for a shard, TU selection by shard, and UDP
+// receive shards feeding their own shard's fifo. The dispatch itself is
+// exercised by testStack --tc-by-call-id.
+
+using namespace resip;
+using namespace std;
+
+class ShardTu : public TransactionUser
+{
+   public:
+      ShardTu(const Data& name) : mName(name) {}
+      virtual const Data& name() const { return mName; }
+
+   private:
+      Data mName;
+};
+
+static void
+checkCallIds()
+{
+   const unsigned int shards = 4;
+
+   // unbound: Call-IDs spread over all shards
+   vector<unsigned int> seen(shards, 0);
+   for (unsigned int i = 0; i < 400; ++i)
+   {
+      ++seen[Helper::callIdShard(Helper::computeCallId(), shards)];
+   }
+   for (unsigned int s = 0; s < shards; ++s)
+   {
+      resip_assert(seen[s] > 0);
+   }
+
+   for (unsigned int s = 0; s < shards; ++s)
+   {
+      Helper::setCallIdShard(s, shards);
+      for (unsigned int i = 0; i < 100; ++i)
+      {
+         resip_assert(Helper::callIdShard(Helper::computeCallId(), shards) == s);
+      }
+   }
+
+   Helper::setCallIdShard(0, 1);
+   resip_assert(Helper::callIdShard(Helper::computeCallId(), 1) == 0);
+}
+
+static void
+checkTuSelection()
+{
+   TimeLimitFifo<Message> fallback(0, 0);
+   TuSelector selector(fallback);
+   ShardTu tu0("shard0");
+   ShardTu tu1("shard1");
+   ShardTu any("any");
+   tu0.setShard(0);
+   tu1.setShard(1);
+   selector.registerTransactionUser(tu0);
+   selector.registerTransactionUser(tu1);
+   selector.registerTransactionUser(any);
+
+   auto_ptr<SipMessage> invite(Helper::makeRequest(NameAddr("sip:bob@example.com"),
+                                                   NameAddr("sip:alice@example.com"),
+                                                   INVITE));
+   resip_assert(selector.selectTransactionUser(*invite, 0) == &tu0);
+   resip_assert(selector.selectTransactionUser(*invite, 1) == &tu1);
+   resip_assert(selector.selectTransactionUser(*invite, 2) == &any);
+   // not sharded: first match
+   resip_assert(selector.selectTransactionUser(*invite) == &tu0);
+}
+
+static void
+checkRxShardFifos()
+{
+#ifndef WIN32
+   // The transport feeds fifos[1], so its one receive shard feeds fifos[0].
+   Fifo<TransactionMessage> fifo0;
+   Fifo<TransactionMessage> fifo1;
+   vector<Fifo<TransactionMessage>*> fifos;
+   fifos.push_back(&fifo0);
+   fifos.push_back(&fifo1);
+
+   UdpTransport transport(fifo1, 0, V4, StunDisabled, "127.0.0.1", 0,
+                          Compression::Disabled,
+                          RESIP_TRANSPORT_FLAG_REUSEPORT|RESIP_TRANSPORT_FLAG_OWNTHREAD);
+   transport.setRxShards(2, fifos);
+   TransportThread thread(transport);
+   thread.run();
+
+   auto_ptr<SipMessage> options(Helper::makeRequest(NameAddr("sip:bob@127.0.0.1"),
+                                                    NameAddr("sip:alice@127.0.0.1"),
+                                                    OPTIONS));
+   options->header(h_Vias).front().transport() = "UDP";
+   options->header(h_Vias).front().sentHost() = "127.0.0.1";
+   Data encoded;
+   {
+      DataStream strm(encoded);
+      options->encode(strm);
+   }
+
+   // the kernel spreads source ports over the two sockets
+   const unsigned int senders = 32;
+   for (unsigned int i = 0; i < senders; ++i)
+   {
+      Socket fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+      resip_assert(fd != INVALID_SOCKET);
+      resip_assert(::sendto(fd, encoded.data(), encoded.size(), 0,
+                            &transport.getTuple().getSockaddr(),
+                            transport.getTuple().length()) > 0);
+      closeSocket(fd);
+   }
+
+   unsigned int received[2] = {0, 0};
+   UInt64 end = Timer::getTimeMs() + 5000;
+   while (received[0] + received[1] < senders && Timer::getTimeMs() < end)
+   {
+      for (int f = 0; f < 2; ++f)
+      {
+         Message* msg = fifos[f]->getNext(10);
+         if (msg)
+         {
+            resip_assert(dynamic_cast<SipMessage*>(msg));
+            ++received[f];
+            delete msg;
+         }
+      }
+   }
+   thread.shutdown();
+   thread.join();
+
+   cout << "rx shard fifos: " << received[0] << "/" << received[1] << endl;
+   resip_assert(received[0] + received[1] == senders);
+   resip_assert(received[0] > 0 && received[1] > 0);
+#endif
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   checkCallIds();
+   checkTuSelection();
+   checkRxShardFifos();
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
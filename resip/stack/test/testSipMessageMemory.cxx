@@ -1,13 +1,52 @@
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/Uri.hxx"
+#include "resip/stack/ExtensionHeader.hxx"
+#include "rutil/DataIntern.hxx"
 #include "resip/stack/test/TestSupport.hxx"
 
 #include <iostream>
 #include <memory>
+#include <new>
+#include <stdlib.h>
 
 using namespace resip;
 using namespace std;
 
+// Count heap allocations, so we can tell how many a message costs.
+static size_t heapAllocations = 0;
+
+void* operator new(size_t size)
+{
+   ++heapAllocations;
+   void* p = malloc(size ? size : 1);
+   if (!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void* operator new[](size_t size)
+{
+   ++heapAllocations;
+   void* p = malloc(size ? size : 1);
+   if (!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void operator delete(void* p) throw()
+{
+   free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+   free(p);
+}
+
 int
 main()
 {
@@ -69,6 +108,86 @@ main()
       assert(message1->getRawHeader(Headers::CSeq)->getParserContainer());
    }
 
+   {
+      resipCerr << "Counting heap allocations per message" << endl;
+
+      const char *txt = "INVITE sip:bob@biloxi.com SIP/2.0\r\n"
+         "Via: SIP/2.0/UDP pc33.atlanta.com;branch=z9hG4bKnashds8;received=192.0.2.1\r\n"
+         "Via: SIP/2.0/UDP bigbox3.site3.atlanta.com;branch=z9hG4bK77ef4c2312983.1\r\n"
+         "Via: SIP/2.0/TCP client.atlanta.example.com:5060;branch=z9hG4bK74bf9;rport\r\n"
+         "Record-Route: <sip:p1.example.com;lr>\r\n"
+         "Record-Route: <sip:p2.example.com;lr>\r\n"
+         "Max-Forwards: 70\r\n"
+         "To: Bob <sip:bob@biloxi.com>\r\n"
+         "From: Alice <sip:alice@atlanta.com>;tag=1928301774\r\n"
+         "Call-ID: a84b4c76e66710@pc33.atlanta.com\r\n"
+         "CSeq: 314159 INVITE\r\n"
+         "Contact: <sip:alice@pc33.atlanta.com;transport=tcp>;+sip.instance=\"<urn:uuid:00000000-0000-1000-8000-000A95A0E128>\"\r\n"
+         "Allow: INVITE, ACK, CANCEL, OPTIONS, BYE, REFER, NOTIFY, MESSAGE, SUBSCRIBE, INFO\r\n"
+         "Supported: replaces, timer, gruu\r\n"
+         "Session-Expires: 1800;refresher=uac\r\n"
+         "P-Asserted-Identity: \"Alice\" <sip:alice@atlanta.com>\r\n"
+         "User-Agent: testSipMessageMemory\r\n"
+         "Content-Length: 0\r\n\r\n";
+      Data raw(txt);
+
+      size_t before = heapAllocations;
+      auto_ptr<SipMessage> message(TestSupport::makeMessage(raw));
+      size_t made = heapAllocations;
+
+      for (Vias::iterator i = message->header(h_Vias).begin(); i != message->header(h_Vias).end(); ++i)
+      {
+         assert(i->exists(p_branch));
+      }
+      assert(message->header(h_RecordRoutes).size() == 2);
+      assert(message->header(h_RecordRoutes).front().uri().exists(p_lr));
+      assert(message->header(h_MaxForwards).value() == 70);
+      assert(message->header(h_To).uri().user() == "bob");
+      assert(message->header(h_From).param(p_tag) == "1928301774");
+      assert(!message->header(h_CallId).value().empty());
+      assert(message->header(h_CSeq).sequence() == 314159);
+      assert(message->header(h_Contacts).front().uri().exists(p_transport));
+      assert(message->header(h_Allows).size() == 10);
+      assert(message->header(h_Supporteds).size() == 3);
+      assert(message->header(h_SessionExpires).value() == 1800);
+      assert(message->header(h_PAssertedIdentities).front().uri().host() == "atlanta.com");
+      size_t parsed = heapAllocations;
+
+      message.reset();
+
+      resipCerr << "INVITE: " << (made - before) << " heap allocations to preparse, "
+                << (parsed - made) << " more to parse every header" << endl;
+      // The message, its raw buffer, and a few arena chunks; not one per
+      // header, parser or parameter.
+      assert(parsed - before <= 8);
+   }
+
+   {
+      resipCerr << "Sharing interned extension header names" << endl;
+
+      static const ExtensionHeader h_XCorrelationIdentifier("X-Correlation-Identifier");
+      const Data* interned = DataIntern::find("X-Correlation-Identifier", 24);
+      assert(interned);
+
+      const char *txt = "OPTIONS sip:bob@biloxi.com SIP/2.0\r\n"
+         "Via: SIP/2.0/UDP pc33.atlanta.com;branch=z9hG4bKnashds8\r\n"
+         "To: Bob <sip:bob@biloxi.com>\r\n"
+         "From: Alice <sip:alice@atlanta.com>;tag=1928301774\r\n"
+         "Call-ID: a84b4c76e66710@pc33.atlanta.com\r\n"
+         "CSeq: 1 OPTIONS\r\n"
+         "X-Correlation-Identifier: 3f2a\r\n"
+         "X-Correlation-identifier: 3f2b\r\n"
+         "Content-Length: 0\r\n\r\n";
+      auto_ptr<SipMessage> message(TestSupport::makeMessage(Data(txt)));
+      assert(message->getRawUnknownHeaders().size() == 1);
+      assert(message->getRawUnknownHeaders().front().first.data() == interned->data());
+      assert(message->header(h_XCorrelationIdentifier).size() == 2);
+
+      SipMessage copy(*message);
+      assert(copy.getRawUnknownHeaders().front().first.data() == interned->data());
+      assert(copy.header(h_XCorrelationIdentifier).back().value() == "3f2b");
+   }
+
    resipCout << "All OK" << endl;
    return 0;
 }
@@ -88,6 +88,9 @@ using namespace std;
 
     epoll       Like "event", but specifically uses the epoll implmentation.
 
+    uring       Like "event", but uses the io_uring implementation (falls
+                back to epoll if the kernel does not support io_uring).
+
     fdset       Like "event", but specifically uses the FdSet/select
                 implmentation.
 
@@ -102,6 +105,22 @@ using namespace std;
   of one of your interfaces. Or you can use --bind=='' and we'll try
   to figure out your local DNS name.
 
+  ===============
+  Option: --tc-shards
+  Number of TransactionController shards each stack runs (see
+  SipStackOptions::mTransactionControllerShards). Shards only get their
+  own threads with --thread-type=multithreadedstack, so use the two
+  together to see how the transaction layer scales, e.g.:
+      for n in 1 2 4 8; do
+         ./testStack -p udp -t multithreadedstack --tc-shards=$n -n 8 -r 50000
+      done
+
+  ===============
+  Option: --tc-by-call-id
+  Assign messages to those shards by Call-ID (see
+  SipStackOptions::mShardByCallId), so that the INVITE, ACK and BYE of a
+  call (--invite) are all handled by the same shard.
+
 
 ************************************************************************/
 
@@ -155,7 +174,9 @@ class SipStackAndThread
    public:
       SipStackAndThread(const char *tType,
         AsyncProcessHandler *notifyDn=0,
-        AsyncProcessHandler *notifyUp=0);
+        AsyncProcessHandler *notifyUp=0,
+        unsigned int tcShards=1,
+        bool tcByCallId=false);
          ~SipStackAndThread() {
          destroy();
       }
@@ -203,7 +224,8 @@ class SipStackAndThread
 
 
 SipStackAndThread::SipStackAndThread(const char *tType,
- AsyncProcessHandler *notifyDn, AsyncProcessHandler *notifyUp)
+ AsyncProcessHandler *notifyDn, AsyncProcessHandler *notifyUp,
+ unsigned int tcShards, bool tcByCallId)
   : mStack(0), 
       mThread(0), 
       mSelIntr(0), 
@@ -221,6 +243,7 @@ SipStackAndThread::SipStackAndThread(const char *tType,
    }
    else if ( strcmp(tType,"event")==0
           || strcmp(tType,"epoll")==0
+          || strcmp(tType,"uring")==0
           || strcmp(tType,"fdset")==0
           || strcmp(tType,"poll")==0 )
    {
@@ -249,6 +272,8 @@ SipStackAndThread::SipStackAndThread(const char *tType,
    options.mAsyncProcessHandler = mEventIntr?mEventIntr
       :(mSelIntr?mSelIntr:notifyDn);
    options.mPollGrp = mPollGrp;
+   options.mTransactionControllerShards = tcShards;
+   options.mShardByCallId = tcByCallId;
    mStack = new SipStack(options);
    
    mStack->setFallbackPostNotify(notifyUp);
@@ -594,6 +619,8 @@ main(int argc, char* argv[])
    int sendSleepMs = 0;
    int cManager=0;
    int statisticsInterval=60;
+   int tcShards=1;
+   int tcByCallId=0;
 
 #if defined(HAVE_POPT_H)
 
@@ -620,6 +647,8 @@ main(int argc, char* argv[])
       {"sleep",       0,   POPT_ARG_INT,    &sendSleepMs,0, "time (ms) to sleep after each sent request", 0},
       {"use-congestion-manager",0, POPT_ARG_NONE, &cManager ,   0, "use a CongestionManager", 0},
       {"statistics-interval",       0,   POPT_ARG_INT,    &statisticsInterval,0, "time in seconds between statistics logging", 0},
+      {"tc-shards",   0,   POPT_ARG_INT,    &tcShards,  0, "number of TransactionController shards per stack", 0},
+      {"tc-by-call-id",0,  POPT_ARG_NONE,   &tcByCallId,0, "assign messages to TransactionController shards by Call-ID", 0},
       POPT_AUTOHELP
       { NULL, 0, 0, NULL, 0 }
    };
@@ -646,6 +675,8 @@ main(int argc, char* argv[])
      <<" bindIf="<<bindIfAddr
      <<" listen="<<doListen
      <<" tf="<<tpFlags
+     <<" tcShards="<<tcShards
+     <<" tcByCallId="<<tcByCallId
      <<"." << endl;
 
    const char *eachThreadType = threadType;
@@ -678,8 +709,8 @@ main(int argc, char* argv[])
    {
       notifyUp = &sharedUp;
    }
-   SipStackAndThread receiver(eachThreadType, commonIntr, notifyUp);
-   SipStackAndThread sender(eachThreadType, commonIntr, notifyUp);
+   SipStackAndThread receiver(eachThreadType, commonIntr, notifyUp, tcShards, tcByCallId!=0);
+   SipStackAndThread sender(eachThreadType, commonIntr, notifyUp, tcShards, tcByCallId!=0);
    receiver.getStack().setStatisticsInterval(statisticsInterval);
    sender.getStack().setStatisticsInterval(statisticsInterval);
 
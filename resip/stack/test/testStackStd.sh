@@ -15,6 +15,16 @@ echo "Running TCP REGISTER test (threaded stack, threaded transports)"
 ./testStack --protocol=tcp --thread-type=multithreadedstack --tf=32
 echo "Running UDP REGISTER test"
 ./testStack --protocol=udp
+for shards in 1 2 4 8; do
+   echo "Running UDP REGISTER test (threaded stack, $shards transaction shards)"
+   ./testStack --protocol=udp --thread-type=multithreadedstack --numports=8 --tc-shards=$shards
+done
+echo "Running UDP INVITE test (threaded stack, 4 transaction shards by Call-ID)"
+./testStack --protocol=udp --thread-type=multithreadedstack --numports=8 --tc-shards=4 --tc-by-call-id --invite
+echo "Running TCP REGISTER test (io_uring)"
+./testStack --protocol=tcp --thread-type=uring
+echo "Running UDP REGISTER test (io_uring)"
+./testStack --protocol=udp --thread-type=uring
 echo "Running TCP REGISTER test with 50 ports"
 ./testStack --protocol=tcp --numports=50
 echo "Running TCP INVITE test"
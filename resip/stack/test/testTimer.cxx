@@ -2,6 +2,8 @@
 #include "resip/stack/TransactionMessage.hxx"
 #include "resip/stack/TimerQueue.hxx"
 #include "resip/stack/TuSelector.hxx"
+#include "resip/stack/CancelableTimerQueue.hxx"
+#include "rutil/GenericTimerQueue.hxx"
 #include "rutil/Fifo.hxx"
 #include "rutil/TimeLimitFifo.hxx"
 #ifdef WIN32
@@ -18,6 +20,27 @@
 using namespace resip;
 using namespace std;
 
+class Counted
+{
+   public:
+      Counted() { ++alive; }
+      ~Counted() { --alive; }
+      static int alive;
+};
+int Counted::alive = 0;
+
+class CountedTimerQueue : public GenericTimerQueue<Counted>
+{
+   public:
+      CountedTimerQueue() : mFired(0) {}
+      virtual void processTimer(Counted* c)
+      {
+         ++mFired;
+         delete c;
+      }
+      int mFired;
+};
+
 bool
 isNear(int value, int reference, int epsilon=250)
 {
@@ -118,6 +141,55 @@ main()
    timer.process();   
    assert(r.size() == 5);
 
+   {
+      // cancelled timers never fire, and their handles go stale
+      TimerHandle cancelled = timer.add(Timer::TimerA, "cancelled", 0);
+      timer.add(Timer::TimerA, "kept", 0);
+      assert(timer.size() == 2);
+      assert(timer.cancel(cancelled));
+      assert(!timer.cancel(cancelled));
+      assert(timer.size() == 1);
+      usleep(2000);
+      timer.process();
+      assert(r.size() == 6);
+      assert(timer.empty());
+   }
+
+   {
+      CancelableTimerQueue<int> queue;
+      CancelableTimerQueue<int>::Id first = queue.addRelative(1, 0);
+      CancelableTimerQueue<int>::Id second = queue.addRelative(2, 0);
+      queue.addRelative(3, 60000);
+      assert(queue.size() == 3);
+      assert(queue.cancel(first));
+      assert(!queue.cancel(first));
+      usleep(2000);
+      assert(queue.available());
+      assert(queue.getNext() == 2);
+      assert(!queue.available());
+      assert(!queue.cancel(second));
+      assert(isNear(queue.getTimeout(), 60000));
+      queue.clear();
+      assert(queue.empty());
+      assert(queue.getTimeout() == -1);
+   }
+
+   {
+      CountedTimerQueue queue;
+      TimerHandle handle = queue.add(new Counted, 0);
+      queue.add(new Counted, 0);
+      queue.add(new Counted, 60000);
+      assert(Counted::alive == 3);
+      assert(queue.cancel(handle));
+      assert(Counted::alive == 2);
+      usleep(2000);
+      queue.process();
+      assert(queue.mFired == 1);
+      assert(queue.size() == 1);
+      assert(isNear(queue.msTillNextTimer(), 60000));
+   }
+   assert(Counted::alive == 0);
+
    cerr << "All OK" << endl;
    return 0;
 }
@@ -0,0 +1,307 @@
+#include <iostream>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "rutil/Data.hxx"
+#include "rutil/Random.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/TimerWheel.hxx"
+#include "rutil/ResipAssert.h"
+
+// Compares the std::priority_queue that TimerQueue used to be built on with
+// the TimerWheel it uses now, using TransactionTimers spread over the RFC 3261
+// timer range (T1 to 64*T1). Time is simulated, so the numbers only reflect
+// the cost of the containers.
+
+using namespace resip;
+using namespace std;
+
+typedef priority_queue<TransactionTimer, vector<TransactionTimer>, greater<TransactionTimer> > TimerHeap;
+
+class Collect
+{
+   public:
+      Collect(vector<Data>& fired) : mFired(fired) {}
+      void operator()(const TransactionTimer& timer)
+      {
+         mFired.push_back(timer.getTransactionId());
+      }
+   private:
+      vector<Data>& mFired;
+};
+
+class Count
+{
+   public:
+      Count(UInt64& now) : mNow(now), mCount(0) {}
+      void operator()(const TransactionTimer& timer)
+      {
+         resip_assert(timer.getWhen() <= mNow);
+         ++mCount;
+      }
+      UInt64& mNow;
+      unsigned int mCount;
+};
+
+class OrderedTimer
+{
+   public:
+      OrderedTimer(UInt64 when, unsigned int id) : mWhen(when), mId(id) {}
+      UInt64 getWhen() const { return mWhen; }
+      UInt64 mWhen;
+      unsigned int mId;
+};
+
+class CollectIds
+{
+   public:
+      CollectIds(vector<unsigned int>& fired) : mFired(fired) {}
+      void operator()(const OrderedTimer& timer)
+      {
+         mFired.push_back(timer.mId);
+      }
+   private:
+      vector<unsigned int>& mFired;
+};
+
+static unsigned long
+randomOffset()
+{
+   return 500 + (unsigned long)(Random::getRandom() % 31500);
+}
+
+static double
+rate(unsigned int count, UInt64 micros)
+{
+   return micros ? (double)count * 1000000.0 / (double)micros : 0;
+}
+
+static void
+checkAgainstHeap(unsigned int count)
+{
+   // Fire identical timers from both containers and make sure every step
+   // yields the same set.
+   TimerHeap heap;
+   TimerWheel<TransactionTimer> wheel;
+   UInt64 start = Timer::getTimeMs();
+   for(unsigned int i=0; i<count; ++i)
+   {
+      TransactionTimer t(randomOffset() + (i%7==0 ? 3600000 : 0), Timer::TimerB, Data(i));
+      heap.push(t);
+      wheel.add(t);
+   }
+
+   UInt64 now = start;
+   while(!heap.empty())
+   {
+      now += 1 + Random::getRandom() % 50;
+      vector<Data> fromHeap;
+      while(!heap.empty() && heap.top().getWhen() <= now)
+      {
+         fromHeap.push_back(heap.top().getTransactionId());
+         heap.pop();
+      }
+      vector<Data> fromWheel;
+      Collect collect(fromWheel);
+      wheel.expire(now, collect);
+      sort(fromHeap.begin(), fromHeap.end());
+      sort(fromWheel.begin(), fromWheel.end());
+      resip_assert(fromHeap == fromWheel);
+      if(!heap.empty())
+      {
+         resip_assert(wheel.nextExpiry() == heap.top().getWhen());
+      }
+   }
+   resip_assert(wheel.empty());
+   cout << "wheel matches heap for " << count << " timers" << endl;
+}
+
+static void
+checkSameExpiryOrder(UInt64 when, const UInt64* lead, unsigned int leads)
+{
+   // Timers due on the same tick must fire in the order they were added,
+   // including when the earlier ones were filed in coarser levels and
+   // cascaded down while later ones went straight into a finer level.
+   TimerWheel<OrderedTimer> wheel;
+   unsigned int id = 0;
+   vector<unsigned int> fired;
+   CollectIds collect(fired);
+   for(unsigned int step=0; step<leads; ++step)
+   {
+      wheel.expire(when - lead[step], collect);
+      resip_assert(fired.empty() || step+1 == leads);
+      for(unsigned int i=0; i<4; ++i)
+      {
+         wheel.add(OrderedTimer(when, id++));
+         wheel.add(OrderedTimer(when+1, 1000));
+      }
+   }
+   wheel.expire(when, collect);
+   resip_assert(fired.size() == id);
+   for(unsigned int i=0; i<id; ++i)
+   {
+      resip_assert(fired[i] == i);
+   }
+}
+
+static void
+checkSameExpiryOrder()
+{
+   UInt64 start = Timer::getTimeMs();
+   const UInt64 lead[] = { 300000, 200000, 3000, 20, 0 };
+   checkSameExpiryOrder(start + 300000, lead, sizeof(lead)/sizeof(lead[0]));
+
+   // Just past a 64^2 ms boundary, so that the level 2 slot of the first
+   // timers and the level 1 slot of the next ones are cascaded on the same
+   // tick.
+   UInt64 boundary = (start + 2*4096) & ~UInt64(4095);
+   const UInt64 acrossLevels[] = { boundary + 5 - start, 105, 0 };
+   checkSameExpiryOrder(boundary + 5, acrossLevels, sizeof(acrossLevels)/sizeof(acrossLevels[0]));
+   cout << "same-expiry timers fire in insertion order" << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+   unsigned int count = 1000000;
+   if(argc > 1)
+   {
+      count = atoi(argv[1]);
+   }
+
+   Random::initialize();
+   checkSameExpiryOrder();
+   checkAgainstHeap(count/20 ? count/20 : 1);
+
+   vector<Data> tids;
+   tids.reserve(count);
+   for(unsigned int i=0; i<count; ++i)
+   {
+      tids.push_back(Data("z9hG4bK") + Data(i));
+   }
+   vector<unsigned long> offsets;
+   offsets.reserve(count);
+   for(unsigned int i=0; i<count; ++i)
+   {
+      offsets.push_back(randomOffset());
+   }
+   UInt64 base = Timer::getTimeMs();
+
+   {
+      TimerHeap heap;
+      UInt64 begin = Timer::getTimeMicroSec();
+      for(unsigned int i=0; i<count; ++i)
+      {
+         heap.push(TransactionTimer(offsets[i], Timer::TimerB, tids[i]));
+      }
+      UInt64 inserted = Timer::getTimeMicroSec();
+
+      unsigned int fired = 0;
+      UInt64 now = base;
+      while(!heap.empty())
+      {
+         now += 10;
+         while(!heap.empty() && heap.top().getWhen() <= now)
+         {
+            heap.pop();
+            ++fired;
+         }
+      }
+      UInt64 drained = Timer::getTimeMicroSec();
+      resip_assert(fired == count);
+      cout << "heap : " << count << " timers, insert/s=" << rate(count, inserted-begin)
+           << " expire/s=" << rate(count, drained-inserted) << endl;
+   }
+
+   {
+      TimerWheel<TransactionTimer> wheel;
+      vector<TimerHandle> handles;
+      handles.reserve(count);
+      UInt64 begin = Timer::getTimeMicroSec();
+      for(unsigned int i=0; i<count; ++i)
+      {
+         handles.push_back(wheel.add(TransactionTimer(offsets[i], Timer::TimerB, tids[i])));
+      }
+      UInt64 inserted = Timer::getTimeMicroSec();
+
+      // Transactions usually end long before their guard timers fire.
+      unsigned int cancelled = 0;
+      for(unsigned int i=0; i<count; i+=2)
+      {
+         if(wheel.cancel(handles[i]))
+         {
+            ++cancelled;
+         }
+      }
+      UInt64 afterCancel = Timer::getTimeMicroSec();
+
+      UInt64 now = base;
+      Count counter(now);
+      while(!wheel.empty())
+      {
+         now += 10;
+         wheel.expire(now, counter);
+      }
+      UInt64 drained = Timer::getTimeMicroSec();
+      resip_assert(counter.mCount + cancelled == count);
+      resip_assert(!wheel.cancel(handles[1]));
+      cout << "wheel: " << count << " timers, insert/s=" << rate(count, inserted-begin)
+           << " cancel/s=" << rate(cancelled, afterCancel-inserted)
+           << " expire/s=" << rate(counter.mCount, drained-afterCancel) << endl;
+   }
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,238 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <cstdio>
+#include <iostream>
+
+#include "resip/stack/ssl/Security.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+// Checks TLS session resumption through Security's contexts: tickets,
+// ticket key rotation, the server session cache shared between contexts
+// and client sessions saved per destination. The handshakes run over
+// in-memory BIO pairs.
+
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+static const char* CertFile = "testTlsSession_cert.pem";
+static const char* KeyFile = "testTlsSession_key.pem";
+
+// A self-signed certificate for localhost.
+static Data
+makeCertificate()
+{
+   EVP_PKEY* key = 0;
+   EVP_PKEY_CTX* keyCtx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, 0);
+   resip_assert(keyCtx);
+   resip_assert(EVP_PKEY_keygen_init(keyCtx) == 1);
+   resip_assert(EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyCtx, NID_X9_62_prime256v1) == 1);
+   resip_assert(EVP_PKEY_keygen(keyCtx, &key) == 1);
+   EVP_PKEY_CTX_free(keyCtx);
+
+   X509* cert = X509_new();
+   ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+   X509_gmtime_adj(X509_get_notBefore(cert), 0);
+   X509_gmtime_adj(X509_get_notAfter(cert), 3600);
+   X509_NAME* name = X509_get_subject_name(cert);
+   X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+   X509_set_issuer_name(cert, name);
+   X509_set_pubkey(cert, key);
+   resip_assert(X509_sign(cert, key, EVP_sha256()) > 0);
+
+   FILE* f = fopen(CertFile, "w");
+   resip_assert(f);
+   PEM_write_X509(f, cert);
+   fclose(f);
+   f = fopen(KeyFile, "w");
+   resip_assert(f);
+   PEM_write_PrivateKey(f, key, 0, 0, 0, 0, 0);
+   fclose(f);
+
+   X509_free(cert);
+   EVP_PKEY_free(key);
+   return Data::fromFile(CertFile);
+}
+
+static unsigned int handshakes = 0;
+
+// Connects a client on clientCtx to a server on serverCtx and returns
+// whether the handshake resumed a session.
+static bool
+connect(Security& security, SSL_CTX* serverCtx, SSL_CTX* clientCtx, const Data& clientKey,
+        int maxVersion = 0)
+{
+   SSL* server = SSL_new(serverCtx);
+   SSL* client = SSL_new(clientCtx);
+   resip_assert(server && client);
+   SSL_set_verify(server, SSL_VERIFY_NONE, 0);
+   if (maxVersion)
+   {
+      SSL_set_max_proto_version(client, maxVersion);
+   }
+
+   BIO* serverBio = 0;
+   BIO* clientBio = 0;
+   resip_assert(BIO_new_bio_pair(&serverBio, 0, &clientBio, 0) == 1);
+   SSL_set_bio(server, serverBio, serverBio);
+   SSL_set_bio(client, clientBio, clientBio);
+
+   SSL_set_accept_state(server);
+   SSL_set_tlsext_host_name(client, "localhost");
+   security.prepareClientSession(client, clientKey);
+   SSL_set_connect_state(client);
+
+   bool clientDone = false;
+   bool serverDone = false;
+   for (int i = 0; i < 10 && !(clientDone && serverDone); ++i)
+   {
+      if (!clientDone)
+      {
+         int ret = SSL_do_handshake(client);
+         clientDone = ret == 1;
+         resip_assert(clientDone || SSL_get_error(client, ret) == SSL_ERROR_WANT_READ);
+      }
+      if (!serverDone)
+      {
+         int ret = SSL_do_handshake(server);
+         serverDone = ret == 1;
+         resip_assert(serverDone || SSL_get_error(server, ret) == SSL_ERROR_WANT_READ);
+      }
+   }
+   resip_assert(clientDone && serverDone);
+   resip_assert(SSL_get_verify_result(client) == X509_V_OK);
+
+   // takes in the tickets a TLS 1.3 server sends after the handshake
+   char buf[1];
+   resip_assert(SSL_read(client, buf, sizeof(buf)) <= 0);
+
+   bool resumed = SSL_session_reused(client) != 0;
+   resip_assert(resumed == (SSL_session_reused(server) != 0));
+   security.onHandshakeDone(client);
+   security.onHandshakeDone(server);
+   handshakes += 2;
+
+   SSL_shutdown(client);
+   SSL_shutdown(server);
+   SSL_free(client);
+   SSL_free(server);
+   return resumed;
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   Security security;
+   security.addRootCertPEM(makeCertificate());
+   SSL_CTX* client = security.getSslCtx();
+   SSL_CTX* first = security.createDomainCtx(SSLv23_method(), "localhost", CertFile, KeyFile, "");
+   SSL_CTX* second = security.createDomainCtx(SSLv23_method(), "localhost", CertFile, KeyFile, "");
+   unsigned int resumptions = 0;
+
+   // tickets: the second connection resumes, also on another transport
+   // for the same domain, and still does once the ticket key has changed
+   resip_assert(!connect(security, first, client, "a"));
+   resip_assert(connect(security, first, client, "a"));
+   resip_assert(connect(security, second, client, "a"));
+   security.rotateTlsTicketKey();
+   resip_assert(connect(security, first, client, "a"));
+   resumptions += 3;
+   // sessions are saved per destination
+   resip_assert(!connect(security, first, client, "b"));
+
+   // without tickets, from the server cache shared between contexts, but
+   // only for the same domain
+   security.setTlsSessionTickets(0);
+   SSL_CTX* third = security.createDomainCtx(SSLv23_method(), "localhost", CertFile, KeyFile, "");
+   SSL_CTX* fourth = security.createDomainCtx(SSLv23_method(), "localhost", CertFile, KeyFile, "");
+   SSL_CTX* other = security.createDomainCtx(SSLv23_method(), "other.example.com", CertFile, KeyFile, "");
+   resip_assert(!connect(security, third, client, "c"));
+   resip_assert(connect(security, fourth, client, "c"));
+   resip_assert(!connect(security, other, client, "c"));
+   resip_assert(!connect(security, third, client, "d", TLS1_2_VERSION));
+   resip_assert(connect(security, fourth, client, "d", TLS1_2_VERSION));
+   resumptions += 2;
+
+   // no client reuse, no resumption
+   security.setTlsClientSessionReuse(false);
+   resip_assert(!connect(security, fourth, client, "d", TLS1_2_VERSION));
+
+   BaseSecurity::TlsSessionStatistics stats;
+   security.getTlsSessionStatistics(stats);
+   resip_assert(stats.resumedHandshakes == 2 * resumptions);
+   resip_assert(stats.fullHandshakes + stats.resumedHandshakes == handshakes);
+
+   SSL_CTX_free(first);
+   SSL_CTX_free(second);
+   SSL_CTX_free(third);
+   SSL_CTX_free(fourth);
+   SSL_CTX_free(other);
+   remove(CertFile);
+   remove(KeyFile);
+
+   cout << "full=" << stats.fullHandshakes << " resumed=" << stats.resumedHandshakes << endl;
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
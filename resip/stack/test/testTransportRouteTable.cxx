@@ -0,0 +1,159 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+#include <vector>
+
+#include "resip/stack/TransportRouteTable.hxx"
+#include "resip/stack/TcpTransport.hxx"
+#include "resip/stack/UdpTransport.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Timer.hxx"
+
+// Checks that TransportRouteTable finds the transports TransportSelector's
+// lookups expect, and measures how fast it answers them.
+
+using namespace resip;
+using namespace std;
+
+static const int BasePort = 27360;
+
+static unsigned int
+rate(unsigned int count, UInt64 ms)
+{
+   return ms ? (unsigned int)(count * 1000ULL / ms) : 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   Fifo<TransactionMessage> fifo;
+   TcpTransport tcp(fifo, BasePort, V4, "127.0.0.1");
+   UdpTransport udp1(fifo, BasePort, V4, StunDisabled, "127.0.0.1");
+   UdpTransport udp2(fifo, BasePort + 1, V4, StunDisabled, "127.0.0.2");
+   UdpTransport udpAny(fifo, BasePort + 2, V4, StunDisabled, Data::Empty);
+   tcp.setKey(1);
+   udp1.setKey(2);
+   udp2.setKey(3);
+   udpAny.setKey(4);
+
+   vector<Transport*> transports;
+   transports.push_back(&tcp);
+   transports.push_back(&udp2);
+   transports.push_back(&udp1);
+   transports.push_back(&udpAny);
+   TransportRouteTable routes(transports);
+   resip_assert(routes.numTransports() == 4);
+
+   resip_assert(routes.findByKey(1) == &tcp);
+   resip_assert(routes.findByKey(4) == &udpAny);
+   resip_assert(routes.findByKey(5) == 0);
+
+   // only one TCP transport, but several UDP ones
+   resip_assert(routes.findOnlyOfType(Tuple("192.0.2.1", 5060, V4, TCP)) == &tcp);
+   resip_assert(routes.findOnlyOfType(Tuple("192.0.2.1", 5060, V4, UDP)) == 0);
+   resip_assert(routes.findOnlyOfType(Tuple("192.0.2.1", 5060, V4, TLS)) == 0);
+
+   resip_assert(routes.findExact(Tuple("127.0.0.2", BasePort + 1, V4, UDP)) == &udp2);
+   resip_assert(routes.findExact(Tuple("127.0.0.2", BasePort, V4, UDP)) == 0);
+   resip_assert(routes.findExact(Tuple("127.0.0.1", BasePort, V4, TCP)) == &tcp);
+   // transports bound to ANY interface are only found by port
+   resip_assert(routes.findExact(Tuple("0.0.0.0", BasePort + 2, V4, UDP)) == 0);
+   resip_assert(routes.findAnyInterface(Tuple("192.0.2.7", BasePort + 2, V4, UDP)) == &udpAny);
+   resip_assert(routes.findAnyInterface(Tuple("192.0.2.7", BasePort + 1, V4, UDP)) == 0);
+
+   resip_assert(routes.findAnyPort(Tuple("127.0.0.1", 0, V4, UDP)) == &udp1);
+   resip_assert(routes.findAnyPort(Tuple("127.0.0.1", 0, V4, TCP)) == &tcp);
+   resip_assert(routes.findAnyPort(Tuple("192.0.2.7", 0, V4, UDP)) == 0);
+   resip_assert(routes.findAnyPortAnyInterface(Tuple("192.0.2.7", 0, V4, UDP)) == &udpAny);
+   resip_assert(routes.findAnyPortAnyInterface(Tuple("192.0.2.7", 0, V4, TCP)) == 0);
+
+   // loopback lookups prefer the lowest address, and rewrite the source
+   Tuple source("127.0.0.9", BasePort + 1, V4, UDP);
+   resip_assert(routes.findLoopback(source, false) == &udp2);
+   resip_assert(source == Tuple("127.0.0.2", BasePort + 1, V4, UDP));
+   source = Tuple("127.0.0.9", 0, V4, UDP);
+   resip_assert(routes.findLoopback(source, true) == &udp1);
+   resip_assert(source == Tuple("127.0.0.1", BasePort, V4, UDP));
+   source = Tuple("127.0.0.9", BasePort + 2, V4, UDP);
+   resip_assert(routes.findLoopback(source, false) == 0);
+
+   resip_assert(routes.findTls(Data::Empty, TLS, V4) == 0);
+
+   const unsigned int lookups = 1000000;
+   Tuple exact("127.0.0.2", BasePort + 1, V4, UDP);
+   Tuple anyPort("192.0.2.7", 0, V4, UDP);
+   unsigned int found = 0;
+   UInt64 begin = Timer::getTimeMs();
+   for (unsigned int i = 0; i < lookups; ++i)
+   {
+      found += routes.findExact(exact) != 0;
+   }
+   UInt64 exactDone = Timer::getTimeMs();
+   for (unsigned int i = 0; i < lookups; ++i)
+   {
+      found += routes.findAnyPortAnyInterface(anyPort) != 0;
+   }
+   UInt64 end = Timer::getTimeMs();
+   resip_assert(found == 2 * lookups);
+
+   cout << "exact lookups/s=" << rate(lookups, exactDone - begin)
+        << ", any port any interface lookups/s=" << rate(lookups, end - exactDone) << endl;
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,208 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "resip/stack/UdpTransport.hxx"
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/Uri.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/DnsUtil.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+// Pushes OPTIONS requests between two loopback UdpTransports, once with one
+// datagram per system call and once batched with recvmmsg/sendmmsg, checking
+// that every request arrives intact and reporting batch occupancy.
+
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+static void
+runBatch(unsigned batchSize, const vector<Data>& encoded, const vector<Data>& callIds)
+{
+   const unsigned flags = RESIP_TRANSPORT_FLAG_RXALL|RESIP_TRANSPORT_FLAG_TXALL;
+   Fifo<TransactionMessage> txFifo;
+   UdpTransport sender(txFifo, 0, V4, StunDisabled, "127.0.0.1", 0, Compression::Disabled, flags);
+   Fifo<TransactionMessage> rxFifo;
+   UdpTransport receiver(rxFifo, 0, V4, StunDisabled, "127.0.0.1", 0, Compression::Disabled, flags);
+   sender.setBatchSize(batchSize);
+   receiver.setBatchSize(batchSize);
+
+   Tuple dest(receiver.getTuple());
+   set<Data> pending(callIds.begin(), callIds.end());
+   const unsigned window = 64;
+
+   UInt64 begin = Timer::getTimeMicroSec();
+   UInt64 giveUp = Timer::getTimeMs() + 20000;
+   size_t next = 0;
+   unsigned outstanding = 0;
+   while (!pending.empty() && Timer::getTimeMs() < giveUp)
+   {
+      while (outstanding < window && next < encoded.size())
+      {
+         sender.send(sender.makeSendData(dest, encoded[next], Data((UInt64)next)));
+         ++next;
+         ++outstanding;
+      }
+
+      FdSet fdset;
+      sender.buildFdSet(fdset);
+      receiver.buildFdSet(fdset);
+      fdset.selectMilliSeconds(100);
+      sender.process(fdset);
+      receiver.process(fdset);
+
+      while (rxFifo.messageAvailable())
+      {
+         Message* msg = rxFifo.getNext();
+         SipMessage* received = dynamic_cast<SipMessage*>(msg);
+         resip_assert(received);
+         resip_assert(received->header(h_RequestLine).method() == OPTIONS);
+         // The sender address came through intact.
+         resip_assert(received->header(h_Vias).front().param(p_rport).port() == sender.getTuple().getPort());
+         size_t erased = pending.erase(received->header(h_CallId).value());
+         resip_assert(erased == 1);
+         --outstanding;
+         delete msg;
+      }
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - begin;
+   if (!pending.empty())
+   {
+      // Loopback should not drop with a window this small, but report
+      // rather than hang if the kernel disagrees.
+      cerr << "batch=" << batchSize << ": " << pending.size() << " requests lost" << endl;
+      resip_assert(0);
+   }
+
+   UdpTransport::BatchStats tx;
+   UdpTransport::BatchStats rx;
+   sender.getBatchStats(tx);
+   receiver.getBatchStats(rx);
+   if (batchSize > 1 && sender.getBatchSize() > 1)
+   {
+      resip_assert(tx.mTxMsgs == encoded.size());
+      resip_assert(rx.mRxMsgs == encoded.size());
+      resip_assert(tx.mTxCalls < tx.mTxMsgs);
+   }
+   else
+   {
+      resip_assert(tx.mTxCalls == 0 && rx.mRxCalls == 0);
+   }
+
+   cout << "batch=" << sender.getBatchSize()
+        << " msgs=" << encoded.size()
+        << " msgs/s=" << (elapsed ? (double)encoded.size() * 1000000.0 / (double)elapsed : 0);
+   if (tx.mTxCalls && rx.mRxCalls)
+   {
+      cout << " tx-occupancy=" << (double)tx.mTxMsgs / tx.mTxCalls
+           << " rx-occupancy=" << (double)rx.mRxMsgs / rx.mRxCalls;
+   }
+   cout << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   unsigned count = 5000;
+   if (argc > 1)
+   {
+      count = atoi(argv[1]);
+   }
+
+   NameAddr target;
+   target.uri().scheme() = "sip";
+   target.uri().user() = "fluffy";
+   target.uri().host() = "localhost";
+   NameAddr from(target);
+   from.uri().user() = "cullen";
+
+   vector<Data> encoded;
+   vector<Data> callIds;
+   encoded.reserve(count);
+   callIds.reserve(count);
+   for (unsigned i=0; i<count; ++i)
+   {
+      auto_ptr<SipMessage> msg(Helper::makeRequest(target, from, OPTIONS));
+      // What the TransportSelector would fill in on the way out.
+      Via& via = msg->header(h_Vias).front();
+      via.transport() = "UDP";
+      via.sentHost() = "127.0.0.1";
+      via.sentPort() = 5060;
+      callIds.push_back(msg->header(h_CallId).value());
+      Data enc;
+      {
+         DataStream strm(enc);
+         msg->encode(strm);
+      }
+      encoded.push_back(enc);
+   }
+
+   runBatch(1, encoded, callIds);
+   runBatch(16, encoded, callIds);
+   runBatch(64, encoded, callIds);
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,277 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+#include <vector>
+
+#include "resip/stack/UdpTransport.hxx"
+#include "resip/stack/TransportThread.hxx"
+#include "resip/stack/Helper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "resip/stack/Uri.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#endif
+
+// Load generator for UdpTransport::setRxShards(): blasts OPTIONS requests
+// from many source ports at one address:port served by 1, 2, 4 and 8
+// SO_REUSEPORT sockets, and reports how many requests per second reach the
+// state machine fifo and how the kernel spread them over the sockets.
+// Rates only scale with the thread count when there are cores to spare.
+
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+static const unsigned int ShardedKey = 7;
+
+class Blaster : public ThreadIf
+{
+   public:
+      Blaster(const Tuple& dest, const vector<Data>& encoded, unsigned sockets)
+         : mDest(dest), mEncoded(encoded), mSent(0)
+      {
+         for (unsigned i=0; i<sockets; ++i)
+         {
+            Socket fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+            resip_assert(fd != INVALID_SOCKET);
+            mFds.push_back(fd);
+         }
+      }
+      virtual ~Blaster()
+      {
+         for (size_t i=0; i<mFds.size(); ++i)
+         {
+            closeSocket(mFds[i]);
+         }
+      }
+
+      virtual void thread()
+      {
+         size_t next = 0;
+         while (!isShutdown())
+         {
+            for (size_t i=0; i<mFds.size(); ++i)
+            {
+               const Data& msg = mEncoded[next++ % mEncoded.size()];
+               if (::sendto(mFds[i], msg.data(), msg.size(), 0,
+                            &mDest.getSockaddr(), mDest.length()) > 0)
+               {
+                  ++mSent;
+               }
+            }
+         }
+      }
+
+      Tuple mDest;
+      const vector<Data>& mEncoded;
+      vector<Socket> mFds;
+      unsigned long mSent;
+};
+
+static double
+runShards(unsigned shards, unsigned durationMs, const vector<Data>& encoded)
+{
+   Fifo<TransactionMessage> rxFifo;
+   UdpTransport transport(rxFifo, 0, V4, StunDisabled, "127.0.0.1", 0,
+                          Compression::Disabled,
+                          RESIP_TRANSPORT_FLAG_REUSEPORT|RESIP_TRANSPORT_FLAG_OWNTHREAD|
+                          RESIP_TRANSPORT_FLAG_RXALL);
+   transport.setKey(ShardedKey);
+   // Batch statistics double as per-socket receive counts.
+   transport.setBatchSize(8);
+   transport.setRxShards(shards);
+   resip_assert(transport.getRxShards() == shards);
+
+   TransportThread thread(transport);
+   thread.run();
+
+   vector<Blaster*> blasters;
+   for (int i=0; i<2; ++i)
+   {
+      blasters.push_back(new Blaster(transport.getTuple(), encoded, 16));
+      blasters.back()->run();
+   }
+
+   unsigned long received = 0;
+   UInt64 begin = Timer::getTimeMs();
+   UInt64 end = begin + durationMs;
+   while (Timer::getTimeMs() < end)
+   {
+      Message* msg = rxFifo.getNext(10);
+      if (msg)
+      {
+         SipMessage* sip = dynamic_cast<SipMessage*>(msg);
+         resip_assert(sip);
+         resip_assert(sip->getReceivedTransportTuple().mTransportKey == ShardedKey);
+         ++received;
+         delete msg;
+      }
+   }
+   UInt64 elapsed = Timer::getTimeMs() - begin;
+
+   unsigned long sent = 0;
+   for (size_t i=0; i<blasters.size(); ++i)
+   {
+      blasters[i]->shutdown();
+      blasters[i]->join();
+      sent += blasters[i]->mSent;
+      delete blasters[i];
+   }
+   thread.shutdown();
+   thread.join();
+
+   vector<unsigned> perSocket;
+   UdpTransport::BatchStats stats;
+   transport.getBatchStats(stats);
+   perSocket.push_back(stats.mRxMsgs);
+   for (unsigned i=0; i+1<shards; ++i)
+   {
+      transport.getRxShard(i).getBatchStats(stats);
+      perSocket.push_back(stats.mRxMsgs);
+   }
+
+   unsigned busy = 0;
+   cout << "threads=" << shards << " sent=" << sent << " received=" << received
+        << " rx/s=" << (elapsed ? received * 1000.0 / elapsed : 0) << " per-socket=";
+   for (size_t i=0; i<perSocket.size(); ++i)
+   {
+      cout << (i ? "/" : "") << perSocket[i];
+      if (perSocket[i])
+      {
+         ++busy;
+      }
+   }
+   cout << endl;
+
+   resip_assert(received > 0);
+   // 32 source ports hash onto more than one socket, barring bad luck that
+   // is not worth guarding against.
+   resip_assert(shards == 1 || busy > 1);
+
+   // drain whatever the shards pushed after we stopped counting
+   while (rxFifo.messageAvailable())
+   {
+      delete rxFifo.getNext();
+   }
+   return elapsed ? received * 1000.0 / elapsed : 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Err, argv[0]);
+
+   unsigned durationMs = 1000;
+   unsigned maxThreads = 8;
+   if (argc > 1)
+   {
+      durationMs = atoi(argv[1]);
+   }
+   if (argc > 2)
+   {
+      maxThreads = atoi(argv[2]);
+   }
+
+   NameAddr target;
+   target.uri().scheme() = "sip";
+   target.uri().user() = "fluffy";
+   target.uri().host() = "localhost";
+   NameAddr from(target);
+   from.uri().user() = "cullen";
+
+   vector<Data> encoded;
+   for (unsigned i=0; i<256; ++i)
+   {
+      auto_ptr<SipMessage> msg(Helper::makeRequest(target, from, OPTIONS));
+      Via& via = msg->header(h_Vias).front();
+      via.transport() = "UDP";
+      via.sentHost() = "127.0.0.1";
+      via.sentPort() = 5060;
+      Data enc;
+      {
+         DataStream strm(enc);
+         msg->encode(strm);
+      }
+      encoded.push_back(enc);
+   }
+
+   double base = 0;
+   for (unsigned shards=1; shards<=maxThreads; shards*=2)
+   {
+      double rate = runShards(shards, durationMs, encoded);
+      if (shards == 1)
+      {
+         base = rate;
+      }
+      else if (base > 0)
+      {
+         cout << "   speedup over 1 thread: " << rate / base << endl;
+      }
+   }
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -3,6 +3,9 @@
 
 #include "rutil/ResipAssert.h"
 #include <deque>
+#include <atomic>
+#include <new>
+#include <stdint.h>
 
 #include "rutil/Mutex.hxx"
 #include "rutil/Condition.hxx"
@@ -116,6 +119,15 @@ class FifoStatsInterface
    (aka template hoist) 
    AbstractFifo's get operations are all threadsafe; AbstractFifo does not 
    define any put operations (these are defined in subclasses).
+
+   By default every add and get takes mMutex. A fifo with a single consumer
+   can instead be put in lock-free mode (see setLockFree()); producers then
+   push onto an intrusive multi-producer/single-consumer list with a single
+   atomic exchange, and only touch mMutex to wake a consumer that is blocked
+   waiting for work. The consumer moves pending items into mFifo whenever it
+   polls, so the existing get operations and FifoStatsInterface metrics 
+   continue to work unchanged. The list nodes are recycled through a bounded
+   lock-free pool, so a steady stream of adds does not go to the allocator.
    @note Users of the resip stack will not need to interact with this class 
       directly in most cases. Look at Fifo and TimeLimitFifo instead.
 
@@ -134,11 +146,23 @@ class AbstractFifo : public FifoStatsInterface
             mLastSampleTakenMicroSec(0),
             mCounter(0),
             mAverageServiceTimeMicroSec(0),
-            mSize(0)
+            mSize(0),
+            mLockFree(false),
+            mLockFreeCount(0),
+            mInboxHead(&mInboxStub),
+            mInboxTail(&mInboxStub),
+            mConsumerWaiting(false)
       {}
 
       virtual ~AbstractFifo()
       {
+         InboxNode* node;
+         while((node=popInbox()) != 0)
+         {
+            InboxItem* item = static_cast<InboxItem*>(node);
+            item->item().~T();
+            delete item;
+         }
       }
 
       /** 
@@ -147,6 +171,10 @@ class AbstractFifo : public FifoStatsInterface
        **/
       bool empty() const
       {
+         if(mLockFree)
+         {
+            return mLockFreeCount.load() == 0;
+         }
          Lock lock(mMutex); (void)lock;
          return mFifo.empty();
       }
@@ -160,6 +188,10 @@ class AbstractFifo : public FifoStatsInterface
        */
       virtual unsigned int size() const
       {
+         if(mLockFree)
+         {
+            return (unsigned int)mLockFreeCount.load();
+         }
          Lock lock(mMutex); (void)lock;
          return (unsigned int)mFifo.size();
       }
@@ -171,6 +203,10 @@ class AbstractFifo : public FifoStatsInterface
        
       bool messageAvailable() const
       {
+         if(mLockFree)
+         {
+            return mLockFreeCount.load() != 0;
+         }
          Lock lock(mMutex); (void)lock;
          return !mFifo.empty();
       }
@@ -187,12 +223,16 @@ class AbstractFifo : public FifoStatsInterface
 
       virtual size_t getCountDepth() const
       {
+         if(mLockFree)
+         {
+            return mLockFreeCount.load();
+         }
          return mSize;
       }
 
       virtual time_t expectedWaitTimeMilliSec() const
       {
-         return ((mAverageServiceTimeMicroSec*mSize)+500)/1000;
+         return ((mAverageServiceTimeMicroSec*AbstractFifo<T>::getCountDepth())+500)/1000;
       }
 
       virtual time_t averageServiceTimeMicroSec() const
@@ -219,7 +259,7 @@ class AbstractFifo : public FifoStatsInterface
          onFifoPolled();
 
          // Wait util there are messages available.
-         while (mFifo.empty())
+         while (emptyForConsumer())
          {
             mCondition.wait(mMutex);
          }
@@ -254,10 +294,11 @@ class AbstractFifo : public FifoStatsInterface
          {
             Lock lock(mMutex); (void)lock;
             onFifoPolled();
-            if (mFifo.empty())	// WATCHOUT: Do not test mSize instead
+            if (emptyForConsumer(false))	// WATCHOUT: Do not test mSize instead
               return false;
             toReturn = mFifo.front();
             mFifo.pop_front();
+            onMessagePopped();
             return true;
          }
 
@@ -267,16 +308,13 @@ class AbstractFifo : public FifoStatsInterface
          onFifoPolled();
 
          // Wait until there are messages available
-         while (mFifo.empty())
+         while (emptyForConsumer())
          {
-            if(ms==0)
-            {
-               return false;
-            }
             const UInt64 now(Timer::getTimeMs());
             if(now >= end)
             {
-                return false;
+               mConsumerWaiting.store(false);
+               return false;
             }
       
             unsigned int timeout((unsigned int)(end - now));
@@ -285,6 +323,7 @@ class AbstractFifo : public FifoStatsInterface
             bool signaled = mCondition.wait(mMutex, timeout);
             if (!signaled)
             {
+               mConsumerWaiting.store(false);
                return false;
             }
          }
@@ -304,7 +343,7 @@ class AbstractFifo : public FifoStatsInterface
          Lock lock(mMutex); (void)lock;
          onFifoPolled();
          resip_assert(other.empty());
-         while (mFifo.empty())
+         while (emptyForConsumer())
          {
             mCondition.wait(mMutex);
          }
@@ -340,17 +379,22 @@ class AbstractFifo : public FifoStatsInterface
          Lock lock(mMutex); (void)lock;
          onFifoPolled();
 
-         // Wait until there are messages available
-         while (mFifo.empty())
+         if(ms < 0)
          {
-            if(ms < 0)
+            if(emptyForConsumer(false))
             {
                return false;
             }
+         }
+
+         // Wait until there are messages available
+         while (emptyForConsumer())
+         {
             const UInt64 now(Timer::getTimeMs());
             if(now >= end)
             {
-                return false;
+               mConsumerWaiting.store(false);
+               return false;
             }
 
             unsigned int timeout((unsigned int)(end - now));
@@ -359,6 +403,7 @@ class AbstractFifo : public FifoStatsInterface
             bool signaled = mCondition.wait(mMutex, timeout);
             if (!signaled)
             {
+               mConsumerWaiting.store(false);
                return false;
             }
          }
@@ -383,6 +428,15 @@ class AbstractFifo : public FifoStatsInterface
 
       size_t add(const T& item)
       {
+         if(mLockFree)
+         {
+            InboxItem* node = allocItem(item);
+            size_t size = mLockFreeCount.fetch_add(1) + 1;
+            pushInbox(node, node);
+            wakeConsumer();
+            return size;
+         }
+
          Lock lock(mMutex); (void)lock;
          mFifo.push_back(item);
          mCondition.signal();
@@ -392,6 +446,30 @@ class AbstractFifo : public FifoStatsInterface
 
       size_t addMultiple(Messages& items)
       {
+         if(mLockFree)
+         {
+            size_t num = items.size();
+            if(num == 0)
+            {
+               return mLockFreeCount.load();
+            }
+            // Link the batch privately, then publish it with one exchange.
+            InboxItem* first = allocItem(items.front());
+            InboxItem* last = first;
+            items.pop_front();
+            while(!items.empty())
+            {
+               InboxItem* node = allocItem(items.front());
+               items.pop_front();
+               last->mNext.store(node, std::memory_order_relaxed);
+               last = node;
+            }
+            size_t size = mLockFreeCount.fetch_add(num) + num;
+            pushInbox(first, last);
+            wakeConsumer();
+            return size;
+         }
+
          Lock lock(mMutex); (void)lock;
          size_t size=items.size();
          if(mFifo.empty())
@@ -413,6 +491,91 @@ class AbstractFifo : public FifoStatsInterface
          return mFifo.size();
       }
 
+      /**
+         @brief Switches this fifo to lock-free producers.
+         @note Only valid for fifos with exactly one consuming thread, and
+            only for subclasses that add through AbstractFifo::add() and
+            AbstractFifo::addMultiple(). Must be called before any producer
+            or consumer touches the fifo.
+      */
+      void setLockFree(bool lockFree)
+      {
+         resip_assert(mFifo.empty() && mLockFreeCount.load() == 0);
+         mLockFree = lockFree;
+         if(mLockFree)
+         {
+            mFreeItems.init(FreeItemPoolSize);
+         }
+      }
+
+      bool isLockFree() const
+      {
+         return mLockFree;
+      }
+
+      /**
+         @brief Moves everything the producers have pushed onto the lock-free
+            inbox into mFifo, preserving order.
+         @note Must be called with mMutex held, from the consumer side.
+      */
+      void drainInbox()
+      {
+         if(!mLockFree)
+         {
+            return;
+         }
+         int num = 0;
+         InboxNode* node;
+         while((node=popInbox()) != 0)
+         {
+            InboxItem* item = static_cast<InboxItem*>(node);
+            mFifo.push_back(item->item());
+            item->item().~T();
+            if(!mFreeItems.push(item))
+            {
+               delete item;
+            }
+            ++num;
+         }
+         if(num)
+         {
+            onMessagePushed(num);
+         }
+      }
+
+      /**
+         @brief Consumer-side emptiness test, made with mMutex held.
+         @details In lock-free mode, this drains the inbox, and if the fifo is
+            still empty (and the caller is about to block) advertises that the
+            consumer is waiting, so that producers know to signal mCondition.
+            The inbox is re-checked after the flag is raised to close the race
+            with a producer that pushed just before seeing the flag.
+      */
+      bool emptyForConsumer(bool willWait=true)
+      {
+         if(!mLockFree)
+         {
+            return mFifo.empty();
+         }
+
+         drainInbox();
+         if(!mFifo.empty() || !willWait)
+         {
+            mConsumerWaiting.store(false);
+            return mFifo.empty();
+         }
+
+         mConsumerWaiting.store(true);
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         drainInbox();
+         if(!mFifo.empty())
+         {
+            mConsumerWaiting.store(false);
+            return false;
+         }
+         return true;
+      }
+
       /** @brief container for FIFO items */
       Messages mFifo;
       /** @brief access serialization lock */
@@ -470,6 +633,10 @@ class AbstractFifo : public FifoStatsInterface
       {
          mCounter+=num;
          mSize-=num;
+         if(mLockFree)
+         {
+            mLockFreeCount.fetch_sub(num);
+         }
       }
 
       virtual void onMessagePushed(int num)
@@ -483,6 +650,227 @@ class AbstractFifo : public FifoStatsInterface
          mSize+=num;
       }
    private:
+      // Intrusive multi-producer/single-consumer list (after Dmitry Vyukov's
+      // design). Producers only ever exchange mInboxHead; the consumer owns
+      // mInboxTail. mInboxStub keeps the list non-empty so that neither side
+      // needs to special-case the last element.
+      class InboxNode
+      {
+         public:
+            InboxNode() : mNext(0) {}
+            std::atomic<InboxNode*> mNext;
+      };
+
+      // The item is constructed in place while the node is on the inbox, and
+      // destroyed when the consumer takes it, so that a pooled node does not
+      // hold on to a copy.
+      class InboxItem : public InboxNode
+      {
+         public:
+            T& item() { return *reinterpret_cast<T*>(mStorage); }
+            alignas(T) unsigned char mStorage[sizeof(T)];
+      };
+
+      // Bounded pool of unused InboxItems (Vyukov's bounded MPMC queue). The
+      // consumer returns nodes to it and producers take them back out; each
+      // cell carries a sequence number, so a cell cannot be reused by a
+      // thread holding a stale position.
+      class FreeItemPool
+      {
+         public:
+            FreeItemPool() : mCells(0), mMask(0), mPushPos(0), mPopPos(0) {}
+
+            ~FreeItemPool()
+            {
+               InboxItem* item;
+               while((item=pop()) != 0)
+               {
+                  delete item;
+               }
+               delete [] mCells;
+            }
+
+            // capacity must be a power of two
+            void init(size_t capacity)
+            {
+               if(mCells)
+               {
+                  return;
+               }
+               mCells = new Cell[capacity];
+               mMask = capacity-1;
+               for(size_t i=0; i<capacity; ++i)
+               {
+                  mCells[i].mSeq.store(i, std::memory_order_relaxed);
+               }
+            }
+
+            bool push(InboxItem* item)
+            {
+               if(!mCells)
+               {
+                  return false;
+               }
+               Cell* cell;
+               size_t pos = mPushPos.load(std::memory_order_relaxed);
+               for(;;)
+               {
+                  cell = &mCells[pos & mMask];
+                  size_t seq = cell->mSeq.load(std::memory_order_acquire);
+                  intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                  if(diff == 0)
+                  {
+                     if(mPushPos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                     {
+                        break;
+                     }
+                  }
+                  else if(diff < 0)
+                  {
+                     return false; // full
+                  }
+                  else
+                  {
+                     pos = mPushPos.load(std::memory_order_relaxed);
+                  }
+               }
+               cell->mItem = item;
+               cell->mSeq.store(pos+1, std::memory_order_release);
+               return true;
+            }
+
+            InboxItem* pop()
+            {
+               if(!mCells)
+               {
+                  return 0;
+               }
+               Cell* cell;
+               size_t pos = mPopPos.load(std::memory_order_relaxed);
+               for(;;)
+               {
+                  cell = &mCells[pos & mMask];
+                  size_t seq = cell->mSeq.load(std::memory_order_acquire);
+                  intptr_t diff = (intptr_t)seq - (intptr_t)(pos+1);
+                  if(diff == 0)
+                  {
+                     if(mPopPos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                     {
+                        break;
+                     }
+                  }
+                  else if(diff < 0)
+                  {
+                     return 0; // empty
+                  }
+                  else
+                  {
+                     pos = mPopPos.load(std::memory_order_relaxed);
+                  }
+               }
+               InboxItem* item = cell->mItem;
+               cell->mSeq.store(pos+mMask+1, std::memory_order_release);
+               return item;
+            }
+
+         private:
+            class Cell
+            {
+               public:
+                  Cell() : mSeq(0), mItem(0) {}
+                  std::atomic<size_t> mSeq;
+                  InboxItem* mItem;
+            };
+
+            Cell* mCells;
+            size_t mMask;
+            // padded apart, since producers contend on mPopPos only
+            std::atomic<size_t> mPushPos;
+            char mPad[64];
+            std::atomic<size_t> mPopPos;
+
+            FreeItemPool(const FreeItemPool&);
+            FreeItemPool& operator=(const FreeItemPool&);
+      };
+
+      static const size_t FreeItemPoolSize = 1024;
+
+      InboxItem* allocItem(const T& item)
+      {
+         InboxItem* node = mFreeItems.pop();
+         if(!node)
+         {
+            node = new InboxItem;
+         }
+         new (node->mStorage) T(item);
+         return node;
+      }
+
+      void pushInbox(InboxNode* first, InboxNode* last)
+      {
+         last->mNext.store(0, std::memory_order_relaxed);
+         InboxNode* prev = mInboxHead.exchange(last, std::memory_order_acq_rel);
+         prev->mNext.store(first, std::memory_order_release);
+      }
+
+      InboxNode* popInbox()
+      {
+         InboxNode* tail = mInboxTail;
+         InboxNode* next = tail->mNext.load(std::memory_order_acquire);
+         if(tail == &mInboxStub)
+         {
+            if(next == 0)
+            {
+               return 0;
+            }
+            mInboxTail = next;
+            tail = next;
+            next = next->mNext.load(std::memory_order_acquire);
+         }
+
+         if(next)
+         {
+            mInboxTail = next;
+            return tail;
+         }
+
+         if(tail != mInboxHead.load(std::memory_order_acquire))
+         {
+            // A producer is between its exchange and its link; it will wake 
+            // us if we end up blocking.
+            return 0;
+         }
+
+         pushInbox(&mInboxStub, &mInboxStub);
+         next = tail->mNext.load(std::memory_order_acquire);
+         if(next)
+         {
+            mInboxTail = next;
+            return tail;
+         }
+         return 0;
+      }
+
+      void wakeConsumer()
+      {
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         if(mConsumerWaiting.load())
+         {
+            Lock lock(mMutex); (void)lock;
+            mCondition.signal();
+         }
+      }
+
+      bool mLockFree;
+      // Items in mFifo plus items still on the inbox; only used in lock-free 
+      // mode.
+      std::atomic<size_t> mLockFreeCount;
+      std::atomic<InboxNode*> mInboxHead;
+      InboxNode* mInboxTail;
+      InboxNode mInboxStub;
+      std::atomic<bool> mConsumerWaiting;
+      FreeItemPool mFreeItems;
+
       // no value semantics
       AbstractFifo(const AbstractFifo&);
       AbstractFifo& operator=(const AbstractFifo&);
@@ -0,0 +1,183 @@
+#ifndef ArenaPool_Include_Guard
+#define ArenaPool_Include_Guard
+
+#include <limits>
+#include <memory>
+#include <stddef.h>
+
+#include "rutil/PoolBase.hxx"
+
+namespace resip
+{
+/**
+   A DinkyPool that grows. The first S bytes are carved out of storage inside
+   the ArenaPool itself; once those are used up, further allocations are carved
+   out of heap chunks of ChunkSize bytes, at most MaxChunks of them. Like
+   DinkyPool, deallocating does not free up room; everything is released in
+   one go when the ArenaPool goes away. This makes it a good fit for objects
+   like SipMessage that make many small allocations while parsing and free
+   them all at once, since a whole message then costs a handful of chunk
+   allocations instead of one per parser object.
+
+   Requests larger than a quarter of a chunk, and everything once MaxChunks
+   chunks are in use, fall back to the system new/delete, so a long-lived
+   object that keeps reallocating cannot grow the arena without bound.
+*/
+template<unsigned int S, unsigned int ChunkSize=4096, unsigned int MaxChunks=16>
+class ArenaPool : public PoolBase
+{
+   public:
+      ArenaPool() :
+         count(0),
+         mChunks(0),
+         mChunkUsed(ChunkSize),
+         mChunkCount(0),
+         heapBytes(0),
+         heapAllocations(0)
+      {}
+
+      ~ArenaPool()
+      {
+         while(mChunks)
+         {
+            Chunk* next = mChunks->mNext;
+            ::operator delete(mChunks);
+            mChunks = next;
+         }
+      }
+
+      void* allocate(size_t size)
+      {
+         size_t rounded = (size+7) & ~(size_t)7;
+         if((8*count)+size <= S)
+         {
+            void* result=mBuf[count];
+            count+=rounded/8;
+            return result;
+         }
+
+         if(rounded <= ChunkSize/4)
+         {
+            if(mChunkUsed + rounded > ChunkSize && mChunkCount < MaxChunks)
+            {
+               Chunk* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk)));
+               chunk->mNext = mChunks;
+               mChunks = chunk;
+               mChunkUsed = 0;
+               ++mChunkCount;
+            }
+            if(mChunks && mChunkUsed + rounded <= ChunkSize)
+            {
+               void* result = mChunks->mBuf[mChunkUsed/8];
+               mChunkUsed += rounded;
+               return result;
+            }
+         }
+
+         heapBytes += size;
+         ++heapAllocations;
+         return ::operator new(size);
+      }
+
+      void deallocate(void* ptr)
+      {
+         if(ptr >= (void*)mBuf[0] && ptr < (void*)mBuf[(S+7)/8])
+         {
+            return;
+         }
+         for(Chunk* chunk = mChunks; chunk; chunk = chunk->mNext)
+         {
+            if(ptr >= (void*)chunk->mBuf[0] && ptr < (void*)chunk->mBuf[ChunkSize/8])
+            {
+               return;
+            }
+         }
+         ::operator delete(ptr);
+      }
+
+      size_t max_size() const
+      {
+         return std::numeric_limits<size_t>::max();
+      }
+
+      size_t getHeapBytes() const { return heapBytes; }
+      size_t getHeapAllocations() const { return heapAllocations; }
+      size_t getChunkCount() const { return mChunkCount; }
+      size_t getPoolBytes() const
+      {
+         return count*8 + (mChunkCount ? (mChunkCount-1)*ChunkSize + mChunkUsed : 0);
+      }
+      size_t getPoolSizeBytes() const { return sizeof(mBuf) + mChunkCount*ChunkSize; }
+
+   private:
+      // disabled
+      ArenaPool& operator=(const ArenaPool& rhs);
+      ArenaPool(const ArenaPool& other);
+
+      struct Chunk
+      {
+         Chunk* mNext;
+         char mBuf[ChunkSize/8][8]; // 8-byte chunks for alignment
+      };
+
+      size_t count; // 8-byte chunks alloced so far
+      char mBuf[(S+7)/8][8]; // 8-byte chunks for alignment
+      Chunk* mChunks; // most recent first
+      size_t mChunkUsed; // bytes used in the most recent chunk
+      size_t mChunkCount;
+      size_t heapBytes;
+      size_t heapAllocations;
+};
+
+}
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
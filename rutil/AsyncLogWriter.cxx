@@ -0,0 +1,266 @@
+#include <ostream>
+
+#include "rutil/AsyncLogWriter.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Subsystem.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+
+AsyncLogWriter::Ring::Ring(size_t capacity) :
+   mRecords(capacity),
+   mMask(capacity-1),
+   mHead(0),
+   mTail(0),
+   mOrphaned(false)
+{
+   resip_assert((capacity & mMask) == 0);
+}
+
+void
+AsyncLogWriter::WriterThread::thread()
+{
+   while (!isShutdown())
+   {
+      {
+         Lock lock(mWriter.mWakeMutex);
+         if (!isShutdown())
+         {
+            mWriter.mWakeCondition.wait(mWriter.mWakeMutex, FlushIntervalMs);
+         }
+      }
+      mWriter.drain();
+   }
+}
+
+AsyncLogWriter::AsyncLogWriter() :
+   mDroppedReported(0),
+   mRunning(false),
+   mDropped(0),
+   mRecordsPerThread(0),
+   mThread(0)
+{
+   ThreadIf::tlsKeyCreate(mRingKey, orphanRing);
+}
+
+AsyncLogWriter::~AsyncLogWriter()
+{
+   stop();
+   ThreadIf::tlsKeyDelete(mRingKey);
+   for (std::vector<Ring*>::iterator i = mRings.begin(); i != mRings.end(); ++i)
+   {
+      delete *i;
+   }
+}
+
+void
+AsyncLogWriter::start(unsigned int recordsPerThread)
+{
+   resip_assert(!mThread);
+   size_t capacity = 16;
+   while (capacity < recordsPerThread)
+   {
+      capacity <<= 1;
+   }
+   mRecordsPerThread = capacity;
+   mThread = new WriterThread(*this);
+   mRunning.store(true, std::memory_order_release);
+   mThread->run();
+}
+
+void
+AsyncLogWriter::stop()
+{
+   if (!mThread)
+   {
+      return;
+   }
+   mRunning.store(false, std::memory_order_release);
+   mThread->shutdown();
+   wake();
+   mThread->join();
+   delete mThread;
+   mThread = 0;
+   drain();
+}
+
+bool
+AsyncLogWriter::push(Log::ThreadData& logger, Log::Level level, const Data& record)
+{
+   Ring* ring = threadRing();
+   size_t tail = ring->mTail.load(std::memory_order_relaxed);
+   size_t queued = tail - ring->mHead.load(std::memory_order_acquire);
+   if (queued > ring->mMask)
+   {
+      mDropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+   }
+
+   Record& r = ring->mRecords[tail & ring->mMask];
+   r.mLogger = &logger;
+   r.mLevel = level;
+   r.mText = record;
+   ring->mTail.store(tail+1, std::memory_order_release);
+
+   if (queued+1 == (ring->mMask+1)/2)
+   {
+      wake();
+   }
+   return true;
+}
+
+void
+AsyncLogWriter::flush()
+{
+   drain();
+}
+
+AsyncLogWriter::Ring*
+AsyncLogWriter::threadRing()
+{
+   Ring* ring = static_cast<Ring*>(ThreadIf::tlsGetValue(mRingKey));
+   if (!ring)
+   {
+      ring = new Ring(mRecordsPerThread);
+      {
+         Lock lock(mRingsMutex);
+         mRings.push_back(ring);
+      }
+      ThreadIf::tlsSetValue(mRingKey, ring);
+   }
+   return ring;
+}
+
+void
+AsyncLogWriter::drain()
+{
+   Lock drainLock(mDrainMutex);
+   {
+      Lock lock(mRingsMutex);
+      mDrainRings = mRings;
+   }
+
+   {
+      Lock logLock(Log::_mutex);
+      mTouched.clear();
+      for (std::vector<Ring*>::iterator i = mDrainRings.begin(); i != mDrainRings.end(); ++i)
+      {
+         Ring& ring = **i;
+         size_t head = ring.mHead.load(std::memory_order_relaxed);
+         size_t tail = ring.mTail.load(std::memory_order_acquire);
+         for (; head != tail; ++head)
+         {
+            Record& r = ring.mRecords[head & ring.mMask];
+            std::ostream* strm = &Log::writeRecord(*r.mLogger, r.mLevel, r.mText, false);
+            if (mTouched.empty() || mTouched.back() != strm)
+            {
+               mTouched.push_back(strm);
+            }
+         }
+         ring.mHead.store(head, std::memory_order_release);
+      }
+
+      UInt64 dropped = getDroppedCount();
+      if (dropped != mDroppedReported)
+      {
+         Data report;
+         {
+            DataStream ds(report);
+            Log::tags(Log::Warning, Subsystem::NONE, __FILE__, __LINE__, ds);
+            ds << Log::delim << "Logging is falling behind; dropped "
+               << (dropped - mDroppedReported) << " log records ("
+               << dropped << " in total)";
+         }
+         mTouched.push_back(&Log::writeRecord(Log::mDefaultLoggerData, Log::Warning, report, false));
+         mDroppedReported = dropped;
+      }
+
+      for (std::vector<std::ostream*>::iterator i = mTouched.begin(); i != mTouched.end(); ++i)
+      {
+         (*i)->flush();
+      }
+   }
+
+   // Rings of threads that have exited can go once they are empty.
+   Lock lock(mRingsMutex);
+   std::vector<Ring*>::iterator i = mRings.begin();
+   while (i != mRings.end())
+   {
+      Ring* ring = *i;
+      if (ring->mOrphaned.load(std::memory_order_acquire) &&
+          ring->mHead.load(std::memory_order_relaxed) == ring->mTail.load(std::memory_order_acquire))
+      {
+         delete ring;
+         i = mRings.erase(i);
+      }
+      else
+      {
+         ++i;
+      }
+   }
+}
+
+void
+AsyncLogWriter::wake()
+{
+   Lock lock(mWakeMutex);
+   mWakeCondition.signal();
+}
+
+void
+AsyncLogWriter::orphanRing(void* ring)
+{
+   static_cast<Ring*>(ring)->mOrphaned.store(true, std::memory_order_release);
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
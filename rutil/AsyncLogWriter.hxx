@@ -0,0 +1,163 @@
+#ifndef RESIP_AsyncLogWriter_hxx
+#define RESIP_AsyncLogWriter_hxx
+
+#include <atomic>
+#include <iosfwd>
+#include <vector>
+
+#include "rutil/Log.hxx"
+#include "rutil/Condition.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/ThreadIf.hxx"
+
+namespace resip
+{
+
+/**
+   @internal
+
+   @brief Writes log records on behalf of Log when asynchronous logging is
+   enabled; see Log::startAsyncWriter().
+
+   Every thread that logs gets its own single-producer ring of records, so
+   logging threads never wait for each other or for the output. The formatted
+   record is copied into ring storage that is reused once it has been written,
+   so a warmed-up ring does not allocate. The writer thread wakes up every
+   FlushIntervalMs, or sooner once a ring is half full, and writes everything
+   that is queued in one batch.
+
+   When a ring is full the record is dropped and counted; the writer reports
+   the number of dropped records through the default logger.
+*/
+class AsyncLogWriter
+{
+   public:
+      enum { FlushIntervalMs = 100 };
+
+      AsyncLogWriter();
+      ~AsyncLogWriter();
+
+      /// Starts the writer thread. recordsPerThread (rounded up to a power of
+      /// two) sizes the rings of threads that have not logged yet.
+      void start(unsigned int recordsPerThread);
+      /// Stops the writer thread and writes whatever is still queued.
+      void stop();
+      bool isRunning() const { return mRunning.load(std::memory_order_acquire); }
+
+      /// Queues a copy of record for the calling thread.
+      /// @return false if the record was dropped because the ring is full
+      bool push(Log::ThreadData& logger, Log::Level level, const Data& record);
+
+      /// Writes everything queued so far before returning.
+      void flush();
+
+      UInt64 getDroppedCount() const { return mDropped.load(std::memory_order_relaxed); }
+
+   private:
+      class Record
+      {
+         public:
+            Record() : mLogger(0), mLevel(Log::Info) {}
+            Log::ThreadData* mLogger;
+            Log::Level mLevel;
+            Data mText;
+      };
+
+      class Ring
+      {
+         public:
+            explicit Ring(size_t capacity);
+
+            std::vector<Record> mRecords;
+            const size_t mMask;
+            std::atomic<size_t> mHead;   // next record to write; advanced by the writer
+            std::atomic<size_t> mTail;   // next free record; advanced by the owning thread
+            std::atomic<bool> mOrphaned; // the owning thread has exited
+      };
+
+      class WriterThread : public ThreadIf
+      {
+         public:
+            explicit WriterThread(AsyncLogWriter& writer) : mWriter(writer) {}
+            virtual void thread();
+         private:
+            AsyncLogWriter& mWriter;
+      };
+
+      Ring* threadRing();
+      void drain();
+      void wake();
+      static void orphanRing(void* ring);
+
+      ThreadIf::TlsKey mRingKey;
+      Mutex mRingsMutex;
+      std::vector<Ring*> mRings;            // guarded by mRingsMutex
+      Mutex mDrainMutex;                    // only one thread drains at a time
+      std::vector<Ring*> mDrainRings;       // guarded by mDrainMutex
+      std::vector<std::ostream*> mTouched;  // guarded by mDrainMutex
+      UInt64 mDroppedReported;              // guarded by mDrainMutex
+      Mutex mWakeMutex;
+      Condition mWakeCondition;
+      std::atomic<bool> mRunning;
+      std::atomic<UInt64> mDropped;
+      size_t mRecordsPerThread;
+      WriterThread* mThread;
+
+      // no value semantics
+      AsyncLogWriter(const AsyncLogWriter&);
+      AsyncLogWriter& operator=(const AsyncLogWriter&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,169 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <atomic>
+#include <string.h>
+
+#include "rutil/DataIntern.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Mutex.hxx"
+
+using namespace resip;
+
+// Open addressing with linear probing. Entries are only ever added, so a
+// reader that finds an empty slot knows the key is not in the table. The
+// table is kept at most three quarters full, so probes are short and always
+// end at an empty slot.
+//
+// Everything here is zero-initialized static storage, so the table works
+// from static constructors in other translation units (ExtensionHeader and
+// ExtensionParameter objects are usually file-scope statics).
+
+static std::atomic<const Data*> internSlots[DataIntern::Capacity];
+static std::atomic<size_t> internCount;
+
+static const size_t InternSlotMask = DataIntern::Capacity - 1;
+static const size_t InternMaxCount = DataIntern::Capacity / 4 * 3;
+
+static Mutex&
+internMutex()
+{
+   static Mutex mutex;
+   return mutex;
+}
+
+static inline size_t
+internHash(const char* buf, Data::size_type length)
+{
+   return Data::rawHash(reinterpret_cast<const unsigned char*>(buf), length);
+}
+
+static inline bool
+internMatches(const Data* entry, const char* buf, Data::size_type length)
+{
+   return entry->size() == length && memcmp(entry->data(), buf, length) == 0;
+}
+
+const Data*
+DataIntern::find(const char* buf, Data::size_type length)
+{
+   for (size_t slot = internHash(buf, length) & InternSlotMask; ;
+        slot = (slot + 1) & InternSlotMask)
+   {
+      const Data* entry = internSlots[slot].load(std::memory_order_acquire);
+      if (entry == 0)
+      {
+         return 0;
+      }
+      if (internMatches(entry, buf, length))
+      {
+         return entry;
+      }
+   }
+}
+
+const Data*
+DataIntern::intern(const char* buf, Data::size_type length)
+{
+   const Data* entry = find(buf, length);
+   if (entry)
+   {
+      return entry;
+   }
+
+   Lock lock(internMutex());
+   size_t slot = internHash(buf, length) & InternSlotMask;
+   for (;;)
+   {
+      // Someone else may have added it (or something else) since find().
+      entry = internSlots[slot].load(std::memory_order_relaxed);
+      if (entry == 0)
+      {
+         break;
+      }
+      if (internMatches(entry, buf, length))
+      {
+         return entry;
+      }
+      slot = (slot + 1) & InternSlotMask;
+   }
+
+   if (internCount.load(std::memory_order_relaxed) >= InternMaxCount)
+   {
+      return 0;
+   }
+   entry = new Data(buf, length);
+   internSlots[slot].store(entry, std::memory_order_release);
+   internCount.fetch_add(1, std::memory_order_relaxed);
+   return entry;
+}
+
+bool
+DataIntern::assign(Data& target, const char* buf, Data::size_type length)
+{
+   const Data* entry = find(buf, length);
+   if (entry)
+   {
+      target.setBuf(Data::Share, entry->data(), entry->size());
+      return true;
+   }
+   target.copy(buf, length);
+   return false;
+}
+
+size_t
+DataIntern::size()
+{
+   return internCount.load(std::memory_order_relaxed);
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,103 @@
+#ifndef RESIP_DataIntern_hxx
+#define RESIP_DataIntern_hxx
+
+#include "rutil/Data.hxx"
+
+namespace resip
+{
+
+/**
+   @brief A process-wide table of interned Data.
+
+   Tokens that show up over and over in messages (extension header names,
+   extension parameter names, and the like) can be interned once; after that,
+   a Data that needs to hold one of them can share the interned copy instead
+   of copying the text into its own buffer, which costs an allocation as soon
+   as the token is longer than the Data's local buffer.
+
+   Lookups never lock and may run in any thread. Adding entries takes a
+   mutex. Interned copies are never freed, and the table has a fixed
+   capacity, so only intern tokens from a fixed vocabulary: never intern
+   text taken off the wire. Lookups are exact, including case.
+*/
+class DataIntern
+{
+   public:
+      enum { Capacity = 1024 };
+
+      /// Returns the interned copy of buf, interning it first if needed.
+      /// @return 0 if the table is full
+      static const Data* intern(const char* buf, Data::size_type length);
+      static const Data* intern(const Data& data)
+      {
+         return intern(data.data(), data.size());
+      }
+
+      /// Returns the interned copy of buf, or 0 if it has not been interned.
+      static const Data* find(const char* buf, Data::size_type length);
+
+      /// Makes target share the interned copy of buf if there is one, and
+      /// copies buf into target otherwise.
+      /// @return true if target shares the interned copy
+      static bool assign(Data& target, const char* buf, Data::size_type length);
+
+      /// The number of interned entries.
+      static size_t size();
+
+   private:
+      DataIntern();
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -12,6 +12,25 @@
 #  include <sys/epoll.h>
 #endif
 
+#ifdef RESIP_POLL_IMPL_URING
+#  include <errno.h>
+#  include <poll.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <linux/io_uring.h>
+// The C library may predate io_uring; the numbers are the same on every
+// architecture but alpha.
+#  if !defined(__NR_io_uring_setup)
+#    define __NR_io_uring_setup 425
+#    define __NR_io_uring_enter 426
+#  endif
+// Timed waits need the Linux 5.11 interface.
+#  if !defined(IORING_FEAT_EXT_ARG)
+#    undef RESIP_POLL_IMPL_URING
+#  endif
+#endif
+
 using namespace resip;
 #define RESIPROCATE_SUBSYSTEM Subsystem::SIP
 
@@ -25,6 +44,12 @@ FdPollItemIf::~FdPollItemIf()
 {
 }
 
+void
+FdPollItemIf::processIoCompletion(FdPollIo& io)
+{
+   resip_assert(0);     // submitIo() needs an override of this
+}
+
 FdPollItemBase::FdPollItemBase(FdPollGrp *grp, Socket fd, FdPollEventMask mask) :
   mPollGrp(grp), mPollSocket(fd), mPollHandle(0)
 {
@@ -83,12 +108,37 @@ FdPollGrp::processItem(FdPollItemIf *item, FdPollEventMask mask)
     */
 }
 
+void
+FdPollGrp::processItemIo(FdPollItemIf *item, FdPollIo& io)
+{
+   try
+   {
+      item->processIoCompletion(io);
+   }
+   catch(BaseException& e)
+   {
+       ErrLog(<<"Exception thrown for FdPollItem: " << e);
+   }
+}
+
 int
 FdPollGrp::getEPollFd() const
 {
    return -1;
 }
 
+bool
+FdPollGrp::canSubmitIo() const
+{
+   return false;
+}
+
+bool
+FdPollGrp::submitIo(FdPollItemHandle handle, FdPollIo& io)
+{
+   return false;
+}
+
 /*****************************************************************
  *
  * FdPollImplFdSet
@@ -1221,42 +1271,1145 @@ FdPollImplEpoll::epollWait(int waitMs)
 
 /*****************************************************************
  *
- * Factory
+ * FdPollImplURing
  *
  *****************************************************************/
 
-/*static*/FdPollGrp*
-FdPollGrp::create(const char *implName)
+#ifdef RESIP_POLL_IMPL_URING
+
+/**
+  This is an implementation built around io_uring poll requests. It
+  reports the same readiness events as the epoll implementation, but
+  adding a socket, or changing the events it is polled for, only queues a
+  request on the submission ring; the queued requests go to the kernel
+  with the next wait, in the same io_uring_enter() call that collects the
+  completions.
+
+  Items can also hand their socket reads and writes to the ring
+  (submitIo()): they are queued as recvmsg/sendmsg requests, and the ring
+  reports them done instead of reporting the socket ready. Any number of
+  them go to the kernel, and come back, in the one io_uring_enter() call
+  per wait, rather than one recv()/send() call each.
+
+  Poll requests are one-shot and are re-armed once the item has processed
+  its event. FPEM_Edge is not needed for that and is ignored. Each request
+  carries its fd and a per-fd generation in user_data, so completions for
+  an item that has since been deleted (or replaced by a new item on a
+  reused fd) are recognized and dropped.
+
+  Requires Linux 5.11 (IORING_FEAT_EXT_ARG for timed waits); create()
+  returns 0 on older kernels, or where io_uring has been disabled. If
+  io_uring_enter() later fails in a way that retrying will not fix, the
+  group moves its items to an epoll group and carries on through that
+  (see fallBack()).
+**/
+
+namespace resip
 {
-   if ( implName==0 || implName[0]==0 || strcmp(implName,"event")==0 )
-      implName = 0;     // pick the first (best) one supported
-#ifdef RESIP_POLL_IMPL_EPOLL
-   if ( implName==0 || strcmp(implName,"epoll")==0 )
+
+class FdPollImplURing : public FdPollGrp
+{
+   public:
+      static FdPollImplURing* create();
+      ~FdPollImplURing();
+
+      virtual const char*       getImplName() const { return "uring"; }
+      virtual ImplType getImplType() const { return URingImpl; }
+
+      virtual FdPollItemHandle  addPollItem(Socket fd,
+                                  FdPollEventMask newMask, FdPollItemIf *item);
+      virtual void              modPollItem(FdPollItemHandle handle,
+                                  FdPollEventMask newMask);
+      virtual void              delPollItem(FdPollItemHandle handle);
+      virtual bool              canSubmitIo() const { return mFallback == 0; }
+      virtual bool              submitIo(FdPollItemHandle handle, FdPollIo& io);
+      virtual void registerFdSetIOObserver(FdSetIOObserver& observer);
+      virtual void unregisterFdSetIOObserver(FdSetIOObserver& observer);
+
+      virtual bool              waitAndProcess(int ms=0);
+      virtual void buildFdSet(FdSet& fdSet);
+      virtual bool processFdSet(FdSet& fdset);
+
+   protected:
+      enum { SubmitEntries = 256, CompleteEntries = 4096 };
+
+      class Item
+      {
+         public:
+            Item() : mItem(0), mMask(0), mGeneration(0), mArmed(false),
+               mIoPending(0) {}
+            FdPollItemIf*   mItem;
+            FdPollEventMask mMask;
+            UInt32          mGeneration;
+            bool            mArmed;    // a poll request is outstanding
+            unsigned        mIoPending; // submitIo() requests not yet reported
+      };
+
+      class IoSlot
+      {
+         public:
+            IoSlot() : mIo(0), mFd(-1) {}
+            FdPollIo*       mIo;       // 0 if the slot is free
+            int             mFd;
+      };
+
+      // while requests outstanding on a failed ring are waited for, the
+      // fallback group waits no longer than this between checks
+      enum { DrainWaitMs = 100 };
+
+      FdPollImplURing();
+      bool setup();
+      void push(const struct io_uring_sqe& sqe);
+      void writeSqe(const struct io_uring_sqe& sqe);
+      unsigned pending() const;
+      int enterRing(unsigned minComplete, int waitMs);
+      bool enter(unsigned minComplete, int waitMs);
+      void fallBack(int err);
+      bool cancelOutstandingIo();
+      bool ioOutstanding() const;
+      void closeRing();
+      void arm(int fd);
+      void disarm(int fd);
+      unsigned reap(std::vector<struct io_uring_cqe>& cqes);
+      FdPollIo* finishIo(unsigned slot);
+      void dropIo(std::vector<struct io_uring_cqe>& cqes, int fd);
+      void cancelIo(int fd);
+      bool uringWait(int waitMs);
+
+      std::vector<Item>           mItems; // indexed by fd
+      std::vector<IoSlot>         mIo;    // indexed by request slot
+      std::vector<unsigned>       mFreeIo;
+      std::vector<FdSetIOObserver*> mFdSetObservers;
+      std::vector<struct io_uring_cqe> mCqeCache;
+      // reaped while cancelling an item's requests, handed out next wait
+      std::vector<struct io_uring_cqe> mDeferredCqes;
+      // takes over once the ring has failed; see fallBack()
+      FdPollImplEpoll*          mFallback;
+
+      int                       mRingFd;        // from io_uring_setup()
+      void*                     mSqRing;
+      size_t                    mSqRingSize;
+      void*                     mCqRing;
+      size_t                    mCqRingSize;
+      struct io_uring_sqe*      mSqes;
+      size_t                    mSqesSize;
+      unsigned*                 mSqHead;
+      unsigned*                 mSqTail;
+      unsigned*                 mSqFlags;
+      unsigned*                 mSqArray;
+      unsigned                  mSqMask;
+      unsigned                  mSqEntries;
+      unsigned*                 mCqHead;
+      unsigned*                 mCqTail;
+      struct io_uring_cqe*      mCqes;
+      unsigned                  mCqMask;
+      unsigned                  mCqEntries;
+};
+
+};      // namespace
+
+// user_data of the POLL_REMOVE and ASYNC_CANCEL requests themselves;
+// never a valid fd.
+static const UInt64 URingRemoveUserData = ~(UInt64)0;
+// Marks submitIo() requests, which carry their slot in place of the
+// generation. Never set for a poll request, since an fd is not negative.
+static const UInt64 URingIoFlag = 0x80000000;
+
+static inline UInt64
+URingUserData(int fd, UInt32 generation)
+{
+   return ((UInt64)generation << 32) | (UInt32)fd;
+}
+
+static inline UInt64
+URingIoUserData(int fd, unsigned slot)
+{
+   return ((UInt64)slot << 32) | URingIoFlag | (UInt32)fd;
+}
+
+static inline bool
+URingIsIo(UInt64 userData)
+{
+   return userData != URingRemoveUserData && (userData & URingIoFlag) != 0;
+}
+
+static inline int
+URingFd(UInt64 userData)
+{
+   return (int)(userData & (URingIoFlag-1));
+}
+
+static inline unsigned short
+CvtURingToUsrMask(int sysMask)
+{
+   unsigned usrMask = 0;
+   if(sysMask & POLLIN)  usrMask |= FPEM_Read;
+   if(sysMask & POLLOUT) usrMask |= FPEM_Write;
+   if(sysMask & (POLLERR|POLLHUP)) usrMask |= FPEM_Error|FPEM_Read|FPEM_Write;
+   // NOTE: above, fake read and write if error to encourage
+   // apps to actually do something about it
+   return usrMask;
+}
+
+static inline unsigned short
+CvtUsrToURingMask(unsigned short usrMask)
+{
+   unsigned short sysMask = 0;
+   if(usrMask & FPEM_Read)  sysMask |= POLLIN;
+   if(usrMask & FPEM_Write) sysMask |= POLLOUT;
+   return sysMask;
+}
+
+FdPollImplURing*
+FdPollImplURing::create()
+{
+   FdPollImplURing* grp = new FdPollImplURing();
+   if (!grp->setup())
    {
-      return new FdPollImplEpoll();
+      delete grp;
+      return 0;
    }
-#endif
-#ifdef RESIP_POLL_IMPL_POLL
-   if ( implName==0 || strcmp(implName,"poll")==0 )
+   return grp;
+}
+
+FdPollImplURing::FdPollImplURing() :
+   mFallback(0),
+   mRingFd(-1),
+   mSqRing(MAP_FAILED), mSqRingSize(0),
+   mCqRing(MAP_FAILED), mCqRingSize(0),
+   mSqes((struct io_uring_sqe*)MAP_FAILED), mSqesSize(0),
+   mSqHead(0), mSqTail(0), mSqFlags(0), mSqArray(0), mSqMask(0), mSqEntries(0),
+   mCqHead(0), mCqTail(0), mCqes(0), mCqMask(0), mCqEntries(0)
+{
+}
+
+bool
+FdPollImplURing::setup()
+{
+   struct io_uring_params params;
+   memset(&params, 0, sizeof(params));
+   params.flags = IORING_SETUP_CQSIZE;
+   params.cq_entries = CompleteEntries;
+   if ( (mRingFd = (int)syscall(__NR_io_uring_setup, SubmitEntries, &params)) < 0 )
    {
-      return new FdPollImplPoll();
+      InfoLog(<<"io_uring_setup() failed: "<<strerror(errno));
+      return false;
    }
-#endif
-   if ( implName==0 || strcmp(implName,"fdset")==0 )
+   if (!(params.features & IORING_FEAT_EXT_ARG))
    {
-      return new FdPollImplFdSet();
+      InfoLog(<<"io_uring does not support timed waits (needs Linux 5.11)");
+      return false;
    }
-   resip_assert(0);
-   return NULL;
+
+   mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+   mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+   bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+   if (singleMmap)
+   {
+      mSqRingSize = mCqRingSize = resipMax(mSqRingSize, mCqRingSize);
+   }
+   mSqRing = mmap(0, mSqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                  mRingFd, IORING_OFF_SQ_RING);
+   if (mSqRing == MAP_FAILED)
+   {
+      InfoLog(<<"mmap() of io_uring submission ring failed: "<<strerror(errno));
+      return false;
+   }
+   if (singleMmap)
+   {
+      mCqRing = mSqRing;
+   }
+   else
+   {
+      mCqRing = mmap(0, mCqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                     mRingFd, IORING_OFF_CQ_RING);
+      if (mCqRing == MAP_FAILED)
+      {
+         InfoLog(<<"mmap() of io_uring completion ring failed: "<<strerror(errno));
+         return false;
+      }
+   }
+   mSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+   mSqes = (struct io_uring_sqe*)mmap(0, mSqesSize, PROT_READ|PROT_WRITE,
+                                      MAP_SHARED|MAP_POPULATE, mRingFd, IORING_OFF_SQES);
+   if (mSqes == MAP_FAILED)
+   {
+      InfoLog(<<"mmap() of io_uring submission entries failed: "<<strerror(errno));
+      return false;
+   }
+
+   char* sq = (char*)mSqRing;
+   mSqHead = (unsigned*)(sq + params.sq_off.head);
+   mSqTail = (unsigned*)(sq + params.sq_off.tail);
+   mSqFlags = (unsigned*)(sq + params.sq_off.flags);
+   mSqArray = (unsigned*)(sq + params.sq_off.array);
+   mSqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+   mSqEntries = params.sq_entries;
+   char* cq = (char*)mCqRing;
+   mCqHead = (unsigned*)(cq + params.cq_off.head);
+   mCqTail = (unsigned*)(cq + params.cq_off.tail);
+   mCqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+   mCqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+   mCqEntries = params.cq_entries;
+   mCqeCache.reserve(mCqEntries);
+   return true;
 }
 
-/*static*/const char*
-FdPollGrp::getImplList()
+FdPollImplURing::~FdPollImplURing()
 {
-   // .kw. this isn't really scalable approach if we get a lot of impls
-   // but it works for now
-#ifdef RESIP_POLL_IMPL_EPOLL
- #ifdef RESIP_POLL_IMPL_POLL
+   unsigned itemIdx;
+   for (itemIdx=0; itemIdx < mItems.size(); itemIdx++)
+   {
+      if (mItems[itemIdx].mItem)
+      {
+         CritLog(<<"FdPollItem idx="<<itemIdx
+               <<" not deleted prior to destruction");
+      }
+   }
+   delete mFallback;
+   closeRing();
+}
+
+void
+FdPollImplURing::closeRing()
+{
+   if (mSqes != MAP_FAILED)
+   {
+      munmap(mSqes, mSqesSize);
+      mSqes = (struct io_uring_sqe*)MAP_FAILED;
+   }
+   if (mCqRing != MAP_FAILED && mCqRing != mSqRing)
+   {
+      munmap(mCqRing, mCqRingSize);
+   }
+   mCqRing = MAP_FAILED;
+   if (mSqRing != MAP_FAILED)
+   {
+      munmap(mSqRing, mSqRingSize);
+      mSqRing = MAP_FAILED;
+   }
+   if (mRingFd != -1)
+   {
+      close(mRingFd);
+      mRingFd = -1;
+   }
+}
+
+unsigned
+FdPollImplURing::pending() const
+{
+   return *mSqTail - __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE);
+}
+
+void
+FdPollImplURing::push(const struct io_uring_sqe& sqe)
+{
+   if (mFallback)
+   {
+      return;
+   }
+   if (pending() >= mSqEntries)
+   {
+      // Submission ring is full; hand what we have to the kernel.
+      enter(0, 0);
+      if (mFallback)
+      {
+         return;
+      }
+      resip_assert(pending() < mSqEntries);
+   }
+   writeSqe(sqe);
+}
+
+void
+FdPollImplURing::writeSqe(const struct io_uring_sqe& sqe)
+{
+   unsigned tail = *mSqTail;
+   unsigned idx = tail & mSqMask;
+   mSqes[idx] = sqe;
+   mSqArray[idx] = idx;
+   __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+  Submits whatever is queued and, if minComplete is not 0, waits up to
+  waitMs (forever if negative) for a completion. Returns 0, or the errno
+  io_uring_enter() failed with.
+**/
+int
+FdPollImplURing::enterRing(unsigned minComplete, int waitMs)
+{
+   unsigned flags = 0;
+   struct io_uring_getevents_arg arg;
+   struct __kernel_timespec ts;
+   void* argp = 0;
+   size_t argSize = 0;
+   if (minComplete > 0)
+   {
+      flags |= IORING_ENTER_GETEVENTS;
+      if (waitMs >= 0)
+      {
+         memset(&arg, 0, sizeof(arg));
+         ts.tv_sec = waitMs / 1000;
+         ts.tv_nsec = (long long)(waitMs % 1000) * 1000000;
+         arg.ts = (UInt64)(uintptr_t)&ts;
+         flags |= IORING_ENTER_EXT_ARG;
+         argp = &arg;
+         argSize = sizeof(arg);
+      }
+   }
+   if (syscall(__NR_io_uring_enter, mRingFd, pending(), minComplete, flags,
+               argp, argSize) < 0)
+   {
+      return errno;
+   }
+   return 0;
+}
+
+/**
+  As enterRing(), but returns false if the wait timed out or was
+  interrupted, or the ring has failed. A failure that retrying will not
+  fix hands everything to the fallback group.
+**/
+bool
+FdPollImplURing::enter(unsigned minComplete, int waitMs)
+{
+   if (mFallback)
+   {
+      return false;
+   }
+   int err = enterRing(minComplete, waitMs);
+   if (err)
+   {
+      switch (err)
+      {
+         case ETIME:
+         case EINTR:
+            return false;
+         case EAGAIN:
+         case EBUSY:
+            // Completions are backed up; reaping them will let us continue.
+            return true;
+         default:
+            fallBack(err);
+            return false;
+      }
+   }
+   return true;
+}
+
+/**
+  Called when io_uring_enter() fails in a way that retrying will not fix.
+  Rather than fail every wait from then on, the items move to an epoll
+  group, which everything is handed to from now on, and submitIo()
+  refuses new requests, so that the items go back to polling for
+  readiness.
+
+  The submitIo() requests still on the ring point at memory their owners
+  will reuse as soon as the requests are reported, so each one is
+  cancelled and waited for first; its real completion is reported at the
+  next wait. Only then is the ring closed. If the ring will not even take
+  the cancellations, whatever has not completed is left to complete in
+  its own time: it is not reported until it does, and the ring stays open
+  until then (see waitAndProcess()).
+**/
+void
+FdPollImplURing::fallBack(int err)
+{
+   CritLog(<<"io_uring_enter() failed: " << strerror(err)
+           << "; switching to epoll");
+   bool drained = cancelOutstandingIo();
+
+   mFallback = new FdPollImplEpoll();
+   for (unsigned fd = 0; fd < mItems.size(); ++fd)
+   {
+      Item& item = mItems[fd];
+      item.mArmed = false;
+      if (item.mItem)
+      {
+         mFallback->addPollItem(fd, item.mMask, item.mItem);
+      }
+   }
+   for(std::vector<FdSetIOObserver*>::iterator o=mFdSetObservers.begin();
+         o!=mFdSetObservers.end();++o)
+   {
+      mFallback->registerFdSetIOObserver(**o);
+   }
+
+   if (drained)
+   {
+      closeRing();
+   }
+   else
+   {
+      CritLog(<<"io_uring would not cancel its outstanding requests;"
+              << " keeping the ring open until they complete");
+   }
+}
+
+/**
+  Queues an IORING_OP_ASYNC_CANCEL for every submitIo() request that has
+  not completed yet, and waits until each of them has. Their completions
+  are kept in mDeferredCqes. Returns false if the ring failed before that.
+  Only used by fallBack(), so it goes around push() and enter().
+**/
+bool
+FdPollImplURing::cancelOutstandingIo()
+{
+   reap(mDeferredCqes);
+   if (!ioOutstanding())
+   {
+      return true;
+   }
+
+   std::vector<bool> completed(mIo.size(), false);
+   for (size_t ne = 0; ne < mCqeCache.size(); ne++)
+   {
+      if (URingIsIo(mCqeCache[ne].user_data))
+      {
+         completed[(unsigned)(mCqeCache[ne].user_data >> 32)] = true;
+      }
+   }
+   for (size_t ne = 0; ne < mDeferredCqes.size(); ne++)
+   {
+      if (URingIsIo(mDeferredCqes[ne].user_data))
+      {
+         completed[(unsigned)(mDeferredCqes[ne].user_data >> 32)] = true;
+      }
+   }
+   for (unsigned slot = 0; slot < mIo.size(); ++slot)
+   {
+      if (mIo[slot].mIo == 0 || completed[slot])
+      {
+         continue;
+      }
+      if (pending() >= mSqEntries)
+      {
+         enterRing(0, 0);
+         reap(mDeferredCqes);
+         if (pending() >= mSqEntries)
+         {
+            return false;
+         }
+      }
+      struct io_uring_sqe sqe;
+      memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_ASYNC_CANCEL;
+      sqe.fd = -1;
+      sqe.addr = URingIoUserData(mIo[slot].mFd, slot);
+      sqe.user_data = URingRemoveUserData;
+      writeSqe(sqe);
+   }
+
+   for (;;)
+   {
+      int err = enterRing(1, DrainWaitMs);
+      reap(mDeferredCqes);
+      if (!ioOutstanding())
+      {
+         return true;
+      }
+      switch (err)
+      {
+         case 0:
+         case ETIME:
+         case EINTR:
+         case EAGAIN:
+         case EBUSY:
+            break;
+         default:
+            return false;
+      }
+   }
+}
+
+/**
+  True if some submitIo() request has neither been reported nor has a
+  completion waiting to be.
+**/
+bool
+FdPollImplURing::ioOutstanding() const
+{
+   unsigned waiting = 0;
+   for (size_t ne = 0; ne < mCqeCache.size(); ne++)
+   {
+      if (URingIsIo(mCqeCache[ne].user_data))
+      {
+         ++waiting;
+      }
+   }
+   for (size_t ne = 0; ne < mDeferredCqes.size(); ne++)
+   {
+      if (URingIsIo(mDeferredCqes[ne].user_data))
+      {
+         ++waiting;
+      }
+   }
+   return mIo.size() - mFreeIo.size() > waiting;
+}
+
+void
+FdPollImplURing::arm(int fd)
+{
+   Item& item = mItems[fd];
+   unsigned short events = CvtUsrToURingMask(item.mMask);
+   if (mFallback || item.mArmed || item.mItem == 0 || events == 0)
+   {
+      return;
+   }
+   struct io_uring_sqe sqe;
+   memset(&sqe, 0, sizeof(sqe));
+   sqe.opcode = IORING_OP_POLL_ADD;
+   sqe.fd = fd;
+   // The kernel reads this as poll32_events, swapping halves on big-endian
+   // machines, so the 16-bit field is right everywhere.
+   sqe.poll_events = events;
+   sqe.user_data = URingUserData(fd, item.mGeneration);
+   push(sqe);
+   item.mArmed = true;
+}
+
+void
+FdPollImplURing::disarm(int fd)
+{
+   Item& item = mItems[fd];
+   if (item.mArmed)
+   {
+      struct io_uring_sqe sqe;
+      memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_POLL_REMOVE;
+      sqe.fd = -1;
+      sqe.addr = URingUserData(fd, item.mGeneration);
+      sqe.user_data = URingRemoveUserData;
+      push(sqe);
+      item.mArmed = false;
+   }
+   // The cancelled request, or an event already on the completion ring,
+   // now carries a stale generation.
+   ++item.mGeneration;
+}
+
+FdPollItemHandle
+FdPollImplURing::addPollItem(Socket fd, FdPollEventMask newMask, FdPollItemIf *item)
+{
+   resip_assert(fd>=0);
+   if (mItems.size() <= (unsigned)fd)
+   {
+      unsigned newsz = fd+1;
+      newsz += newsz/3; // plus 30% margin
+      mItems.resize(newsz);
+   }
+   Item& entry = mItems[fd];
+   resip_assert(entry.mItem == NULL);     // what is right thing to do?
+   resip_assert(entry.mIoPending == 0);
+   entry.mItem = item;
+   entry.mMask = newMask;
+   entry.mArmed = false;
+   ++entry.mGeneration;
+   if (mFallback)
+   {
+      return mFallback->addPollItem(fd, newMask, item);
+   }
+   arm(fd);
+   return IMPL_EPOLL_FdToHandle(fd);
+}
+
+void
+FdPollImplURing::modPollItem(const FdPollItemHandle handle, FdPollEventMask newMask)
+{
+   int fd = IMPL_EPOLL_HandleToFd(handle);
+   resip_assert(fd>=0 && ((unsigned)fd) < mItems.size());
+   Item& entry = mItems[fd];
+   resip_assert(entry.mItem != NULL);
+   bool changed = CvtUsrToURingMask(entry.mMask) != CvtUsrToURingMask(newMask);
+   entry.mMask = newMask;
+   if (mFallback)
+   {
+      mFallback->modPollItem(handle, newMask);
+   }
+   else if (changed)
+   {
+      disarm(fd);
+      arm(fd);
+   }
+}
+
+void
+FdPollImplURing::delPollItem(FdPollItemHandle handle)
+{
+   int fd = IMPL_EPOLL_HandleToFd(handle);
+   resip_assert(fd>=0 && ((unsigned)fd) < mItems.size());
+   resip_assert( mItems[fd].mItem != NULL );
+   cancelIo(fd);
+   disarm(fd);
+   mItems[fd].mItem = NULL;
+   if (mFallback)
+   {
+      mFallback->delPollItem(handle);
+      return;
+   }
+   // An outstanding poll request holds a reference to the socket; submit the
+   // removal now so that closing the fd really closes the socket.
+   if (pending())
+   {
+      enter(0, 0);
+   }
+}
+
+bool
+FdPollImplURing::submitIo(FdPollItemHandle handle, FdPollIo& io)
+{
+   if (mFallback)
+   {
+      return false;
+   }
+   int fd = IMPL_EPOLL_HandleToFd(handle);
+   resip_assert(fd>=0 && ((unsigned)fd) < mItems.size());
+   resip_assert(mItems[fd].mItem != NULL);
+   resip_assert(io.mHdr != NULL);
+   unsigned slot;
+   if (mFreeIo.empty())
+   {
+      slot = (unsigned)mIo.size();
+      mIo.push_back(IoSlot());
+   }
+   else
+   {
+      slot = mFreeIo.back();
+      mFreeIo.pop_back();
+   }
+   mIo[slot].mIo = &io;
+   mIo[slot].mFd = fd;
+   ++mItems[fd].mIoPending;
+
+   struct io_uring_sqe sqe;
+   memset(&sqe, 0, sizeof(sqe));
+   sqe.opcode = (io.mOp & FPEM_Write) ? IORING_OP_SENDMSG : IORING_OP_RECVMSG;
+   sqe.fd = fd;
+   sqe.addr = (UInt64)(uintptr_t)io.mHdr;
+   sqe.len = 1;
+   sqe.user_data = URingIoUserData(fd, slot);
+   push(sqe);
+   return true;
+}
+
+/**
+  Frees the slot of a finished (or dropped) request, and returns the
+  request.
+**/
+FdPollIo*
+FdPollImplURing::finishIo(unsigned slot)
+{
+   IoSlot& entry = mIo[slot];
+   FdPollIo* io = entry.mIo;
+   resip_assert(io);
+   --mItems[entry.mFd].mIoPending;
+   entry.mIo = 0;
+   entry.mFd = -1;
+   mFreeIo.push_back(slot);
+   return io;
+}
+
+/**
+  Drops the completions in {cqes} for requests on {fd}; they stay in
+  place, but no longer refer to anything.
+**/
+void
+FdPollImplURing::dropIo(std::vector<struct io_uring_cqe>& cqes, int fd)
+{
+   for (size_t ne = 0; ne < cqes.size(); ne++)
+   {
+      struct io_uring_cqe& cqe = cqes[ne];
+      if (URingIsIo(cqe.user_data) && URingFd(cqe.user_data) == fd)
+      {
+         finishIo((unsigned)(cqe.user_data >> 32));
+         cqe.user_data = URingRemoveUserData;
+      }
+   }
+}
+
+/**
+  Called as an item is deleted. Its requests use memory the item is
+  about to free, so the outstanding ones are cancelled and waited for;
+  none of them is reported. Completions for other items that arrive
+  meanwhile are kept for the next wait.
+**/
+void
+FdPollImplURing::cancelIo(int fd)
+{
+   if (mItems[fd].mIoPending == 0)
+   {
+      return;
+   }
+   // Completions reaped, but not handed out yet (we may be called from
+   // within uringWait()).
+   dropIo(mCqeCache, fd);
+   dropIo(mDeferredCqes, fd);
+   for (unsigned slot = 0; slot < mIo.size(); ++slot)
+   {
+      if (mIo[slot].mIo && mIo[slot].mFd == fd)
+      {
+         struct io_uring_sqe sqe;
+         memset(&sqe, 0, sizeof(sqe));
+         sqe.opcode = IORING_OP_ASYNC_CANCEL;
+         sqe.fd = -1;
+         sqe.addr = URingIoUserData(fd, slot);
+         sqe.user_data = URingRemoveUserData;
+         if (!mFallback)
+         {
+            push(sqe);
+         }
+         else if (mRingFd != -1 && pending() < mSqEntries)
+         {
+            // The failed ring is still open (see fallBack()); it may yet
+            // take the cancellation.
+            writeSqe(sqe);
+         }
+      }
+   }
+   if (mFallback && mRingFd != -1 && pending())
+   {
+      enterRing(0, 0);
+   }
+   while (mItems[fd].mIoPending > 0)
+   {
+      if (!mFallback)
+      {
+         if (enter(1, -1))
+         {
+            reap(mDeferredCqes);
+         }
+      }
+      else if (mRingFd != -1)
+      {
+         // The ring is readable while completions are waiting on it.
+         struct pollfd pfd;
+         pfd.fd = mRingFd;
+         pfd.events = POLLIN;
+         pfd.revents = 0;
+         poll(&pfd, 1, DrainWaitMs);
+         reap(mDeferredCqes);
+      }
+      // Once the ring has been closed, every request has its completion
+      // here.
+      for (size_t ne = 0; ne < mDeferredCqes.size(); )
+      {
+         const struct io_uring_cqe& cqe = mDeferredCqes[ne];
+         if (URingIsIo(cqe.user_data) && URingFd(cqe.user_data) == fd)
+         {
+            finishIo((unsigned)(cqe.user_data >> 32));
+            mDeferredCqes.erase(mDeferredCqes.begin() + ne);
+         }
+         else
+         {
+            ++ne;
+         }
+      }
+   }
+}
+
+void 
+FdPollImplURing::registerFdSetIOObserver(FdSetIOObserver& observer)
+{
+   mFdSetObservers.push_back(&observer);
+   if (mFallback)
+   {
+      mFallback->registerFdSetIOObserver(observer);
+   }
+}
+
+void 
+FdPollImplURing::unregisterFdSetIOObserver(FdSetIOObserver& observer)
+{
+   if (mFallback)
+   {
+      mFallback->unregisterFdSetIOObserver(observer);
+   }
+   for(std::vector<FdSetIOObserver*>::iterator o=mFdSetObservers.begin();
+         o!=mFdSetObservers.end();++o)
+   {
+      if(*o==&observer)
+      {
+         mFdSetObservers.erase(o);
+         return;
+      }
+   }
+}
+
+bool
+FdPollImplURing::waitAndProcess(int ms)
+{
+   bool didSomething = false;
+   int waitMs = ms;
+
+   if (mFallback)
+   {
+      if (mRingFd != -1)
+      {
+         // Requests the failed ring would not cancel; see fallBack().
+         reap(mDeferredCqes);
+         if (ioOutstanding())
+         {
+            if (ms < 0 || ms > DrainWaitMs)
+            {
+               ms = DrainWaitMs;
+            }
+         }
+         else
+         {
+            closeRing();
+         }
+      }
+      // Requests that were outstanding when the ring failed are reported
+      // first.
+      if (!mDeferredCqes.empty())
+      {
+         didSomething = uringWait(0);
+      }
+      return mFallback->waitAndProcess(didSomething ? 0 : ms) || didSomething;
+   }
+
+   if(!mFdSetObservers.empty())
+   {
+      if(ms < 0)
+      {
+         ms=INT_MAX;
+         waitMs=INT_MAX;
+      }
+
+      // Same approach as FdPollImplEpoll: select() on the ring fd, which is
+      // readable while completions are waiting, along with the observers'
+      // fds. Queued poll requests must reach the kernel before we sleep.
+      if (pending())
+      {
+         enter(0, 0);
+      }
+
+      FdSet fdset;
+      buildFdSet(fdset);
+
+      for(std::vector<FdSetIOObserver*>::iterator o=mFdSetObservers.begin();
+            o!=mFdSetObservers.end();++o)
+      {
+         ms = resipMin((unsigned int)ms, (*o)->getTimeTillNextProcessMS());
+      }
+      waitMs -= ms;
+
+      int numReady = fdset.selectMilliSeconds(ms);
+      if ( numReady < 0 )
+      {
+         int err = getErrno();
+         if ( err!=EINTR )
+         {
+            CritLog(<<"select() failed: "<<strerror(err));
+            resip_assert(0);     // .kw. not sure correct behavior...
+         }
+         return false;
+      }
+      if ( numReady==0 )
+         return false;     // timer expired
+
+      didSomething |= processFdSet(fdset);
+   }
+
+   didSomething |= uringWait(waitMs);
+   return didSomething;
+}
+
+void
+FdPollImplURing::buildFdSet(FdSet& fdset)
+{
+   if (mFallback)
+   {
+      mFallback->buildFdSet(fdset);
+      return;
+   }
+   fdset.setRead(mRingFd);
+   for(std::vector<FdSetIOObserver*>::iterator o=mFdSetObservers.begin();
+         o!=mFdSetObservers.end();++o)
+   {
+      (*o)->buildFdSet(fdset);
+   }
+}
+
+bool
+FdPollImplURing::processFdSet(FdSet& fdset)
+{
+   if (mFallback)
+   {
+      return mFallback->processFdSet(fdset);
+   }
+   bool didsomething=false;
+   for(std::vector<FdSetIOObserver*>::iterator o=mFdSetObservers.begin();
+         o!=mFdSetObservers.end();++o)
+   {
+      didsomething=true;
+      (*o)->process(fdset);
+   }
+
+   if (fdset.readyToRead(mRingFd))
+   {
+      uringWait(0);
+   }
+   return didsomething;
+}
+
+/**
+  Appends the completions on the ring to {cqes}, freeing their ring
+  entries. Returns how many there were.
+**/
+unsigned
+FdPollImplURing::reap(std::vector<struct io_uring_cqe>& cqes)
+{
+   unsigned head = *mCqHead;
+   unsigned tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+   unsigned count = tail - head;
+   for (; head != tail; ++head)
+   {
+      cqes.push_back(mCqes[head & mCqMask]);
+   }
+   __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+   return count;
+}
+
+bool
+FdPollImplURing::uringWait(int waitMs)
+{
+   bool maybeMore;
+   bool didsomething=false;
+   do
+   {
+      if (!mFallback)
+      {
+         bool haveCompletions = !mDeferredCqes.empty() ||
+            *mCqHead != __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+         if (waitMs != 0 && !haveCompletions)
+         {
+            enter(1, waitMs);
+         }
+         else if (pending())
+         {
+            enter(0, 0);
+         }
+      }
+      waitMs = 0;             // don't wait anymore
+
+      // Copy the completions out first, so the ring can be refilled while
+      // the items run.
+      mCqeCache.clear();
+      mCqeCache.swap(mDeferredCqes);
+      maybeMore = !mFallback && (reap(mCqeCache) == mCqEntries ||
+         (__atomic_load_n(mSqFlags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW));
+
+      for (size_t ne = 0; ne < mCqeCache.size(); ne++)
+      {
+         const struct io_uring_cqe& cqe = mCqeCache[ne];
+         if (cqe.user_data == URingRemoveUserData)
+         {
+            continue;
+         }
+         if (URingIsIo(cqe.user_data))
+         {
+            // The item is still there: deleting it drops its completions.
+            int fd = URingFd(cqe.user_data);
+            FdPollIo* io = finishIo((unsigned)(cqe.user_data >> 32));
+            io->mResult = cqe.res;
+            processItemIo(mItems[fd].mItem, *io);
+            didsomething = true;
+            continue;
+         }
+         int fd = (int)(cqe.user_data & 0xffffffff);
+         UInt32 generation = (UInt32)(cqe.user_data >> 32);
+         if (fd < 0 || (unsigned)fd >= mItems.size() ||
+             mItems[fd].mGeneration != generation || mItems[fd].mItem == NULL)
+         {
+            /* this can happen if item was deleted or modified after
+             * event was generated in kernel, etc. */
+            continue;
+         }
+         mItems[fd].mArmed = false;
+         if (cqe.res < 0)
+         {
+            // The poll request itself failed (e.g. the fd was closed without
+            // deleting the item). Report it, but do not re-arm.
+            ErrLog(<<"io_uring poll on fd="<<fd<<" failed: "<<strerror(-cqe.res));
+            processItem(mItems[fd].mItem, FPEM_Error|FPEM_Read|FPEM_Write);
+         }
+         else
+         {
+            processItem(mItems[fd].mItem, CvtURingToUsrMask(cqe.res));
+            // WATCHOUT: the item may have been deleted, and mItems resized
+            if ((unsigned)fd < mItems.size() && mItems[fd].mGeneration == generation)
+            {
+               arm(fd);
+            }
+         }
+         didsomething = true;
+      }
+      mCqeCache.clear();
+      maybeMore |= !mDeferredCqes.empty();
+   } while (maybeMore);
+   return didsomething;
+}
+
+#endif // RESIP_POLL_IMPL_URING
+
+/*****************************************************************
+ *
+ * Factory
+ *
+ *****************************************************************/
+
+/*static*/FdPollGrp*
+FdPollGrp::create(const char *implName)
+{
+   if ( implName==0 || implName[0]==0 || strcmp(implName,"event")==0 )
+      implName = 0;     // pick the first (best) one supported
+#ifdef RESIP_POLL_IMPL_URING
+   if ( implName!=0 && strcmp(implName,"uring")==0 )
+   {
+      FdPollGrp* grp = FdPollImplURing::create();
+      if (grp)
+      {
+         return grp;
+      }
+      WarningLog(<<"io_uring is not available, using epoll instead");
+      implName = "epoll";
+   }
+#endif
+#ifdef RESIP_POLL_IMPL_EPOLL
+   if ( implName==0 || strcmp(implName,"epoll")==0 )
+   {
+      return new FdPollImplEpoll();
+   }
+#endif
+#ifdef RESIP_POLL_IMPL_POLL
+   if ( implName==0 || strcmp(implName,"poll")==0 )
+   {
+      return new FdPollImplPoll();
+   }
+#endif
+   if ( implName==0 || strcmp(implName,"fdset")==0 )
+   {
+      return new FdPollImplFdSet();
+   }
+   resip_assert(0);
+   return NULL;
+}
+
+/*static*/const char*
+FdPollGrp::getImplList()
+{
+   // .kw. this isn't really scalable approach if we get a lot of impls
+   // but it works for now
+#ifdef RESIP_POLL_IMPL_EPOLL
+ #ifdef RESIP_POLL_IMPL_URING
+  #ifdef RESIP_POLL_IMPL_POLL
+   return "event|epoll|uring|fdset|poll";
+  #else
+   return "event|epoll|uring|fdset";
+  #endif
+ #elif defined(RESIP_POLL_IMPL_POLL)
    return "event|epoll|fdset|poll";
  #else
    return "event|epoll|fdset";
@@ -5,6 +5,7 @@
 
 /* The Makefile system may define the following:
  * HAVE_EPOLL: system call epoll() is available
+ * HAVE_LINUX_IO_URING_H: io_uring kernel interface headers are available
  *
  * An implementation based upon FdSet (and select()) is always available.
  *
@@ -17,10 +18,20 @@
 #define RESIP_POLL_IMPL_EPOLL
 #endif
 
+// The io_uring implementation falls back to epoll when the running kernel
+// does not support it, so it is only built alongside epoll. Besides
+// readiness polling it can carry out socket reads and writes itself; see
+// FdPollGrp::submitIo().
+#if defined(RESIP_POLL_IMPL_EPOLL) && defined(HAVE_LINUX_IO_URING_H)
+#define RESIP_POLL_IMPL_URING
+#endif
+
 #if defined(HAVE_POLL) || (_WIN32_WINNT >= 0x0600)
 #define RESIP_POLL_IMPL_POLL
 #endif
 
+struct msghdr;
+
 namespace resip {
 
 
@@ -40,6 +51,22 @@ class FdPollGrp;
  */
 typedef struct FdPollItemFake* FdPollItemHandle;
 
+/**
+ * A socket read or write queued with FdPollGrp::submitIo(). The owner
+ * fills in mOp and mHdr, and must keep the request, and everything mHdr
+ * points at, until it is handed back through
+ * FdPollItemIf::processIoCompletion().
+ */
+class FdPollIo
+{
+   public:
+      FdPollIo() : mOp(0), mHdr(0), mResult(0) { };
+
+      FdPollEventMask   mOp;        // FPEM_Read: recvmsg(), FPEM_Write: sendmsg()
+      struct msghdr*    mHdr;
+      int               mResult;    // what the call returned, or -errno
+};
+
 class FdPollItemIf
 {
    //friend class FdPollGrp;
@@ -51,6 +78,12 @@ class FdPollItemIf
         Called by PollGrp when activity is possible
       **/
       virtual void processPollEvent(FdPollEventMask mask) = 0;
+
+      /**
+        Called by PollGrp when a request queued with submitIo() has
+        finished. Only items that queue requests need to override this.
+      **/
+      virtual void processIoCompletion(FdPollIo& io);
 };
 
 class FdPollItemBase : public FdPollItemIf
@@ -75,9 +108,11 @@ class FdPollGrp
       FdPollGrp();
       virtual ~FdPollGrp();
 
-      typedef enum {FdSetImpl = 0, PollImpl, EPollImpl } ImplType;
+      typedef enum {FdSetImpl = 0, PollImpl, EPollImpl, URingImpl } ImplType;
 
-      /// factory
+      /// factory. implName is one of getImplList(); "uring" falls back to
+      /// "epoll" if the running kernel does not support io_uring, and
+      /// switches to it if io_uring fails later on.
       static FdPollGrp* create(const char *implName=NULL);
       /// Return candidate impl names with vertical bar (|) between them
       /// Intended for help messages
@@ -90,6 +125,16 @@ class FdPollGrp
       virtual void modPollItem(FdPollItemHandle handle, FdPollEventMask newMask) = 0;
       virtual void delPollItem(FdPollItemHandle handle) = 0;
 
+      /// True if submitIo() is supported: the group can carry out the
+      /// socket reads and writes itself, not just report readiness.
+      virtual bool canSubmitIo() const;
+      /// Queue {io} on the item's socket. It goes to the kernel with the
+      /// next wait, and comes back through the item's processIoCompletion().
+      /// delPollItem() cancels, and waits for, the item's requests that
+      /// are still outstanding; those are not reported. Returns false, and
+      /// queues nothing, if the group cannot do this.
+      virtual bool submitIo(FdPollItemHandle handle, FdPollIo& io);
+
       virtual void registerFdSetIOObserver(FdSetIOObserver& observer) = 0;
       virtual void unregisterFdSetIOObserver(FdSetIOObserver& observer) = 0;
 
@@ -112,6 +157,7 @@ class FdPollGrp
 
    protected:
       void processItem(FdPollItemIf *item, FdPollEventMask mask);
+      void processItemIo(FdPollItemIf *item, FdPollIo& io);
 };
 
 
@@ -23,6 +23,8 @@ class Fifo : public AbstractFifo<Msg*>
       using AbstractFifo<Msg*>::mCondition;
       using AbstractFifo<Msg*>::empty;
       using AbstractFifo<Msg*>::size;
+      using AbstractFifo<Msg*>::setLockFree;
+      using AbstractFifo<Msg*>::isLockFree;
 
       /// Add a message to the fifo.
       size_t add(Msg* msg);
@@ -89,10 +91,17 @@ void
 Fifo<Msg>::clear()
 {
    Lock lock(mMutex); (void)lock;
+   this->drainInbox();
+   unsigned int num = 0;
    while ( ! mFifo.empty() )
    {
       delete mFifo.front();
       mFifo.pop_front();
+      ++num;
+   }
+   if(num)
+   {
+      this->onMessagePopped(num);
    }
    resip_assert(mFifo.empty());
 }
@@ -2,7 +2,7 @@
 #define RUTIL_GENERICTIMERQUEUE_HXX
 
 #include "rutil/Timer.hxx"
-#include <set>
+#include "rutil/TimerWheel.hxx"
 #include <vector>
 
 namespace resip {
@@ -28,6 +28,11 @@ class GenericTimerQueue
             {
                return mEvent;
             }
+
+            UInt64 getWhen() const
+            {
+               return mWhen;
+            }
             
             bool operator<(const TimerEntry<E>& rhs) const
             {
@@ -40,58 +45,55 @@ class GenericTimerQueue
       /// deletes the message associated with the timer as well.
       virtual ~GenericTimerQueue()
       {
-         for (typename std::multiset<TimerEntry<T> >::iterator i = mTimers.begin(); i !=  mTimers.end(); ++i)
-         {
-            delete i->mEvent;            
-         }
+         DeleteEvent deleteEvent;
+         mTimers.clear(deleteEvent);
       }
       
       virtual void process()
       {
          if (!mTimers.empty() && msTillNextTimer() == 0)
          {
-            TimerEntry<T> now(0, 0);
-
-            // hacky solution, needs work, insertion from processTimer
-            // caused bizarre infinite loop issues in previous revision;
-            // this code is in desperate need of help
-            typedef typename std::multiset<TimerEntry<T> > TimerSet;
-            typedef std::vector<typename TimerSet::iterator> ItVector;
-            ItVector iterators;
-
-            typename TimerSet::iterator end = mTimers.upper_bound(now);
-            typename TimerSet::iterator begin = mTimers.begin();
-
-            for (typename TimerSet::iterator i = begin; i != end; ++i)
-            {
-               iterators.push_back(i);
-            }
-
-            for (typename ItVector::iterator i = iterators.begin(); i != iterators.end(); ++i)
-            {
-               resip_assert((*i)->getEvent());
-               processTimer((*i)->getEvent());               
-            }
+            // Collect everything that is due before handing any of it out;
+            // processTimer() may add timers, and those must wait for the next
+            // call even if they are already due.
+            Collect collect(mExpired);
+            mTimers.expire(Timer::getTimeMs(), collect);
 
-            //!dcm! -- erasing the range didn't work...upper bound was prob. end()
-            for (typename ItVector::iterator i = iterators.begin(); i != iterators.end(); ++i)
+            for (typename std::vector<T*>::iterator i = mExpired.begin(); i != mExpired.end(); ++i)
             {
-               mTimers.erase(*i);
+               resip_assert(*i);
+               processTimer(*i);
             }
+            mExpired.clear();
          }
       }
 
       virtual void processTimer(T*)=0;      
 
-	  void add(T* event, unsigned long msOffset)
-	  {
-   	      TimerEntry<T> t(msOffset, event);
-		  mTimers.insert(t);
-	  }
+      /// @return a handle that can be passed to cancel()
+      TimerHandle add(T* event, unsigned long msOffset)
+      {
+         return mTimers.add(TimerEntry<T>(msOffset, event));
+      }
+
+      /// Removes a pending timer and deletes its event.
+      /// @return false if the timer had already fired or been cancelled
+      bool cancel(TimerHandle handle)
+      {
+         const TimerEntry<T>* entry = mTimers.find(handle);
+         if (!entry)
+         {
+            return false;
+         }
+         T* event = entry->getEvent();
+         mTimers.cancel(handle);
+         delete event;
+         return true;
+      }
 
       int size() const
       {
-         return mTimers.size();
+         return (int)mTimers.size();
       }
       
       bool empty() const
@@ -103,7 +105,7 @@ class GenericTimerQueue
       {
          if (!mTimers.empty())
          {
-            UInt64 next = mTimers.begin()->mWhen;
+            UInt64 next = mTimers.nextExpiry();
             UInt64 now = Timer::getTimeMs();
             if (now > next) 
             {
@@ -131,8 +133,31 @@ class GenericTimerQueue
 
       
    protected:
+      class Collect
+      {
+         public:
+            Collect(std::vector<T*>& expired) : mExpired(expired) {}
+            void operator()(const TimerEntry<T>& entry)
+            {
+               mExpired.push_back(entry.getEvent());
+            }
+         private:
+            std::vector<T*>& mExpired;
+      };
+
+      class DeleteEvent
+      {
+         public:
+            void operator()(const TimerEntry<T>& entry)
+            {
+               delete entry.getEvent();
+            }
+      };
+
 //      friend std::ostream& operator<<(std::ostream&, const GenericTimerQueue&);
-      std::multiset<TimerEntry<T> > mTimers;
+      TimerWheel<TimerEntry<T> > mTimers;
+      // reused by process() so that firing timers does not allocate
+      std::vector<T*> mExpired;
 };
 
 }
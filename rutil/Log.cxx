@@ -1,6 +1,7 @@
 #include "rutil/Socket.hxx"
 
 #include "rutil/ResipAssert.h"
+#include <atomic>
 #include <iostream>
 #include <fstream>
 #include <stdio.h>
@@ -14,6 +15,7 @@
 #include <time.h>
 
 #include "rutil/Log.hxx"
+#include "rutil/AsyncLogWriter.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
 #include "rutil/ThreadIf.hxx"
@@ -65,6 +67,11 @@ Log::mDescriptions[][32] = {"NONE", "EMERG", "ALERT", "CRIT", "ERR", "WARNING",
 
 Mutex Log::_mutex;
 
+// Created by the first startAsyncWriter() and kept until the last
+// LogStaticInitializer goes away, since logging threads may still be looking
+// at it.
+static std::atomic<AsyncLogWriter*> asyncLogWriter(0);
+
 extern "C"
 {
    void freeThreadSetting(void* setting)
@@ -106,6 +113,8 @@ LogStaticInitializer::~LogStaticInitializer()
       delete Log::mLevelKey;
 #endif
 
+      delete asyncLogWriter.exchange(0);
+
       ThreadIf::tlsKeyDelete(*Log::mLocalLoggerKey);
       delete Log::mLocalLoggerKey;
    }
@@ -237,6 +246,9 @@ Log::initialize(Type type, Level level, const Data& appName,
                 ExternalLogger* externalLogger,
                 const Data& syslogFacilityName)
 {
+   // Records already queued were formatted for the old settings.
+   flushAsync();
+
    Lock lock(_mutex);
    mDefaultLoggerData.reset();   
    
@@ -741,6 +753,8 @@ int Log::localLoggerReinitialize(Log::LocalLoggerId loggerId,
 
 int Log::localLoggerRemove(Log::LocalLoggerId loggerId)
 {
+   // Queued records may still refer to this logger.
+   flushAsync();
    return mLocalLoggerMap.remove(loggerId);
 }
 
@@ -762,6 +776,80 @@ int Log::setThreadLocalLogger(Log::LocalLoggerId loggerId)
    return (loggerId == 0) || (pData != NULL)?0:1;
 }
 
+void
+Log::startAsyncWriter(unsigned int recordsPerThread)
+{
+   AsyncLogWriter* writer = asyncLogWriter.load();
+   if (!writer)
+   {
+      Lock lock(_mutex);
+      writer = asyncLogWriter.load();
+      if (!writer)
+      {
+         writer = new AsyncLogWriter;
+         asyncLogWriter.store(writer);
+      }
+   }
+   if (!writer->isRunning())
+   {
+      writer->start(recordsPerThread);
+   }
+}
+
+void
+Log::stopAsyncWriter()
+{
+   AsyncLogWriter* writer = asyncLogWriter.load();
+   if (writer)
+   {
+      writer->stop();
+   }
+}
+
+bool
+Log::isAsync()
+{
+   AsyncLogWriter* writer = asyncLogWriter.load();
+   return writer && writer->isRunning();
+}
+
+void
+Log::flushAsync()
+{
+   AsyncLogWriter* writer = asyncLogWriter.load();
+   if (writer)
+   {
+      writer->flush();
+   }
+}
+
+UInt64
+Log::getDroppedRecordCount()
+{
+   AsyncLogWriter* writer = asyncLogWriter.load();
+   return writer ? writer->getDroppedCount() : 0;
+}
+
+std::ostream&
+Log::writeRecord(ThreadData& logger, Level level, const Data& record, bool flush)
+{
+   std::ostream& _instance = logger.Instance((int)record.size()+2);
+   if (logger.type() == resip::Log::Syslog)
+   {
+      // endl is magic in syslog -- so put it here
+      _instance << level << record << std::endl;
+   }
+   else
+   {
+      _instance << record << '\n';
+      if (flush)
+      {
+         _instance.flush();
+      }
+   }
+   return _instance;
+}
+
 std::ostream&
 Log::Instance(unsigned int bytesToWrite)
 {
@@ -944,6 +1032,18 @@ Log::Guard::~Guard()
       return;
    }
 
+   if (logType != resip::Log::VSDebugWindow)
+   {
+      AsyncLogWriter* writer = asyncLogWriter.load(std::memory_order_acquire);
+      if (writer && writer->isRunning())
+      {
+         // A record that does not fit in this thread's queue is dropped and
+         // counted.
+         writer->push(resip::Log::getLoggerData(), mLevel, mData);
+         return;
+      }
+   }
+
    resip::Lock lock(resip::Log::_mutex);
    // !dlb! implement VSDebugWindow as an external logger
    if (logType == resip::Log::VSDebugWindow)
@@ -953,13 +1053,7 @@ Log::Guard::~Guard()
    }
    else 
    {
-      // endl is magic in syslog -- so put it here
-      std::ostream& _instance = Instance((int)mData.size()+2);
-      if (logType == resip::Log::Syslog)
-      {
-         _instance << mLevel;
-      }
-      _instance << mData << std::endl;  
+      writeRecord(resip::Log::getLoggerData(), mLevel, mData, true);
    }
 }
 
@@ -257,6 +257,26 @@ class Log
       static int setThreadLocalLogger(LocalLoggerId loggerId);
 
 
+      /**
+         @brief Moves writing of log records off the logging threads.
+
+         @details Records are still formatted by the thread that logs them,
+         then queued in a lock-free ring owned by that thread. A dedicated
+         writer thread writes them out in batches. If a thread logs faster
+         than the writer can keep up, records that do not fit in its ring of
+         recordsPerThread entries are dropped and counted; see
+         getDroppedRecordCount(). External loggers and VSDebugWindow output
+         are still called on the logging thread.
+      */
+      static void startAsyncWriter(unsigned int recordsPerThread=4096);
+      /// Stops the writer thread, writing out whatever is still queued.
+      static void stopAsyncWriter();
+      static bool isAsync();
+      /// Blocks until every record queued so far has been written.
+      static void flushAsync();
+      /// Number of records dropped because a thread's queue was full.
+      static UInt64 getDroppedRecordCount();
+
       static std::ostream& Instance(unsigned int bytesToWrite);
       static bool isLogging(Log::Level level, const Subsystem&);
       static void OutputToWin32DebugWindow(const Data& result);      
@@ -266,6 +286,8 @@ class Log
 #endif
 
    protected:
+      friend class AsyncLogWriter;
+
       static Mutex _mutex;
       static volatile short touchCount;
       static const Data delim;
@@ -353,6 +375,10 @@ class Log
 #endif
       static const char mDescriptions[][32];
 
+      /// Writes one formatted record to logger's output; _mutex must be held.
+      static std::ostream& writeRecord(ThreadData& logger, Level level,
+                                       const Data& record, bool flush);
+
       static ThreadData &getLoggerData()
       {
          ThreadData* pData = static_cast<ThreadData*>(ThreadIf::tlsGetValue(*Log::mLocalLoggerKey));
@@ -0,0 +1,369 @@
+#ifndef RESIP_OpenHashTable_hxx
+#define RESIP_OpenHashTable_hxx
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "rutil/ResipAssert.h"
+
+namespace resip
+{
+
+/**
+   @brief An open-addressing hash table of pointers to objects that carry
+   their own key.
+
+   @details Each slot holds the full hash of its entry next to the pointer,
+   so a probe only dereferences an entry whose hash matches; with linear
+   probing a lookup usually touches a single cache line. The key itself is
+   not copied into the table: Traits tells the table how to compare a key
+   with an entry.
+
+   Erasing uses backward-shift deletion (later entries of the probe run are
+   moved up into the hole), so there are no tombstones and probe runs never
+   degrade over time.
+
+   Growing is incremental. When the load factor reaches 3/4, a table of
+   twice the size is allocated and the old one is drained a few slots at a
+   time by subsequent insert() and erase() calls, so no single call pays for
+   moving every entry. Until the old table is empty, lookups check both.
+
+   Traits must provide:
+   @code
+      typedef ... KeyType;
+      static bool matches(const T* value, const KeyType& key);
+   @endcode
+
+   The caller supplies the hash, which lets objects compute it once and
+   keep it (see TransactionState). The same value must be passed for a
+   given entry every time. The table does not own the objects it points to.
+
+   @ingroup data_structures
+*/
+template <class T, class Traits>
+class OpenHashTable
+{
+   public:
+      typedef typename Traits::KeyType KeyType;
+
+      explicit OpenHashTable(size_t initialCapacity=64) :
+         mOld(0),
+         mOldMask(0),
+         mOldSize(0),
+         mMigrateCursor(0)
+      {
+         size_t capacity = MinCapacity;
+         while(capacity < initialCapacity)
+         {
+            capacity <<= 1;
+         }
+         mTable = allocate(capacity);
+         mMask = capacity-1;
+         mSize = 0;
+      }
+
+      ~OpenHashTable()
+      {
+         std::free(mTable);
+         std::free(mOld);
+      }
+
+      T* find(const KeyType& key, size_t hash) const
+      {
+         T* found = findIn(mTable, mMask, key, hash);
+         if(!found && mOld)
+         {
+            found = findIn(mOld, mOldMask, key, hash);
+         }
+         return found;
+      }
+
+      /**
+         @brief Adds value, which must not already be in the table (the
+         caller is expected to have checked with find()).
+      */
+      void insert(T* value, size_t hash)
+      {
+         resip_assert(value);
+         if(mOld)
+         {
+            migrate(MigrateSlotsPerCall);
+         }
+         if((mSize + mOldSize + 1)*4 > (mMask+1)*3)
+         {
+            grow();
+         }
+         insertIn(mTable, mMask, value, hash);
+         ++mSize;
+      }
+
+      /**
+         @brief Removes value (compared by address) from the table.
+         @return false if it was not there.
+      */
+      bool erase(const T* value, size_t hash)
+      {
+         bool erased = false;
+         if(eraseIn(mTable, mMask, value, hash))
+         {
+            --mSize;
+            erased = true;
+         }
+         else if(mOld && eraseIn(mOld, mOldMask, value, hash))
+         {
+            --mOldSize;
+            erased = true;
+         }
+         if(mOld)
+         {
+            migrate(MigrateSlotsPerCall);
+         }
+         return erased;
+      }
+
+      /// Some entry of the table, or 0 if it is empty. This scans from the
+      /// first slot on every call; use values() to visit every entry.
+      T* any() const
+      {
+         for(size_t i=0; mOld && i<=mOldMask; ++i)
+         {
+            if(mOld[i].mValue)
+            {
+               return mOld[i].mValue;
+            }
+         }
+         for(size_t i=0; mSize && i<=mMask; ++i)
+         {
+            if(mTable[i].mValue)
+            {
+               return mTable[i].mValue;
+            }
+         }
+         return 0;
+      }
+
+      /// Appends every entry of the table to out, e.g. so that they can
+      /// be deleted (and erase themselves) without rescanning the table.
+      void values(std::vector<T*>& out) const
+      {
+         out.reserve(out.size() + size());
+         for(size_t i=0; mOld && i<=mOldMask; ++i)
+         {
+            if(mOld[i].mValue)
+            {
+               out.push_back(mOld[i].mValue);
+            }
+         }
+         for(size_t i=0; mSize && i<=mMask; ++i)
+         {
+            if(mTable[i].mValue)
+            {
+               out.push_back(mTable[i].mValue);
+            }
+         }
+      }
+
+      size_t size() const { return mSize + mOldSize; }
+      bool empty() const { return size()==0; }
+      size_t capacity() const { return mMask+1; }
+      /// true while entries are still being moved out of the previous table
+      bool isGrowing() const { return mOld != 0; }
+
+   private:
+      OpenHashTable(const OpenHashTable&);
+      OpenHashTable& operator=(const OpenHashTable&);
+
+      enum
+      {
+         MinCapacity = 16,
+         // The old table has half as many slots as the new one, so it is
+         // drained after capacity/8 inserts; the new one does not reach its
+         // load limit until 3*capacity/8 inserts after the grow.
+         MigrateSlotsPerCall = 4
+      };
+
+      // An empty slot is all zero bits, so tables come from calloc(): large
+      // ones are then mapped in lazily instead of being cleared up front.
+      struct Slot
+      {
+         size_t mHash;
+         T* mValue;
+      };
+
+      static Slot* allocate(size_t capacity)
+      {
+         Slot* table = static_cast<Slot*>(std::calloc(capacity, sizeof(Slot)));
+         if(!table)
+         {
+            throw std::bad_alloc();
+         }
+         return table;
+      }
+
+      static T* findIn(const Slot* table, size_t mask, const KeyType& key, size_t hash)
+      {
+         for(size_t i=hash & mask; table[i].mValue; i=(i+1) & mask)
+         {
+            if(table[i].mHash == hash && Traits::matches(table[i].mValue, key))
+            {
+               return table[i].mValue;
+            }
+         }
+         return 0;
+      }
+
+      static void insertIn(Slot* table, size_t mask, T* value, size_t hash)
+      {
+         size_t i=hash & mask;
+         while(table[i].mValue)
+         {
+            i=(i+1) & mask;
+         }
+         table[i].mHash = hash;
+         table[i].mValue = value;
+      }
+
+      static bool eraseIn(Slot* table, size_t mask, const T* value, size_t hash)
+      {
+         for(size_t i=hash & mask; table[i].mValue; i=(i+1) & mask)
+         {
+            if(table[i].mValue == value)
+            {
+               removeAt(table, mask, i);
+               return true;
+            }
+         }
+         return false;
+      }
+
+      // Backward-shift deletion: pull later members of the probe run into
+      // the hole as long as that does not move them before their home slot.
+      static void removeAt(Slot* table, size_t mask, size_t hole)
+      {
+         size_t next = (hole+1) & mask;
+         while(table[next].mValue)
+         {
+            size_t home = table[next].mHash & mask;
+            // distance from home to next vs. from home to hole (cyclic)
+            if(((next - home) & mask) >= ((next - hole) & mask))
+            {
+               table[hole] = table[next];
+               hole = next;
+            }
+            next = (next+1) & mask;
+         }
+         table[hole].mHash = 0;
+         table[hole].mValue = 0;
+      }
+
+      void grow()
+      {
+         if(mOld)
+         {
+            // Should not happen given MigrateSlotsPerCall; finish the
+            // previous grow before starting another.
+            migrate(mOldMask+1);
+         }
+         mOld = mTable;
+         mOldMask = mMask;
+         mOldSize = mSize;
+         mMigrateCursor = 0;
+
+         mMask = (mMask+1)*2-1;
+         mTable = allocate(mMask+1);
+         mSize = 0;
+      }
+
+      // Moves the entries found in the next count slots of the old table.
+      // Each move is a proper erase, so the old table stays searchable
+      // throughout, and slots before the cursor stay empty.
+      void migrate(size_t count)
+      {
+         while(count-- && mOldSize)
+         {
+            Slot& slot = mOld[mMigrateCursor];
+            while(slot.mValue)
+            {
+               insertIn(mTable, mMask, slot.mValue, slot.mHash);
+               ++mSize;
+               --mOldSize;
+               removeAt(mOld, mOldMask, mMigrateCursor);
+            }
+            ++mMigrateCursor;
+            resip_assert(mMigrateCursor <= mOldMask+1);
+         }
+         if(mOldSize==0)
+         {
+            std::free(mOld);
+            mOld = 0;
+            mOldMask = 0;
+            mMigrateCursor = 0;
+         }
+      }
+
+      Slot* mTable;
+      size_t mMask;
+      size_t mSize;
+
+      // previous table while a grow is in progress
+      Slot* mOld;
+      size_t mOldMask;
+      size_t mOldSize;
+      size_t mMigrateCursor;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
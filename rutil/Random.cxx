@@ -68,6 +68,32 @@ ThreadIf::TlsKey Random::sRandomStateKey = 0;
 
 #define RANDOM_STATE_SIZE 128
 
+struct Random::FastState
+{
+   UInt64 s[4];
+   unsigned int remaining; // calls until the next reseed
+};
+
+namespace
+{
+inline UInt64
+rotl(UInt64 x, int k)
+{
+   return (x << k) | (x >> (64 - k));
+}
+
+// Spreads a seed over the whole xoshiro state; see
+// http://prng.di.unimi.it/splitmix64.c
+inline UInt64
+splitMix64(UInt64& x)
+{
+   UInt64 z = (x += 0x9e3779b97f4a7c15ULL);
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+   return z ^ (z >> 31);
+}
+}
+
 const char*
 Random::getImplName()
 {
@@ -335,6 +361,69 @@ Random::getCryptoRandom()
 #endif
 }
 
+Random::FastState*
+Random::getFastState()
+{
+   // a new state has remaining == 0, so it is seeded below
+   static ThreadLocal<FastState> states;
+   FastState* state = states.get();
+   if (state->remaining == 0)
+   {
+      UInt64 seed[4];
+      getCryptoRandom((unsigned char*)seed, sizeof(seed));
+      // Without OpenSSL getCryptoRandom() is only as good as getRandom();
+      // fold in something that is sure to differ between threads.
+      UInt64 mix = seed[0] ^ ResipClock::getTimeMicroSec() ^ (UInt64)(size_t)state;
+      for (int i = 0; i < 4; ++i)
+      {
+         state->s[i] = seed[i] ^ splitMix64(mix);
+      }
+      if ((state->s[0] | state->s[1] | state->s[2] | state->s[3]) == 0)
+      {
+         state->s[0] = 1; // the all-zero state is a fixed point
+      }
+      state->remaining = FastReseedInterval;
+   }
+   --state->remaining;
+   return state;
+}
+
+UInt64
+Random::getFastRandom()
+{
+   // xoshiro256** 1.0; see http://prng.di.unimi.it/
+   UInt64* s = getFastState()->s;
+   const UInt64 result = rotl(s[1] * 5, 7) * 9;
+   const UInt64 t = s[1] << 17;
+   s[2] ^= s[0];
+   s[3] ^= s[1];
+   s[1] ^= s[2];
+   s[0] ^= s[3];
+   s[2] ^= t;
+   s[3] = rotl(s[3], 45);
+   return result;
+}
+
+Data
+Random::getFastRandomHex(unsigned int numBytes)
+{
+   static const char hexDigits[] = "0123456789abcdef";
+   resip_assert(numBytes < Random::maxLength+1);
+
+   char buf[2*Random::maxLength];
+   char* out = buf;
+   while (numBytes)
+   {
+      UInt64 r = getFastRandom();
+      for (int i = 0; i < 8 && numBytes; ++i, --numBytes, r >>= 8)
+      {
+         *out++ = hexDigits[(r >> 4) & 0xf];
+         *out++ = hexDigits[r & 0xf];
+      }
+   }
+   return Data(buf, (Data::size_type)(out - buf));
+}
+
 Data 
 Random::getRandom(unsigned int len)
 {
@@ -84,11 +84,28 @@ class Random
       static int  getRandom();
       static int  getCryptoRandom();
 
+      /**
+          Returns 64 bits from a per-thread xoshiro256** generator. Each
+          thread seeds its own generator from getCryptoRandom() on first use
+          and reseeds it every FastReseedInterval calls; no lock is taken
+          otherwise. Meant for identifiers that must not collide and should
+          not be predictable from the outside (branches, tags, Call-IDs),
+          not for key material.
+      **/
+      static UInt64 getFastRandom();
+      static Data getFastRandomHex(unsigned int numBytes); // actual length is 2*numBytes
+
+      enum {FastReseedInterval = 1<<20};
+
       static const char* getImplName();
 
    private:
       static Mutex mMutex;
       static bool  mIsInitialized;
+
+      ///@internal
+      struct FastState;
+      static FastState* getFastState();
       
 #ifdef WIN32
       // ensure each thread is initialized since windows requires you to call srand for each thread
@@ -3,6 +3,8 @@
 
 #include "rutil/Socket.hxx"
 
+#include <cstdlib>
+
 #ifdef WIN32
 #  include <BaseTsd.h>
 #  include <winbase.h>
@@ -134,6 +136,45 @@ protected:
 static TlsDestructorInitializer _staticTlsInit;
 #endif
 
+/**
+   A per-thread T, zero filled on first use in each thread and freed when
+   that thread exits. T must be plain data. Declare it as a function local
+   static, so that the key is created (thread-safely) on first use.
+*/
+template<class T>
+class ThreadLocal
+{
+   public:
+      ThreadLocal()
+      {
+         ThreadIf::tlsKeyCreate(mKey, ::free);
+      }
+
+      /// This thread's T, or 0 if get() has not been called on this thread.
+      T* peek() const
+      {
+         return static_cast<T*>(ThreadIf::tlsGetValue(mKey));
+      }
+
+      /// This thread's T, created on first use.
+      T* get()
+      {
+         T* value = peek();
+         if (value == 0)
+         {
+            value = static_cast<T*>(::calloc(1, sizeof(T)));
+            ThreadIf::tlsSetValue(mKey, value);
+         }
+         return value;
+      }
+
+   private:
+      ThreadIf::TlsKey mKey;
+
+      ThreadLocal(const ThreadLocal&);
+      ThreadLocal& operator=(const ThreadLocal&);
+};
+
 }
 
 #endif
@@ -0,0 +1,627 @@
+#ifndef RESIP_TimerWheel_hxx
+#define RESIP_TimerWheel_hxx
+
+#include <vector>
+#include <cstddef>
+#include <new>
+
+#include "rutil/ResipAssert.h"
+#include "rutil/compat.hxx"
+#include "rutil/Timer.hxx"
+
+namespace resip
+{
+
+/**
+   @brief Identifies a timer held by a TimerWheel. Handles stay safe to use
+   after the timer has fired or been cancelled; cancel() simply reports that
+   there was nothing to remove. Zero is never a valid handle.
+*/
+typedef UInt64 TimerHandle;
+
+/**
+   @brief A hierarchical timing wheel.
+
+   @details Timers are kept in Levels rings of Slots slots each. A timer that
+   is due less than 64 ms from now sits in the slot for its exact millisecond
+   in level 0; one due less than 64^2 ms from now sits in the level 1 slot for
+   its 64 ms interval, and so on. When time reaches the start of a higher
+   level slot, that slot is cascaded (its timers are re-filed into finer
+   levels), so every timer is touched at most Levels times over its lifetime.
+   Timers beyond the range of the top level (about 12 days) are parked in the
+   top level and re-filed whenever they are cascaded.
+
+   Timers that are due on the same tick fire in the order they were added.
+
+   Insert and cancel are O(1) and do not allocate once the node pool has
+   warmed up; nodes live in fixed-size blocks that are never moved, and are
+   recycled through a free list. Each level keeps a 64 bit occupancy map, so
+   skipping over idle stretches costs a handful of bit operations per level.
+
+   T must be copy-constructible and provide UInt64 getWhen() const, giving
+   the absolute expiry in milliseconds (see Timer::getTimeMs()).
+
+   @ingroup data_structures
+*/
+template <class T>
+class TimerWheel
+{
+   public:
+      TimerWheel() :
+         mCurrent(Timer::getTimeMs()),
+         mSize(0),
+         mFreeList(Nil),
+         mNextExpiry(0),
+         mNextExpiryValid(true)
+      {
+         for(int level=0; level<Levels; ++level)
+         {
+            mOccupied[level]=0;
+            for(int slot=0; slot<Slots; ++slot)
+            {
+               mSlots[level][slot]=Nil;
+               mTails[level][slot]=Nil;
+            }
+         }
+      }
+
+      ~TimerWheel()
+      {
+         clear();
+         for(typename std::vector<Node*>::iterator i=mBlocks.begin(); i!=mBlocks.end(); ++i)
+         {
+            delete [] *i;
+         }
+      }
+
+      /**
+         @brief Schedules a copy of timer to fire at timer.getWhen().
+         @note Timers that are already due fire on the next call to expire().
+      */
+      TimerHandle add(const T& timer)
+      {
+         UInt32 index = allocNode();
+         Node& n = node(index);
+         new (n.mStorage.mBytes) T(timer);
+         link(index, false);
+         ++mSize;
+
+         if(mNextExpiryValid)
+         {
+            UInt64 when = dueTick(timer.getWhen());
+            if(mSize==1 || when < mNextExpiry)
+            {
+               mNextExpiry = when;
+            }
+         }
+         return makeHandle(index, n.mGeneration);
+      }
+
+      /**
+         @brief Removes a pending timer.
+         @return true if the timer was pending, false if it had already fired,
+            been cancelled, or the handle is invalid.
+      */
+      bool cancel(TimerHandle handle)
+      {
+         UInt32 index;
+         if(!lookup(handle, index))
+         {
+            return false;
+         }
+         unlink(index);
+         releaseNode(index);
+         return true;
+      }
+
+      /// @return the pending timer for handle, or 0 if it is no longer pending
+      const T* find(TimerHandle handle) const
+      {
+         UInt32 index;
+         if(!lookup(handle, index))
+         {
+            return 0;
+         }
+         return &value(node(index));
+      }
+
+      bool isPending(TimerHandle handle) const
+      {
+         UInt32 index;
+         return lookup(handle, index);
+      }
+
+      size_t size() const
+      {
+         return mSize;
+      }
+
+      bool empty() const
+      {
+         return mSize==0;
+      }
+
+      /**
+         @brief Returns the expiry of the earliest pending timer, or 0 if the
+            wheel is empty. Timers that were added after they were already due
+            report the time of the next tick instead.
+      */
+      UInt64 nextExpiry() const
+      {
+         if(mSize==0)
+         {
+            return 0;
+         }
+         if(!mNextExpiryValid)
+         {
+            mNextExpiry = computeNextExpiry();
+            mNextExpiryValid = true;
+         }
+         return mNextExpiry;
+      }
+
+      /**
+         @brief Fires every timer due at or before now, in order of expiry, by
+            calling onExpire(const T&). The timer is no longer in the wheel
+            when onExpire runs, so onExpire may add new timers.
+      */
+      template <class F>
+      void expire(UInt64 now, F& onExpire)
+      {
+         UInt32 index;
+         while((index=dueNode(now))!=Nil)
+         {
+            unlink(index);
+            T timer(value(node(index)));
+            releaseNode(index);
+            onExpire(timer);
+         }
+      }
+
+      /**
+         @brief Returns the handle of a timer that is due at or before now,
+            earliest first, or 0 if there is none. The timer stays in the
+            wheel until it is passed to cancel().
+      */
+      TimerHandle nextExpired(UInt64 now)
+      {
+         UInt32 index = dueNode(now);
+         if(index==Nil)
+         {
+            return 0;
+         }
+         return makeHandle(index, node(index).mGeneration);
+      }
+
+      /// @brief Removes every timer, passing each one to onDiscard(const T&)
+      template <class F>
+      void clear(F& onDiscard)
+      {
+         for(int level=0; level<Levels; ++level)
+         {
+            for(int slot=0; slot<Slots; ++slot)
+            {
+               while(mSlots[level][slot]!=Nil)
+               {
+                  UInt32 index = mSlots[level][slot];
+                  unlink(index);
+                  onDiscard(value(node(index)));
+                  releaseNode(index);
+               }
+            }
+         }
+      }
+
+      /// @brief Removes every timer
+      void clear()
+      {
+         Discard discard;
+         clear(discard);
+      }
+
+   private:
+      enum
+      {
+         SlotBits = 6,
+         Slots = 1 << SlotBits,
+         SlotMask = Slots - 1,
+         Levels = 5,
+         BlockBits = 10,
+         NodesPerBlock = 1 << BlockBits
+      };
+
+      static const UInt32 Nil = 0xFFFFFFFF;
+      static const UInt8 Unlinked = 0xFF;
+
+      class Node
+      {
+         public:
+            union
+            {
+               char mBytes[sizeof(T)];
+               UInt64 mAlignInt;
+               double mAlignDouble;
+               void* mAlignPtr;
+            } mStorage;
+            UInt32 mPrev;
+            UInt32 mNext;
+            UInt32 mGeneration;
+            UInt8 mLevel;
+            UInt8 mSlot;
+      };
+
+      class Discard
+      {
+         public:
+            void operator()(const T&) {}
+      };
+
+      static int levelShift(int level)
+      {
+         return level*SlotBits;
+      }
+
+      static UInt64 levelMask(int level)
+      {
+         return (UInt64(1) << levelShift(level)) - 1;
+      }
+
+      static int lowestBit(UInt64 bits)
+      {
+#if defined(__GNUC__)
+         return __builtin_ctzll(bits);
+#else
+         int bit=0;
+         while((bits & 1)==0)
+         {
+            bits >>= 1;
+            ++bit;
+         }
+         return bit;
+#endif
+      }
+
+      Node& node(UInt32 index)
+      {
+         return mBlocks[index >> BlockBits][index & (NodesPerBlock-1)];
+      }
+
+      const Node& node(UInt32 index) const
+      {
+         return mBlocks[index >> BlockBits][index & (NodesPerBlock-1)];
+      }
+
+      static T& value(Node& n)
+      {
+         return *reinterpret_cast<T*>(n.mStorage.mBytes);
+      }
+
+      static const T& value(const Node& n)
+      {
+         return *reinterpret_cast<const T*>(n.mStorage.mBytes);
+      }
+
+      static TimerHandle makeHandle(UInt32 index, UInt32 generation)
+      {
+         return (TimerHandle(generation) << 32) | TimerHandle(index+1);
+      }
+
+      bool lookup(TimerHandle handle, UInt32& index) const
+      {
+         UInt32 low = (UInt32)(handle & 0xFFFFFFFF);
+         if(low==0)
+         {
+            return false;
+         }
+         index = low-1;
+         if((index >> BlockBits) >= mBlocks.size())
+         {
+            return false;
+         }
+         const Node& n = node(index);
+         return n.mLevel!=Unlinked && n.mGeneration==(UInt32)(handle >> 32);
+      }
+
+      UInt32 allocNode()
+      {
+         if(mFreeList==Nil)
+         {
+            UInt32 first = (UInt32)(mBlocks.size() << BlockBits);
+            Node* block = new Node[NodesPerBlock];
+            mBlocks.push_back(block);
+            for(UInt32 i=NodesPerBlock; i>0; --i)
+            {
+               Node& n = block[i-1];
+               n.mGeneration = 1;
+               n.mLevel = Unlinked;
+               n.mNext = mFreeList;
+               mFreeList = first+i-1;
+            }
+         }
+         UInt32 index = mFreeList;
+         mFreeList = node(index).mNext;
+         return index;
+      }
+
+      void releaseNode(UInt32 index)
+      {
+         Node& n = node(index);
+         if(mNextExpiryValid && dueTick(value(n).getWhen()) <= mNextExpiry)
+         {
+            mNextExpiryValid = false;
+         }
+         value(n).~T();
+         ++n.mGeneration;
+         n.mLevel = Unlinked;
+         n.mNext = mFreeList;
+         mFreeList = index;
+         --mSize;
+      }
+
+      UInt64 dueTick(UInt64 when) const
+      {
+         return when < mCurrent ? mCurrent : when;
+      }
+
+      // Files the node into the slot for its expiry, at the tail, or at the
+      // head if first is set.
+      void link(UInt32 index, bool first)
+      {
+         Node& n = node(index);
+         UInt64 when = dueTick(value(n).getWhen());
+         UInt64 delta = when - mCurrent;
+
+         int level = 0;
+         while(level < Levels-1 && delta >= (UInt64(1) << levelShift(level+1)))
+         {
+            ++level;
+         }
+         if(level==Levels-1 && delta >= (UInt64(1) << levelShift(Levels)))
+         {
+            // Out of range; park it as far out as the top level reaches.
+            when = mCurrent + (UInt64(1) << levelShift(Levels)) - 1;
+         }
+
+         int slot = (int)((when >> levelShift(level)) & SlotMask);
+         UInt32& head = mSlots[level][slot];
+         UInt32& tail = mTails[level][slot];
+         n.mLevel = (UInt8)level;
+         n.mSlot = (UInt8)slot;
+         if(head==Nil)
+         {
+            n.mPrev = Nil;
+            n.mNext = Nil;
+            head = index;
+            tail = index;
+         }
+         else if(first)
+         {
+            n.mPrev = Nil;
+            n.mNext = head;
+            node(head).mPrev = index;
+            head = index;
+         }
+         else
+         {
+            n.mPrev = tail;
+            n.mNext = Nil;
+            node(tail).mNext = index;
+            tail = index;
+         }
+         mOccupied[level] |= (UInt64(1) << slot);
+      }
+
+      void unlink(UInt32 index)
+      {
+         Node& n = node(index);
+         resip_assert(n.mLevel!=Unlinked);
+         UInt32& head = mSlots[n.mLevel][n.mSlot];
+         UInt32& tail = mTails[n.mLevel][n.mSlot];
+         if(n.mPrev!=Nil)
+         {
+            node(n.mPrev).mNext = n.mNext;
+         }
+         else
+         {
+            head = n.mNext;
+         }
+         if(n.mNext!=Nil)
+         {
+            node(n.mNext).mPrev = n.mPrev;
+         }
+         else
+         {
+            tail = n.mPrev;
+         }
+         if(head==Nil)
+         {
+            mOccupied[n.mLevel] &= ~(UInt64(1) << n.mSlot);
+         }
+         n.mLevel = Unlinked;
+      }
+
+      void cascade(int level, int slot)
+      {
+         // Detach first; out-of-range timers can be re-filed into this very
+         // slot. A timer that reaches a finer slot this way was added before
+         // any timer with the same expiry that was filed there directly, so
+         // the cascaded timers go in front, walking from the tail to keep
+         // their own order.
+         UInt32 index = mTails[level][slot];
+         mSlots[level][slot] = Nil;
+         mTails[level][slot] = Nil;
+         mOccupied[level] &= ~(UInt64(1) << slot);
+         while(index!=Nil)
+         {
+            UInt32 prev = node(index).mPrev;
+            link(index, true);
+            index = prev;
+         }
+      }
+
+      // Moves time forward to tick (which must not skip any due slot) and
+      // cascades every coarser slot that starts there. Finer levels go
+      // first: a timer in a coarser slot was added before any with the same
+      // expiry in a finer one, and cascade() puts it in front of them.
+      void advance(UInt64 tick)
+      {
+         mCurrent = tick;
+         mNextExpiryValid = false;
+         for(int level=1; level<Levels; ++level)
+         {
+            if((mCurrent & levelMask(level))==0)
+            {
+               cascade(level, (int)((mCurrent >> levelShift(level)) & SlotMask));
+            }
+         }
+      }
+
+      // Finds a timer due at or before now, moving time forward as far as
+      // needed. Slots that start at mCurrent have always been cascaded
+      // already, so the next event is searched for from mCurrent+1.
+      UInt32 dueNode(UInt64 now)
+      {
+         while(mSize)
+         {
+            UInt32 head = mSlots[0][mCurrent & SlotMask];
+            if(head!=Nil)
+            {
+               return mCurrent <= now ? head : Nil;
+            }
+            UInt64 tick = nextEventTick(mCurrent+1);
+            if(tick==0 || tick > now)
+            {
+               break;
+            }
+            advance(tick);
+         }
+         if(mCurrent < now)
+         {
+            // Nothing is due in (mCurrent, now]; skip ahead.
+            mCurrent = now;
+         }
+         return Nil;
+      }
+
+      // The first tick at or after from at which a slot of this level is due
+      // (fired for level 0, cascaded otherwise), or 0 if the level is empty.
+      UInt64 levelEventTick(int level, UInt64 from) const
+      {
+         UInt64 bits = mOccupied[level];
+         if(bits==0)
+         {
+            return 0;
+         }
+         int shift = levelShift(level);
+         UInt64 first = (from + levelMask(level)) >> shift;
+         int start = (int)(first & SlotMask);
+         UInt64 rotated = start ? ((bits >> start) | (bits << (Slots-start))) : bits;
+         return (first + lowestBit(rotated)) << shift;
+      }
+
+      UInt64 nextEventTick(UInt64 from) const
+      {
+         UInt64 next = 0;
+         for(int level=0; level<Levels; ++level)
+         {
+            UInt64 tick = levelEventTick(level, from);
+            if(tick && (next==0 || tick < next))
+            {
+               next = tick;
+            }
+         }
+         return next;
+      }
+
+      UInt64 computeNextExpiry() const
+      {
+         // Level 0 slots hold a single millisecond. A coarser slot only needs
+         // to be searched if it becomes due before the best answer so far;
+         // all of its timers expire at or after that point.
+         UInt64 best = levelEventTick(0, mCurrent);
+         for(int level=1; level<Levels; ++level)
+         {
+            UInt64 tick = levelEventTick(level, mCurrent);
+            if(tick==0 || (best && tick >= best))
+            {
+               continue;
+            }
+            int slot = (int)((tick >> levelShift(level)) & SlotMask);
+            for(UInt32 index=mSlots[level][slot]; index!=Nil; index=node(index).mNext)
+            {
+               UInt64 when = dueTick(value(node(index)).getWhen());
+               if(best==0 || when < best)
+               {
+                  best = when;
+               }
+            }
+         }
+         return best;
+      }
+
+      UInt64 mCurrent;
+      size_t mSize;
+      UInt32 mFreeList;
+      UInt32 mSlots[Levels][Slots];
+      UInt32 mTails[Levels][Slots];
+      UInt64 mOccupied[Levels];
+      std::vector<Node*> mBlocks;
+      mutable UInt64 mNextExpiry;
+      mutable bool mNextExpiryValid;
+
+      // no value semantics
+      TimerWheel(const TimerWheel&);
+      TimerWheel& operator=(const TimerWheel&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
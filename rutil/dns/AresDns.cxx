@@ -374,6 +374,29 @@ AresDns::internalInit(const std::vector<GenericIPAddress>& additionalNameservers
       }
 #endif
 
+      // Both libraries use one port for all servers; honour one given with
+      // the first additional nameserver.
+      unsigned short port = additionalNameservers[0].v4Address.sin_port;
+#ifdef USE_IPV6
+      if (!additionalNameservers[0].isVersion4())
+      {
+         port = additionalNameservers[0].v6Address.sin6_port;
+      }
+#endif
+      if (port != 0 && port != htons(NAMESERVER_PORT))
+      {
+         optmask |= ARES_OPT_UDP_PORT | ARES_OPT_TCP_PORT;
+#if defined(USE_ARES)
+         // contrib/ares takes it in network byte order
+         opt.udp_port = port;
+         opt.tcp_port = port;
+#elif defined(USE_CARES)
+         // c-ares takes it in host byte order
+         opt.udp_port = ntohs(port);
+         opt.tcp_port = ntohs(port);
+#endif
+      }
+
 #if defined(USE_ARES)
       status = ares_init_options_with_socket_function(channel, &opt, optmask, socketfunc);
 #elif defined(USE_CARES)
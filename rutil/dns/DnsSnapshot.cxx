@@ -0,0 +1,184 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include "rutil/dns/DnsSnapshot.hxx"
+
+using namespace resip;
+
+void
+DnsSnapshotWriter::putUInt8(UInt8 value)
+{
+   mOut += (char)value;
+}
+
+void
+DnsSnapshotWriter::putUInt16(UInt16 value)
+{
+   putUInt8((UInt8)(value >> 8));
+   putUInt8((UInt8)(value & 0xff));
+}
+
+void
+DnsSnapshotWriter::putUInt32(UInt32 value)
+{
+   putUInt16((UInt16)(value >> 16));
+   putUInt16((UInt16)(value & 0xffff));
+}
+
+void
+DnsSnapshotWriter::putUInt64(UInt64 value)
+{
+   putUInt32((UInt32)(value >> 32));
+   putUInt32((UInt32)(value & 0xffffffff));
+}
+
+void
+DnsSnapshotWriter::putData(const Data& value)
+{
+   putUInt32((UInt32)value.size());
+   mOut += value;
+}
+
+void
+DnsSnapshotWriter::putDomain(const Data& name)
+{
+   const char* label = name.data();
+   const char* end = name.data() + name.size();
+   while (label < end)
+   {
+      const char* dot = label;
+      while (dot < end && *dot != '.')
+      {
+         ++dot;
+      }
+      if (dot > label)
+      {
+         putUInt8((UInt8)(dot - label));
+         mOut.append(label, (Data::size_type)(dot - label));
+      }
+      label = dot + 1;
+   }
+   putUInt8(0);
+}
+
+void
+DnsSnapshotWriter::putCharacterString(const Data& value)
+{
+   Data::size_type size = value.size() > 255 ? 255 : value.size();
+   putUInt8((UInt8)size);
+   mOut.append(value.data(), size);
+}
+
+bool
+DnsSnapshotReader::getUInt8(UInt8& value)
+{
+   if (mPos + 1 > mIn.size())
+   {
+      return false;
+   }
+   value = (UInt8)mIn[mPos++];
+   return true;
+}
+
+bool
+DnsSnapshotReader::getUInt16(UInt16& value)
+{
+   UInt8 high = 0;
+   UInt8 low = 0;
+   if (!getUInt8(high) || !getUInt8(low))
+   {
+      return false;
+   }
+   value = (UInt16)((high << 8) | low);
+   return true;
+}
+
+bool
+DnsSnapshotReader::getUInt32(UInt32& value)
+{
+   UInt16 high = 0;
+   UInt16 low = 0;
+   if (!getUInt16(high) || !getUInt16(low))
+   {
+      return false;
+   }
+   value = ((UInt32)high << 16) | low;
+   return true;
+}
+
+bool
+DnsSnapshotReader::getUInt64(UInt64& value)
+{
+   UInt32 high = 0;
+   UInt32 low = 0;
+   if (!getUInt32(high) || !getUInt32(low))
+   {
+      return false;
+   }
+   value = ((UInt64)high << 32) | low;
+   return true;
+}
+
+bool
+DnsSnapshotReader::getData(Data& value)
+{
+   UInt32 size = 0;
+   if (!getUInt32(size) || size > mIn.size() - mPos)
+   {
+      return false;
+   }
+   value = Data(mIn.data() + mPos, size);
+   mPos += size;
+   return true;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,108 @@
+#ifndef RESIP_DNSSNAPSHOT_HXX
+#define RESIP_DNSSNAPSHOT_HXX
+
+#include "rutil/Data.hxx"
+#include "rutil/compat.hxx"
+
+namespace resip
+{
+
+/**
+   Writes the compact binary form of DnsStub's cache snapshot file:
+   integers in network byte order, and Data as a 32 bit length followed
+   by its bytes.
+*/
+class DnsSnapshotWriter
+{
+   public:
+      explicit DnsSnapshotWriter(Data& out) : mOut(out) {}
+
+      void putUInt8(UInt8 value);
+      void putUInt16(UInt16 value);
+      void putUInt32(UInt32 value);
+      void putUInt64(UInt64 value);
+      void putData(const Data& value);
+      // A domain name as DNS labels, and a DNS character-string (at most
+      // 255 bytes), for building resource records.
+      void putDomain(const Data& name);
+      void putCharacterString(const Data& value);
+
+   private:
+      Data& mOut;
+};
+
+/**
+   Reads what DnsSnapshotWriter wrote. Every get fails, rather than read
+   past the end, once the input runs out; the caller then gives up on the
+   rest of the snapshot.
+*/
+class DnsSnapshotReader
+{
+   public:
+      explicit DnsSnapshotReader(const Data& in) : mIn(in), mPos(0) {}
+
+      bool getUInt8(UInt8& value);
+      bool getUInt16(UInt16& value);
+      bool getUInt32(UInt32& value);
+      bool getUInt64(UInt64& value);
+      bool getData(Data& value);
+      bool atEnd() const { return mPos >= mIn.size(); }
+
+   private:
+      const Data& mIn;
+      Data::size_type mPos;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -6,6 +6,10 @@
 //	MS non-consistent declaration of time_t. we defined _USE_32BIT_TIME_T
 //	in all projects and that solved the issue with beta compiler, however
 //	release version messes time_t definition again
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
 #include <set>
 #include <vector>
 #include "rutil/ResipAssert.h"
@@ -25,6 +29,7 @@
 #include "rutil/BaseException.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/Inserter.hxx"
+#include "rutil/dns/DnsSnapshot.hxx"
 #include "rutil/dns/DnsStub.hxx"
 #include "rutil/dns/ExternalDns.hxx"
 #include "rutil/dns/ExternalDnsFactory.hxx"
@@ -88,7 +93,18 @@ DnsStub::DnsStub(const NameserverList& additional,
    mTransform(0),
    mDnsProvider(ExternalDnsFactory::createExternalDns()),
    mPollGrp(0),
-   mAsyncProcessHandler(asyncProcessHandler)
+   mAsyncProcessHandler(asyncProcessHandler),
+   mPrefetchWindow(0),
+   mPrefetchMinHits(0),
+   mNextPrefetchSweep(0),
+   mCacheHits(0),
+   mCacheMisses(0),
+   mPrefetches(0),
+   mStaleAnswers(0),
+   mWireQueries(0),
+   mCoalescedQueries(0),
+   mSnapshotInterval(0),
+   mNextSnapshot(0)
 {
    setPollGrp(pollGrp);
 
@@ -115,16 +131,43 @@ DnsStub::~DnsStub()
    {
       delete *it;
    }
+   // the queries waiting on these are gone; the provider may still call
+   // back into them while it is destroyed
+   for (InFlightQueries::iterator it = mInFlightQueries.begin(); it != mInFlightQueries.end(); ++it)
+   {
+      it->second->mQueries.clear();
+      it->second->mDetached = true;
+      mDetachedInFlightQueries.insert(it->second);
+   }
+   mInFlightQueries.clear();
 
    setPollGrp(0);
    delete mDnsProvider;
+
+   for (set<InFlightQuery*>::iterator it = mDetachedInFlightQueries.begin(); it != mDetachedInFlightQueries.end(); ++it)
+   {
+      delete *it;
+   }
 }
 
 unsigned int
 DnsStub::getTimeTillNextProcessMS()
 {
     if(mCommandFifo.size() > 0) return 0;
-    return mDnsProvider->getTimeTillNextProcessMS();
+    unsigned int ms = mDnsProvider->getTimeTillNextProcessMS();
+    if (mPrefetchWindow)
+    {
+       UInt64 now = Timer::getTimeMs();
+       unsigned int untilSweep = mNextPrefetchSweep > now ? (unsigned int)(mNextPrefetchSweep - now) : 0;
+       ms = resipMin(ms, untilSweep);
+    }
+    if (!mSnapshotPath.empty() && mSnapshotInterval)
+    {
+       UInt64 now = Timer::getTimeMs();
+       unsigned int untilSnapshot = mNextSnapshot > now ? (unsigned int)resipMin(mNextSnapshot - now, (UInt64)UINT_MAX) : 0;
+       ms = resipMin(ms, untilSnapshot);
+    }
+    return ms;
 }
 
 void
@@ -151,6 +194,9 @@ DnsStub::process(FdSet& fdset)
    mSelectInterruptor.process(fdset);
    processFifo();
    mDnsProvider->process(fdset.read, fdset.write);
+   prefetch();
+   saveSnapshotIfDue();
+   mRRCache.reclaim();
 }
 
 void
@@ -159,6 +205,183 @@ DnsStub::processTimers()
    // the fifo is captures as a timer within getTimeTill... above
    processFifo();
    mDnsProvider->processTimers();
+   prefetch();
+   saveSnapshotIfDue();
+   mRRCache.reclaim();
+}
+
+void
+DnsStub::prefetch()
+{
+   if (mPrefetchWindow == 0 || Timer::getTimeMs() < mNextPrefetchSweep)
+   {
+      return;
+   }
+   mNextPrefetchSweep = Timer::getTimeMs() + PrefetchSweepMs;
+
+   vector<pair<Data, int> > candidates;
+   mRRCache.getRefreshCandidates(mPrefetchWindow, mPrefetchMinHits, candidates);
+   for (vector<pair<Data, int> >::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+   {
+      DebugLog(<< "Prefetching " << it->first << " type " << it->second);
+      ++mPrefetches;
+      refresh(it->first, it->second);
+   }
+}
+
+// Snapshot file: a header, then sections, each a name and a body. The
+// "cache" section holds the RRCache; the others belong to SnapshotHandlers.
+static const UInt32 SnapshotMagic = 0x52444e53; // "RDNS"
+static const UInt16 SnapshotVersion = 1;
+static const Data SnapshotCacheSection("cache");
+
+void
+DnsStub::saveSnapshotIfDue()
+{
+   if (mSnapshotPath.empty() || mSnapshotInterval == 0 || Timer::getTimeMs() < mNextSnapshot)
+   {
+      return;
+   }
+   mNextSnapshot = Timer::getTimeMs() + mSnapshotInterval;
+   saveSnapshot();
+}
+
+void
+DnsStub::saveSnapshot()
+{
+   Data snapshot;
+   DnsSnapshotWriter out(snapshot);
+   out.putUInt32(SnapshotMagic);
+   out.putUInt16(SnapshotVersion);
+   out.putUInt64((UInt64)time(0));
+
+   Data section;
+   DnsSnapshotWriter sectionOut(section);
+   mRRCache.saveSnapshot(sectionOut);
+   out.putData(SnapshotCacheSection);
+   out.putData(section);
+   for (SnapshotHandlers::const_iterator it = mSnapshotHandlers.begin(); it != mSnapshotHandlers.end(); ++it)
+   {
+      section.clear();
+      it->second->saveSnapshot(sectionOut);
+      out.putData(it->first);
+      out.putData(section);
+   }
+
+   // write a new file and move it into place, so that a crash part way
+   // through leaves the previous snapshot intact
+   const Data tmpPath = mSnapshotPath + ".tmp";
+   {
+      std::ofstream file(tmpPath.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+      file.write(snapshot.data(), snapshot.size());
+      if (!file)
+      {
+         WarningLog(<< "Could not write DNS cache snapshot " << tmpPath);
+         return;
+      }
+   }
+#ifdef WIN32
+   ::remove(mSnapshotPath.c_str());
+#endif
+   if (::rename(tmpPath.c_str(), mSnapshotPath.c_str()) != 0)
+   {
+      WarningLog(<< "Could not move DNS cache snapshot into " << mSnapshotPath);
+      return;
+   }
+   DebugLog(<< "Saved " << snapshot.size() << " byte DNS cache snapshot to " << mSnapshotPath);
+}
+
+void
+DnsStub::loadSnapshot()
+{
+   Data snapshot;
+   try
+   {
+      snapshot = Data::fromFile(mSnapshotPath);
+   }
+   catch (BaseException&)
+   {
+      InfoLog(<< "No DNS cache snapshot in " << mSnapshotPath);
+      return;
+   }
+
+   DnsSnapshotReader in(snapshot);
+   UInt32 magic = 0;
+   UInt16 version = 0;
+   UInt64 savedAt = 0;
+   if (!in.getUInt32(magic) || magic != SnapshotMagic ||
+       !in.getUInt16(version) || version != SnapshotVersion ||
+       !in.getUInt64(savedAt))
+   {
+      WarningLog(<< "Ignoring " << mSnapshotPath << ": not a DNS cache snapshot");
+      return;
+   }
+   const UInt64 now = (UInt64)time(0);
+   const UInt64 ageSecs = now > savedAt ? now - savedAt : 0;
+
+   while (!in.atEnd())
+   {
+      Data name;
+      Data section;
+      if (!in.getData(name) || !in.getData(section))
+      {
+         WarningLog(<< "DNS cache snapshot " << mSnapshotPath << " is truncated");
+         return;
+      }
+      DnsSnapshotReader sectionIn(section);
+      if (name == SnapshotCacheSection)
+      {
+         int restored = mRRCache.loadSnapshot(sectionIn, ageSecs);
+         if (restored < 0)
+         {
+            WarningLog(<< "DNS cache snapshot " << mSnapshotPath << " is corrupt");
+         }
+         else
+         {
+            InfoLog(<< "Restored " << restored << " DNS cache entries saved " << ageSecs << "s ago");
+         }
+         continue;
+      }
+      SnapshotHandlers::iterator handler = mSnapshotHandlers.find(name);
+      if (handler != mSnapshotHandlers.end())
+      {
+         handler->second->loadSnapshot(sectionIn, ageSecs);
+      }
+   }
+}
+
+void
+DnsStub::refresh(const Data& target, int rrType)
+{
+   if (mDnsProvider->hostFileLookupLookupOnlyMode())
+   {
+      mRRCache.endRefresh(target, rrType);
+      return;
+   }
+
+   switch (rrType)
+   {
+      case T_A:
+         refreshQuery<RR_A>(target);
+         break;
+#ifdef USE_IPV6
+      case T_AAAA:
+         refreshQuery<RR_AAAA>(target);
+         break;
+#endif
+      case T_SRV:
+         refreshQuery<RR_SRV>(target);
+         break;
+      case T_NAPTR:
+         refreshQuery<RR_NAPTR>(target);
+         break;
+      case T_CNAME:
+         refreshQuery<RR_CNAME>(target);
+         break;
+      default:
+         mRRCache.endRefresh(target, rrType);
+         break;
+   }
 }
 
 void 
@@ -375,6 +598,28 @@ DnsStub::removeQuery(Query* query)
    }
 }
 
+bool
+DnsStub::cachedCname(const Data& target, int rrType, Data& targetToQuery) const
+{
+   if (rrType == T_CNAME)
+   {
+      return false;
+   }
+   targetToQuery = target;
+   for (int i = 0; i < Query::MAX_REQUERIES; ++i)
+   {
+      vector<DnsCnameRecord> cnames;
+      int status = 0;
+      if (!mRRCache.concurrentCache().lookup(targetToQuery, T_CNAME, cnames, status) || cnames.empty())
+      {
+         return targetToQuery != target;
+      }
+      targetToQuery = cnames[0].cname();
+   }
+   // a chain this long is probably a loop; let the DNS thread deal with it
+   return false;
+}
+
 void
 DnsStub::setResultTransform(ResultTransform* transform)
 {
@@ -409,7 +654,8 @@ DnsStub::setPollGrp(FdPollGrp* pollGrp)
 
 DnsStub::Query::Query(DnsStub& stub, ResultTransform* transform, ResultConverter* resultConv,
                       const Data& target, int rrType,
-                      bool followCname, int proto, DnsResultSink* s)
+                      bool followCname, int proto, DnsResultSink* s,
+                      bool refresh)
    : mRRType(rrType),
      mStub(stub),
      mTransform(transform),
@@ -418,13 +664,19 @@ DnsStub::Query::Query(DnsStub& stub, ResultTransform* transform, ResultConverter
      mProto(proto),
      mReQuery(0),
      mSink(s),
-     mFollowCname(followCname)
+     mFollowCname(followCname),
+     mRefresh(refresh)
 {
    resip_assert(s);
 }
 
 DnsStub::Query::~Query()
 {
+   if (mRefresh)
+   {
+      // a successful answer already cleared this when it updated the cache
+      mStub.mRRCache.endRefresh(mTarget, mRRType);
+   }
    delete mResultConverter; //.dcm. flyweight?
 }
 
@@ -465,11 +717,19 @@ DnsStub::Query::go()
 {
    StackLog(<< "DNS query of:" << mTarget << " " << typeToData(mRRType));
 
+   if (mRefresh)
+   {
+      StackLog(<< "Refreshing " << mTarget << " from external dns");
+      mStub.lookupRecords(mTarget, mRRType, this);
+      return;
+   }
+
    DnsResourceRecordsByPtr records;
    int status = 0;
    bool cached = false;
+   bool stale = false;
    Data targetToQuery = mTarget;
-   cached = mStub.mRRCache.lookup(mTarget, mRRType, mProto, records, status);
+   cached = mStub.mRRCache.lookup(mTarget, mRRType, mProto, records, status, stale);
 
    if (!cached)
    {
@@ -490,11 +750,12 @@ DnsStub::Query::go()
    if (targetToQuery != mTarget)
    {
       StackLog(<< mTarget << " mapped to CNAME " << targetToQuery);
-      cached = mStub.mRRCache.lookup(targetToQuery, mRRType, mProto, records, status);
+      cached = mStub.mRRCache.lookup(targetToQuery, mRRType, mProto, records, status, stale);
    }
 
    if (!cached)
    {
+      ++mStub.mCacheMisses;
       if(mStub.mDnsProvider && mStub.mDnsProvider->hostFileLookupLookupOnlyMode())
       {
          resip_assert(mRRType == T_A);
@@ -531,6 +792,16 @@ DnsStub::Query::go()
    }
    else // is cached
    {
+      ++mStub.mCacheHits;
+      if (stale)
+      {
+         ++mStub.mStaleAnswers;
+         if (mStub.mRRCache.startRefresh(targetToQuery, mRRType))
+         {
+            StackLog(<< "Answering " << targetToQuery << " from an expired entry while refreshing it");
+            mStub.refresh(targetToQuery, mRRType);
+         }
+      }
       if (mTransform && !records.empty())
       {
          mTransform->transform(mTarget, mRRType, records);
@@ -543,7 +814,7 @@ DnsStub::Query::go()
 }
 
 void
-DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
+DnsStub::Query::process(int status, const unsigned char* abuf, const int alen, bool& answerCached)
 {
    if (status != 0)
    {
@@ -578,7 +849,11 @@ DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
             }
             try
             {
-               mStub.cacheTTL(mTarget, mRRType, status, abuf, alen);
+               if (!answerCached)
+               {
+                  mStub.cacheTTL(mTarget, mRRType, status, abuf, alen);
+                  answerCached = true;
+               }
             }
             catch (BaseException& e)
             {
@@ -661,7 +936,7 @@ DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
    {
       bool bGotAnswers = true;
       Data targetToQuery;
-      followCname(aptr, abuf, alen, bGotAnswers, bDeleteThis, targetToQuery);
+      followCname(aptr, abuf, alen, bGotAnswers, bDeleteThis, targetToQuery, answerCached);
 
       if (bGotAnswers)
       {
@@ -689,11 +964,12 @@ DnsStub::Query::process(int status, const unsigned char* abuf, const int alen)
 void
 DnsStub::Query::onDnsRaw(int status, const unsigned char* abuf, int alen)
 {
-   process(status, abuf, alen);
+   bool answerCached = false;
+   process(status, abuf, alen, answerCached);
 }
 
 void
-DnsStub::Query::followCname(const unsigned char* aptr, const unsigned char*abuf, const int alen, bool& bGotAnswers, bool& bDeleteThis, Data& targetToQuery)
+DnsStub::Query::followCname(const unsigned char* aptr, const unsigned char*abuf, const int alen, bool& bGotAnswers, bool& bDeleteThis, Data& targetToQuery, bool& answerCached)
 {
    bGotAnswers = true;
    bDeleteThis = true;
@@ -714,7 +990,11 @@ DnsStub::Query::followCname(const unsigned char* aptr, const unsigned char*abuf,
 
    try
    {
-      mStub.cache(name, abuf, alen);
+      if (!answerCached)
+      {
+         mStub.cache(name, abuf, alen);
+         answerCached = true;
+      }
    }
    catch (BaseException& e)
    {
@@ -772,9 +1052,69 @@ DnsStub::errorMessage(int status)
 }
 
 void
-DnsStub::lookupRecords(const Data& target, unsigned short type, DnsRawSink* sink)
+DnsStub::lookupRecords(const Data& target, unsigned short type, Query* query)
+{
+   InFlightQuery::Key key(Data(target).lowercase(), type);
+   InFlightQueries::iterator it = mInFlightQueries.find(key);
+   if (it != mInFlightQueries.end())
+   {
+      StackLog(<< "Waiting on the outstanding query for " << target << " " << typeToData(type));
+      ++mCoalescedQueries;
+      it->second->mQueries.push_back(query);
+      return;
+   }
+
+   // in the map before the lookup, which may answer straight away
+   InFlightQuery* inFlight = new InFlightQuery(*this, key);
+   inFlight->mQueries.push_back(query);
+   mInFlightQueries[key] = inFlight;
+   ++mWireQueries;
+   mDnsProvider->lookup(target.c_str(), type, this, inFlight);
+}
+
+void
+DnsStub::InFlightQuery::onDnsRaw(int status, const unsigned char* abuf, int alen)
+{
+   if (mDetached)
+   {
+      mStub.mDetachedInFlightQueries.erase(this);
+      delete this;
+      return;
+   }
+
+   // out of the map first, so that a query looking the same thing up again
+   // gets a wire query of its own
+   mStub.mInFlightQueries.erase(mKey);
+   bool answerCached = false;
+   for (vector<Query*>::iterator it = mQueries.begin(); it != mQueries.end(); ++it)
+   {
+      (*it)->process(status, abuf, alen, answerCached);
+   }
+   delete this;
+}
+
+void
+DnsStub::clearInFlightQueries()
 {
-   mDnsProvider->lookup(target.c_str(), type, this, sink);
+   // Out of the map first, so that lookups made by the sinks being failed
+   // get wire queries of their own. The provider still holds each of these
+   // as the userData of a request, so they are kept until it answers.
+   InFlightQueries inFlight;
+   inFlight.swap(mInFlightQueries);
+   for (InFlightQueries::iterator it = inFlight.begin(); it != inFlight.end(); ++it)
+   {
+      InFlightQuery* query = it->second;
+      query->mDetached = true;
+      mDetachedInFlightQueries.insert(query);
+
+      vector<Query*> waiting;
+      waiting.swap(query->mQueries);
+      bool answerCached = false;
+      for (vector<Query*>::iterator q = waiting.begin(); q != waiting.end(); ++q)
+      {
+         (*q)->process(ARES_EDESTRUCTION, 0, 0, answerCached);
+      }
+   }
 }
 
 void
@@ -880,6 +1220,11 @@ DnsStub::doReloadDnsServers()
         doClearDnsCache();
 
         mDnsProvider->init(mDnsTimeout, mDnsTries, mDnsFeatures);
+
+        // any outstanding query the provider did not fail will never be
+        // answered; fail whoever waits on it, and keep later lookups from
+        // waiting on it
+        clearInFlightQueries();
     }
 }
 
@@ -895,6 +1240,70 @@ DnsStub::setDnsCacheSize(int size)
    mRRCache.setSize(size);
 }
 
+void
+DnsStub::setDnsPrefetch(unsigned int windowSecs, unsigned int minHits)
+{
+   mPrefetchWindow = windowSecs;
+   mPrefetchMinHits = minHits;
+}
+
+void
+DnsStub::setDnsMaxStale(int maxStaleSecs)
+{
+   mRRCache.setMaxStale(maxStaleSecs);
+}
+
+void
+DnsStub::setDnsCacheSnapshot(const Data& path, unsigned int intervalSecs)
+{
+   queueCommand(new SetDnsCacheSnapshotCommand(*this, path, intervalSecs));
+}
+
+void
+DnsStub::doSetDnsCacheSnapshot(const Data& path, unsigned int intervalSecs)
+{
+   mSnapshotPath = path;
+   mSnapshotInterval = (UInt64)intervalSecs * 1000;
+   mNextSnapshot = Timer::getTimeMs() + mSnapshotInterval;
+   if (!mSnapshotPath.empty())
+   {
+      loadSnapshot();
+   }
+}
+
+void
+DnsStub::addSnapshotHandler(const Data& name, SnapshotHandler* handler)
+{
+   resip_assert(name != SnapshotCacheSection);
+   mSnapshotHandlers[name] = handler;
+}
+
+void
+DnsStub::removeSnapshotHandler(const Data& name)
+{
+   mSnapshotHandlers.erase(name);
+}
+
+void
+DnsStub::saveDnsCacheSnapshot()
+{
+   if (!mSnapshotPath.empty())
+   {
+      saveSnapshot();
+   }
+}
+
+void
+DnsStub::getCacheStatistics(CacheStatistics& stats) const
+{
+   stats.hits = mCacheHits.load();
+   stats.misses = mCacheMisses.load();
+   stats.prefetches = mPrefetches.load();
+   stats.staleAnswers = mStaleAnswers.load();
+   stats.wireQueries = mWireQueries.load();
+   stats.coalescedQueries = mCoalescedQueries.load();
+}
+
 /* ====================================================================
  * The Vovida Software License, Version 1.0 
  * 
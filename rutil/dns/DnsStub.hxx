@@ -6,6 +6,7 @@
 #endif
 
 
+#include <atomic>
 #include <vector>
 #include <list>
 #include <map>
@@ -31,6 +32,8 @@
 namespace resip
 {
 class FdPollGrp;
+class DnsSnapshotWriter;
+class DnsSnapshotReader;
 
 class GetDnsCacheDumpHandler
 {
@@ -130,6 +133,17 @@ class DnsStub : public ExternalDnsHandler
             virtual void transform(const Data& target, int rrType, DnsResourceRecordsByPtr& src) = 0;
       };
 
+      // State kept beside the cache that should survive a restart with it;
+      // see setDnsCacheSnapshot(). Called on the DNS thread.
+      class SnapshotHandler
+      {
+         public:
+            virtual ~SnapshotHandler() {}
+            virtual void saveSnapshot(DnsSnapshotWriter& out) = 0;
+            // ageSecs is how long ago the snapshot was saved.
+            virtual void loadSnapshot(DnsSnapshotReader& in, UInt64 ageSecs) = 0;
+      };
+
       class DnsStubException : public BaseException
       {
          public:
@@ -179,6 +193,40 @@ class DnsStub : public ExternalDnsHandler
       void getDnsCacheDump(std::pair<unsigned long, unsigned long> key, GetDnsCacheDumpHandler* handler);
       void setDnsCacheTTL(int ttl);
       void setDnsCacheSize(int size);
+      // Re-queries popular answers in the background before they expire: an
+      // answer with at least minHits hits since it was last fetched is
+      // refreshed once it is within windowSecs of its TTL. A windowSecs of 0
+      // (the default) turns prefetching off.
+      void setDnsPrefetch(unsigned int windowSecs, unsigned int minHits);
+      // Lets an expired answer still be returned for up to maxStaleSecs; each
+      // time it is, a query to refresh it is sent if none is outstanding.
+      void setDnsMaxStale(int maxStaleSecs);
+
+      class CacheStatistics
+      {
+         public:
+            CacheStatistics() : hits(0), misses(0), prefetches(0), staleAnswers(0),
+                                wireQueries(0), coalescedQueries(0) {}
+            unsigned int hits;         // queries answered from the cache
+            unsigned int misses;       // queries that had to go to the resolver
+            unsigned int prefetches;   // answers refreshed before they expired
+            unsigned int staleAnswers; // queries answered with an expired answer
+            unsigned int wireQueries;  // queries sent to the resolver
+            unsigned int coalescedQueries; // queries that waited on an identical one instead
+      };
+      void getCacheStatistics(CacheStatistics& stats) const;
+
+      // Restores the cache from the snapshot file at path, then saves it
+      // back there every intervalSecs (if not 0), so a restarted process
+      // starts out with the answers it had. Answers that expired in the
+      // meantime are dropped. An empty path turns this off.
+      void setDnsCacheSnapshot(const Data& path, unsigned int intervalSecs);
+      // Adds handler's state to the snapshot as the section called name.
+      // Only call these, and saveDnsCacheSnapshot() (e.g. at shutdown),
+      // while the DNS thread is not running.
+      void addSnapshotHandler(const Data& name, SnapshotHandler* handler);
+      void removeSnapshotHandler(const Data& name);
+      void saveDnsCacheSnapshot();
       void reloadDnsServers();
       bool checkDnsChange();
       bool supportedType(int);
@@ -201,6 +249,38 @@ class DnsStub : public ExternalDnsHandler
          queueCommand(command);
       }
 
+      // False while a ResultTransform is set; lookupCached() then never
+      // answers.
+      bool canLookupCached() const { return mTransform == 0; }
+
+      // Answers a lookup from the cache without queueing a command, so it
+      // may be called from any thread. Follows cached CNAMEs like lookup()
+      // does. Returns false if the answer is not cached (or a
+      // ResultTransform is set); use lookup() then.
+      template<class QueryType> bool lookupCached(const Data& target, DNSResult<typename QueryType::Type>& result) const
+      {
+         if (!canLookupCached())
+         {
+            return false;
+         }
+         std::vector<typename QueryType::Type> records;
+         int status = 0;
+         if (!mRRCache.concurrentCache().lookup(target, QueryType::getRRType(), records, status))
+         {
+            Data targetToQuery;
+            if (!cachedCname(target, QueryType::getRRType(), targetToQuery) ||
+                !mRRCache.concurrentCache().lookup(targetToQuery, QueryType::getRRType(), records, status))
+            {
+               return false;
+            }
+         }
+         result.domain = target;
+         result.status = status;
+         result.msg = Data(Data::Take, mDnsProvider->errorMessage(status));
+         result.records.swap(records);
+         return true;
+      }
+
       virtual void handleDnsRaw(ExternalDnsRawResult);
 
       virtual void process(FdSet& fdset);
@@ -213,6 +293,11 @@ class DnsStub : public ExternalDnsHandler
 
   private:
       void processFifo();
+      void prefetch();
+      void refresh(const Data& target, int rrType);
+      void saveSnapshotIfDue();
+      void saveSnapshot();
+      void loadSnapshot();
 
    protected:
       void cache(const Data& key, in_addr addr);
@@ -259,15 +344,19 @@ class DnsStub : public ExternalDnsHandler
       {
          public:
             Query(DnsStub& stub, ResultTransform* transform, ResultConverter* resultConv, 
-                  const Data& target, int rrType, bool followCname, int proto, DnsResultSink* s);
+                  const Data& target, int rrType, bool followCname, int proto, DnsResultSink* s,
+                  bool refresh=false);
             virtual ~Query();
 
             enum {MAX_REQUERIES = 5};
 
             void go();
-            void process(int status, const unsigned char* abuf, const int alen);
+            // answerCached: on entry, whether another query waiting on the
+            // same answer has already put it in the cache; set once this
+            // one has.
+            void process(int status, const unsigned char* abuf, const int alen, bool& answerCached);
             void onDnsRaw(int status, const unsigned char* abuf, int alen);
-            void followCname(const unsigned char* aptr, const unsigned char*abuf, const int alen, bool& bGotAnswers, bool& bDeleteThis, Data& targetToQuery);
+            void followCname(const unsigned char* aptr, const unsigned char*abuf, const int alen, bool& bGotAnswers, bool& bDeleteThis, Data& targetToQuery, bool& answerCached);
 
          private:
             static DnsResourceRecordsByPtr Empty;
@@ -280,6 +369,7 @@ class DnsStub : public ExternalDnsHandler
             int mReQuery;
             DnsResultSink* mSink;
             bool mFollowCname;
+            bool mRefresh; // skips the cache; the answer is only wanted for it
       };
 
    private:
@@ -300,6 +390,18 @@ class DnsStub : public ExternalDnsHandler
          mQueries.insert(query);
          query->go();
       }
+
+      template<class QueryType>
+      void refreshQuery(const Data& target)
+      {
+         Query* query = new Query(*this, 0,
+                                  new ResultConverterImpl<QueryType>(),
+                                  target, QueryType::getRRType(),
+                                  QueryType::SupportsCName, Protocol::Reserved, &mRefreshSink,
+                                  true);
+         mQueries.insert(query);
+         query->go();
+      }
       
    private:
 
@@ -428,6 +530,26 @@ class DnsStub : public ExternalDnsHandler
             GetDnsCacheDumpHandler* mHandler;
       };
 
+      void doSetDnsCacheSnapshot(const Data& path, unsigned int intervalSecs);
+
+      class SetDnsCacheSnapshotCommand : public Command
+      {
+         public:
+            SetDnsCacheSnapshotCommand(DnsStub& stub, const Data& path, unsigned int intervalSecs)
+               : mStub(stub), mPath(path), mIntervalSecs(intervalSecs)
+            {}
+            ~SetDnsCacheSnapshotCommand() {}
+            void execute()
+            {
+               mStub.doSetDnsCacheSnapshot(mPath, mIntervalSecs);
+            }
+
+         private:
+            DnsStub& mStub;
+            Data mPath;
+            unsigned int mIntervalSecs;
+      };
+
       void doReloadDnsServers();
 
       class ReloadDnsServersCommand : public Command
@@ -460,7 +582,34 @@ class DnsStub : public ExternalDnsHandler
                                          std::vector<RROverlay>&,
                                          bool discard=false);
       void removeQuery(Query*);
-      void lookupRecords(const Data& target, unsigned short type, DnsRawSink* sink);
+
+      // One query sent to the resolver, and the queries waiting for its
+      // answer. Lookups of the same name and type made while it is
+      // outstanding wait on it instead of sending their own. The answer is
+      // cached by the first of them only. A detached one has no queries
+      // waiting any more, and is only kept for the resolver to answer.
+      class InFlightQuery : public DnsRawSink
+      {
+         public:
+            typedef std::pair<Data, int> Key; // lowercased target, rrType
+            InFlightQuery(DnsStub& stub, const Key& key) : mDetached(false), mStub(stub), mKey(key) {}
+            virtual void onDnsRaw(int status, const unsigned char* abuf, int alen);
+
+            std::vector<Query*> mQueries;
+            bool mDetached;
+
+         private:
+            DnsStub& mStub;
+            Key mKey;
+      };
+      typedef std::map<InFlightQuery::Key, InFlightQuery*> InFlightQueries;
+      InFlightQueries mInFlightQueries;
+      std::set<InFlightQuery*> mDetachedInFlightQueries;
+      // Fails the queries waiting on the outstanding ones, and detaches
+      // those.
+      void clearInFlightQueries();
+      bool cachedCname(const Data& target, int rrType, Data& targetToQuery) const;
+      void lookupRecords(const Data& target, unsigned short type, Query* query);
       Data errorMessage(int status);
 
       ResultTransform* mTransform;
@@ -480,6 +629,40 @@ class DnsStub : public ExternalDnsHandler
 
       /// Dns Cache
       RRCache mRRCache;
+
+      class RefreshSink : public DnsResultSink
+      {
+         public:
+            virtual void onDnsResult(const DNSResult<DnsHostRecord>&) {}
+            virtual void onLogDnsResult(const DNSResult<DnsHostRecord>&) {}
+            virtual void onDnsResult(const DNSResult<DnsAAAARecord>&) {}
+            virtual void onLogDnsResult(const DNSResult<DnsAAAARecord>&) {}
+            virtual void onDnsResult(const DNSResult<DnsSrvRecord>&) {}
+            virtual void onLogDnsResult(const DNSResult<DnsSrvRecord>&) {}
+            virtual void onDnsResult(const DNSResult<DnsNaptrRecord>&) {}
+            virtual void onLogDnsResult(const DNSResult<DnsNaptrRecord>&) {}
+            virtual void onDnsResult(const DNSResult<DnsCnameRecord>&) {}
+            virtual void onLogDnsResult(const DNSResult<DnsCnameRecord>&) {}
+      };
+      RefreshSink mRefreshSink;
+
+      static const unsigned int PrefetchSweepMs = 1000;
+      unsigned int mPrefetchWindow; // in seconds
+      unsigned int mPrefetchMinHits;
+      UInt64 mNextPrefetchSweep;
+
+      std::atomic<unsigned int> mCacheHits;
+      std::atomic<unsigned int> mCacheMisses;
+      std::atomic<unsigned int> mPrefetches;
+      std::atomic<unsigned int> mStaleAnswers;
+      std::atomic<unsigned int> mWireQueries;
+      std::atomic<unsigned int> mCoalescedQueries;
+
+      Data mSnapshotPath;
+      UInt64 mSnapshotInterval; // in milliseconds
+      UInt64 mNextSnapshot;
+      typedef std::map<Data, SnapshotHandler*> SnapshotHandlers;
+      SnapshotHandlers mSnapshotHandlers;
 };
 
 typedef DnsStub::Protocol Protocol;
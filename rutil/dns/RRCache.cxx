@@ -30,7 +30,9 @@
 #include "rutil/ResipAssert.h"
 #include "rutil/BaseException.hxx"
 #include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
 #include "rutil/Timer.hxx"
+#include "rutil/dns/DnsSnapshot.hxx"
 #include "rutil/dns/RRFactory.hxx"
 #include "rutil/dns/RROverlay.hxx"
 #include "rutil/dns/RRFactory.hxx"
@@ -46,11 +48,94 @@
 using namespace resip;
 using namespace std;
 
+#define RESIPROCATE_SUBSYSTEM resip::Subsystem::DNS
+
+// The record's RDATA in DNS wire format, as the record factories parse it.
+static bool
+encodeRdata(int rrType, const DnsResourceRecord* record, DnsSnapshotWriter& out)
+{
+   switch (rrType)
+   {
+      case T_A:
+      {
+         const DnsHostRecord* host = dynamic_cast<const DnsHostRecord*>(record);
+         resip_assert(host);
+         out.putUInt32(ntohl(host->addr().s_addr));
+         return true;
+      }
+#ifdef USE_IPV6
+      case T_AAAA:
+      {
+         const DnsAAAARecord* host = dynamic_cast<const DnsAAAARecord*>(record);
+         resip_assert(host);
+         const unsigned char* addr = reinterpret_cast<const unsigned char*>(&host->v6Address());
+         for (size_t i = 0; i < sizeof(in6_addr); ++i)
+         {
+            out.putUInt8(addr[i]);
+         }
+         return true;
+      }
+#endif
+      case T_SRV:
+      {
+         const DnsSrvRecord* srv = dynamic_cast<const DnsSrvRecord*>(record);
+         resip_assert(srv);
+         out.putUInt16((UInt16)srv->priority());
+         out.putUInt16((UInt16)srv->weight());
+         out.putUInt16((UInt16)srv->port());
+         out.putDomain(srv->target());
+         return true;
+      }
+      case T_NAPTR:
+      {
+         const DnsNaptrRecord* naptr = dynamic_cast<const DnsNaptrRecord*>(record);
+         resip_assert(naptr);
+         out.putUInt16((UInt16)naptr->order());
+         out.putUInt16((UInt16)naptr->preference());
+         out.putCharacterString(naptr->flags());
+         out.putCharacterString(naptr->service());
+         // only the two halves of the regexp are kept; put them back
+         // between delimiters that neither contains
+         const Data& regexp = naptr->regexp().regexp();
+         const Data& replacement = naptr->regexp().replacement();
+         Data substitution;
+         if (!regexp.empty() || !replacement.empty())
+         {
+            const char* delims = "!/#|";
+            char delim = *delims;
+            for (; *delims; ++delims)
+            {
+               delim = *delims;
+               if (regexp.find(Data(delim)) == Data::npos &&
+                   replacement.find(Data(delim)) == Data::npos)
+               {
+                  break;
+               }
+            }
+            substitution = Data(delim) + regexp + Data(delim) + replacement + Data(delim);
+         }
+         out.putCharacterString(substitution);
+         out.putDomain(naptr->replacement());
+         return true;
+      }
+      case T_CNAME:
+      {
+         const DnsCnameRecord* cname = dynamic_cast<const DnsCnameRecord*>(record);
+         resip_assert(cname);
+         out.putDomain(cname->cname());
+         return true;
+      }
+      default:
+         return false;
+   }
+}
+
 RRCache::RRCache() 
    : mHead(),
      mLruHead(LruListType::makeList(&mHead)),
      mUserDefinedTTL(DEFAULT_USER_DEFINED_TTL),
-     mSize(DEFAULT_SIZE)
+     mSize(DEFAULT_SIZE),
+     mMaxStale(0)
 {
    mFactoryMap[T_CNAME] = &mCnameRecordFactory;
    mFactoryMap[T_NAPTR] = &mNaptrRecordFacotry;
@@ -77,12 +162,14 @@ RRCache::updateCacheFromHostFile(const DnsHostRecord &record)
    {
       (*lb)->update(record, 3600);
       touch(*lb);
+      mConcurrentCache.publish(**lb);
    }
    else
    {
       RRList* val = new RRList(record, 3600);
       mRRSet.insert(val);
       mLruHead->push_back(val);
+      mConcurrentCache.publish(*val);
       purge();
    }
    delete key;
@@ -104,12 +191,14 @@ RRCache::updateCache(const Data& target,
    {
       (*lb)->update(it->second, begin, end, mUserDefinedTTL);
       touch(*lb);
+      mConcurrentCache.publish(**lb);
    }
    else
    {
       RRList* val = new RRList(it->second, domain, rrType, begin, end, mUserDefinedTTL);
       mRRSet.insert(val);
       mLruHead->push_back(val);
+      mConcurrentCache.publish(*val);
       purge();
    }
    delete key;
@@ -143,6 +232,7 @@ RRCache::cacheTTL(const Data& target,
    }
    mRRSet.insert(val);
    mLruHead->push_back(val);
+   mConcurrentCache.publish(*val);
    purge();
 }
 
@@ -164,10 +254,15 @@ RRCache::lookup(const Data& target,
    }
    else
    {
-      if (Timer::getTimeSecs() >= (*it)->absoluteExpiry())
+      UInt64 now = Timer::getTimeSecs();
+      if (now >= (*it)->absoluteExpiry())
       {
-         delete *it;
-         mRRSet.erase(it);
+         if (isDead(*it, now))
+         {
+            mConcurrentCache.withdraw((*it)->key(), (*it)->rrType());
+            delete *it;
+            mRRSet.erase(it);
+         }
          return false;
       }
       else
@@ -180,6 +275,82 @@ RRCache::lookup(const Data& target,
    }
 }
 
+bool 
+RRCache::lookup(const Data& target, 
+                const int type, 
+                const int protocol,
+                Result& records, 
+                int& status,
+                bool& stale)
+{
+   stale = false;
+   RRList key(target, type);
+   RRSet::iterator it = mRRSet.find(&key);
+   if (it != mRRSet.end() && Timer::getTimeSecs() >= (*it)->absoluteExpiry())
+   {
+      // only positive answers are worth serving stale
+      if ((*it)->status() != 0 || isDead(*it, Timer::getTimeSecs()))
+      {
+         return lookup(target, type, protocol, records, status);
+      }
+      stale = true;
+      records = (*it)->records(protocol);
+      status = 0;
+      touch(*it);
+      return true;
+   }
+   if (lookup(target, type, protocol, records, status))
+   {
+      (*it)->hit();
+      return true;
+   }
+   return false;
+}
+
+void
+RRCache::getRefreshCandidates(unsigned int windowSecs, 
+                              unsigned int minHits, 
+                              std::vector<std::pair<Data, int> >& candidates)
+{
+   UInt64 now = Timer::getTimeSecs();
+   for (RRSet::iterator it = mRRSet.begin(); it != mRRSet.end(); ++it)
+   {
+      RRList* list = *it;
+      if (list->status() == 0 &&
+          !list->refreshing() &&
+          list->absoluteExpiry() <= now + windowSecs &&
+          list->hits() + mConcurrentCache.hits(list->key(), list->rrType()) >= minHits)
+      {
+         list->setRefreshing(true);
+         candidates.push_back(std::make_pair(list->key(), list->rrType()));
+      }
+   }
+}
+
+bool
+RRCache::startRefresh(const Data& target, const int type)
+{
+   RRList key(target, type);
+   RRSet::iterator it = mRRSet.find(&key);
+   if (it == mRRSet.end() || (*it)->refreshing())
+   {
+      return false;
+   }
+   (*it)->setRefreshing(true);
+   return true;
+}
+
+void
+RRCache::endRefresh(const Data& target, const int type)
+{
+   RRList key(target, type);
+   RRSet::iterator it = mRRSet.find(&key);
+   if (it != mRRSet.end())
+   {
+      (*it)->setRefreshing(false);
+   }
+}
+
 void 
 RRCache::clearCache()
 {
@@ -202,6 +373,7 @@ RRCache::cleanup()
       delete *it;
    }
    mRRSet.clear();
+   mConcurrentCache.clear();
 }
 
 int 
@@ -230,6 +402,7 @@ RRCache::purge()
    RRList* lst = *(mLruHead->begin());
    RRSet::iterator it = mRRSet.find(lst);
    resip_assert(it != mRRSet.end());
+   mConcurrentCache.withdraw(lst->key(), lst->rrType());
    lst->remove();
    delete *it;
    mRRSet.erase(it);
@@ -241,8 +414,9 @@ RRCache::logCache()
    UInt64 now = Timer::getTimeSecs();
    for (std::set<RRList*, CompareT>::iterator it = mRRSet.begin(); it != mRRSet.end(); )
    {
-      if (now >= (*it)->absoluteExpiry())
+      if (isDead(*it, now))
       {
+         mConcurrentCache.withdraw((*it)->key(), (*it)->rrType());
          delete *it;
          mRRSet.erase(it++);
       }
@@ -261,8 +435,9 @@ RRCache::getCacheDump(Data& dnsCacheDump)
    DataStream strm(dnsCacheDump);
    for (std::set<RRList*, CompareT>::iterator it = mRRSet.begin(); it != mRRSet.end(); )
    {
-      if (now >= (*it)->absoluteExpiry())
+      if (isDead(*it, now))
       {
+         mConcurrentCache.withdraw((*it)->key(), (*it)->rrType());
          delete *it;
          mRRSet.erase(it++);
       }
@@ -275,6 +450,134 @@ RRCache::getCacheDump(Data& dnsCacheDump)
    strm.flush();
 }
 
+void
+RRCache::saveSnapshot(DnsSnapshotWriter& out)
+{
+   UInt64 now = Timer::getTimeSecs();
+   for (LruListType::iterator it = mLruHead->begin(); it != mLruHead->end(); ++it)
+   {
+      RRList* list = *it;
+      if (list->absoluteExpiry() <= now)
+      {
+         continue;
+      }
+
+      Result records = list->records(Protocol::Reserved);
+      vector<Data> rdatas;
+      for (Result::const_iterator r = records.begin(); r != records.end(); ++r)
+      {
+         Data rdata;
+         DnsSnapshotWriter rdataOut(rdata);
+         if (encodeRdata(list->rrType(), *r, rdataOut))
+         {
+            rdatas.push_back(rdata);
+         }
+      }
+      if (rdatas.size() != records.size())
+      {
+         continue;
+      }
+
+      UInt64 remaining = list->absoluteExpiry() - now;
+      out.putData(list->key());
+      out.putUInt16((UInt16)list->rrType());
+      out.putUInt32((UInt32)list->status());
+      out.putUInt32(remaining > 0xffffffff ? 0xffffffff : (UInt32)remaining);
+      out.putUInt16((UInt16)rdatas.size());
+      for (vector<Data>::const_iterator r = rdatas.begin(); r != rdatas.end(); ++r)
+      {
+         out.putData(*r);
+      }
+   }
+}
+
+int
+RRCache::loadSnapshot(DnsSnapshotReader& in, UInt64 ageSecs)
+{
+   int restored = 0;
+   while (!in.atEnd())
+   {
+      Data key;
+      UInt16 rrType = 0;
+      UInt32 status = 0;
+      UInt32 remaining = 0;
+      UInt16 count = 0;
+      if (!in.getData(key) || !in.getUInt16(rrType) || !in.getUInt32(status) ||
+          !in.getUInt32(remaining) || !in.getUInt16(count))
+      {
+         return -1;
+      }
+
+      // each record goes back into a resource record of its own for the
+      // factory to parse, with the TTL it has left
+      const UInt32 ttl = remaining > ageSecs ? (UInt32)(remaining - ageSecs) : 0;
+      vector<Data> rrs;
+      for (UInt16 i = 0; i < count; ++i)
+      {
+         Data rdata;
+         if (!in.getData(rdata) || rdata.size() > 0xffff)
+         {
+            return -1;
+         }
+         Data rr;
+         DnsSnapshotWriter rrOut(rr);
+         rrOut.putDomain(key);
+         rrOut.putUInt16(rrType);
+         rrOut.putUInt16(C_IN);
+         rrOut.putUInt32(ttl);
+         rrOut.putUInt16((UInt16)rdata.size());
+         rr += rdata;
+         rrs.push_back(rr);
+      }
+
+      FactoryMap::iterator factory = mFactoryMap.find(rrType);
+      if (ttl == 0 || factory == mFactoryMap.end())
+      {
+         continue;
+      }
+      RRList probe(key, rrType);
+      if (mRRSet.find(&probe) != mRRSet.end())
+      {
+         continue;
+      }
+
+      RRList* list = 0;
+      if (rrs.empty())
+      {
+         list = new RRList(key, rrType, (int)ttl, (int)status);
+      }
+      else
+      {
+         vector<RROverlay> overlays;
+         try
+         {
+            for (vector<Data>::const_iterator rr = rrs.begin(); rr != rrs.end(); ++rr)
+            {
+               const unsigned char* buf = reinterpret_cast<const unsigned char*>(rr->data());
+               overlays.push_back(RROverlay(buf, buf, (int)rr->size()));
+            }
+         }
+         catch (BaseException& e)
+         {
+            WarningLog(<< "Skipping " << key << " in DNS cache snapshot: " << e.getMessage());
+            continue;
+         }
+         list = new RRList(factory->second, key, rrType, overlays.begin(), overlays.end(), 0);
+         if (list->records(Protocol::Reserved).size() != rrs.size())
+         {
+            delete list;
+            continue;
+         }
+      }
+      mRRSet.insert(list);
+      mLruHead->push_back(list);
+      mConcurrentCache.publish(*list);
+      purge();
+      ++restored;
+   }
+   return restored;
+}
+
 /* ====================================================================
  * The Vovida Software License, Version 1.0 
  * 
@@ -4,6 +4,7 @@
 #include <map>
 #include <set>
 #include <memory>
+#include <vector>
 
 #include "rutil/dns/RRFactory.hxx"
 #include "rutil/dns/DnsResourceRecord.hxx"
@@ -13,10 +14,13 @@
 #include "rutil/dns/DnsSrvRecord.hxx"
 #include "rutil/dns/DnsCnameRecord.hxx"
 #include "rutil/dns/RRList.hxx"
+#include "rutil/dns/RRConcurrentCache.hxx"
 
 namespace resip
 {
 class RROverlay;
+class DnsSnapshotWriter;
+class DnsSnapshotReader;
 
 class RRCache
 {
@@ -31,6 +35,9 @@ class RRCache
       ~RRCache();
       void setTTL(int ttl) { if (ttl > 0) mUserDefinedTTL = ttl * MIN_TO_SEC; }
       void setSize(int size) { mSize = size; }
+      // How long past its TTL an answer may still be returned by the
+      // lookup() that reports staleness; 0 (the default) never does.
+      void setMaxStale(int secs) { mMaxStale = secs > 0 ? secs : 0; }
       // Update existing cache record, or add a new one
       void updateCache(const Data& target,
                        const int rrType,
@@ -43,9 +50,31 @@ class RRCache
                     const int status,
                     RROverlay overlay);
       bool lookup(const Data& target, const int type, const int proto, Result& records, int& status);
+      // As above, for a new query: counts the hit towards prefetching, and
+      // may return an answer up to the max-stale time past its TTL, setting
+      // stale.
+      bool lookup(const Data& target, const int type, const int proto, Result& records, int& status, bool& stale);
+      // Finds answers that have had at least minHits hits, counting those
+      // served by concurrentCache(), and expire within windowSecs, and
+      // marks them as being refreshed.
+      void getRefreshCandidates(unsigned int windowSecs, unsigned int minHits, std::vector<std::pair<Data, int> >& candidates);
+      // Marks an answer as being refreshed; returns false if it already was,
+      // or is not cached.
+      bool startRefresh(const Data& target, const int type);
+      void endRefresh(const Data& target, const int type);
       void clearCache();
       void logCache();
       void getCacheDump(Data& dnsCacheDump);
+      // Writes every unexpired answer, oldest first, with the time it has
+      // left.
+      void saveSnapshot(DnsSnapshotWriter& out);
+      // Restores answers written by saveSnapshot() ageSecs ago, skipping
+      // those that have expired since and those already cached. Returns
+      // the number restored, or -1 if the snapshot is corrupt.
+      int loadSnapshot(DnsSnapshotReader& in, UInt64 ageSecs);
+      // Copy of the cache that other threads may read; see RRConcurrentCache.
+      const RRConcurrentCache& concurrentCache() const { return mConcurrentCache; }
+      void reclaim() { mConcurrentCache.reclaim(); }
 
    private:
       static const int MIN_TO_SEC = 60;
@@ -73,6 +102,7 @@ class RRCache
       };
 
       void touch(RRList* node);
+      bool isDead(const RRList* node, UInt64 now) const { return now >= node->absoluteExpiry() + mMaxStale; }
       void cleanup();
       int getTTL(const RROverlay& overlay);
       void purge();
@@ -83,6 +113,7 @@ class RRCache
 
       typedef std::set<RRList*, CompareT> RRSet;
       RRSet mRRSet;
+      RRConcurrentCache mConcurrentCache;
 
       RRFactory<DnsHostRecord> mHostRecordFactory;
       RRFactory<DnsSrvRecord> mSrvRecordFactory;
@@ -95,6 +126,7 @@ class RRCache
       
       int mUserDefinedTTL; // used when the ttl in RR is 0 or less than default(60). in seconds.
       unsigned int mSize;
+      UInt64 mMaxStale; // in seconds
 };
 
 }
@@ -0,0 +1,310 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include "AresCompat.hxx"
+
+#ifndef WIN32
+#ifndef __CYGWIN__
+#include <arpa/nameser.h>
+#endif
+#endif
+
+#include "rutil/ResipAssert.h"
+#include "rutil/dns/DnsAAAARecord.hxx"
+#include "rutil/dns/DnsCnameRecord.hxx"
+#include "rutil/dns/DnsHostRecord.hxx"
+#include "rutil/dns/DnsNaptrRecord.hxx"
+#include "rutil/dns/DnsSrvRecord.hxx"
+#include "rutil/dns/RRConcurrentCache.hxx"
+#include "rutil/dns/RRList.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+using namespace std;
+
+static DnsResourceRecord*
+copyRecord(int rrType, const DnsResourceRecord* record)
+{
+   switch (rrType)
+   {
+      case T_A:
+         return new DnsHostRecord(*dynamic_cast<const DnsHostRecord*>(record));
+#ifdef USE_IPV6
+      case T_AAAA:
+         return new DnsAAAARecord(*dynamic_cast<const DnsAAAARecord*>(record));
+#endif
+      case T_SRV:
+         return new DnsSrvRecord(*dynamic_cast<const DnsSrvRecord*>(record));
+      case T_NAPTR:
+         return new DnsNaptrRecord(*dynamic_cast<const DnsNaptrRecord*>(record));
+      case T_CNAME:
+         return new DnsCnameRecord(*dynamic_cast<const DnsCnameRecord*>(record));
+      default:
+         resip_assert(0);
+         return 0;
+   }
+}
+
+RRConcurrentCache::Entry::Entry(RRList& list, size_t hash)
+   : mKey(list.key()),
+     mRRType(list.rrType()),
+     mStatus(list.status()),
+     mAbsoluteExpiry(list.absoluteExpiry()),
+     mHash(hash),
+     mNext(0),
+     mHits(0)
+{
+   RRList::Records records = list.records(RRList::Protocol::Reserved);
+   for (RRList::Records::const_iterator it = records.begin(); it != records.end(); ++it)
+   {
+      mRecords.push_back(copyRecord(mRRType, *it));
+   }
+}
+
+RRConcurrentCache::Entry::~Entry()
+{
+   for (vector<DnsResourceRecord*>::iterator it = mRecords.begin(); it != mRecords.end(); ++it)
+   {
+      delete *it;
+   }
+}
+
+RRConcurrentCache::Shard::Shard()
+   : mEpoch(0)
+{
+   mReaders[0] = 0;
+   mReaders[1] = 0;
+   for (unsigned int i = 0; i < BucketsPerShard; ++i)
+   {
+      mBuckets[i] = 0;
+   }
+}
+
+RRConcurrentCache::Shard::~Shard()
+{
+   for (unsigned int i = 0; i < BucketsPerShard; ++i)
+   {
+      Entry* entry = mBuckets[i].load();
+      while (entry)
+      {
+         Entry* next = entry->mNext.load();
+         delete entry;
+         entry = next;
+      }
+   }
+   for (vector<Entry*>::iterator it = mRetired.begin(); it != mRetired.end(); ++it)
+   {
+      delete *it;
+   }
+   for (vector<Entry*>::iterator it = mDraining.begin(); it != mDraining.end(); ++it)
+   {
+      delete *it;
+   }
+}
+
+RRConcurrentCache::RRConcurrentCache()
+   : mShards(new Shard[NumShards]),
+     mSize(0)
+{
+}
+
+RRConcurrentCache::~RRConcurrentCache()
+{
+   delete [] mShards;
+}
+
+size_t
+RRConcurrentCache::hashOf(const Data& key, int rrType)
+{
+   return key.caseInsensitivehash() * 31 + (size_t)rrType;
+}
+
+const RRConcurrentCache::Entry*
+RRConcurrentCache::find(Shard& shard, size_t hash, const Data& key, int rrType)
+{
+   for (const Entry* entry = bucketFor(shard, hash).load(); entry; entry = entry->mNext.load())
+   {
+      if (entry->mHash == hash &&
+          entry->mRRType == rrType &&
+          isEqualNoCase(entry->mKey, key))
+      {
+         return entry;
+      }
+   }
+   return 0;
+}
+
+unsigned int
+RRConcurrentCache::hits(const Data& key, int rrType) const
+{
+   // The writer frees entries, so it needs no ReadGuard.
+   const size_t hash = hashOf(key, rrType);
+   const Entry* entry = find(shardFor(hash), hash, key, rrType);
+   return entry ? entry->mHits.load(std::memory_order_relaxed) : 0;
+}
+
+void
+RRConcurrentCache::unlink(Shard& shard, atomic<Entry*>* link, size_t hash, const Data& key, int rrType)
+{
+   // Only the writer changes links, so a plain walk is enough to find the
+   // entry; the store that unlinks it is what readers see.
+   for (Entry* entry = link->load(); entry; entry = link->load())
+   {
+      if (entry->mHash == hash &&
+          entry->mRRType == rrType &&
+          isEqualNoCase(entry->mKey, key))
+      {
+         link->store(entry->mNext.load());
+         shard.mRetired.push_back(entry);
+         --mSize;
+         return;
+      }
+      link = &entry->mNext;
+   }
+}
+
+void
+RRConcurrentCache::publish(RRList& list)
+{
+   const size_t hash = hashOf(list.key(), list.rrType());
+   Shard& shard = shardFor(hash);
+   atomic<Entry*>& bucket = bucketFor(shard, hash);
+
+   // Link the new answer in ahead of the old one before unlinking that, so
+   // a concurrent reader finds one or the other.
+   Entry* entry = new Entry(list, hash);
+   entry->mNext.store(bucket.load());
+   bucket.store(entry);
+   ++mSize;
+   unlink(shard, &entry->mNext, hash, list.key(), list.rrType());
+   reclaim(shard);
+}
+
+void
+RRConcurrentCache::withdraw(const Data& key, int rrType)
+{
+   const size_t hash = hashOf(key, rrType);
+   Shard& shard = shardFor(hash);
+   unlink(shard, &bucketFor(shard, hash), hash, key, rrType);
+   reclaim(shard);
+}
+
+void
+RRConcurrentCache::clear()
+{
+   for (unsigned int s = 0; s < NumShards; ++s)
+   {
+      Shard& shard = mShards[s];
+      for (unsigned int i = 0; i < BucketsPerShard; ++i)
+      {
+         Entry* entry = shard.mBuckets[i].exchange(0);
+         while (entry)
+         {
+            shard.mRetired.push_back(entry);
+            entry = entry->mNext.load();
+         }
+      }
+      reclaim(shard);
+   }
+   mSize = 0;
+}
+
+void
+RRConcurrentCache::reclaim()
+{
+   for (unsigned int s = 0; s < NumShards; ++s)
+   {
+      reclaim(mShards[s]);
+   }
+}
+
+void
+RRConcurrentCache::reclaim(Shard& shard)
+{
+   for (int pass = 0; pass < 2; ++pass)
+   {
+      const unsigned int epoch = shard.mEpoch.load();
+      if (!shard.mDraining.empty())
+      {
+         // mDraining was unlinked before the flip to epoch; anyone who can
+         // still see it counted themselves under the previous one.
+         if (shard.mReaders[(epoch - 1) & 1].load() != 0)
+         {
+            return;
+         }
+         for (vector<Entry*>::iterator it = shard.mDraining.begin(); it != shard.mDraining.end(); ++it)
+         {
+            delete *it;
+         }
+         shard.mDraining.clear();
+      }
+      if (shard.mRetired.empty())
+      {
+         return;
+      }
+      shard.mDraining.swap(shard.mRetired);
+      shard.mEpoch.store(epoch + 1);
+   }
+}
+
+size_t
+RRConcurrentCache::retired() const
+{
+   size_t count = 0;
+   for (unsigned int s = 0; s < NumShards; ++s)
+   {
+      count += mShards[s].mRetired.size() + mShards[s].mDraining.size();
+   }
+   return count;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
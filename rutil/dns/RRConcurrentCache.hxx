@@ -0,0 +1,221 @@
+#ifndef RESIP_RRCONCURRENTCACHE_HXX
+#define RESIP_RRCONCURRENTCACHE_HXX
+
+#include <atomic>
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/dns/DnsResourceRecord.hxx"
+
+namespace resip
+{
+class RRList;
+
+/**
+   A copy of the answers held by RRCache that any thread can read without
+   a lock and without a trip through the DnsStub command fifo. Each entry
+   counts the lookups it answered, so RRCache can weigh them when it picks
+   answers to prefetch.
+
+   Only the thread that owns the RRCache writes to it. Each answer is an
+   immutable Entry on a singly linked bucket chain; the writer links new
+   entries in at the head of the chain and unlinks replaced ones, so a
+   reader walking the chain always sees a consistent list.
+
+   Unlinked entries are not freed while a reader may still hold them. A
+   reader counts itself in its shard under the shard's current epoch
+   (one of two); the writer retires entries, flips the epoch, and frees
+   them once the count of the old epoch drops to zero. Readers never
+   wait, and the writer never blocks on readers.
+*/
+class RRConcurrentCache
+{
+   public:
+      RRConcurrentCache();
+      ~RRConcurrentCache();
+
+      // Writer side; only the thread that owns the RRCache may call these.
+
+      // Adds a copy of list's answer, replacing any earlier one for the
+      // same key and type.
+      void publish(RRList& list);
+      void withdraw(const Data& key, int rrType);
+      void clear();
+      // Frees retired entries that no reader can still see. publish(),
+      // withdraw() and clear() do this as they go.
+      void reclaim();
+
+      size_t size() const { return mSize; }
+      size_t retired() const;
+      // Lookups answered from key/rrType's current answer.
+      unsigned int hits(const Data& key, int rrType) const;
+
+      // Reader side; any thread.
+
+      // Copies the records cached for key/rrType into records. Returns false
+      // if there is no answer, or it has expired. A cached failure returns
+      // true with a non-zero status and no records.
+      template<class T>
+      bool lookup(const Data& key, int rrType, std::vector<T>& records, int& status) const
+      {
+         const size_t hash = hashOf(key, rrType);
+         Shard& shard = shardFor(hash);
+         ReadGuard guard(shard);
+         const Entry* entry = find(shard, hash, key, rrType);
+         if (entry == 0 || Timer::getTimeSecs() >= entry->mAbsoluteExpiry)
+         {
+            return false;
+         }
+         entry->mHits.fetch_add(1, std::memory_order_relaxed);
+         records.clear();
+         for (std::vector<DnsResourceRecord*>::const_iterator it = entry->mRecords.begin();
+              it != entry->mRecords.end(); ++it)
+         {
+            records.push_back(*dynamic_cast<const T*>(*it));
+         }
+         status = entry->mStatus;
+         return true;
+      }
+
+   private:
+      static const unsigned int NumShards = 16;
+      static const unsigned int BucketsPerShard = 256;
+
+      class Entry
+      {
+         public:
+            Entry(RRList& list, size_t hash);
+            ~Entry();
+
+            const Data mKey;
+            const int mRRType;
+            const int mStatus;
+            const UInt64 mAbsoluteExpiry;
+            const size_t mHash;
+            std::vector<DnsResourceRecord*> mRecords;
+            std::atomic<Entry*> mNext;
+            mutable std::atomic<unsigned int> mHits;
+
+         private:
+            Entry(const Entry&);
+            Entry& operator=(const Entry&);
+      };
+
+      class Shard
+      {
+         public:
+            Shard();
+            ~Shard();
+
+            std::atomic<unsigned int> mEpoch;
+            std::atomic<unsigned int> mReaders[2];
+            std::atomic<Entry*> mBuckets[BucketsPerShard];
+
+            // writer only
+            std::vector<Entry*> mRetired;  // unlinked in the current epoch
+            std::vector<Entry*> mDraining; // unlinked before the last flip
+            char mPad[64];                 // keep neighbouring shards' counters apart
+      };
+
+      class ReadGuard
+      {
+         public:
+            explicit ReadGuard(Shard& shard)
+            {
+               // Only count as a reader of an epoch that is still current
+               // once counted; otherwise the writer may have already looked
+               // at this count and moved on.
+               unsigned int epoch = shard.mEpoch.load();
+               for (;;)
+               {
+                  mReaders = &shard.mReaders[epoch & 1];
+                  mReaders->fetch_add(1);
+                  unsigned int now = shard.mEpoch.load();
+                  if (now == epoch)
+                  {
+                     break;
+                  }
+                  mReaders->fetch_sub(1);
+                  epoch = now;
+               }
+            }
+            ~ReadGuard()
+            {
+               mReaders->fetch_sub(1);
+            }
+
+         private:
+            std::atomic<unsigned int>* mReaders;
+      };
+
+      static size_t hashOf(const Data& key, int rrType);
+      Shard& shardFor(size_t hash) const { return mShards[hash % NumShards]; }
+      static std::atomic<Entry*>& bucketFor(Shard& shard, size_t hash)
+      {
+         return shard.mBuckets[(hash / NumShards) % BucketsPerShard];
+      }
+      static const Entry* find(Shard& shard, size_t hash, const Data& key, int rrType);
+      void unlink(Shard& shard, std::atomic<Entry*>* link, size_t hash, const Data& key, int rrType);
+      static void reclaim(Shard& shard);
+
+      Shard* mShards;
+      size_t mSize;
+
+      RRConcurrentCache(const RRConcurrentCache&);
+      RRConcurrentCache& operator=(const RRConcurrentCache&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
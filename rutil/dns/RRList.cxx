@@ -36,19 +36,19 @@ using namespace std;
 
 #define RESIPROCATE_SUBSYSTEM resip::Subsystem::DNS
 
-RRList::RRList() : mRRType(0), mStatus(0), mAbsoluteExpiry(ULONG_MAX) {}
+RRList::RRList() : mRRType(0), mStatus(0), mAbsoluteExpiry(ULONG_MAX), mHits(0), mRefreshing(false) {}
 
 RRList::RRList(const Data& key, 
                const int rrtype, 
                int ttl, 
                int status)
-   : mKey(key), mRRType(rrtype), mStatus(status)
+   : mKey(key), mRRType(rrtype), mStatus(status), mHits(0), mRefreshing(false)
 {
    mAbsoluteExpiry = ttl + Timer::getTimeSecs();
 }
 
 RRList::RRList(const DnsHostRecord &record, int ttl)
-   : mKey(record.name()), mRRType(T_A), mStatus(0), mAbsoluteExpiry(ULONG_MAX)
+   : mKey(record.name()), mRRType(T_A), mStatus(0), mAbsoluteExpiry(ULONG_MAX), mHits(0), mRefreshing(false)
 {
    update(record, ttl);
 }
@@ -61,10 +61,12 @@ void RRList::update(const DnsHostRecord &record, int ttl)
    item.record = new DnsHostRecord(record);
    mRecords.push_back(item);
    mAbsoluteExpiry = Timer::getTimeSecs() + ttl;
+   mHits = 0;
+   mRefreshing = false;
 }
       
 RRList::RRList(const Data& key, int rrtype)
-   : mKey(key), mRRType(rrtype), mStatus(0), mAbsoluteExpiry(ULONG_MAX)
+   : mKey(key), mRRType(rrtype), mStatus(0), mAbsoluteExpiry(ULONG_MAX), mHits(0), mRefreshing(false)
 {}
 
 RRList::~RRList()
@@ -78,7 +80,7 @@ RRList::RRList(const RRFactoryBase* factory,
                Itr begin,
                Itr end, 
                int ttl)
-   : mKey(key), mRRType(rrType), mStatus(0)
+   : mKey(key), mRRType(rrType), mStatus(0), mHits(0), mRefreshing(false)
 {
    update(factory, begin, end, ttl);
 }
@@ -112,6 +114,8 @@ void RRList::update(const RRFactoryBase* factory, Itr begin, Itr end, int ttl)
    }
 
    mAbsoluteExpiry += Timer::getTimeSecs();
+   mHits = 0;
+   mRefreshing = false;
 }
 
 RRList::Records RRList::records(const int protocol)
@@ -52,6 +52,12 @@ class RRList : public IntrusiveListElement<RRList*>
       int rrType() const { return mRRType; }
       UInt64 absoluteExpiry() const { return mAbsoluteExpiry; }
       UInt64& absoluteExpiry() { return mAbsoluteExpiry; }
+      // Lookups answered from this list since it was last updated.
+      unsigned int hits() const { return mHits; }
+      void hit() { ++mHits; }
+      // Set while a background query to refresh this list is outstanding.
+      bool refreshing() const { return mRefreshing; }
+      void setRefreshing(bool refreshing) { mRefreshing = refreshing; }
       void log();
       EncodeStream& encodeRRList(EncodeStream& strm);
 
@@ -73,6 +79,8 @@ class RRList : public IntrusiveListElement<RRList*>
 
       int mStatus; // dns query status.
       UInt64 mAbsoluteExpiry;
+      unsigned int mHits;
+      bool mRefreshing;
 
       RecordItr find(const Data&);
       void clear();
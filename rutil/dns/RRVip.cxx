@@ -34,6 +34,7 @@
 #include "rutil/dns/DnsAAAARecord.hxx"
 #include "rutil/dns/DnsHostRecord.hxx"
 #include "rutil/dns/DnsNaptrRecord.hxx"
+#include "rutil/dns/DnsSnapshot.hxx"
 #include "rutil/dns/DnsSrvRecord.hxx"
 #include "rutil/dns/RRVip.hxx"
 #include "rutil/WinLeakCheck.hxx"
@@ -114,6 +115,36 @@ void RRVip::transform(const Data& target,
    }
 }
 
+void RRVip::saveSnapshot(DnsSnapshotWriter& out)
+{
+   for (TransformMap::iterator it = mTransforms.begin(); it != mTransforms.end(); ++it)
+   {
+      out.putData(it->first.target());
+      out.putUInt16((UInt16)it->first.rrType());
+      out.putData(it->second->vip());
+   }
+}
+
+void RRVip::loadSnapshot(DnsSnapshotReader& in, UInt64 ageSecs)
+{
+   while (!in.atEnd())
+   {
+      Data target;
+      UInt16 rrType = 0;
+      Data vipData;
+      if (!in.getData(target) || !in.getUInt16(rrType) || !in.getData(vipData))
+      {
+         WarningLog(<< "Vips in DNS cache snapshot are truncated");
+         return;
+      }
+      if (mFactories.find(rrType) != mFactories.end())
+      {
+         DebugLog(<< "restored vip " << target << "(" << rrType << "): " << vipData);
+         vip(target, rrType, vipData);
+      }
+   }
+}
+
 RRVip::Transform::Transform(const Data& vip) 
    : mVip(vip)
 {
@@ -6,7 +6,7 @@
 namespace resip
 {
 
-class RRVip : public DnsStub::ResultTransform
+class RRVip : public DnsStub::ResultTransform, public DnsStub::SnapshotHandler
 {
    public:
       RRVip();
@@ -16,6 +16,11 @@ class RRVip : public DnsStub::ResultTransform
       void removeVip(const Data& target, int rrType);
       void transform(const Data& target, int rrType, std::vector<DnsResourceRecord*>&);
 
+      // The vips have no expiry, so a restored one stays until the result
+      // it points at fails like any other.
+      void saveSnapshot(DnsSnapshotWriter& out);
+      void loadSnapshot(DnsSnapshotReader& in, UInt64 ageSecs);
+
    private:
 
       RRVip(const RRVip&);
@@ -55,6 +60,8 @@ class RRVip : public DnsStub::ResultTransform
             MapKey();
             MapKey(const Data& target, int rrType);
             bool operator<(const MapKey&) const;
+            const Data& target() const { return mTarget; }
+            int rrType() const { return mRRType; }
          private:
             Data mTarget;
             int mRRType;
@@ -0,0 +1,398 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "rutil/DnsUtil.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Time.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/dns/QueryTypes.hxx"
+
+#include "LocalDnsServer.hxx"
+
+using namespace resip;
+using namespace std;
+
+static const int TypeA = 1;
+static const int TypeSrv = 33;
+static const int TypeNaptr = 35;
+
+static void
+putShort(Data& out, unsigned int value)
+{
+   out += (char)((value >> 8) & 0xff);
+   out += (char)(value & 0xff);
+}
+
+static void
+putLong(Data& out, unsigned int value)
+{
+   putShort(out, value >> 16);
+   putShort(out, value & 0xffff);
+}
+
+static void
+putName(Data& out, const Data& name)
+{
+   const char* label = name.data();
+   const char* end = name.data() + name.size();
+   while (label < end)
+   {
+      const char* dot = label;
+      while (dot < end && *dot != '.')
+      {
+         ++dot;
+      }
+      out += (char)(dot - label);
+      out.append(label, (Data::size_type)(dot - label));
+      label = dot + 1;
+   }
+   out += (char)0;
+}
+
+static void
+putString(Data& out, const Data& value)
+{
+   out += (char)value.size();
+   out += value;
+}
+
+LocalDnsServer::LocalDnsServer()
+   : mTotalQueries(0),
+     mDelayMs(0)
+{
+   mFd = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+   resip_assert(mFd != INVALID_SOCKET);
+
+   memset(&mAddress, 0, sizeof(mAddress));
+   mAddress.sin_family = AF_INET;
+   mAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   mAddress.sin_port = 0;
+   int ret = ::bind(mFd, reinterpret_cast<sockaddr*>(&mAddress), sizeof(mAddress));
+   resip_assert(ret == 0);
+   socklen_t len = sizeof(mAddress);
+   ret = ::getsockname(mFd, reinterpret_cast<sockaddr*>(&mAddress), &len);
+   resip_assert(ret == 0);
+}
+
+LocalDnsServer::~LocalDnsServer()
+{
+   shutdown();
+   join();
+   closeSocket(mFd);
+}
+
+GenericIPAddress
+LocalDnsServer::address() const
+{
+   return GenericIPAddress(mAddress);
+}
+
+void
+LocalDnsServer::add(const Data& name, int type, unsigned int ttl, const Data& rdata)
+{
+   Lock lock(mMutex);
+   mRecords[Key(Data(name).lowercase(), type)].push_back(make_pair(ttl, rdata));
+}
+
+void
+LocalDnsServer::addA(const Data& name, const Data& ip, unsigned int ttl)
+{
+   in_addr addr;
+   bool ok = DnsUtil::inet_pton(ip, addr) != 0;
+   resip_assert(ok);
+   add(name, TypeA, ttl, Data(reinterpret_cast<const char*>(&addr), sizeof(addr)));
+}
+
+void
+LocalDnsServer::addSrv(const Data& name, unsigned short priority, unsigned short weight,
+                       unsigned short port, const Data& target, unsigned int ttl)
+{
+   Data rdata;
+   putShort(rdata, priority);
+   putShort(rdata, weight);
+   putShort(rdata, port);
+   putName(rdata, target);
+   add(name, TypeSrv, ttl, rdata);
+}
+
+void
+LocalDnsServer::addNaptr(const Data& name, unsigned short order, unsigned short preference,
+                         const Data& flags, const Data& service,
+                         const Data& regexp, const Data& replacement,
+                         unsigned int ttl)
+{
+   Data rdata;
+   putShort(rdata, order);
+   putShort(rdata, preference);
+   putString(rdata, flags);
+   putString(rdata, service);
+   putString(rdata, regexp);
+   putName(rdata, replacement);
+   add(name, TypeNaptr, ttl, rdata);
+}
+
+void
+LocalDnsServer::clear(const Data& name, int type)
+{
+   Lock lock(mMutex);
+   mRecords.erase(Key(Data(name).lowercase(), type));
+}
+
+void
+LocalDnsServer::setDelay(unsigned int ms)
+{
+   Lock lock(mMutex);
+   mDelayMs = ms;
+}
+
+unsigned int
+LocalDnsServer::queries() const
+{
+   Lock lock(mMutex);
+   return mTotalQueries;
+}
+
+unsigned int
+LocalDnsServer::queries(const Data& name, int type) const
+{
+   Lock lock(mMutex);
+   map<Key, unsigned int>::const_iterator it = mQueries.find(Key(Data(name).lowercase(), type));
+   return it == mQueries.end() ? 0 : it->second;
+}
+
+void
+LocalDnsServer::thread()
+{
+   while (!isShutdown())
+   {
+      FdSet fdset;
+      fdset.setRead(mFd);
+      if (fdset.selectMilliSeconds(50) <= 0 || !fdset.readyToRead(mFd))
+      {
+         continue;
+      }
+
+      char buffer[512];
+      sockaddr_in from;
+      socklen_t fromLen = sizeof(from);
+      int len = (int)::recvfrom(mFd, buffer, sizeof(buffer), 0,
+                                reinterpret_cast<sockaddr*>(&from), &fromLen);
+      if (len >= 12)
+      {
+         answer(buffer, len, from);
+      }
+   }
+}
+
+void
+LocalDnsServer::answer(const char* query, int len, const sockaddr_in& from)
+{
+   // one question: the name as labels, then type and class
+   Data name;
+   int pos = 12;
+   while (pos < len && query[pos] != 0)
+   {
+      int labelLen = (unsigned char)query[pos];
+      if (pos + 1 + labelLen > len)
+      {
+         return;
+      }
+      if (!name.empty())
+      {
+         name += '.';
+      }
+      name.append(query + pos + 1, labelLen);
+      pos += 1 + labelLen;
+   }
+   if (pos + 5 > len)
+   {
+      return;
+   }
+   int type = ((unsigned char)query[pos + 1] << 8) | (unsigned char)query[pos + 2];
+   const int questionEnd = pos + 5;
+   Key key(name.lowercase(), type);
+
+   Answers answers;
+   unsigned int delay = 0;
+   {
+      Lock lock(mMutex);
+      ++mTotalQueries;
+      ++mQueries[key];
+      map<Key, Answers>::const_iterator it = mRecords.find(key);
+      if (it != mRecords.end())
+      {
+         answers = it->second;
+      }
+      delay = mDelayMs;
+   }
+   if (delay)
+   {
+      sleepMs(delay);
+   }
+
+   Data response;
+   response.append(query, 2); // id
+   putShort(response, answers.empty() ? 0x8183 : 0x8180); // response, RD, RA; NXDOMAIN if empty
+   putShort(response, 1);
+   putShort(response, (unsigned int)answers.size());
+   putShort(response, 0);
+   putShort(response, 0);
+   response.append(query + 12, questionEnd - 12);
+   for (Answers::const_iterator it = answers.begin(); it != answers.end(); ++it)
+   {
+      putShort(response, 0xc00c); // the name in the question
+      putShort(response, type);
+      putShort(response, 1);
+      putLong(response, it->first);
+      putShort(response, (unsigned int)it->second.size());
+      response += it->second;
+   }
+
+   ::sendto(mFd, response.data(), response.size(), 0,
+            reinterpret_cast<const sockaddr*>(&from), sizeof(from));
+}
+
+TestDnsSink::TestDnsSink() :
+   mResults(0),
+   mHostResults(0),
+   mNaptrResults(0),
+   mFailures(0),
+   mRecords(0),
+   mStatus(-1)
+{
+}
+
+void
+TestDnsSink::onDnsResult(const DNSResult<DnsHostRecord>& result)
+{
+   ++mHostResults;
+   mHosts = result.records;
+   done(result.status, result.records.size());
+}
+
+void
+TestDnsSink::onDnsResult(const DNSResult<DnsAAAARecord>& result)
+{
+   done(result.status, result.records.size());
+}
+
+void
+TestDnsSink::onDnsResult(const DNSResult<DnsSrvRecord>& result)
+{
+   mSrvs = result.records;
+   done(result.status, result.records.size());
+}
+
+void
+TestDnsSink::onDnsResult(const DNSResult<DnsNaptrRecord>& result)
+{
+   ++mNaptrResults;
+   mNaptrs = result.records;
+   done(result.status, result.records.size());
+}
+
+void
+TestDnsSink::onDnsResult(const DNSResult<DnsCnameRecord>& result)
+{
+   done(result.status, result.records.size());
+}
+
+void
+TestDnsSink::done(int status, size_t records)
+{
+   ++mResults;
+   mStatus = status;
+   if (status != 0)
+   {
+      ++mFailures;
+   }
+   mRecords += records;
+}
+
+void
+runFor(DnsStub& stub, unsigned int ms)
+{
+   UInt64 end = Timer::getTimeMs() + ms;
+   do
+   {
+      FdSet fdset;
+      stub.buildFdSet(fdset);
+      fdset.selectMilliSeconds(resipMin(stub.getTimeTillNextProcessMS(), 20U));
+      stub.process(fdset);
+   }
+   while (Timer::getTimeMs() < end);
+}
+
+void
+runUntil(DnsStub& stub, const unsigned int& results, unsigned int wanted)
+{
+   UInt64 end = Timer::getTimeMs() + 5000;
+   while (results < wanted && Timer::getTimeMs() < end)
+   {
+      runFor(stub, 0);
+   }
+   resip_assert(results == wanted);
+}
+
+Data
+resolveA(DnsStub& stub, const Data& target)
+{
+   TestDnsSink sink;
+   resolve<RR_A>(stub, target, sink);
+   resip_assert(sink.mHosts.size() == 1);
+   return sink.mHosts[0].host();
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,163 @@
+#ifndef LocalDnsServer_hxx
+#define LocalDnsServer_hxx
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/GenericIPAddress.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Socket.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/dns/DnsStub.hxx"
+
+/**
+   A small DNS server on 127.0.0.1 for tests. It answers A, SRV and NAPTR
+   questions from a table over UDP, says NXDOMAIN to anything else, and
+   counts the questions it is asked.
+*/
+class LocalDnsServer : public resip::ThreadIf
+{
+   public:
+      LocalDnsServer();
+      virtual ~LocalDnsServer();
+
+      // The address to hand to DnsStub as its only nameserver.
+      resip::GenericIPAddress address() const;
+
+      void addA(const resip::Data& name, const resip::Data& ip, unsigned int ttl);
+      void addSrv(const resip::Data& name, unsigned short priority, unsigned short weight,
+                  unsigned short port, const resip::Data& target, unsigned int ttl);
+      void addNaptr(const resip::Data& name, unsigned short order, unsigned short preference,
+                    const resip::Data& flags, const resip::Data& service,
+                    const resip::Data& regexp, const resip::Data& replacement,
+                    unsigned int ttl);
+      void clear(const resip::Data& name, int type);
+
+      // Waits this long before answering each question.
+      void setDelay(unsigned int ms);
+
+      unsigned int queries() const;
+      unsigned int queries(const resip::Data& name, int type) const;
+
+      virtual void thread();
+
+   private:
+      typedef std::pair<resip::Data, int> Key; // lowercased name, type
+      typedef std::vector<std::pair<unsigned int, resip::Data> > Answers; // ttl, rdata
+
+      void add(const resip::Data& name, int type, unsigned int ttl, const resip::Data& rdata);
+      void answer(const char* query, int len, const sockaddr_in& from);
+
+      resip::Socket mFd;
+      sockaddr_in mAddress;
+
+      mutable resip::Mutex mMutex;
+      std::map<Key, Answers> mRecords;
+      std::map<Key, unsigned int> mQueries;
+      unsigned int mTotalQueries;
+      unsigned int mDelayMs;
+};
+
+/**
+   Keeps whatever a DnsStub answers, for tests. mStatus and the record
+   vectors are from the latest answer; the counters add up over all of them.
+*/
+class TestDnsSink : public resip::DnsResultSink
+{
+   public:
+      TestDnsSink();
+
+      virtual void onDnsResult(const resip::DNSResult<resip::DnsHostRecord>& result);
+      virtual void onDnsResult(const resip::DNSResult<resip::DnsAAAARecord>& result);
+      virtual void onDnsResult(const resip::DNSResult<resip::DnsSrvRecord>& result);
+      virtual void onDnsResult(const resip::DNSResult<resip::DnsNaptrRecord>& result);
+      virtual void onDnsResult(const resip::DNSResult<resip::DnsCnameRecord>& result);
+
+      unsigned int mResults;
+      unsigned int mHostResults;
+      unsigned int mNaptrResults;
+      unsigned int mFailures;
+      size_t mRecords;
+      int mStatus;
+      std::vector<resip::DnsHostRecord> mHosts;
+      std::vector<resip::DnsSrvRecord> mSrvs;
+      std::vector<resip::DnsNaptrRecord> mNaptrs;
+
+   private:
+      void done(int status, size_t records);
+};
+
+// Drives stub (and so its nameserver traffic) for at least ms milliseconds.
+void runFor(resip::DnsStub& stub, unsigned int ms);
+
+// Drives stub until results reaches wanted, for at most 5 seconds, and
+// asserts that it did.
+void runUntil(resip::DnsStub& stub, const unsigned int& results, unsigned int wanted);
+
+// Looks target up and waits for the answer, which must be a success.
+template<class QueryType>
+void
+resolve(resip::DnsStub& stub, const resip::Data& target, TestDnsSink& sink)
+{
+   stub.lookup<QueryType>(target, &sink);
+   runUntil(stub, sink.mResults, 1);
+   resip_assert(sink.mStatus == 0);
+}
+
+// The one address target has.
+resip::Data resolveA(resip::DnsStub& stub, const resip::Data& target);
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
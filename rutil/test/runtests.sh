@@ -16,6 +16,7 @@ for i in \
 	testDataStream \
 	testDnsUtil \
 	testFifo \
+	testFifoPerformance \
 	testFileSystem \
 	testInserter \
 	testIntrusiveList \
@@ -1,11 +1,131 @@
 #include "rutil/DataStream.hxx"
+#include "rutil/DataIntern.hxx"
 #include "rutil/Random.hxx"
+#include "rutil/Timer.hxx"
+
+#include <iostream>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <assert.h>
 
 using namespace resip;
+using namespace std;
+
+// Count heap allocations, so we can tell what the token mix below costs.
+static size_t heapAllocations = 0;
+
+void* operator new(size_t size)
+{
+   ++heapAllocations;
+   void* p = malloc(size ? size : 1);
+   if (!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void* operator new[](size_t size)
+{
+   ++heapAllocations;
+   void* p = malloc(size ? size : 1);
+   if (!p)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void operator delete(void* p) throw()
+{
+   free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+   free(p);
+}
+
+// Tokens as they turn up in a typical INVITE/REGISTER mix, weighted roughly
+// by how often each appears in a message.
+static const char* sipTokens[] =
+{
+   "INVITE", "ACK", "BYE", "REGISTER", "OPTIONS",
+   "SIP", "2.0", "UDP", "TCP", "TLS",
+   "branch", "branch", "branch", "tag", "tag", "rport", "received", "lr", "lr",
+   "transport", "expires", "q", "+sip.instance", "reg-id", "ob",
+   "application/sdp", "sip.example.com", "atlanta.example.com",
+   "P-Charging-Vector", "P-Access-Network-Info", "P-Visited-Network-ID",
+   "X-Correlation-Id", "X-Application-Session", "icid-value", "orig-ioi",
+   "urn:uuid:f81d4fae-7dec-11d0-a765-00a0c91e6bf6"
+};
+static const size_t numSipTokens = sizeof(sipTokens) / sizeof(sipTokens[0]);
+
+static void
+tokenMix(unsigned int rounds)
+{
+   vector<Data::size_type> lengths;
+   for (size_t i = 0; i < numSipTokens; ++i)
+   {
+      lengths.push_back((Data::size_type)strlen(sipTokens[i]));
+   }
+
+   Data target;
+   size_t before = heapAllocations;
+   UInt64 start = Timer::getTimeMicroSec();
+   for (unsigned int r = 0; r < rounds; ++r)
+   {
+      for (size_t i = 0; i < numSipTokens; ++i)
+      {
+         Data copied(sipTokens[i], lengths[i]);
+      }
+   }
+   UInt64 copiedTime = Timer::getTimeMicroSec() - start;
+   size_t copiedAllocations = heapAllocations - before;
+
+   for (size_t i = 0; i < numSipTokens; ++i)
+   {
+      const Data* interned = DataIntern::intern(sipTokens[i], lengths[i]);
+      assert(interned);
+      assert(DataIntern::intern(Data(sipTokens[i])) == interned);
+      assert(DataIntern::find(sipTokens[i], lengths[i]) == interned);
+   }
+   assert(DataIntern::find("x-correlation-id", 16) == 0);
+   assert(!DataIntern::assign(target, "x-correlation-id", 16));
+   assert(target == "x-correlation-id");
+
+   before = heapAllocations;
+   start = Timer::getTimeMicroSec();
+   for (unsigned int r = 0; r < rounds; ++r)
+   {
+      for (size_t i = 0; i < numSipTokens; ++i)
+      {
+         Data shared;
+         DataIntern::assign(shared, sipTokens[i], lengths[i]);
+      }
+   }
+   UInt64 sharedTime = Timer::getTimeMicroSec() - start;
+   size_t sharedAllocations = heapAllocations - before;
+
+   const Data* interned = DataIntern::find("P-Charging-Vector", 17);
+   assert(DataIntern::assign(target, "P-Charging-Vector", 17));
+   assert(target.data() == interned->data());
+
+   cout << "RESIP_DATA_LOCAL_SIZE=" << RESIP_DATA_LOCAL_SIZE << ", "
+        << rounds * numSipTokens << " SIP tokens: "
+        << "copied " << copiedAllocations << " allocations, " << copiedTime << " us; "
+        << "interned " << sharedAllocations << " allocations, " << sharedTime << " us"
+        << endl;
+   assert(sharedAllocations == 0);
+}
 
 int 
 main()
 {
+   tokenMix(100000);
+
    Data data = Random::getRandomHex(8);
    for (int j=0; j<100; j++)
    {
@@ -19,6 +139,7 @@ main()
          strm << "chars";
       }
    }
+   cout << "All OK" << endl;
    return 0;
 }
 /* ====================================================================
@@ -0,0 +1,148 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Socket.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/dns/DnsStub.hxx"
+#include "rutil/dns/QueryTypes.hxx"
+
+#include "LocalDnsServer.hxx"
+
+// Checks that a burst of identical lookups made while the first is still
+// outstanding puts one query on the wire, and that every sink is answered
+// from it, against a slow LocalDnsServer.
+
+using namespace resip;
+using namespace std;
+
+static const unsigned int Burst = 500;
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+   initNetwork();
+
+   LocalDnsServer server;
+   server.addNaptr("burst.example.com", 10, 50, "s", "SIP+D2U", "", "_sip._udp.burst.example.com", 3600);
+   server.addNaptr("burst.example.com", 20, 50, "s", "SIP+D2T", "", "_sip._tcp.burst.example.com", 3600);
+   server.addA("host.example.com", "192.0.2.1", 3600);
+   // long enough that the whole burst is made before the first answer
+   server.setDelay(300);
+   server.run();
+
+   DnsStub::NameserverList nameservers;
+   nameservers.push_back(server.address());
+   DnsStub stub(nameservers);
+   DnsStub::CacheStatistics stats;
+
+   // a burst of NAPTR lookups for one domain: one wire query
+   TestDnsSink naptrs;
+   UInt64 start = Timer::getTimeMs();
+   for (unsigned int i = 0; i < Burst; ++i)
+   {
+      stub.lookup<RR_NAPTR>("burst.example.com", &naptrs);
+   }
+   runUntil(stub, naptrs.mNaptrResults, Burst);
+   UInt64 elapsed = Timer::getTimeMs() - start;
+   resip_assert(naptrs.mFailures == 0);
+   resip_assert(naptrs.mRecords == 2 * Burst);
+   resip_assert(server.queries("burst.example.com", T_NAPTR) == 1);
+   stub.getCacheStatistics(stats);
+   resip_assert(stats.wireQueries == 1);
+   resip_assert(stats.coalescedQueries == Burst - 1);
+
+   // names differing only in case are the same query, a different type is not
+   TestDnsSink hosts;
+   stub.lookup<RR_A>("host.example.com", &hosts);
+   stub.lookup<RR_A>("HOST.Example.com", &hosts);
+   stub.lookup<RR_NAPTR>("host.example.com", &hosts);
+   runUntil(stub, hosts.mHostResults, 2);
+   runUntil(stub, hosts.mNaptrResults, 1);
+   resip_assert(hosts.mRecords == 2);
+   resip_assert(hosts.mFailures == 1); // no NAPTR for host.example.com
+   resip_assert(server.queries("host.example.com", T_A) == 1);
+   resip_assert(server.queries("host.example.com", T_NAPTR) == 1);
+
+   // a failed answer fails every waiter
+   TestDnsSink missing;
+   for (unsigned int i = 0; i < 10; ++i)
+   {
+      stub.lookup<RR_A>("missing.example.com", &missing);
+   }
+   runUntil(stub, missing.mHostResults, 10);
+   resip_assert(missing.mFailures == 10);
+   resip_assert(server.queries("missing.example.com", T_A) == 1);
+
+   // once answered, the next lookup comes from the cache
+   server.setDelay(0);
+   TestDnsSink cached;
+   stub.lookup<RR_NAPTR>("burst.example.com", &cached);
+   runUntil(stub, cached.mNaptrResults, 1);
+   resip_assert(server.queries("burst.example.com", T_NAPTR) == 1);
+
+   stub.getCacheStatistics(stats);
+   resip_assert(stats.wireQueries == 4);
+   resip_assert(stats.coalescedQueries == Burst - 1 + 1 + 9);
+   resip_assert(server.queries() == 4);
+
+   cout << Burst << " lookups in " << elapsed << "ms, wire queries=" << stats.wireQueries
+        << " coalesced=" << stats.coalescedQueries << endl;
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,130 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+
+#include "rutil/DnsUtil.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Socket.hxx"
+#include "rutil/dns/DnsStub.hxx"
+#include "rutil/dns/QueryTypes.hxx"
+
+#include "LocalDnsServer.hxx"
+
+// Checks that DnsStub refreshes popular answers before they expire, and
+// that it answers from an expired entry while refreshing it when allowed
+// to, against a LocalDnsServer.
+
+using namespace resip;
+using namespace std;
+
+// RRCache keeps answers for at least this long, whatever their TTL.
+static const unsigned int MinCacheSecs = 10;
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+   initNetwork();
+
+   LocalDnsServer server;
+   server.addA("hot.example.com", "192.0.2.1", 1);
+   server.addA("cold.example.com", "192.0.2.2", 1);
+   server.run();
+
+   DnsStub::NameserverList nameservers;
+   nameservers.push_back(server.address());
+   DnsStub stub(nameservers);
+   DnsStub::CacheStatistics stats;
+
+   // prefetching: entries with two hits are refreshed up to MinCacheSecs
+   // before they expire, i.e. straight away here
+   stub.setDnsPrefetch(MinCacheSecs, 2);
+   resip_assert(resolveA(stub, "hot.example.com") == "192.0.2.1");
+   resip_assert(resolveA(stub, "cold.example.com") == "192.0.2.2");
+   resip_assert(resolveA(stub, "hot.example.com") == "192.0.2.1");
+   resip_assert(resolveA(stub, "hot.example.com") == "192.0.2.1");
+   runFor(stub, 1500);
+   resip_assert(server.queries("hot.example.com", T_A) == 2);
+   resip_assert(server.queries("cold.example.com", T_A) == 1);
+   stub.getCacheStatistics(stats);
+   resip_assert(stats.misses == 2);
+   resip_assert(stats.hits == 2);
+   resip_assert(stats.prefetches == 1);
+   // the refresh reset the hit count, so it is not refreshed again
+   runFor(stub, 1500);
+   resip_assert(server.queries("hot.example.com", T_A) == 2);
+
+   // stale answers: once cold.example.com expires it is still answered,
+   // from the old entry, while it is refetched
+   stub.setDnsPrefetch(0, 0);
+   stub.setDnsMaxStale(60);
+   server.clear("cold.example.com", T_A);
+   server.addA("cold.example.com", "192.0.2.3", 1);
+   runFor(stub, (MinCacheSecs + 1) * 1000);
+   resip_assert(resolveA(stub, "cold.example.com") == "192.0.2.2");
+   runFor(stub, 200);
+   resip_assert(server.queries("cold.example.com", T_A) == 2);
+   resip_assert(resolveA(stub, "cold.example.com") == "192.0.2.3");
+   resip_assert(server.queries("cold.example.com", T_A) == 2);
+   stub.getCacheStatistics(stats);
+   resip_assert(stats.staleAnswers == 1);
+   resip_assert(stats.misses == 2);
+
+   cout << "misses=" << stats.misses << " hits=" << stats.hits
+        << " prefetches=" << stats.prefetches << " stale=" << stats.staleAnswers << endl;
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,264 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "rutil/DnsUtil.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Socket.hxx"
+#include "rutil/dns/DnsSnapshot.hxx"
+#include "rutil/dns/DnsStub.hxx"
+#include "rutil/dns/QueryTypes.hxx"
+#include "rutil/dns/RRVip.hxx"
+
+#include "LocalDnsServer.hxx"
+
+// Checks that a DnsStub restores the cache, and the state of its
+// SnapshotHandlers, that another DnsStub saved to a snapshot file, and
+// that answers which expired in between are looked up again.
+
+using namespace resip;
+using namespace std;
+
+static const char* SnapshotFile = "testDnsSnapshot.cache";
+
+// Holds a value that goes into the snapshot as a section of its own.
+class TestHandler : public DnsStub::SnapshotHandler
+{
+   public:
+      TestHandler() : mLoaded(false), mAgeSecs(0) {}
+
+      virtual void saveSnapshot(DnsSnapshotWriter& out)
+      {
+         out.putData(mValue);
+      }
+      virtual void loadSnapshot(DnsSnapshotReader& in, UInt64 ageSecs)
+      {
+         mLoaded = in.getData(mValue) && in.atEnd();
+         mAgeSecs = ageSecs;
+      }
+
+      Data mValue;
+      bool mLoaded;
+      UInt64 mAgeSecs;
+};
+
+static bool
+fileExists(const char* path)
+{
+   ifstream file(path);
+   return file.is_open();
+}
+
+// Moves the time the snapshot was saved back by secs.
+static void
+ageSnapshot(UInt64 secs)
+{
+   Data snapshot = Data::fromFile(SnapshotFile);
+   DnsSnapshotReader in(snapshot);
+   UInt32 magic = 0;
+   UInt16 version = 0;
+   UInt64 savedAt = 0;
+   resip_assert(in.getUInt32(magic) && in.getUInt16(version) && in.getUInt64(savedAt));
+
+   Data header;
+   DnsSnapshotWriter out(header);
+   out.putUInt32(magic);
+   out.putUInt16(version);
+   out.putUInt64(savedAt - secs);
+   Data aged = header + snapshot.substr(header.size());
+
+   ofstream file(SnapshotFile, ios_base::out | ios_base::binary | ios_base::trunc);
+   file.write(aged.data(), aged.size());
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+   initNetwork();
+   ::remove(SnapshotFile);
+
+   LocalDnsServer server;
+   server.addA("long.example.com", "192.0.2.1", 3600);
+   server.addA("short.example.com", "192.0.2.2", 60);
+   server.addSrv("_sip._udp.example.com", 10, 0, 5060, "sip1.example.com", 3600);
+   server.addSrv("_sip._udp.example.com", 20, 0, 5070, "sip2.example.com", 3600);
+   server.addNaptr("example.com", 10, 50, "s", "SIP+D2U", "", "_sip._udp.example.com", 3600);
+   server.addNaptr("example.com", 20, 50, "u", "E2U+sip", "!^.*$!sip:info@example.com!", "", 3600);
+   server.run();
+
+   DnsStub::NameserverList nameservers;
+   nameservers.push_back(server.address());
+
+   // fill a cache, and save it as at shutdown
+   {
+      TestHandler handler;
+      RRVip vip;
+      DnsStub stub(nameservers);
+      handler.mValue = "kept";
+      stub.addSnapshotHandler("test", &handler);
+      stub.addSnapshotHandler("vips", &vip);
+      vip.vip("_sip._udp.example.com", T_SRV, "sip2.example.com:5070");
+
+      stub.setDnsCacheSnapshot(SnapshotFile, 0);
+      runFor(stub, 10);
+      resip_assert(!handler.mLoaded);
+
+      resip_assert(resolveA(stub, "long.example.com") == "192.0.2.1");
+      resip_assert(resolveA(stub, "short.example.com") == "192.0.2.2");
+      TestDnsSink srv;
+      resolve<RR_SRV>(stub, "_sip._udp.example.com", srv);
+      resip_assert(srv.mSrvs.size() == 2);
+      TestDnsSink naptr;
+      resolve<RR_NAPTR>(stub, "example.com", naptr);
+      resip_assert(naptr.mNaptrs.size() == 2);
+      resip_assert(!fileExists(SnapshotFile));
+      stub.saveDnsCacheSnapshot();
+   }
+   resip_assert(fileExists(SnapshotFile));
+   resip_assert(server.queries() == 4);
+
+   // a restart two minutes later: short.example.com has expired since
+   ageSnapshot(120);
+   {
+      TestHandler handler;
+      RRVip vip;
+      DnsStub stub(nameservers);
+      stub.addSnapshotHandler("test", &handler);
+      stub.addSnapshotHandler("vips", &vip);
+      stub.setResultTransform(&vip);
+
+      stub.setDnsCacheSnapshot(SnapshotFile, 1);
+      runFor(stub, 10);
+      resip_assert(handler.mLoaded);
+      resip_assert(handler.mValue == "kept");
+      resip_assert(handler.mAgeSecs >= 120 && handler.mAgeSecs < 130);
+
+      resip_assert(resolveA(stub, "long.example.com") == "192.0.2.1");
+      resip_assert(server.queries() == 4);
+
+      TestDnsSink srv;
+      resolve<RR_SRV>(stub, "_sip._udp.example.com", srv);
+      resip_assert(srv.mSrvs.size() == 2);
+      for (vector<DnsSrvRecord>::const_iterator it = srv.mSrvs.begin(); it != srv.mSrvs.end(); ++it)
+      {
+         // the restored vip moves sip2 to the front
+         if (it->target() == "sip2.example.com")
+         {
+            resip_assert(it->port() == 5070);
+            resip_assert(it->priority() == 10);
+         }
+         else
+         {
+            resip_assert(it->target() == "sip1.example.com");
+            resip_assert(it->port() == 5060);
+            resip_assert(it->priority() == 11);
+         }
+      }
+
+      TestDnsSink naptr;
+      resolve<RR_NAPTR>(stub, "example.com", naptr);
+      resip_assert(naptr.mNaptrs.size() == 2);
+      for (vector<DnsNaptrRecord>::const_iterator it = naptr.mNaptrs.begin(); it != naptr.mNaptrs.end(); ++it)
+      {
+         if (it->order() == 10)
+         {
+            resip_assert(it->flags() == "s");
+            resip_assert(it->service() == "SIP+D2U");
+            resip_assert(it->replacement() == "_sip._udp.example.com");
+         }
+         else
+         {
+            resip_assert(it->order() == 20);
+            resip_assert(it->service() == "E2U+sip");
+            resip_assert(it->regexp().regexp() == "^.*$");
+            resip_assert(it->regexp().replacement() == "sip:info@example.com");
+            resip_assert(it->replacement().empty());
+         }
+      }
+      resip_assert(server.queries() == 4);
+
+      resip_assert(resolveA(stub, "short.example.com") == "192.0.2.2");
+      resip_assert(server.queries("short.example.com", T_A) == 2);
+      resip_assert(server.queries() == 5);
+
+      // and it is saved again every second
+      ::remove(SnapshotFile);
+      runFor(stub, 1500);
+      resip_assert(fileExists(SnapshotFile));
+   }
+
+   // a file that is not a snapshot is ignored
+   {
+      ofstream file(SnapshotFile, ios_base::out | ios_base::trunc);
+      file << "not a snapshot";
+   }
+   {
+      DnsStub stub(nameservers);
+      stub.setDnsCacheSnapshot(SnapshotFile, 0);
+      runFor(stub, 10);
+      resip_assert(resolveA(stub, "long.example.com") == "192.0.2.1");
+      resip_assert(server.queries() == 6);
+      stub.setDnsCacheSnapshot(Data::Empty, 0);
+      runFor(stub, 10);
+   }
+
+   ::remove(SnapshotFile);
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
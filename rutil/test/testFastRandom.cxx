@@ -0,0 +1,198 @@
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "rutil/Random.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+// Compares the per-thread Random::getFastRandomHex() with the shared
+// Random::getRandomHex() as the number of threads generating identifiers
+// goes from 1 to 16, and checks that the identifiers handed out to
+// different threads never collide.
+
+using namespace resip;
+using namespace std;
+
+class HexThread : public ThreadIf
+{
+   public:
+      HexThread(bool fast, unsigned int calls, bool keep) :
+         mFast(fast),
+         mCalls(calls),
+         mKeep(keep)
+      {}
+
+      virtual void thread()
+      {
+         for(unsigned int i=0; i<mCalls; ++i)
+         {
+            Data id(mFast ? Random::getFastRandomHex(8) : Random::getRandomHex(8));
+            if(mKeep)
+            {
+               mIds.push_back(id);
+            }
+         }
+      }
+
+      vector<Data> mIds;
+
+   private:
+      const bool mFast;
+      const unsigned int mCalls;
+      const bool mKeep;
+};
+
+// ids/s over all threads
+static double
+run(bool fast, unsigned int numThreads, unsigned int callsPerThread)
+{
+   vector<HexThread*> threads;
+   for(unsigned int i=0; i<numThreads; ++i)
+   {
+      threads.push_back(new HexThread(fast, callsPerThread, false));
+   }
+   UInt64 begin = Timer::getTimeMicroSec();
+   for(unsigned int i=0; i<numThreads; ++i)
+   {
+      threads[i]->run();
+   }
+   for(unsigned int i=0; i<numThreads; ++i)
+   {
+      threads[i]->join();
+      delete threads[i];
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - begin;
+   return elapsed ? (double)numThreads*callsPerThread*1000000.0/(double)elapsed : 0;
+}
+
+static void
+checkFormat()
+{
+   for(unsigned int len=1; len<=Random::maxLength; len+=7)
+   {
+      Data id(Random::getFastRandomHex(len));
+      resip_assert(id.size() == 2*len);
+      for(Data::size_type i=0; i<id.size(); ++i)
+      {
+         resip_assert(isxdigit((unsigned char)id[i]));
+      }
+   }
+
+   // crude sanity check on the bits: each of the 64 bit positions should be
+   // set about half the time
+   unsigned int counts[64] = {0};
+   const unsigned int samples = 100000;
+   for(unsigned int i=0; i<samples; ++i)
+   {
+      UInt64 r = Random::getFastRandom();
+      for(int b=0; b<64; ++b)
+      {
+         counts[b] += (r >> b) & 1;
+      }
+   }
+   for(int b=0; b<64; ++b)
+   {
+      resip_assert(counts[b] > samples*45/100 && counts[b] < samples*55/100);
+   }
+   cout << "format OK" << endl;
+}
+
+static void
+checkNoDuplicates(unsigned int numThreads, unsigned int callsPerThread)
+{
+   vector<HexThread*> threads;
+   for(unsigned int i=0; i<numThreads; ++i)
+   {
+      threads.push_back(new HexThread(true, callsPerThread, true));
+      threads.back()->run();
+   }
+   set<Data> all;
+   for(unsigned int i=0; i<numThreads; ++i)
+   {
+      threads[i]->join();
+      all.insert(threads[i]->mIds.begin(), threads[i]->mIds.end());
+      delete threads[i];
+   }
+   resip_assert(all.size() == (size_t)numThreads*callsPerThread);
+   cout << "no duplicates among " << all.size() << " ids from "
+        << numThreads << " threads" << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+   unsigned int callsPerThread = 200000;
+   if(argc > 1)
+   {
+      callsPerThread = atoi(argv[1]);
+   }
+
+   Random::initialize();
+   checkFormat();
+   checkNoDuplicates(16, 20000);
+
+   for(unsigned int numThreads=1; numThreads<=16; numThreads*=2)
+   {
+      double shared = run(false, numThreads, callsPerThread);
+      double fast = run(true, numThreads, callsPerThread);
+      cout << numThreads << " threads: getRandomHex(8) " << (unsigned long)shared
+           << "/s, getFastRandomHex(8) " << (unsigned long)fast << "/s" << endl;
+   }
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
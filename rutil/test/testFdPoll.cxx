@@ -0,0 +1,611 @@
+#include <iostream>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+
+#include "rutil/FdPoll.hxx"
+#include "rutil/Socket.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/ParseBuffer.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+// Drives every FdPollGrp implementation built into this tree through the
+// same add/mod/del sequence over loopback UDP sockets, checks the queued
+// receives and sends of those that support submitIo(), then reports how many
+// ping-pong events each one processes per second.
+
+using namespace resip;
+using namespace std;
+
+static Socket
+makeUdpSocket(sockaddr_in& addr)
+{
+   Socket fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+   resip_assert(fd != INVALID_SOCKET);
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   int rc = ::bind(fd, (sockaddr*)&addr, sizeof(addr));
+   resip_assert(rc == 0);
+   socklen_t len = sizeof(addr);
+   rc = ::getsockname(fd, (sockaddr*)&addr, &len);
+   resip_assert(rc == 0);
+   bool ok = makeSocketNonBlocking(fd);
+   resip_assert(ok);
+   return fd;
+}
+
+class Endpoint : public FdPollItemIf
+{
+   public:
+      Endpoint(FdPollGrp& grp, FdPollEventMask mask)
+         : mGrp(grp), mHandle(0), mReads(0), mWrites(0), mDatagrams(0),
+           mPeer(0), mPingPongs(0), mDelSelf(false)
+      {
+         mFd = makeUdpSocket(mAddr);
+         mHandle = mGrp.addPollItem(mFd, mask, this);
+      }
+      virtual ~Endpoint()
+      {
+         if(mHandle)
+         {
+            mGrp.delPollItem(mHandle);
+         }
+         closeSocket(mFd);
+      }
+
+      void sendTo(const Endpoint& other)
+      {
+         char c = 'x';
+         ssize_t sent = ::sendto(mFd, &c, 1, 0, (const sockaddr*)&other.mAddr, sizeof(other.mAddr));
+         resip_assert(sent == 1);
+      }
+
+      void mod(FdPollEventMask mask)
+      {
+         mGrp.modPollItem(mHandle, mask);
+      }
+
+      virtual void processPollEvent(FdPollEventMask mask)
+      {
+         resip_assert(!(mask & FPEM_Error));
+         if(mask & FPEM_Write)
+         {
+            ++mWrites;
+         }
+         if(mask & FPEM_Read)
+         {
+            ++mReads;
+            char buf[16];
+            while(::recv(mFd, buf, sizeof(buf), 0) > 0)
+            {
+               ++mDatagrams;
+               if(mPeer && mPingPongs)
+               {
+                  --mPingPongs;
+                  sendTo(*mPeer);
+               }
+            }
+         }
+         if(mDelSelf)
+         {
+            mGrp.delPollItem(mHandle);
+            mHandle = 0;
+         }
+      }
+
+      FdPollGrp& mGrp;
+      Socket mFd;
+      sockaddr_in mAddr;
+      FdPollItemHandle mHandle;
+      unsigned int mReads;
+      unsigned int mWrites;
+      unsigned int mDatagrams;
+      Endpoint* mPeer;
+      unsigned int mPingPongs;
+      bool mDelSelf;
+};
+
+// Polls until the predicate holds or a second passes.
+template<class Pred>
+static bool
+pollUntil(FdPollGrp& grp, Pred pred)
+{
+   UInt64 end = Timer::getTimeMs() + 1000;
+   while(!pred())
+   {
+      if(Timer::getTimeMs() > end)
+      {
+         return false;
+      }
+      grp.waitAndProcess(10);
+   }
+   return true;
+}
+
+struct ReadsAtLeast
+{
+   ReadsAtLeast(const Endpoint& e, unsigned int n) : mE(e), mN(n) {}
+   bool operator()() const { return mE.mDatagrams >= mN; }
+   const Endpoint& mE;
+   unsigned int mN;
+};
+
+struct WritesAtLeast
+{
+   WritesAtLeast(const Endpoint& e, unsigned int n) : mE(e), mN(n) {}
+   bool operator()() const { return mE.mWrites >= mN; }
+   const Endpoint& mE;
+   unsigned int mN;
+};
+
+static void
+checkSemantics(const char* impl)
+{
+   FdPollGrp* grp = FdPollGrp::create(impl);
+   resip_assert(grp);
+   resip_assert(Data(grp->getImplName()) == impl);
+
+   // Nothing registered, so this must time out.
+   UInt64 begin = Timer::getTimeMs();
+   grp->waitAndProcess(50);
+   resip_assert(Timer::getTimeMs() >= begin + 40);
+
+   {
+      Endpoint a(*grp, FPEM_Read);
+      Endpoint b(*grp, FPEM_Read);
+
+      // Level triggered read interest survives being reported.
+      for(int i=0; i<3; ++i)
+      {
+         b.sendTo(a);
+         resip_assert(pollUntil(*grp, ReadsAtLeast(a, i+1)));
+      }
+      resip_assert(b.mReads == 0);
+      resip_assert(a.mWrites == 0);
+
+      // Once drained, nothing is reported.
+      unsigned int reads = a.mReads;
+      grp->waitAndProcess(20);
+      resip_assert(a.mReads == reads);
+
+      // Adding write interest reports writability immediately and keeps
+      // reporting it.
+      a.mod(FPEM_Read|FPEM_Write);
+      resip_assert(pollUntil(*grp, WritesAtLeast(a, 2)));
+      a.mod(FPEM_Read);
+      grp->waitAndProcess(0);
+      unsigned int writes = a.mWrites;
+      grp->waitAndProcess(20);
+      resip_assert(a.mWrites == writes);
+
+      // Read interest is still in place after the mods.
+      b.sendTo(a);
+      resip_assert(pollUntil(*grp, ReadsAtLeast(a, 4)));
+
+      // An empty mask silences the item without removing it.
+      a.mod(0);
+      b.sendTo(a);
+      reads = a.mReads;
+      grp->waitAndProcess(20);
+      resip_assert(a.mReads == reads);
+      a.mod(FPEM_Read);
+      resip_assert(pollUntil(*grp, ReadsAtLeast(a, 5)));
+   }
+
+   {
+      // An item that removes itself from its own callback, next to another
+      // ready item, and a new item that reuses the descriptor right away.
+      Endpoint a(*grp, FPEM_Read);
+      Endpoint b(*grp, FPEM_Read);
+      Endpoint c(*grp, FPEM_Read);
+      a.mDelSelf = true;
+      c.sendTo(a);
+      c.sendTo(b);
+      resip_assert(pollUntil(*grp, ReadsAtLeast(b, 1)));
+      resip_assert(pollUntil(*grp, ReadsAtLeast(a, 1)));
+      resip_assert(a.mHandle == 0);
+
+      Socket oldFd = a.mFd;
+      closeSocket(a.mFd);
+      a.mFd = makeUdpSocket(a.mAddr);
+      if(a.mFd == oldFd)
+      {
+         Endpoint* reuse = &a;
+         reuse->mDelSelf = false;
+         reuse->mHandle = grp->addPollItem(reuse->mFd, FPEM_Read, reuse);
+         unsigned int before = reuse->mDatagrams;
+         c.sendTo(*reuse);
+         resip_assert(pollUntil(*grp, ReadsAtLeast(*reuse, before+1)));
+      }
+   }
+
+   delete grp;
+   cout << impl << ": semantics OK" << endl;
+}
+
+// Queues its receives and sends on the group instead of polling.
+class IoEndpoint : public FdPollItemIf
+{
+   public:
+      enum { Depth = 4 };
+
+      IoEndpoint(FdPollGrp& grp)
+         : mGrp(grp), mReceived(0), mSent(0), mCancelled(0), mDel(0)
+      {
+         mFd = makeUdpSocket(mAddr);
+         mHandle = mGrp.addPollItem(mFd, 0, this);
+         for(int i=0; i<Depth; ++i)
+         {
+            setHdr(mRxHdr[i], mRxIov[i], mRxBuf[i], sizeof(mRxBuf[i]), 0);
+            mRx[i].mOp = FPEM_Read;
+            mRx[i].mHdr = &mRxHdr[i];
+            bool ok = mGrp.submitIo(mHandle, mRx[i]);
+            resip_assert(ok);
+         }
+      }
+      virtual ~IoEndpoint()
+      {
+         mGrp.delPollItem(mHandle);
+         closeSocket(mFd);
+      }
+
+      void sendTo(const IoEndpoint& other)
+      {
+         static char c = 'x';
+         setHdr(mTxHdr, mTxIov, &c, 1, &other.mAddr);
+         mTx.mOp = FPEM_Write;
+         mTx.mHdr = &mTxHdr;
+         bool ok = mGrp.submitIo(mHandle, mTx);
+         resip_assert(ok);
+      }
+
+      virtual void processPollEvent(FdPollEventMask mask)
+      {
+         resip_assert(0);     // nothing to poll for
+      }
+
+      virtual void processIoCompletion(FdPollIo& io)
+      {
+         if(io.mResult == -ECANCELED)
+         {
+            ++mCancelled;
+            return;
+         }
+         if(io.mOp == FPEM_Write)
+         {
+            resip_assert(&io == &mTx && io.mResult == 1);
+            ++mSent;
+            return;
+         }
+         resip_assert(io.mResult == 1);
+         int i = (int)(&io - mRx);
+         resip_assert(i >= 0 && i < Depth && mRxBuf[i][0] == 'x');
+         ++mReceived;
+         if(mDel)
+         {
+            delete mDel;
+            mDel = 0;
+         }
+         mRxBuf[i][0] = 0;
+         // refused once the group has fallen back to polling
+         bool ok = mGrp.submitIo(mHandle, io);
+         resip_assert(ok || !mGrp.canSubmitIo());
+      }
+
+      static void setHdr(msghdr& hdr, iovec& iov, char* buf, size_t len,
+                         const sockaddr_in* to)
+      {
+         iov.iov_base = buf;
+         iov.iov_len = len;
+         memset(&hdr, 0, sizeof(hdr));
+         hdr.msg_name = (void*)to;
+         hdr.msg_namelen = to ? sizeof(*to) : 0;
+         hdr.msg_iov = &iov;
+         hdr.msg_iovlen = 1;
+      }
+
+      FdPollGrp& mGrp;
+      Socket mFd;
+      sockaddr_in mAddr;
+      FdPollItemHandle mHandle;
+      FdPollIo mRx[Depth];
+      msghdr mRxHdr[Depth];
+      iovec mRxIov[Depth];
+      char mRxBuf[Depth][16];
+      FdPollIo mTx;
+      msghdr mTxHdr;
+      iovec mTxIov;
+      unsigned int mReceived;
+      unsigned int mSent;
+      unsigned int mCancelled;
+      IoEndpoint* mDel;       // deleted from the next receive
+};
+
+struct ReceivedAtLeast
+{
+   ReceivedAtLeast(const IoEndpoint& e, unsigned int n) : mE(e), mN(n) {}
+   bool operator()() const { return mE.mReceived >= mN; }
+   const IoEndpoint& mE;
+   unsigned int mN;
+};
+
+struct StoppedSubmitIo
+{
+   StoppedSubmitIo(const FdPollGrp& grp) : mGrp(grp) {}
+   bool operator()() const { return !mGrp.canSubmitIo(); }
+   const FdPollGrp& mGrp;
+};
+
+// Points the descriptor of our io_uring instance at /dev/null, so that the
+// next io_uring_enter() fails for good.
+static bool
+breakRing()
+{
+   DIR* dir = opendir("/proc/self/fd");
+   if(!dir)
+   {
+      return false;
+   }
+   bool found = false;
+   struct dirent* entry;
+   while(!found && (entry = readdir(dir)) != 0)
+   {
+      char path[300];
+      char target[64];
+      snprintf(path, sizeof(path), "/proc/self/fd/%s", entry->d_name);
+      ssize_t len = readlink(path, target, sizeof(target)-1);
+      if(len > 0)
+      {
+         target[len] = 0;
+         if(strcmp(target, "anon_inode:[io_uring]") == 0)
+         {
+            int null = open("/dev/null", O_RDONLY);
+            found = dup2(null, atoi(entry->d_name)) >= 0;
+            close(null);
+         }
+      }
+   }
+   closedir(dir);
+   return found;
+}
+
+static void
+checkSubmitIo(const char* impl)
+{
+   FdPollGrp* grp = FdPollGrp::create(impl);
+   resip_assert(grp);
+   if(!grp->canSubmitIo())
+   {
+      {
+         Endpoint a(*grp, FPEM_Read);
+         FdPollIo io;
+         resip_assert(!grp->submitIo(a.mHandle, io));
+      }
+      delete grp;
+      return;
+   }
+
+   {
+      IoEndpoint a(*grp);
+      IoEndpoint b(*grp);
+
+      // Sends and receives queued together complete in one wait.
+      for(int i=0; i<3; ++i)
+      {
+         b.sendTo(a);
+         resip_assert(pollUntil(*grp, ReceivedAtLeast(a, i+1)));
+         resip_assert(b.mSent == (unsigned int)i+1);
+      }
+      resip_assert(b.mReceived == 0);
+
+      // More datagrams than queued receives; each receive is queued again
+      // as it is reported.
+      Endpoint c(*grp, 0);
+      for(int i=0; i<IoEndpoint::Depth*2; ++i)
+      {
+         ssize_t sent = ::sendto(c.mFd, "x", 1, 0, (const sockaddr*)&a.mAddr, sizeof(a.mAddr));
+         resip_assert(sent == 1);
+      }
+      resip_assert(pollUntil(*grp, ReceivedAtLeast(a, 3+IoEndpoint::Depth*2)));
+   }
+
+   {
+      // Deleting an item from another one's completion, when its own
+      // receive may have completed in the same wait: that is not reported.
+      IoEndpoint a(*grp);
+      a.mDel = new IoEndpoint(*grp);
+      Endpoint c(*grp, 0);
+      ssize_t sent = ::sendto(c.mFd, "x", 1, 0, (const sockaddr*)&a.mAddr, sizeof(a.mAddr));
+      resip_assert(sent == 1);
+      sent = ::sendto(c.mFd, "x", 1, 0, (const sockaddr*)&a.mDel->mAddr, sizeof(a.mAddr));
+      resip_assert(sent == 1);
+      resip_assert(pollUntil(*grp, ReceivedAtLeast(a, 1)));
+      resip_assert(a.mDel == 0);
+      grp->waitAndProcess(20);
+
+      // Deleted with receives outstanding; they are cancelled.
+      IoEndpoint* b = new IoEndpoint(*grp);
+      grp->waitAndProcess(0);
+      delete b;
+      grp->waitAndProcess(20);
+   }
+   delete grp;
+
+   grp = FdPollGrp::create(impl);
+   {
+      // When the ring fails the group carries on through epoll: new
+      // requests are refused, and readiness is reported as before. This
+      // ring will not even take the cancellations, so the queued receives
+      // still own their buffers; they are only reported once they really
+      // complete, never as cancelled.
+      IoEndpoint a(*grp);
+      Endpoint b(*grp, FPEM_Read);
+      grp->waitAndProcess(0);
+      resip_assert(breakRing());
+      resip_assert(pollUntil(*grp, StoppedSubmitIo(*grp)));
+      b.sendTo(b);
+      resip_assert(pollUntil(*grp, ReadsAtLeast(b, 1)));
+      resip_assert(a.mCancelled == 0 && a.mReceived == 0);
+      Endpoint c(*grp, 0);
+      for(int i=0; i<IoEndpoint::Depth; ++i)
+      {
+         ssize_t sent = ::sendto(c.mFd, "x", 1, 0, (const sockaddr*)&a.mAddr, sizeof(a.mAddr));
+         resip_assert(sent == 1);
+      }
+      resip_assert(pollUntil(*grp, ReceivedAtLeast(a, IoEndpoint::Depth)));
+      resip_assert(a.mCancelled == 0);
+   }
+   delete grp;
+   cout << impl << ": submitIo OK" << endl;
+}
+
+static void
+measure(const char* impl, unsigned int pingPongs)
+{
+   FdPollGrp* grp = FdPollGrp::create(impl);
+   resip_assert(grp);
+
+   // A few idle sockets so the poll set is not trivially small.
+   vector<Endpoint*> idle;
+   for(int i=0; i<64; ++i)
+   {
+      idle.push_back(new Endpoint(*grp, FPEM_Read));
+   }
+
+   {
+      Endpoint a(*grp, FPEM_Read);
+      Endpoint b(*grp, FPEM_Read);
+      a.mPeer = &b;
+      b.mPeer = &a;
+      a.mPingPongs = pingPongs/2;
+      b.mPingPongs = pingPongs - pingPongs/2;
+
+      UInt64 begin = Timer::getTimeMicroSec();
+      a.sendTo(b);
+      UInt64 end = Timer::getTimeMs() + 10000;
+      while((a.mPingPongs || b.mPingPongs) && Timer::getTimeMs() < end)
+      {
+         grp->waitAndProcess(100);
+      }
+      UInt64 elapsed = Timer::getTimeMicroSec() - begin;
+      resip_assert(a.mPingPongs == 0 && b.mPingPongs == 0);
+
+      cout << impl << ": " << pingPongs << " ping-pongs, events/s="
+           << (elapsed ? (double)(a.mReads + b.mReads) * 1000000.0 / (double)elapsed : 0)
+           << endl;
+   }
+
+   for(vector<Endpoint*>::iterator i=idle.begin(); i!=idle.end(); ++i)
+   {
+      delete *i;
+   }
+   delete grp;
+}
+
+int
+main(int argc, char** argv)
+{
+   unsigned int pingPongs = 20000;
+   if(argc > 1)
+   {
+      pingPongs = atoi(argv[1]);
+   }
+
+   vector<Data> impls;
+   Data list(FdPollGrp::getImplList());
+   ParseBuffer pb(list);
+   while(!pb.eof())
+   {
+      const char* start = pb.position();
+      pb.skipToChar('|');
+      Data name;
+      pb.data(name, start);
+      if(!pb.eof())
+      {
+         pb.skipChar();
+      }
+      // "event" is an alias for the default implementation.
+      if(name != "event")
+      {
+         impls.push_back(name);
+      }
+   }
+
+   for(vector<Data>::iterator i=impls.begin(); i!=impls.end(); ++i)
+   {
+      FdPollGrp* grp = FdPollGrp::create(i->c_str());
+      bool fellBack = Data(grp->getImplName()) != *i;
+      delete grp;
+      if(fellBack)
+      {
+         // Only uring can fall back, when the kernel lacks support.
+         cout << *i << ": not supported by this kernel, skipped" << endl;
+         continue;
+      }
+      checkSemantics(i->c_str());
+      checkSubmitIo(i->c_str());
+      measure(i->c_str(), pingPongs);
+   }
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,281 @@
+#include <iostream>
+#include <vector>
+
+#include "rutil/Fifo.hxx"
+#include "rutil/TimeLimitFifo.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+// Measures multi-producer/single-consumer throughput of Fifo (mutex), 
+// Fifo in lock-free mode, and TimeLimitFifo, and checks that the lock-free
+// mode preserves per-producer ordering and loses nothing.
+
+using namespace resip;
+using namespace std;
+
+class Item
+{
+   public:
+      Item(unsigned int producer, unsigned int seq)
+         : mProducer(producer),
+           mSeq(seq)
+      {}
+
+      unsigned int mProducer;
+      unsigned int mSeq;
+};
+
+class FifoProducer : public ThreadIf
+{
+   public:
+      FifoProducer(Fifo<Item>& fifo, unsigned int id, unsigned int count, unsigned int batch)
+         : mFifo(fifo), mId(id), mCount(count), mBatch(batch)
+      {}
+
+      virtual void thread()
+      {
+         Fifo<Item>::Messages batch;
+         for(unsigned int i=0; i<mCount; ++i)
+         {
+            if(mBatch <= 1)
+            {
+               mFifo.add(new Item(mId, i));
+               continue;
+            }
+            batch.push_back(new Item(mId, i));
+            if(batch.size() >= mBatch || i+1 == mCount)
+            {
+               mFifo.addMultiple(batch);
+            }
+         }
+      }
+
+   private:
+      Fifo<Item>& mFifo;
+      unsigned int mId;
+      unsigned int mCount;
+      unsigned int mBatch;
+};
+
+class TimeLimitProducer : public ThreadIf
+{
+   public:
+      TimeLimitProducer(TimeLimitFifo<Item>& fifo, unsigned int id, unsigned int count)
+         : mFifo(fifo), mId(id), mCount(count)
+      {}
+
+      virtual void thread()
+      {
+         for(unsigned int i=0; i<mCount; ++i)
+         {
+            mFifo.add(new Item(mId, i), TimeLimitFifo<Item>::InternalElement);
+         }
+      }
+
+   private:
+      TimeLimitFifo<Item>& mFifo;
+      unsigned int mId;
+      unsigned int mCount;
+};
+
+static void
+checkItem(Item* item, vector<unsigned int>& nextSeq)
+{
+   resip_assert(item);
+   resip_assert(item->mProducer < nextSeq.size());
+   resip_assert(item->mSeq == nextSeq[item->mProducer]);
+   ++nextSeq[item->mProducer];
+   delete item;
+}
+
+static void
+runFifo(bool lockFree, unsigned int producers, unsigned int perProducer, unsigned int batch)
+{
+   Fifo<Item> fifo;
+   fifo.setLockFree(lockFree);
+   vector<unsigned int> nextSeq(producers, 0);
+   vector<FifoProducer*> threads;
+
+   UInt64 start = Timer::getTimeMicroSec();
+   for(unsigned int p=0; p<producers; ++p)
+   {
+      threads.push_back(new FifoProducer(fifo, p, perProducer, batch));
+      threads.back()->run();
+   }
+
+   // Alternate between the single and bulk get paths, the way 
+   // ConsumerFifoBuffer and the stack threads do.
+   unsigned int total = producers*perProducer;
+   unsigned int received = 0;
+   Fifo<Item>::Messages bulk;
+   while(received < total)
+   {
+      if(received % 2)
+      {
+         checkItem(fifo.getNext(), nextSeq);
+         ++received;
+      }
+      else if(fifo.getMultiple(100, bulk, 8))
+      {
+         while(!bulk.empty())
+         {
+            checkItem(bulk.front(), nextSeq);
+            bulk.pop_front();
+            ++received;
+         }
+      }
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - start;
+
+   for(unsigned int p=0; p<producers; ++p)
+   {
+      threads[p]->join();
+      delete threads[p];
+   }
+
+   resip_assert(fifo.empty());
+   resip_assert(fifo.size() == 0);
+   resip_assert(fifo.getNext(-1) == 0);
+   for(unsigned int p=0; p<producers; ++p)
+   {
+      resip_assert(nextSeq[p] == perProducer);
+   }
+
+   cout << (lockFree ? "lock-free Fifo " : "Fifo           ")
+        << " producers=" << producers 
+        << " batch=" << batch
+        << " msgs/s=" << (elapsed ? (UInt64)total*1000000/elapsed : 0) << endl;
+}
+
+static void
+runTimeLimitFifo(unsigned int producers, unsigned int perProducer)
+{
+   TimeLimitFifo<Item> fifo(0, 0);
+   vector<unsigned int> nextSeq(producers, 0);
+   vector<TimeLimitProducer*> threads;
+
+   UInt64 start = Timer::getTimeMicroSec();
+   for(unsigned int p=0; p<producers; ++p)
+   {
+      threads.push_back(new TimeLimitProducer(fifo, p, perProducer));
+      threads.back()->run();
+   }
+
+   unsigned int total = producers*perProducer;
+   for(unsigned int received=0; received < total; ++received)
+   {
+      checkItem(fifo.getNext(), nextSeq);
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - start;
+
+   for(unsigned int p=0; p<producers; ++p)
+   {
+      threads[p]->join();
+      delete threads[p];
+   }
+   resip_assert(fifo.empty());
+
+   cout << "TimeLimitFifo  " 
+        << " producers=" << producers 
+        << " batch=1"
+        << " msgs/s=" << (elapsed ? (UInt64)total*1000000/elapsed : 0) << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+   unsigned int perProducer = 50000;
+   if(argc > 1)
+   {
+      perProducer = atoi(argv[1]);
+   }
+
+   {
+      // Interruptor semantics depend on add() reporting the empty->non-empty
+      // transition, so check the returned sizes in lock-free mode.
+      Fifo<Item> fifo;
+      fifo.setLockFree(true);
+      resip_assert(fifo.isLockFree());
+      resip_assert(fifo.add(new Item(0, 0)) == 1);
+      resip_assert(fifo.add(new Item(0, 1)) == 2);
+      resip_assert(fifo.size() == 2);
+      resip_assert(fifo.messageAvailable());
+      Fifo<Item>::Messages batch;
+      batch.push_back(new Item(0, 2));
+      batch.push_back(new Item(0, 3));
+      resip_assert(fifo.addMultiple(batch) == 4);
+      resip_assert(batch.empty());
+      delete fifo.getNext(-1);
+      resip_assert(fifo.getCountDepth() == 3);
+      fifo.clear();
+      resip_assert(fifo.empty());
+      resip_assert(fifo.getNext(10) == 0);
+      resip_assert(fifo.add(new Item(0, 4)) == 1);
+      // remaining item is released by ~Fifo
+   }
+
+   const unsigned int producerCounts[] = { 1, 2, 4, 8 };
+   for(unsigned int i=0; i<sizeof(producerCounts)/sizeof(producerCounts[0]); ++i)
+   {
+      unsigned int producers = producerCounts[i];
+      runTimeLimitFifo(producers, perProducer);
+      runFifo(false, producers, perProducer, 1);
+      runFifo(true, producers, perProducer, 1);
+      runFifo(false, producers, perProducer, 16);
+      runFifo(true, producers, perProducer, 16);
+   }
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
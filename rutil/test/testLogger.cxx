@@ -3,6 +3,10 @@
 #include "rutil/Data.hxx"
 #include "rutil/ThreadIf.hxx"
 #include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+#include <fstream>
+#include <string>
 
 #include "TestSubsystemLogLevel.hxx"
 #include "rutil/WinLeakCheck.hxx"
@@ -76,6 +80,72 @@ class TestExternalLogger : public ExternalLogger
       }
 };
 
+class BurstThread : public ThreadIf
+{
+   public:
+      BurstThread(int count) : mCount(count) {}
+
+      void thread()
+      {
+         for (int i = 0; i < mCount; ++i)
+         {
+            InfoLog(<< "async record " << i);
+         }
+      }
+   private:
+      int mCount;
+};
+
+void
+testAsyncWriter(const char *appname)
+{
+   const char* fileName = "testLoggerAsync.txt";
+   remove(fileName);
+   Log::initialize(Log::File, Log::Info, appname, fileName);
+   Log::startAsyncWriter(64);
+   resip_assert(Log::isAsync());
+
+   const int threads = 4;
+   const int perThread = 5000;
+   BurstThread* bursts[threads];
+   for (int i = 0; i < threads; ++i)
+   {
+      bursts[i] = new BurstThread(perThread);
+      bursts[i]->run();
+   }
+   for (int i = 0; i < threads; ++i)
+   {
+      bursts[i]->join();
+      delete bursts[i];
+   }
+   Log::stopAsyncWriter();
+   resip_assert(!Log::isAsync());
+
+   // Every record was either written or counted as dropped.
+   int written = 0;
+   int reports = 0;
+   std::ifstream in(fileName);
+   std::string line;
+   while (std::getline(in, line))
+   {
+      if (line.find("async record") != std::string::npos)
+      {
+         ++written;
+      }
+      else if (line.find("dropped") != std::string::npos)
+      {
+         ++reports;
+      }
+   }
+   UInt64 dropped = Log::getDroppedRecordCount();
+   cout << "async writer: " << written << " written, " << dropped << " dropped" << endl;
+   resip_assert(written + dropped == (UInt64)(threads*perThread));
+   resip_assert(dropped == 0 || reports > 0);
+
+   Log::initialize(Log::Cout, Log::Info, appname);
+   remove(fileName);
+}
+
 void
 testThreadLocalLoggers(const char *appname)
 {
@@ -248,6 +318,8 @@ main(int argc, char* argv[])
    cout << endl;
    testThreadLocalLoggers(argv[0]);
 
+   testAsyncWriter(argv[0]);
+
    return 0;
 }
 
@@ -0,0 +1,341 @@
+#include <iostream>
+#include <map>
+#include <vector>
+#include <cstdlib>
+
+#include "rutil/OpenHashTable.hxx"
+#include "rutil/HashMap.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Random.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/ResipAssert.h"
+
+// Checks OpenHashTable against std::map under a random mix of operations,
+// then compares it with the HashMap<Data, T*> layout TransactionMap used to
+// have, at 100k and 1M live entries keyed by branch-like ids.
+
+using namespace resip;
+using namespace std;
+
+class Entry
+{
+   public:
+      Entry(const Data& id) : mId(id), mHash(id.caseInsensitiveTokenHash()) {}
+      const Data mId;
+      const size_t mHash;
+};
+
+class EntryTraits
+{
+   public:
+      typedef Data KeyType;
+      static bool matches(const Entry* entry, const Data& key)
+      {
+         return isEqualNoCase(entry->mId, key);
+      }
+};
+
+typedef OpenHashTable<Entry, EntryTraits> Table;
+
+#if defined(HASH_MAP_NAMESPACE)
+class BranchHasher
+{
+   public:
+      size_t operator()(const Data& branch) const
+      {
+         return branch.caseInsensitiveTokenHash();
+      }
+};
+
+class BranchEqual
+{
+   public:
+      bool operator()(const Data& branch1, const Data& branch2) const
+      {
+         return isEqualNoCase(branch1, branch2);
+      }
+};
+typedef HashMap<Data, Entry*, BranchHasher, BranchEqual> OldMap;
+#else
+class BranchCompare
+{
+   public:
+      bool operator()(const Data& branch1, const Data& branch2) const
+      {
+         return isLessThanNoCase(branch1, branch2);
+      }
+};
+typedef std::map<Data, Entry*, BranchCompare> OldMap;
+#endif
+
+static Data
+makeId(unsigned int i)
+{
+   // looks like what the stack generates: magic cookie + random-ish token
+   return Data("z9hG4bK-524287-1---") + Data(i) + "-" + Random::getRandomHex(4);
+}
+
+static double
+rate(size_t count, UInt64 micros)
+{
+   return micros ? (double)count * 1000000.0 / (double)micros : 0;
+}
+
+static void
+checkAgainstMap(unsigned int ops)
+{
+   Table table;
+   map<Data, Entry*> reference;
+   vector<Entry*> live;
+
+   for(unsigned int op=0; op<ops; ++op)
+   {
+      unsigned int r = Random::getRandom() % 10;
+      if(r < 5 || live.empty())
+      {
+         Entry* e = new Entry(makeId(op));
+         resip_assert(!table.find(e->mId, e->mHash));
+         table.insert(e, e->mHash);
+         reference[e->mId] = e;
+         live.push_back(e);
+      }
+      else if(r < 8)
+      {
+         size_t victim = Random::getRandom() % live.size();
+         Entry* e = live[victim];
+         resip_assert(table.erase(e, e->mHash));
+         resip_assert(!table.erase(e, e->mHash));
+         reference.erase(e->mId);
+         live[victim] = live.back();
+         live.pop_back();
+         delete e;
+      }
+      else
+      {
+         Entry* e = live[Random::getRandom() % live.size()];
+         // lookups are case insensitive
+         Data upper(e->mId);
+         upper.uppercase();
+         resip_assert(table.find(upper, upper.caseInsensitiveTokenHash()) == e);
+         Data missing(makeId(ops+op));
+         resip_assert(!table.find(missing, missing.caseInsensitiveTokenHash()));
+      }
+      resip_assert(table.size() == reference.size());
+   }
+
+   // Everything in the reference must be reachable, whether or not a grow
+   // is still in progress.
+   for(map<Data, Entry*>::iterator i=reference.begin(); i!=reference.end(); ++i)
+   {
+      resip_assert(table.find(i->first, i->second->mHash) == i->second);
+   }
+
+   vector<Entry*> entries;
+   table.values(entries);
+   resip_assert(entries.size() == reference.size());
+   for(vector<Entry*>::iterator i=entries.begin(); i!=entries.end(); ++i)
+   {
+      resip_assert(table.erase(*i, (*i)->mHash));
+      delete *i;
+   }
+   resip_assert(table.empty());
+   cout << "table matches std::map over " << ops << " operations" << endl;
+}
+
+static void
+checkIncrementalGrow()
+{
+   Table table(16);
+   vector<Entry*> entries;
+   size_t lastCapacity = table.capacity();
+   bool sawGrow = false;
+   for(unsigned int i=0; i<5000; ++i)
+   {
+      Entry* e = new Entry(makeId(i));
+      entries.push_back(e);
+      table.insert(e, e->mHash);
+      if(table.capacity() != lastCapacity)
+      {
+         // a grow only ever doubles and leaves the old entries in place
+         resip_assert(table.capacity() == lastCapacity*2);
+         resip_assert(table.isGrowing());
+         lastCapacity = table.capacity();
+         sawGrow = true;
+      }
+      for(unsigned int j=(i>64 ? i-64 : 0); j<=i; ++j)
+      {
+         resip_assert(table.find(entries[j]->mId, entries[j]->mHash) == entries[j]);
+      }
+   }
+   resip_assert(sawGrow);
+   for(size_t i=0; i<entries.size(); ++i)
+   {
+      resip_assert(table.find(entries[i]->mId, entries[i]->mHash) == entries[i]);
+      resip_assert(table.erase(entries[i], entries[i]->mHash));
+      delete entries[i];
+   }
+   resip_assert(table.empty());
+   cout << "incremental grow OK" << endl;
+}
+
+static void
+benchmark(unsigned int live)
+{
+   vector<Data> ids;
+   ids.reserve(live*2);
+   for(unsigned int i=0; i<live*2; ++i)
+   {
+      ids.push_back(makeId(i));
+   }
+   vector<Entry*> entries;
+   entries.reserve(live*2);
+   for(unsigned int i=0; i<live*2; ++i)
+   {
+      entries.push_back(new Entry(ids[i]));
+   }
+   // lookups arrive with a freshly parsed tid, not the stored one
+   vector<Data> probes(ids.begin(), ids.begin()+live);
+
+   {
+      OldMap map;
+      UInt64 worst = 0;
+      UInt64 begin = Timer::getTimeMicroSec();
+      UInt64 last = begin;
+      for(unsigned int i=0; i<live; ++i)
+      {
+         map[entries[i]->mId] = entries[i];
+         UInt64 now = Timer::getTimeMicroSec();
+         worst = resipMax(worst, now-last);
+         last = now;
+      }
+      UInt64 inserted = Timer::getTimeMicroSec();
+      unsigned int hits = 0;
+      for(unsigned int i=0; i<live; ++i)
+      {
+         hits += map.find(probes[i]) != map.end();
+      }
+      UInt64 found = Timer::getTimeMicroSec();
+      // steady state: one transaction ends, another starts
+      for(unsigned int i=0; i<live; ++i)
+      {
+         map.erase(entries[i]->mId);
+         map[entries[live+i]->mId] = entries[live+i];
+      }
+      UInt64 churned = Timer::getTimeMicroSec();
+      resip_assert(hits == live);
+      cout << "HashMap      : " << live << " live, insert/s=" << rate(live, inserted-begin)
+           << " worst insert=" << worst << "us"
+           << " find/s=" << rate(live, found-inserted)
+           << " churn/s=" << rate(live, churned-found) << endl;
+   }
+
+   {
+      Table table;
+      UInt64 worst = 0;
+      UInt64 begin = Timer::getTimeMicroSec();
+      UInt64 last = begin;
+      for(unsigned int i=0; i<live; ++i)
+      {
+         table.insert(entries[i], entries[i]->mHash);
+         UInt64 now = Timer::getTimeMicroSec();
+         worst = resipMax(worst, now-last);
+         last = now;
+      }
+      UInt64 inserted = Timer::getTimeMicroSec();
+      unsigned int hits = 0;
+      for(unsigned int i=0; i<live; ++i)
+      {
+         hits += table.find(probes[i], probes[i].caseInsensitiveTokenHash()) != 0;
+      }
+      UInt64 found = Timer::getTimeMicroSec();
+      for(unsigned int i=0; i<live; ++i)
+      {
+         table.erase(entries[i], entries[i]->mHash);
+         table.insert(entries[live+i], entries[live+i]->mHash);
+      }
+      UInt64 churned = Timer::getTimeMicroSec();
+      resip_assert(hits == live);
+      resip_assert(table.size() == live);
+      cout << "OpenHashTable: " << live << " live, insert/s=" << rate(live, inserted-begin)
+           << " worst insert=" << worst << "us"
+           << " find/s=" << rate(live, found-inserted)
+           << " churn/s=" << rate(live, churned-found) << endl;
+   }
+
+   for(size_t i=0; i<entries.size(); ++i)
+   {
+      delete entries[i];
+   }
+}
+
+int
+main(int argc, char** argv)
+{
+   unsigned int maxLive = 1000000;
+   if(argc > 1)
+   {
+      maxLive = atoi(argv[1]);
+   }
+
+   Random::initialize();
+   checkAgainstMap(200000);
+   checkIncrementalGrow();
+
+   for(unsigned int live=100000; live<=maxLive; live*=10)
+   {
+      benchmark(live);
+   }
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0 
+ * 
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ * 
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ * 
+ * ====================================================================
+ * 
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
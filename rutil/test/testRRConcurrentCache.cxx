@@ -0,0 +1,238 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include "rutil/BaseException.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/dns/QueryTypes.hxx"
+#include "rutil/dns/RRCache.hxx"
+
+#ifndef WIN32
+#include <arpa/inet.h>
+#endif
+
+// Checks that RRCache keeps its RRConcurrentCache in step, that readers on
+// other threads only ever see whole answers while the cache is rewritten,
+// and that replaced answers are eventually freed.
+
+using namespace resip;
+using namespace std;
+
+static const unsigned int NumNames = 64;
+
+static in_addr
+address(unsigned int a)
+{
+   in_addr addr;
+   addr.s_addr = htonl(a);
+   return addr;
+}
+
+static Data
+name(unsigned int i)
+{
+   return "host" + Data(i) + ".example.com";
+}
+
+static bool
+lookupA(const RRCache& cache, const Data& target, unsigned int& found)
+{
+   vector<DnsHostRecord> records;
+   int status = -1;
+   if (!cache.concurrentCache().lookup(target, RR_A::getRRType(), records, status))
+   {
+      return false;
+   }
+   resip_assert(status == 0);
+   resip_assert(records.size() == 1);
+   resip_assert(isEqualNoCase(records[0].name(), target));
+   found = ntohl(records[0].addr().s_addr);
+   return true;
+}
+
+class Reader : public ThreadIf
+{
+   public:
+      Reader(const RRCache& cache, const atomic<bool>& done)
+         : mCache(cache), mDone(done), mLookups(0), mHits(0)
+      {}
+
+      virtual void thread()
+      {
+         unsigned int i = 0;
+         while (!mDone.load())
+         {
+            unsigned int found = 0;
+            const unsigned int n = i++ % NumNames;
+            if (lookupA(mCache, name(n), found))
+            {
+               // every version of host<n> maps to (n << 16) + version
+               resip_assert((found >> 16) == n);
+               ++mHits;
+            }
+            ++mLookups;
+         }
+      }
+
+      const RRCache& mCache;
+      const atomic<bool>& mDone;
+      unsigned int mLookups;
+      unsigned int mHits;
+};
+
+static void
+checkUpdates()
+{
+   RRCache cache;
+   unsigned int found = 0;
+
+   cache.updateCacheFromHostFile(DnsHostRecord("a.example.com", address(0x0a000001)));
+   resip_assert(lookupA(cache, "a.example.com", found) && found == 0x0a000001);
+   resip_assert(lookupA(cache, "A.Example.COM", found) && found == 0x0a000001);
+   resip_assert(!lookupA(cache, "b.example.com", found));
+
+   cache.updateCacheFromHostFile(DnsHostRecord("a.example.com", address(0x0a000002)));
+   resip_assert(lookupA(cache, "a.example.com", found) && found == 0x0a000002);
+   resip_assert(cache.concurrentCache().size() == 1);
+
+   // LRU purging withdraws the oldest answers; RRCache keeps one below its
+   // size
+   cache.setSize(4);
+   for (unsigned int i = 0; i < 4; ++i)
+   {
+      cache.updateCacheFromHostFile(DnsHostRecord(name(i), address(i)));
+   }
+   resip_assert(!lookupA(cache, "a.example.com", found));
+   resip_assert(!lookupA(cache, name(0), found));
+   resip_assert(lookupA(cache, name(3), found) && found == 3);
+   resip_assert(cache.concurrentCache().size() == 3);
+
+   cache.clearCache();
+   resip_assert(!lookupA(cache, name(3), found));
+   resip_assert(cache.concurrentCache().size() == 0);
+
+   // nobody is reading, so nothing is left waiting to be freed
+   cache.reclaim();
+   resip_assert(cache.concurrentCache().retired() == 0);
+}
+
+static void
+checkConcurrentReaders()
+{
+   const unsigned int numReaders = 4;
+   const unsigned int updates = 50000;
+
+   RRCache cache;
+   cache.setSize(NumNames * 2);
+   atomic<bool> done(false);
+   vector<Reader*> readers;
+   for (unsigned int r = 0; r < numReaders; ++r)
+   {
+      readers.push_back(new Reader(cache, done));
+      readers.back()->run();
+   }
+
+   size_t maxRetired = 0;
+   UInt64 begin = Timer::getTimeMs();
+   for (unsigned int u = 0; u < updates; ++u)
+   {
+      const unsigned int n = u % NumNames;
+      cache.updateCacheFromHostFile(DnsHostRecord(name(n), address((n << 16) + (u / NumNames) % 0xffff)));
+      if (cache.concurrentCache().retired() > maxRetired)
+      {
+         maxRetired = cache.concurrentCache().retired();
+      }
+   }
+   UInt64 end = Timer::getTimeMs();
+
+   done = true;
+   unsigned int lookups = 0;
+   unsigned int hits = 0;
+   for (unsigned int r = 0; r < numReaders; ++r)
+   {
+      readers[r]->join();
+      lookups += readers[r]->mLookups;
+      hits += readers[r]->mHits;
+      delete readers[r];
+   }
+   resip_assert(hits > 0);
+
+   cache.reclaim();
+   cache.reclaim();
+   resip_assert(cache.concurrentCache().retired() == 0);
+   resip_assert(cache.concurrentCache().size() == NumNames);
+
+   cout << updates << " updates with " << numReaders << " readers in " << (end - begin)
+        << " ms; " << lookups << " lookups (" << hits << " hits), at most "
+        << maxRetired << " answers waiting to be freed" << endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   checkUpdates();
+   checkConcurrentReaders();
+
+   cout << "All OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -245,7 +245,7 @@ SequenceClass::handleEvent(boost::shared_ptr<Event> event)
 #endif
       if (ot && ot->getExpect() == expect)
       {
-         mTimerId=-7;
+         mTimerId=0;
          scheduleTimeout();
          return;
       }
@@ -342,7 +342,7 @@ SequenceClass::removeFromActiveSet()
 
 void SequenceClass::cancelTimeout()
 {
-   if (mTimerId != -7)
+   if (mTimerId != 0)
    {
       InfoLog(<< "SequenceClass::cancelTimeout(" << mTimerId << ") " << this);
       if(!getSequenceSet()->mEventFifo.cancel(mTimerId))
@@ -352,7 +352,7 @@ void SequenceClass::cancelTimeout()
          // was waiting for. It would be nice to figure out a way to fix this.
          resip_assert(0);
       }
-      mTimerId = -7;
+      mTimerId = 0;
    }
 }
 
@@ -388,7 +388,7 @@ void SequenceClass::scheduleTimeout()
 void
 SequenceClass::start()
 {
-   mTimerId = -7;
+   mTimerId = 0;
    addToActiveSet();
    mAction->exec();
 }
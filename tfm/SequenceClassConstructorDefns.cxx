@@ -14,7 +14,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -39,7 +39,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -66,7 +66,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute) 
    {
@@ -95,7 +95,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -126,7 +126,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -159,7 +159,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute) 
    {
@@ -194,7 +194,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -231,7 +231,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -270,7 +270,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -311,7 +311,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -354,7 +354,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -400,7 +400,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -447,7 +447,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -496,7 +496,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -547,7 +547,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -600,7 +600,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -655,7 +655,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -713,7 +713,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -772,7 +772,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -834,7 +834,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -899,7 +899,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -967,7 +967,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -1037,7 +1037,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -1104,7 +1104,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -1208,7 +1208,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -1354,7 +1354,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -1502,7 +1502,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -1652,7 +1652,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -1804,7 +1804,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -1958,7 +1958,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -2114,7 +2114,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -2272,7 +2272,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -2432,7 +2432,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -2594,7 +2594,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -2758,7 +2758,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -2924,7 +2924,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -3092,7 +3092,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -3262,7 +3262,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -3434,7 +3434,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -3608,7 +3608,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -3784,7 +3784,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -3962,7 +3962,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -4142,7 +4142,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -4324,7 +4324,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
@@ -4508,7 +4508,7 @@ SequenceClass::SequenceClass(int lineNumber,
      mBranchCount(0),
      mAfterAction(0),
      mTimingOut(false),
-     mTimerId(-7)
+     mTimerId(0)
 {
    if (execute)
    {
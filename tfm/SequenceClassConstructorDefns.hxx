@@ -15,7 +15,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -40,7 +40,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -67,7 +67,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -96,7 +96,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -127,7 +127,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -160,7 +160,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -195,7 +195,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -232,7 +232,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -271,7 +271,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -312,7 +312,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -355,7 +355,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -400,7 +400,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -447,7 +447,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -496,7 +496,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -547,7 +547,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -600,7 +600,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -655,7 +655,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -712,7 +712,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -771,7 +771,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -832,7 +832,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -895,7 +895,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -960,7 +960,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1027,7 +1027,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1096,7 +1096,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1167,7 +1167,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1240,7 +1240,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1315,7 +1315,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1392,7 +1392,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1471,7 +1471,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1552,7 +1552,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1635,7 +1635,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1720,7 +1720,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1807,7 +1807,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1896,7 +1896,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -1987,7 +1987,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -2080,7 +2080,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -2175,7 +2175,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -2272,7 +2272,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -2371,7 +2371,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -2472,7 +2472,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -2575,7 +2575,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -2680,7 +2680,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -2787,7 +2787,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -2896,7 +2896,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -3007,7 +3007,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -3120,7 +3120,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -3235,7 +3235,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -3352,7 +3352,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -3471,7 +3471,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -3592,7 +3592,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -3715,7 +3715,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -3840,7 +3840,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -3967,7 +3967,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -4096,7 +4096,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -4227,7 +4227,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -4360,7 +4360,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -4495,7 +4495,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -4632,7 +4632,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -4771,7 +4771,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -4912,7 +4912,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -5055,7 +5055,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -5200,7 +5200,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -5347,7 +5347,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -5496,7 +5496,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -5647,7 +5647,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -5800,7 +5800,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -5955,7 +5955,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -6112,7 +6112,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -6271,7 +6271,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -6432,7 +6432,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -6595,7 +6595,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -6760,7 +6760,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -6927,7 +6927,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -7096,7 +7096,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -7267,7 +7267,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -7440,7 +7440,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -7615,7 +7615,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -7792,7 +7792,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -7971,7 +7971,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -8152,7 +8152,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -8335,7 +8335,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -8520,7 +8520,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -8707,7 +8707,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -8896,7 +8896,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -9087,7 +9087,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -9280,7 +9280,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -9475,7 +9475,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -9672,7 +9672,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -9871,7 +9871,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -10072,7 +10072,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -10275,7 +10275,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -10480,7 +10480,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -10687,7 +10687,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -10896,7 +10896,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -11107,7 +11107,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -11320,7 +11320,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -11535,7 +11535,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -11752,7 +11752,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -11971,7 +11971,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -12192,7 +12192,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
@@ -12415,7 +12415,7 @@ SequenceClass::SequenceClass(int lineNumber,
       mBranchCount(0),
       mAfterAction(0),
       mTimingOut(false),
-      mTimerId(-7)
+      mTimerId(0)
 {
    if (execute)
    {
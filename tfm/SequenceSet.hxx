@@ -24,7 +24,7 @@ class SequenceSet
       ~SequenceSet();
 
       void enqueue(boost::shared_ptr<Event> event);
-      long enqueue(boost::shared_ptr<Event> event, int delay);
+      resip::ValueFifo< boost::shared_ptr<Event> >::TimerId enqueue(boost::shared_ptr<Event> event, int delay);
       void globalFailure(const resip::Data& message);
       void globalFailure(resip::BaseException& e);
       bool executionFailed() const;